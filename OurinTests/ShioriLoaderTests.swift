@@ -1214,9 +1214,215 @@ struct ShioriLoaderTests {
         #expect(resp?["value"] as? String == snapshot)
     }
 
+    /// SAVEVAR のバイナリスナップショットを別プロセスの RESTOREVAR で読み戻せること、従来の JSON
+    /// 形式の保存ファイルも読めること、壊れたファイル（途中で切れた・レコード数が大きすぎる）は
+    /// 変数に触れずに 0 を返すことを検証する。
+    @Test
+    func yayaCoreSaveVarRestoreVarSnapshot() throws {
+        guard let exe = Self.locateYayaCore() else {
+            print("[skip] yaya_core not found; skipping C++ parser integration test")
+            return
+        }
+        let ghost = URL(fileURLWithPath: NSTemporaryDirectory()).appendingPathComponent(UUID().uuidString)
+        try FileManager.default.createDirectory(at: ghost, withIntermediateDirectories: true)
+        defer { try? FileManager.default.removeItem(at: ghost) }
+
+        let dic = """
+        OnSave {
+            gStr = "あいう"
+            gNum = 42
+            gArr = (1, "x", 2.5)
+            SAVEVAR("vars.bin")
+        }
+        OnLoad {
+            gStr = ""
+            gNum = 0
+            gArr = IARRAY
+            RESTOREVAR(_argv[0]) + ":" + gStr + ":" + gNum + ":" + ARRAYSIZE(gArr) + ":" + gArr[1]
+        }
+        """
+        try dic.write(to: ghost.appendingPathComponent("t.dic"), atomically: true, encoding: .utf8)
+
+        let loadReq: [String: Any] = ["cmd": "load", "ghost_root": ghost.path, "encoding": "UTF-8",
+                                      "dic_entries": [["path": "t.dic", "encoding": "UTF-8"]]]
+        func req(_ id: String, _ ref: [String] = []) -> [String: Any] {
+            return ["cmd": "request", "method": "GET", "id": id, "ref": ref, "headers": ["Charset": "UTF-8"]]
+        }
+
+        // バイナリ形式で保存し、新しいプロセスで読み戻す
+        #expect(Self.runYayaCore(exe: exe, requests: [loadReq, req("OnSave")]) == "1")
+        let saved = try Data(contentsOf: ghost.appendingPathComponent("vars.bin"))
+        #expect(saved.prefix(4) == Data("YVS1".utf8))
+        #expect(Self.runYayaCore(exe: exe, requests: [loadReq, req("OnLoad", ["vars.bin"])]) == "1:あいう:42:3:x")
+
+        // 従来の JSON 形式（{"name":{"t":型,"v":値}}）
+        let legacy = #"{"gStr":{"t":"s","v":"legacy"},"gNum":{"t":"i","v":7},"# +
+            #""gArr":{"t":"a","v":[{"t":"s","v":"p"},{"t":"s","v":"q"}]}}"#
+        try legacy.write(to: ghost.appendingPathComponent("legacy.json"), atomically: true, encoding: .utf8)
+        #expect(Self.runYayaCore(exe: exe, requests: [loadReq, req("OnLoad", ["legacy.json"])]) == "1:legacy:7:2:q")
+
+        // 途中で切れたスナップショット
+        try saved.dropLast(3).write(to: ghost.appendingPathComponent("truncated.bin"))
+        #expect(Self.runYayaCore(exe: exe, requests: [loadReq, req("OnLoad", ["truncated.bin"])]) == "0::0:0:")
+
+        // ヘッダのレコード数がファイルに収まらない（"YVS1", version 1, count 0x7fffffff）
+        var oversized = Data("YVS1".utf8)
+        for word in [UInt32(1), UInt32(0x7fff_ffff)] {
+            withUnsafeBytes(of: word.littleEndian) { oversized.append(contentsOf: $0) }
+        }
+        try oversized.write(to: ghost.appendingPathComponent("oversized.bin"))
+        #expect(Self.runYayaCore(exe: exe, requests: [loadReq, req("OnLoad", ["oversized.bin"])]) == "0::0:0:")
+    }
+
+    /// `--workers 2` で 2 つのゴーストを 1 プロセスに載せ、"instance" ごとに辞書と変数が分かれること、
+    /// 応答が要求の "instance" を返すこと、unload でそのインスタンスだけが解放されることを検証する。
+    @Test
+    func yayaCoreWorkersRouteRequestsByInstance() throws {
+        guard let exe = Self.locateYayaCore() else {
+            print("[skip] yaya_core not found; skipping C++ parser integration test")
+            return
+        }
+        let root = URL(fileURLWithPath: NSTemporaryDirectory()).appendingPathComponent(UUID().uuidString)
+        defer { try? FileManager.default.removeItem(at: root) }
+        for name in ["a", "b"] {
+            let ghost = root.appendingPathComponent(name)
+            try FileManager.default.createDirectory(at: ghost, withIntermediateDirectories: true)
+            let dic = """
+            OnWho {
+                "ghost-\(name)"
+            }
+            OnSet {
+                gX = _argv[0]
+                gX
+            }
+            OnGet {
+                gX
+            }
+            """
+            try dic.write(to: ghost.appendingPathComponent("t.dic"), atomically: true, encoding: .utf8)
+        }
+
+        let proc = Process()
+        proc.executableURL = exe
+        proc.arguments = ["--workers", "2"]
+        let inPipe = Pipe()
+        let outPipe = Pipe()
+        proc.standardInput = inPipe
+        proc.standardOutput = outPipe
+        proc.standardError = Pipe()
+        try proc.run()
+
+        func send(_ obj: [String: Any]) {
+            let data = (try? JSONSerialization.data(withJSONObject: obj)) ?? Data()
+            inPipe.fileHandleForWriting.write(data)
+            inPipe.fileHandleForWriting.write(Data([0x0A]))
+        }
+        func readLine() -> [String: Any]? {
+            var buf = Data()
+            let h = outPipe.fileHandleForReading
+            while true {
+                let d = h.readData(ofLength: 1)
+                if d.isEmpty { return nil }
+                if d == Data([0x0A]) { break }
+                buf.append(d)
+            }
+            return (try? JSONSerialization.jsonObject(with: buf)) as? [String: Any]
+        }
+        func exchange(_ req: [String: Any]) -> [String: Any]? {
+            send(req)
+            return readLine()
+        }
+        func req(_ instance: String, _ id: String, _ ref: [String] = []) -> [String: Any] {
+            return ["cmd": "request", "instance": instance, "method": "GET", "id": id, "ref": ref,
+                    "headers": ["Charset": "UTF-8"]]
+        }
+
+        for name in ["a", "b"] {
+            let loaded = exchange(["cmd": "load", "instance": name,
+                                   "ghost_root": root.appendingPathComponent(name).path, "encoding": "UTF-8",
+                                   "dic_entries": [["path": "t.dic", "encoding": "UTF-8"]]])
+            #expect(loaded?["ok"] as? Bool == true)
+            #expect(loaded?["instance"] as? String == name)
+        }
+
+        // 別インスタンスの要求は並行に走るので、応答は "instance" で振り分ける（同じインスタンス内は順序どおり）
+        for r in [req("a", "OnWho"), req("b", "OnWho"), req("a", "OnSet", ["one"]), req("b", "OnSet", ["two"]),
+                  req("a", "OnGet"), req("b", "OnGet")] {
+            send(r)
+        }
+        var values: [String: [String]] = [:]
+        for _ in 0..<6 {
+            guard let resp = readLine(), let instance = resp["instance"] as? String else { break }
+            values[instance, default: []].append(resp["value"] as? String ?? "")
+        }
+        #expect(values["a"] == ["ghost-a", "one", "one"])
+        #expect(values["b"] == ["ghost-b", "two", "two"])
+
+        // unload は a だけを解放し、b の変数は残る
+        #expect(exchange(["cmd": "unload", "instance": "a"])?["ok"] as? Bool == true)
+        #expect(exchange(req("a", "OnWho"))?["value"] as? String != "ghost-a")
+        #expect(exchange(req("b", "OnGet"))?["value"] as? String == "two")
+
+        inPipe.fileHandleForWriting.closeFile()
+        proc.waitUntilExit()
+    }
+
+    /// 実行予算を使い切った要求は 500 と budget_exhausted で打ち切られ、打ち切られた関数の
+    /// 呼び出し元でも後続の文（ここではグローバルへの代入）が実行されないことを両エンジンで検証する。
+    @Test
+    func yayaCoreBudgetAbortSkipsRemainingStatements() throws {
+        guard let exe = Self.locateYayaCore() else {
+            print("[skip] yaya_core not found; skipping C++ parser integration test")
+            return
+        }
+        let ghost = URL(fileURLWithPath: NSTemporaryDirectory()).appendingPathComponent(UUID().uuidString)
+        try FileManager.default.createDirectory(at: ghost, withIntermediateDirectories: true)
+        defer { try? FileManager.default.removeItem(at: ghost) }
+
+        let dic = """
+        OnSpinCallThenAssign {
+            gAfter = "before"
+            gAfter = spinForever()
+            "done"
+        }
+        spinForever {
+            while 1 { _x = 1 }
+            "spun"
+        }
+        OnAfter {
+            gAfter
+        }
+        """
+        try dic.write(to: ghost.appendingPathComponent("t.dic"), atomically: true, encoding: .utf8)
+
+        for engine in ["ast", "bytecode"] {
+            let loadReq: [String: Any] = ["cmd": "load", "ghost_root": ghost.path, "encoding": "UTF-8",
+                                          "dic_entries": [["path": "t.dic", "encoding": "UTF-8"]],
+                                          "engine": engine, "budget": ["request": 100_000]]
+            let responses = Self.runYayaCoreResponses(exe: exe, requests: [
+                loadReq,
+                ["cmd": "request", "method": "GET", "id": "OnSpinCallThenAssign", "ref": [String]()],
+                ["cmd": "request", "method": "GET", "id": "OnAfter", "ref": [String]()]
+            ])
+            #expect(responses.count == 3, "engine \(engine)")
+            guard responses.count == 3 else { continue }
+            let aborted = responses[1]
+            #expect(aborted["status"] as? Int == 500, "engine \(engine)")
+            #expect(aborted["error"] as? String == "execution budget exhausted", "engine \(engine)")
+            #expect(aborted["budget_exhausted"] as? String == "spinForever", "engine \(engine)")
+            #expect(aborted["value"] == nil, "engine \(engine): no partial script")
+            #expect(responses[2]["value"] as? String == "before", "engine \(engine): assignment after abort must not run")
+        }
+    }
+
     /// Run yaya_core with a sequence of JSON-line requests; return the `value` of the
     /// last response (or nil). Each invocation is a fresh process: load + one request.
     private static func runYayaCore(exe: URL, requests: [[String: Any]]) -> String? {
+        return runYayaCoreResponses(exe: exe, requests: requests).compactMap { $0["value"] as? String }.last
+    }
+
+    /// Like `runYayaCore`, but returns every response object (host_op lines excluded) in order.
+    private static func runYayaCoreResponses(exe: URL, requests: [[String: Any]]) -> [[String: Any]] {
         let stdin = requests.map { (try? JSONSerialization.data(withJSONObject: $0)) ?? Data() }
             .map { String(data: $0, encoding: .utf8) ?? "" }
             .joined(separator: "\n") + "\n"
@@ -1227,18 +1433,18 @@ struct ShioriLoaderTests {
         proc.standardInput = inPipe
         proc.standardOutput = outPipe
         proc.standardError = Pipe()
-        do { try proc.run() } catch { return nil }
+        do { try proc.run() } catch { return [] }
         inPipe.fileHandleForWriting.write(Data(stdin.utf8))
         inPipe.fileHandleForWriting.closeFile()
         // Read all stdout
         let data = outPipe.fileHandleForReading.readDataToEndOfFile()
         proc.waitUntilExit()
-        var lastValue: String?
+        var responses: [[String: Any]] = []
         for line in String(data: data, encoding: .utf8)?.split(separator: "\n") ?? [] {
             guard let obj = try? JSONSerialization.jsonObject(with: Data(line.utf8)) as? [String: Any] else { continue }
             if obj["host_op"] != nil { continue }
-            if let v = obj["value"] as? String { lastValue = v }
+            responses.append(obj)
         }
-        return lastValue
+        return responses
     }
 }
@@ -0,0 +1,286 @@
+import Testing
+@testable import Ourin
+import Foundation
+
+/// `yaya_core` のバイナリ枠（`{"cmd":"handshake","framing":"binary"}` 以降、
+/// u32 LE 長さ + version 1 + varint フィールド数 + キー/タグ付き値）の結合テスト。
+/// 枠の定義は `yaya_core/src/ShioriFrame.hpp` と同じ。
+struct YayaCoreFramingTests {
+    private static func locateYayaCore() -> URL? {
+        if let url = Bundle.main.url(forAuxiliaryExecutable: "yaya_core") { return url }
+        // Repo-relative build output: <repo>/yaya_core/build/yaya_core
+        let testFile = URL(fileURLWithPath: #file)
+        var dir = testFile.deletingLastPathComponent() // OurinTests/
+        for _ in 0..<4 {
+            let candidate = dir.appendingPathComponent("yaya_core/build/yaya_core")
+            if FileManager.default.isExecutableFile(atPath: candidate.path) { return candidate }
+            dir = dir.deletingLastPathComponent()
+        }
+        return nil
+    }
+
+    // MARK: - binary framing
+
+    private static func putVarint(_ out: inout Data, _ value: UInt64) {
+        var v = value
+        while v >= 0x80 {
+            out.append(UInt8(v & 0x7F) | 0x80)
+            v >>= 7
+        }
+        out.append(UInt8(v))
+    }
+
+    private static func putString(_ out: inout Data, _ s: String) {
+        let bytes = Data(s.utf8)
+        putVarint(&out, UInt64(bytes.count))
+        out.append(bytes)
+    }
+
+    /// 長さヘッダ込みの 1 フレーム。文字列配列・文字列マップ以外の入れ子は "j"（JSON 文字列）で送る
+    static func encodeFrame(_ obj: [String: Any]) -> Data {
+        var body = Data([1])
+        putVarint(&body, UInt64(obj.count))
+        for (key, value) in obj {
+            putString(&body, key)
+            switch value {
+            case let s as String:
+                body.append(UInt8(ascii: "s"))
+                putString(&body, s)
+            case let b as Bool:
+                body.append(UInt8(ascii: "b"))
+                body.append(b ? 1 : 0)
+            case let i as Int:
+                body.append(UInt8(ascii: "i"))
+                putVarint(&body, UInt64(bitPattern: Int64((i << 1) ^ (i >> 63))))
+            case let a as [String]:
+                body.append(UInt8(ascii: "a"))
+                putVarint(&body, UInt64(a.count))
+                for e in a { putString(&body, e) }
+            case let m as [String: String]:
+                body.append(UInt8(ascii: "m"))
+                putVarint(&body, UInt64(m.count))
+                for (k, v) in m {
+                    putString(&body, k)
+                    putString(&body, v)
+                }
+            default:
+                body.append(UInt8(ascii: "j"))
+                let json = (try? JSONSerialization.data(withJSONObject: value, options: [.fragmentsAllowed])) ?? Data()
+                putString(&body, String(decoding: json, as: UTF8.self))
+            }
+        }
+        var frame = Data()
+        let length = UInt32(body.count)
+        for shift in stride(from: 0, to: 32, by: 8) { frame.append(UInt8((length >> UInt32(shift)) & 0xFF)) }
+        frame.append(body)
+        return frame
+    }
+
+    private struct FrameReader {
+        let data: [UInt8]
+        var pos = 0
+
+        mutating func byte() -> UInt8? {
+            guard pos < data.count else { return nil }
+            defer { pos += 1 }
+            return data[pos]
+        }
+
+        mutating func varint() -> UInt64? {
+            var v: UInt64 = 0
+            var shift: UInt64 = 0
+            while shift < 64 {
+                guard let b = byte() else { return nil }
+                v |= UInt64(b & 0x7F) << shift
+                if b & 0x80 == 0 { return v }
+                shift += 7
+            }
+            return nil
+        }
+
+        mutating func string() -> String? {
+            guard let n = varint(), n <= UInt64(data.count - pos) else { return nil }
+            defer { pos += Int(n) }
+            return String(decoding: data[pos..<pos + Int(n)], as: UTF8.self)
+        }
+    }
+
+    static func decodeFrame(_ payload: Data) -> [String: Any]? {
+        var r = FrameReader(data: [UInt8](payload))
+        guard r.byte() == 1, let count = r.varint() else { return nil }
+        var obj: [String: Any] = [:]
+        for _ in 0..<count {
+            guard let key = r.string(), let tag = r.byte() else { return nil }
+            switch tag {
+            case UInt8(ascii: "s"):
+                obj[key] = r.string()
+            case UInt8(ascii: "i"):
+                guard let z = r.varint() else { return nil }
+                obj[key] = Int(Int64(bitPattern: (z >> 1) ^ (0 &- (z & 1))))
+            case UInt8(ascii: "b"):
+                obj[key] = r.byte() != 0
+            case UInt8(ascii: "n"):
+                obj[key] = NSNull()
+            case UInt8(ascii: "a"):
+                guard let n = r.varint() else { return nil }
+                obj[key] = (0..<n).compactMap { _ in r.string() }
+            case UInt8(ascii: "m"):
+                guard let n = r.varint() else { return nil }
+                var m: [String: String] = [:]
+                for _ in 0..<n {
+                    guard let k = r.string(), let v = r.string() else { return nil }
+                    m[k] = v
+                }
+                obj[key] = m
+            case UInt8(ascii: "j"):
+                guard let s = r.string() else { return nil }
+                obj[key] = try? JSONSerialization.jsonObject(with: Data(s.utf8), options: [.fragmentsAllowed])
+            default:
+                return nil
+            }
+        }
+        return r.pos == r.data.count ? obj : nil
+    }
+
+    // MARK: - helper process
+
+    private final class Session {
+        let proc = Process()
+        let inPipe = Pipe()
+        let outPipe = Pipe()
+
+        init(exe: URL) throws {
+            proc.executableURL = exe
+            proc.standardInput = inPipe
+            proc.standardOutput = outPipe
+            proc.standardError = FileHandle.nullDevice
+            try proc.run()
+        }
+
+        func sendLine(_ obj: [String: Any]) {
+            let data = (try? JSONSerialization.data(withJSONObject: obj)) ?? Data()
+            inPipe.fileHandleForWriting.write(data)
+            inPipe.fileHandleForWriting.write(Data([0x0A]))
+        }
+
+        func readLine() -> [String: Any]? {
+            var buf = Data()
+            let h = outPipe.fileHandleForReading
+            while true {
+                let d = h.readData(ofLength: 1)
+                if d.isEmpty { return nil }
+                if d == Data([0x0A]) { break }
+                buf.append(d)
+            }
+            return (try? JSONSerialization.jsonObject(with: buf)) as? [String: Any]
+        }
+
+        func sendFrame(_ obj: [String: Any]) {
+            inPipe.fileHandleForWriting.write(YayaCoreFramingTests.encodeFrame(obj))
+        }
+
+        private func readExact(_ n: Int) -> Data? {
+            var buf = Data()
+            while buf.count < n {
+                let d = outPipe.fileHandleForReading.readData(ofLength: n - buf.count)
+                if d.isEmpty { return nil }
+                buf.append(d)
+            }
+            return buf
+        }
+
+        func readFrame() -> [String: Any]? {
+            guard let header = readExact(4) else { return nil }
+            let length = header.enumerated().reduce(0) { $0 | (Int($1.element) << (8 * $1.offset)) }
+            guard let payload = readExact(length) else { return nil }
+            return YayaCoreFramingTests.decodeFrame(payload)
+        }
+
+        func finish() {
+            inPipe.fileHandleForWriting.closeFile()
+            proc.waitUntilExit()
+        }
+    }
+
+    private static func makeGhost() throws -> URL {
+        let ghost = URL(fileURLWithPath: NSTemporaryDirectory()).appendingPathComponent(UUID().uuidString)
+        try FileManager.default.createDirectory(at: ghost, withIntermediateDirectories: true)
+        let dic = """
+        OnEcho {
+            "echo:" + _argv[0] + "/" + _argv[1]
+        }
+        """
+        try dic.write(to: ghost.appendingPathComponent("t.dic"), atomically: true, encoding: .utf8)
+        return ghost
+    }
+
+    /// ハンドシェイクは JSON Lines で応答し、以降はバイナリ枠で JSON と同じ応答を返す。
+    @Test
+    func yayaCoreBinaryHandshakeAndRoundTrip() throws {
+        guard let exe = Self.locateYayaCore() else {
+            print("[skip] yaya_core not found; skipping binary framing integration test")
+            return
+        }
+        let ghost = try Self.makeGhost()
+        defer { try? FileManager.default.removeItem(at: ghost) }
+
+        let load: [String: Any] = ["cmd": "load", "ghost_root": ghost.path, "encoding": "UTF-8",
+                                   "dic_entries": [["path": "t.dic", "encoding": "UTF-8"]]]
+        let request: [String: Any] = ["cmd": "request", "method": "GET", "id": "OnEcho",
+                                      "ref": ["あ", "b"], "headers": ["Charset": "UTF-8"]]
+
+        let json = try Session(exe: exe)
+        json.sendLine(load)
+        _ = json.readLine()
+        json.sendLine(request)
+        let jsonResponse = json.readLine()
+        json.finish()
+
+        let binary = try Session(exe: exe)
+        defer { binary.finish() }
+        binary.sendLine(["cmd": "handshake", "framing": "binary"])
+        let handshake = binary.readLine()
+        #expect(handshake?["ok"] as? Bool == true)
+        #expect(handshake?["framing"] as? String == "binary")
+
+        binary.sendFrame(load)
+        #expect(binary.readFrame()?["ok"] as? Bool == true)
+        binary.sendFrame(request)
+        let binaryResponse = binary.readFrame()
+
+        #expect(binaryResponse?["value"] as? String == "echo:あ/b")
+        #expect(binaryResponse?["value"] as? String == jsonResponse?["value"] as? String)
+        #expect(binaryResponse?["status"] as? Int == jsonResponse?["status"] as? Int)
+    }
+
+    /// 上限（64 MiB）を超える枠はエラーを返して本体を読み飛ばし、次の枠から処理を続ける。
+    @Test
+    func yayaCoreSkipsOversizeBinaryFrame() throws {
+        guard let exe = Self.locateYayaCore() else {
+            print("[skip] yaya_core not found; skipping binary framing integration test")
+            return
+        }
+        let ghost = try Self.makeGhost()
+        defer { try? FileManager.default.removeItem(at: ghost) }
+
+        let session = try Session(exe: exe)
+        defer { session.finish() }
+        session.sendLine(["cmd": "handshake", "framing": "binary"])
+        _ = session.readLine()
+
+        let length = 64 * 1024 * 1024 + 1
+        var oversize = Data((0..<4).map { UInt8((length >> (8 * $0)) & 0xFF) })
+        oversize.append(Data(count: length))
+        session.inPipe.fileHandleForWriting.write(oversize)
+        let error = session.readFrame()
+        #expect(error?["ok"] as? Bool == false)
+        #expect(error?["error"] as? String == "frame too large")
+
+        session.sendFrame(["cmd": "load", "ghost_root": ghost.path, "encoding": "UTF-8",
+                           "dic_entries": [["path": "t.dic", "encoding": "UTF-8"]]])
+        #expect(session.readFrame()?["ok"] as? Bool == true)
+        session.sendFrame(["cmd": "request", "method": "GET", "id": "OnEcho",
+                           "ref": ["x", "y"], "headers": ["Charset": "UTF-8"]])
+        #expect(session.readFrame()?["value"] as? String == "echo:x/y")
+    }
+}
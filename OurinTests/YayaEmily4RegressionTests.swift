@@ -153,7 +153,8 @@ struct YayaEmily4RegressionTests {
         }
     }
 
-    private static func loadEmily4(session: YayaCoreSession, master: URL, extraEntries: [[String: String]] = []) throws {
+    private static func loadEmily4(session: YayaCoreSession, master: URL, extraEntries: [[String: String]] = [],
+                                   extraLoadFields: [String: Any] = [:]) throws {
         let (entries, charset) = try resolveEmily4DicEntries(master: master)
         var dicEntries: [[String: String]] = entries.map { entry in
             var dict = ["path": entry.path]
@@ -161,12 +162,13 @@ struct YayaEmily4RegressionTests {
             return dict
         }
         dicEntries.append(contentsOf: extraEntries)
-        let loadReq: [String: Any] = [
+        var loadReq: [String: Any] = [
             "cmd": "load",
             "ghost_root": master.path,
             "dic_entries": dicEntries,
             "encoding": charset ?? "UTF-8"
         ]
+        loadReq.merge(extraLoadFields) { _, new in new }
         let resp = session.exchange(loadReq)
         #expect(resp?["ok"] as? Bool == true, "Emily4 dictionary set failed to load: \(String(describing: resp))")
     }
@@ -362,4 +364,94 @@ struct YayaEmily4RegressionTests {
         #expect(first == second, "Same SRAND seed must reproduce the same parallel selection")
         #expect(first != third, "Different SRAND seeds are expected to (very likely) select a different talk")
     }
+
+    /// `log_level` を変えても SRAND 固定シードの出力が変わらないことを検証する。
+    /// トレースログの値表示が配列の `asString()`（乱数で要素を選ぶ）を呼ぶと、
+    /// trace のときだけ乱数列が進んでトークが変わってしまう。
+    @Test
+    func emily4SeededTalkDoesNotDependOnLogLevel() throws {
+        guard let exe = Self.locateYayaCore() else {
+            print("[skip] yaya_core not found; skipping Emily4 regression test")
+            return
+        }
+        guard let master = try Self.copyEmily4Master() else {
+            print("[skip] emily4/ghost/master fixture not found; skipping")
+            return
+        }
+        defer { try? FileManager.default.removeItem(at: master) }
+
+        let wrapperDic = "SeededEMTalk {\n\tSRAND(_argv[0])\n\tEMRandomTalkSub\n}\n"
+        try wrapperDic.write(to: master.appendingPathComponent("_regression_log_level_seed.dic"),
+                              atomically: true, encoding: .utf8)
+
+        func talks(logLevel: String) throws -> [String?] {
+            let session = try YayaCoreSession(exe: exe)
+            defer { session.finish() }
+            try Self.loadEmily4(session: session, master: master,
+                                 extraEntries: [["path": "_regression_log_level_seed.dic", "encoding": "UTF-8"]],
+                                 extraLoadFields: ["log_level": logLevel])
+            return (1...10).map { seed in
+                session.exchange([
+                    "cmd": "request", "method": "GET", "id": "SeededEMTalk",
+                    "ref": [String(seed)], "headers": ["Charset": "UTF-8"]
+                ])?["value"] as? String
+            }
+        }
+
+        let quiet = try talks(logLevel: "off")
+        let trace = try talks(logLevel: "trace")
+        #expect(quiet.allSatisfy { $0 != nil })
+        #expect(quiet == trace, "log_level must not change the seeded talk selection")
+    }
+
+    /// `"shiori3fw_native": true` で Emily4 の SHIORI3FW `request()` が VM 側の代行（native）で
+    /// 処理されること、その応答が辞書の `request()` を実行したときと一致することを検証する。
+    /// Emily4 の request() が既定の形と認識されないと代行は黙って辞書経路に戻るので、
+    /// debug ログの "native" で代行が使われたことを確かめる。
+    @Test
+    func emily4NativeShiori3fwMatchesDictionaryRequest() throws {
+        guard let exe = Self.locateYayaCore() else {
+            print("[skip] yaya_core not found; skipping Emily4 regression test")
+            return
+        }
+        guard let master = try Self.copyEmily4Master() else {
+            print("[skip] emily4/ghost/master fixture not found; skipping")
+            return
+        }
+        defer { try? FileManager.default.removeItem(at: master) }
+
+        let requests: [[String: Any]] = [
+            ["cmd": "request", "method": "GET", "id": "OnSecondChange", "ref": ["0", "0", "0", "1", "1"],
+             "headers": ["Charset": "UTF-8"]],
+            ["cmd": "request", "method": "GET", "id": "OnMouseMove", "ref": ["100", "100", "0", "0", "0head", "0"],
+             "headers": ["Charset": "UTF-8"]],
+            ["cmd": "request", "method": "NOTIFY", "id": "OnMouseDoubleClick",
+             "ref": ["100", "100", "0", "0", "0bust", "0"], "headers": ["Charset": "UTF-8"]]
+        ]
+
+        func responses(native: Bool) throws -> (values: [String], stderr: String) {
+            let session = try YayaCoreSession(exe: exe)
+            defer { session.finish() }
+            try Self.loadEmily4(session: session, master: master,
+                                 extraLoadFields: ["shiori3fw_native": native, "log_level": "debug"])
+            let values = requests.map { req -> String in
+                guard let resp = session.exchange(req) else { return "<no response>" }
+                return "\(resp["status"] as? Int ?? -1) \(resp["value"] as? String ?? "")"
+            }
+            // stderr は非同期に読んでいるので、代行のログが届くまで少し待つ
+            let deadline = Date().addingTimeInterval(2)
+            while native && !session.stderrTail.contains(", native)") && Date() < deadline {
+                Thread.sleep(forTimeInterval: 0.05)
+            }
+            return (values, session.stderrTail)
+        }
+
+        let dictionary = try responses(native: false)
+        let native = try responses(native: true)
+        #expect(native.stderr.contains(", native)"),
+                "Emily4 request() was not recognized as the stock SHIORI3FW one: \(native.stderr)")
+        #expect(!dictionary.stderr.contains(", native)"))
+        #expect(native.values == dictionary.values)
+        #expect(!native.values.contains("<no response>"))
+    }
 }
@@ -0,0 +1,91 @@
+// POSIX 版 Satori::updateGhostsInfo（upstream の satoriFMO.cpp は Windows の SakuraFMO 専用）。
+// main.cpp が load の "fmo_segment" を OURIN_FMO_SEGMENT に設定し、ここではホストが公開する
+// 共有メモリ（yaya_core/src/FmoSegment.hpp）からロックを取らずにスナップショットを読む。
+// 指定が無ければ従来どおり何もしない。
+#include "satori.h"
+
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <strings.h>
+
+#include "FmoSegment.hpp"
+
+std::string UTF8toSJIS(const std::string& source);
+
+namespace {
+
+fmo_segment::Reader reader;
+std::string readerName;
+uint32_t parsedGeneration = 1;  // 奇数は有効な世代にならない
+
+std::string withoutTrailingSlash(std::string path) {
+    while (!path.empty() && path.back() == '/') path.pop_back();
+    return path;
+}
+
+// id.key\x01value\r\n の並びを id ごとにまとめる（SakuraFMO::update と同じ形）
+void parseSnapshot(const std::string& snapshot, std::map<std::string, strmap>& entries) {
+    size_t pos = 0;
+    while (pos < snapshot.size()) {
+        size_t end = snapshot.find("\r\n", pos);
+        if (end == std::string::npos) end = snapshot.size();
+        const size_t soh = snapshot.find('\x01', pos);
+        const size_t dot = snapshot.find('.', pos);
+        if (soh < end && dot < soh) {
+            entries[snapshot.substr(pos, dot - pos)][snapshot.substr(dot + 1, soh - dot - 1)] =
+                snapshot.substr(soh + 1, end - soh - 1);
+        }
+        pos = end + 2;
+    }
+}
+
+} // namespace
+
+bool Satori::updateGhostsInfo() {
+    const char* name = std::getenv("OURIN_FMO_SEGMENT");
+    if (name == nullptr || *name == '\0') {
+        return true;
+    }
+    // ホストが後から作る場合に備えて、開けていなければ毎回開き直す
+    if (!reader.isOpen() || readerName != name) {
+        if (!reader.open(name)) {
+            return false;
+        }
+        readerName = name;
+        parsedGeneration = 1;
+    }
+    const std::string* snapshot = reader.read();
+    if (snapshot == nullptr) {
+        return false;
+    }
+    if (reader.generation() == parsedGeneration && !ghosts_info.empty()) {
+        return true;
+    }
+
+    std::map<std::string, strmap> entries;
+    parseSnapshot(UTF8toSJIS(*snapshot), entries);
+    parsedGeneration = reader.generation();
+
+    const std::string self = withoutTrailingSlash(mBaseFolder);
+    ghosts_info.clear();
+    ghosts_info.push_back(strmap());
+    for (auto& entry : entries) {
+        // ダミーを蹴る
+        if (entry.first.find("ssp_fmo_header_dummyentry") != std::string::npos) continue;
+        if (entry.first.find("SSTPVIEWER-") != std::string::npos) continue;
+        if (entry.first.find("SSSB") != std::string::npos) continue;
+
+        strmap& m = entry.second;
+        // 本体のフォルダ（mExeFolder）は POSIX では空なので、ghostpath だけで自分自身を見分ける
+        const auto ghostpath = m.find("ghostpath");
+        const bool isSelfData = ghostpath != m.end() &&
+            strcasecmp((withoutTrailingSlash(ghostpath->second) + "/ghost/master").c_str(), self.c_str()) == 0;
+        if (isSelfData) {
+            ghosts_info[0] = m;
+        } else {
+            ghosts_info.push_back(m);
+        }
+    }
+    return true;
+}
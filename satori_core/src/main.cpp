@@ -8,6 +8,8 @@
 
 #include <nlohmann/json.hpp>
 
+#include "ShioriFrame.hpp"
+
 extern "C" int satori_load(char* data, long length);
 extern "C" int satori_unload(int id);
 extern "C" char* satori_request(int id, char* data, long* length);
@@ -22,6 +24,8 @@ using json = nlohmann::json;
 int runtimeId = 0;
 std::string runtimeProtocolVersion = "SHIORI/3.0";
 bool escapeUnknown = false;
+// stdin/stdout の枠付け。handshake 応答を返した後から切り替わる
+shiori_frame::Framing framing = shiori_frame::Framing::JsonLines;
 
 void configureSaoriSearchPath(const json& request) {
     if (!request.contains("saori_paths") || !request["saori_paths"].is_array()) {
@@ -49,6 +53,18 @@ void configureSaoriSearchPath(const json& request) {
     }
 }
 
+// load の "fmo_segment"（ホストが FMO を公開する共有メモリ）を SatoriFmo.cpp に渡す
+void configureFmoSegment(const json& request) {
+    const std::string name = request.contains("fmo_segment") && request["fmo_segment"].is_string()
+        ? request["fmo_segment"].get<std::string>()
+        : std::string();
+    if (name.empty()) {
+        unsetenv("OURIN_FMO_SEGMENT");
+    } else {
+        setenv("OURIN_FMO_SEGMENT", name.c_str(), 1);
+    }
+}
+
 std::string ensureTrailingSlash(std::string path) {
     if (!path.empty() && path.back() != '/') {
         path.push_back('/');
@@ -179,6 +195,7 @@ json loadRuntime(const json& request) {
     }
     escapeUnknown = request.value("escape_unknown", false);
     configureSaoriSearchPath(request);
+    configureFmoSegment(request);
     runtimeId = satori_load(input, static_cast<long>(root.size()));
     if (runtimeId <= 0) {
         runtimeId = 0;
@@ -196,6 +213,13 @@ json loadRuntime(const json& request) {
 
 json dispatch(const json& request) {
     const std::string command = request.value("cmd", "");
+    if (command == "handshake") {
+        const std::string name = request.value("framing", "json");
+        if (!shiori_frame::parseFraming(name, framing)) {
+            return {{"ok", false}, {"status", 400}, {"headers", json::object()}, {"value", "unsupported framing: " + name}};
+        }
+        return {{"ok", true}, {"status", 200}, {"headers", json::object()}, {"value", ""}, {"framing", name}};
+    }
     if (command == "ping") {
         return {{"ok", true}, {"status", 200}, {"headers", json::object()}, {"value", "pong"}};
     }
@@ -222,15 +246,29 @@ json dispatch(const json& request) {
 
 int main() {
     std::ios::sync_with_stdio(false);
-    std::string line;
-    while (std::getline(std::cin, line)) {
+    for (;;) {
+        // handshake の応答は切り替え前の形式で返す
+        const shiori_frame::Framing current = framing;
         json response;
         try {
-            response = dispatch(json::parse(line));
+            if (current == shiori_frame::Framing::Binary) {
+                std::string payload;
+                if (!shiori_frame::readFrame(std::cin, payload)) break;
+                response = dispatch(shiori_frame::decode(payload));
+            } else {
+                std::string line;
+                if (!std::getline(std::cin, line)) break;
+                response = dispatch(json::parse(line));
+            }
         } catch (const std::exception& error) {
             response = {{"ok", false}, {"status", 500}, {"headers", json::object()}, {"value", error.what()}};
         }
-        std::cout << response.dump() << '\n' << std::flush;
+        if (current == shiori_frame::Framing::Binary) {
+            shiori_frame::writeFrame(std::cout, shiori_frame::encode(response));
+        } else {
+            std::cout << response.dump() << '\n' << std::flush;
+        }
+        if (!std::cin) break;
     }
     if (runtimeId != 0) {
         satori_unload(runtimeId);
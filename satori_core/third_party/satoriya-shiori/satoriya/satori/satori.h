@@ -299,7 +299,7 @@ private:
 
 	// COMMUNICATE
 #ifdef POSIX
-	bool updateGhostsInfo() { return true; } // ȂB
+	bool	updateGhostsInfo();	// Ourin: satori_core/src/SatoriFmo.cpp
 #else
 	bool	updateGhostsInfo();	// FMO擾
 #endif
@@ -0,0 +1,109 @@
+#!/bin/bash
+# Execution budget: runaway dictionaries must be cut off with a SHIORI 500.
+# Writes a small dictionary with an endless while loop, an endless loop of `continue`,
+# an endless for loop that calls a function and unbounded recursion. Loads it on both
+# engines with the given per-request budget. Each request's wall time and response
+# status are printed. The script fails if a runaway request is not aborted, if
+# a bounded event that fits the budget does not answer normally, or if statements
+# after the aborted loop still run (checked with a global read by the next request).
+#
+# usage: examples/bench_budget.sh [budget] [yaya_core binary]
+
+set -euo pipefail
+
+cd "$(dirname "$0")/.."
+
+budget="${1:-1000000}"
+bin="${2:-./build/yaya_core}"
+work="$(mktemp -d)"
+trap 'rm -rf "$work"' EXIT
+
+cat > "$work/runaway.dic" <<'DIC'
+OnSpin
+{
+	_i = 0
+	while 1 { _i++ }
+}
+
+OnSpinContinue
+{
+	while 1 { continue }
+}
+
+OnSpinCalls
+{
+	for _i = 0; 1; _i++ { spinStep(_i) }
+}
+
+spinStep
+{
+	_argv[0] % 7
+}
+
+OnRecurse
+{
+	OnRecurse
+}
+
+OnSpinThenAssign
+{
+	g_after = "before"
+	while 1 { _x = 1 }
+	g_after = "after-loop"
+	"done"
+}
+
+OnSpinCallThenAssign
+{
+	g_after = "before"
+	g_after = spinForever()
+	"done"
+}
+
+spinForever
+{
+	while 1 { _x = 1 }
+	"spun"
+}
+
+OnAfter
+{
+	g_after
+}
+
+OnBounded
+{
+	_s = 0
+	for _i = 0; _i < 1000; _i++ { _s += spinStep(_i) }
+	_s
+}
+DIC
+
+status=0
+for engine in ast bytecode; do
+    for id in OnSpin OnSpinContinue OnSpinCalls OnRecurse OnBounded OnSpinThenAssign OnSpinCallThenAssign; do
+        printf '{"cmd":"load","ghost_root":"%s","dic":["runaway.dic"],"engine":"%s","budget":%s}\n' \
+            "$work" "$engine" "$budget" > "$work/req.jsonl"
+        printf '{"cmd":"request","method":"GET","id":"%s","ref":[]}\n' "$id" >> "$work/req.jsonl"
+        # 打ち切った後の文が実行されていないことを次のリクエストで確かめる
+        printf '{"cmd":"request","method":"GET","id":"OnAfter","ref":[]}\n' >> "$work/req.jsonl"
+        TIMEFORMAT="$(printf '%-8s %-20s %%3Rs' "$engine" "$id")"
+        time "$bin" < "$work/req.jsonl" 2> /dev/null | tail -n 2 > "$work/reply.json"
+        reply="$(head -n 1 "$work/reply.json")"
+        after="$(tail -n 1 "$work/reply.json")"
+        echo "    $reply"
+        case "$id" in
+            OnBounded) [[ "$reply" == *'"status":200'* ]] || { echo "    expected 200"; status=1; } ;;
+            # 再帰は深さの上限（MAX_RECURSION_DEPTH）で止まることもある
+            OnRecurse) ;;
+            OnSpinCallThenAssign) [[ "$reply" == *'"budget_exhausted":"spinForever"'* ]] || { echo "    expected budget_exhausted"; status=1; } ;;
+            *) [[ "$reply" == *'"budget_exhausted":"'"$id"'"'* ]] || { echo "    expected budget_exhausted"; status=1; } ;;
+        esac
+        case "$id" in
+            OnSpinThenAssign|OnSpinCallThenAssign)
+                echo "    g_after: $after"
+                [[ "$after" == *'"value":"before"'* ]] || { echo "    expected g_after unchanged"; status=1; } ;;
+        esac
+    done
+done
+exit $status
@@ -0,0 +1,42 @@
+#!/bin/bash
+# Compare the AST and bytecode engines on the bundled Emily/4 ghost.
+# Loads the ghost's dictionaries (as listed by yaya.txt) once per engine, replays
+# OnSecondChange / OnMouseMove N times each and prints the wall time per engine.
+# The SHIORI responses of both engines are diffed so a divergence is reported too.
+#
+# usage: examples/bench_engines.sh [iterations] [yaya_core binary]
+
+set -euo pipefail
+
+cd "$(dirname "$0")/.."
+
+iterations="${1:-100000}"
+bin="${2:-./build/yaya_core}"
+ghost_root="$(cd ../emily4/ghost/master && pwd)"
+work="$(mktemp -d)"
+trap 'rm -rf "$work"' EXIT
+
+source examples/ghost_dic_entries.sh
+entries="$(ghost_dic_entries "$ghost_root")"
+
+for engine in ast bytecode; do
+    {
+        printf '{"cmd":"load","ghost_root":"%s","dic_entries":%s,"engine":"%s"}\n' \
+            "$ghost_root" "$entries" "$engine"
+        for ((i = 0; i < iterations; i++)); do
+            echo '{"cmd":"request","method":"GET","id":"OnSecondChange","ref":["0","0","0","1","1"]}'
+            echo '{"cmd":"request","method":"GET","id":"OnMouseMove","ref":["100","100","0","0","0head","0"]}'
+        done
+    } > "$work/$engine.jsonl"
+
+    TIMEFORMAT="$(printf '%-8s %d x (OnSecondChange + OnMouseMove): %%2Rs' "$engine" "$iterations")"
+    time "$bin" < "$work/$engine.jsonl" 2>/dev/null > "$work/$engine.out"
+done
+
+if cmp -s "$work/ast.out" "$work/bytecode.out"; then
+    echo "responses: identical"
+else
+    echo "responses: DIFFER"
+    diff "$work/ast.out" "$work/bytecode.out" | head -20
+    exit 1
+fi
@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""READFMO through the shared-memory segment versus the host_op round trip.
+
+Builds examples/fmo_writer.cpp (a stand-in for the host's FMO publisher) and starts
+it on a fresh POSIX shared-memory segment. The writer republishes the snapshot every
+--interval microseconds. A generated dictionary calls READFMO in a loop twice: the
+timed event only reads, the second one also counts torn snapshots (the first and
+last generation records differ) and how many distinct generations it saw. Three
+helper runs are made:
+
+  segment   load with "fmo_segment"; READFMO reads the segment, no host_op expected
+  host_op   load without it; this script answers every host_op "fmo" over the pipe
+  fallback  "fmo_segment" names a segment that does not exist; READFMO must fall
+            back to host_op
+
+The script fails on a torn or empty snapshot or an unexpected host_op count.
+Linux and macOS only (shm_open).
+
+usage:
+  examples/bench_fmo.py [reads] [--bin PATH] [--interval US] [--writer PATH]
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.abspath(os.path.join(HERE, ".."))
+
+DIC = """OnFmoRead
+{{
+	for _i = 0; _i < {reads}; _i++ {{ _s = READFMO('Sakura') }}
+}}
+
+OnFmoCheck
+{{
+	_torn = 0
+	_empty = 0
+	_changes = 0
+	_last = ''
+	for _i = 0; _i < {reads}; _i++ {{
+		_s = READFMO('Sakura')
+		_len = STRLEN(_s)
+		if _len == 0 {{ _empty++; continue }}
+		_head = SUBSTR(_s, 13, 10)
+		if _head != SUBSTR(_s, _len - 12, 10) {{ _torn++ }}
+		if _head != _last {{ _changes++; _last = _head }}
+	}}
+	"torn=%(_torn) empty=%(_empty) changes=%(_changes)"
+}}
+"""
+
+# host_op で返すスナップショット（fmo_writer の世代 0 と同じ形）
+HOST_SNAPSHOT = "0.generation\x010000000000\r\n0.name\x01sakura\r\n9.generation\x010000000000\r\n"
+
+
+def build_writer(work):
+    out = os.path.join(work, "fmo_writer")
+    cmd = [os.environ.get("CXX", "c++"), "-std=c++17", "-O2", "-I", os.path.join(ROOT, "src"),
+           os.path.join(HERE, "fmo_writer.cpp"), "-o", out]
+    if sys.platform.startswith("linux"):
+        cmd.append("-lrt")
+    subprocess.run(cmd, check=True)
+    return out
+
+
+def run(binary, work, reads, segment):
+    load = {"cmd": "load", "ghost_root": work, "dic": ["fmo.dic"]}
+    if segment:
+        load["fmo_segment"] = segment
+    proc = subprocess.Popen([binary], stdin=subprocess.PIPE, stdout=subprocess.PIPE,
+                            stderr=subprocess.DEVNULL, text=True, bufsize=1)
+
+    def send(obj):
+        proc.stdin.write(json.dumps(obj) + "\n")
+        proc.stdin.flush()
+
+    def request(event):
+        host_ops = 0
+        send({"cmd": "request", "method": "GET", "id": event, "ref": []})
+        while True:
+            reply = json.loads(proc.stdout.readline())
+            if "host_op" not in reply:
+                return host_ops, reply.get("value", "")
+            host_ops += 1
+            send({"ok": True, "snapshot": HOST_SNAPSHOT})
+
+    send(load)
+    json.loads(proc.stdout.readline())
+    start = time.perf_counter()
+    host_ops, _ = request("OnFmoRead")
+    elapsed = time.perf_counter() - start
+    checked_ops, value = request("OnFmoCheck")
+    proc.stdin.close()
+    proc.wait()
+    return elapsed, host_ops + checked_ops, value
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("reads", nargs="?", type=int, default=20000)
+    parser.add_argument("--bin", default=os.path.join(ROOT, "build", "yaya_core"))
+    parser.add_argument("--interval", type=int, default=100, help="writer publish interval (us)")
+    parser.add_argument("--writer", help="prebuilt fmo_writer")
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as work:
+        with open(os.path.join(work, "fmo.dic"), "w") as f:
+            f.write(DIC.format(reads=args.reads))
+        writer_bin = args.writer or build_writer(work)
+        segment = "/ourin_fmo_bench_%d" % os.getpid()
+        writer = subprocess.Popen([writer_bin, segment, str(args.interval)],
+                                  stdout=subprocess.PIPE, text=True)
+        try:
+            if writer.stdout.readline().strip() != "ready":
+                sys.exit("fmo_writer failed to start")
+            results = [
+                ("segment", *run(args.bin, work, args.reads, segment)),
+                ("host_op", *run(args.bin, work, args.reads, None)),
+                ("fallback", *run(args.bin, work, args.reads, segment + "_missing")),
+            ]
+        finally:
+            writer.terminate()
+            writer.wait()
+
+    ok = True
+    print("%-9s %8s %10s %12s  %s" % ("mode", "reads", "wall", "us/read", "result"))
+    for mode, elapsed, host_ops, value in results:
+        print("%-9s %8d %9.3fs %12.2f  %s host_ops=%d" %
+              (mode, args.reads, elapsed, elapsed * 1e6 / args.reads, value, host_ops))
+        expected = 0 if mode == "segment" else 2 * args.reads
+        if "torn=0 empty=0" not in value or host_ops != expected:
+            print("    unexpected result (expected host_ops=%d, no torn or empty reads)" % expected)
+            ok = False
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,85 @@
+#!/bin/bash
+# One multi-instance yaya_core process vs. N separate processes, for N concurrent Emily/4
+# ghosts. Each ghost loads the bundled dictionaries and replays OnSecondChange /
+# OnMouseMove the given number of times. For every N the script prints the wall time,
+# the mean time per request and the peak resident memory (VmHWM, summed over processes
+# in the separate-process case).
+#
+# usage: examples/bench_instances.sh [requests per ghost] [yaya_core binary] [N...]
+
+set -euo pipefail
+
+cd "$(dirname "$0")/.."
+
+requests="${1:-2000}"
+bin="${2:-./build/yaya_core}"
+shift $(( $# < 2 ? $# : 2 ))
+counts=("$@")
+[ ${#counts[@]} -gt 0 ] || counts=(1 4 8)
+ghost_root="$(cd ../emily4/ghost/master && pwd)"
+work="$(mktemp -d)"
+trap 'rm -rf "$work"' EXIT
+
+source examples/ghost_dic_entries.sh
+entries="$(ghost_dic_entries "$ghost_root")"
+
+# ghost_requests <instance id or empty>: load + requests for one ghost
+ghost_requests() {
+    local tag=""
+    [ -n "$1" ] && tag=",\"instance\":\"$1\""
+    printf '{"cmd":"load","ghost_root":"%s","dic_entries":%s%s}\n' "$ghost_root" "$entries" "$tag"
+    for ((i = 0; i < requests; i += 2)); do
+        echo "{\"cmd\":\"request\",\"method\":\"GET\",\"id\":\"OnSecondChange\",\"ref\":[\"0\",\"0\",\"0\",\"1\",\"1\"]$tag}"
+        echo "{\"cmd\":\"request\",\"method\":\"GET\",\"id\":\"OnMouseMove\",\"ref\":[\"100\",\"100\",\"0\",\"0\",\"0head\",\"0\"]$tag}"
+    done
+}
+
+# peak_rss <pid>: VmHWM (kB) of the process, sampled until it exits
+peak_rss() {
+    local hwm=0 v
+    while kill -0 "$1" 2>/dev/null; do
+        v="$(awk '/^VmHWM/ {print $2}' "/proc/$1/status" 2>/dev/null || true)"
+        [ -n "$v" ] && hwm="$v"
+        sleep 0.01
+    done
+    echo "$hwm"
+}
+
+report() {
+    local label="$1" n="$2" start="$3" end="$4" rss_kb="$5"
+    awk -v l="$label" -v n="$n" -v s="$start" -v e="$end" -v r="$rss_kb" -v q="$requests" 'BEGIN {
+        wall = e - s
+        printf "%-10s N=%-2d wall %7.2fs  %6.3f ms/request  peak RSS %7.1f MB\n", l, n, wall, wall * 1000 / (n * q), r / 1024
+    }'
+}
+
+for n in "${counts[@]}"; do
+    # 1 process, n instances interleaved on n workers
+    mkdir -p "$work/ghosts"
+    for ((g = 0; g < n; g++)); do ghost_requests "g$g" > "$work/ghosts/$g.jsonl"; done
+    paste -d '\n' "$work"/ghosts/*.jsonl | sed '/^$/d' > "$work/multi.jsonl"
+    rm -rf "$work/ghosts"
+    start="$EPOCHREALTIME"
+    "$bin" --workers "$n" < "$work/multi.jsonl" > /dev/null 2>&1 &
+    pid=$!
+    peak_rss "$pid" > "$work/multi.rss" &
+    wait "$pid"
+    end="$EPOCHREALTIME"
+    wait
+    report multi "$n" "$start" "$end" "$(cat "$work/multi.rss")"
+
+    # n separate processes
+    ghost_requests "" > "$work/single.jsonl"
+    start="$EPOCHREALTIME"
+    pids=()
+    for ((g = 0; g < n; g++)); do
+        "$bin" < "$work/single.jsonl" > /dev/null 2>&1 &
+        pids+=($!)
+        peak_rss "$!" > "$work/single.$g.rss" &
+    done
+    wait "${pids[@]}"
+    end="$EPOCHREALTIME"
+    wait
+    report processes "$n" "$start" "$end" "$(cat "$work"/single.*.rss | awk '{s += $1} END {print s}')"
+    rm -f "$work"/single.*.rss
+done
@@ -0,0 +1,301 @@
+#!/usr/bin/env python3
+"""Round-trip throughput of the JSON Lines and binary framings over a pipe.
+
+Starts the helper once per framing, loads a small ghost, then sends N small
+`request` commands one at a time (write, wait for the response) and prints the
+wall time and round trips per second. The request is encoded once and responses
+are decoded after the timed loop, so the numbers cover the pipe and the helper.
+The responses of both framings are compared so a divergence is reported too.
+
+For yaya_core it also drives a READFMO host_op round trip (the helper asks, this
+script answers) in each framing, both in a plain process and under --workers 2,
+and fails if the reply does not reach the dictionary. It also sends a binary
+frame over the 64 MiB limit and checks that the helper reports it and still
+answers the next frame.
+
+usage:
+  examples/bench_ipc.py [requests] [--helper yaya|satori] [--bin PATH]
+
+yaya_core loads examples/simple_ghost.dic and calls OnMouseDoubleClick;
+satori_core loads satori_core/tests/fixtures/basic and calls OnEchoReference.
+"""
+
+import argparse
+import json
+import os
+import select
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+REPO = os.path.abspath(os.path.join(HERE, "..", ".."))
+
+
+# ---- binary framing (see yaya_core/src/ShioriFrame.hpp) ----
+
+def put_varint(out, v):
+    while v >= 0x80:
+        out.append((v & 0x7F) | 0x80)
+        v >>= 7
+    out.append(v)
+
+
+def put_str(out, s):
+    b = s.encode("utf-8")
+    put_varint(out, len(b))
+    out += b
+
+
+def encode(obj):
+    out = bytearray([1])
+    put_varint(out, len(obj))
+    for key, value in obj.items():
+        put_str(out, key)
+        if isinstance(value, str):
+            out.append(ord("s"))
+            put_str(out, value)
+        elif isinstance(value, bool):
+            out.append(ord("b"))
+            out.append(1 if value else 0)
+        elif isinstance(value, int):
+            out.append(ord("i"))
+            put_varint(out, (value << 1) ^ (value >> 63))
+        elif value is None:
+            out.append(ord("n"))
+        elif isinstance(value, list) and all(isinstance(e, str) for e in value):
+            out.append(ord("a"))
+            put_varint(out, len(value))
+            for e in value:
+                put_str(out, e)
+        elif isinstance(value, dict) and all(isinstance(e, str) for e in value.values()):
+            out.append(ord("m"))
+            put_varint(out, len(value))
+            for k, v in value.items():
+                put_str(out, k)
+                put_str(out, v)
+        else:
+            out.append(ord("j"))
+            put_str(out, json.dumps(value, ensure_ascii=False))
+    return struct.pack("<I", len(out)) + bytes(out)
+
+
+class Reader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def byte(self):
+        b = self.data[self.pos]
+        self.pos += 1
+        return b
+
+    def varint(self):
+        v = shift = 0
+        while True:
+            b = self.byte()
+            v |= (b & 0x7F) << shift
+            if not b & 0x80:
+                return v
+            shift += 7
+
+    def str(self):
+        n = self.varint()
+        s = self.data[self.pos:self.pos + n].decode("utf-8")
+        self.pos += n
+        return s
+
+
+def decode(payload):
+    r = Reader(payload)
+    if r.byte() != 1:
+        raise ValueError("unsupported frame version")
+    obj = {}
+    for _ in range(r.varint()):
+        key = r.str()
+        tag = chr(r.byte())
+        if tag == "s":
+            obj[key] = r.str()
+        elif tag == "i":
+            z = r.varint()
+            obj[key] = (z >> 1) ^ -(z & 1)
+        elif tag == "b":
+            obj[key] = r.byte() != 0
+        elif tag == "n":
+            obj[key] = None
+        elif tag == "a":
+            obj[key] = [r.str() for _ in range(r.varint())]
+        elif tag == "m":
+            obj[key] = {r.str(): r.str() for _ in range(r.varint())}
+        elif tag == "j":
+            obj[key] = json.loads(r.str())
+        else:
+            raise ValueError("unknown field tag " + tag)
+    return obj
+
+
+def read_exact(stream, n):
+    data = stream.read(n)
+    if len(data) != n:
+        raise EOFError("helper closed the pipe")
+    return data
+
+
+class Helper:
+    def __init__(self, binary_path, framing, extra_args=()):
+        self.proc = subprocess.Popen([binary_path, *extra_args], stdin=subprocess.PIPE, stdout=subprocess.PIPE,
+                                     stderr=subprocess.DEVNULL)
+        self.binary = False
+        if framing == "binary":
+            reply = self.call({"cmd": "handshake", "framing": "binary"})
+            if not reply.get("ok"):
+                raise RuntimeError("handshake failed: %r" % reply)
+            self.binary = True
+
+    def pack(self, obj):
+        if self.binary:
+            return encode(obj)
+        return json.dumps(obj, ensure_ascii=False).encode("utf-8") + b"\n"
+
+    def unpack(self, raw):
+        return decode(raw) if self.binary else json.loads(raw)
+
+    # Send an already encoded request and return the raw response, keeping
+    # client-side encoding and decoding out of the timed loop.
+    def round_trip(self, packed):
+        self.write(packed)
+        return self.read()
+
+    def write(self, packed):
+        self.proc.stdin.write(packed)
+        self.proc.stdin.flush()
+
+    def read(self):
+        if self.binary:
+            (length,) = struct.unpack("<I", read_exact(self.proc.stdout, 4))
+            return read_exact(self.proc.stdout, length)
+        line = self.proc.stdout.readline()
+        if not line:
+            raise EOFError("helper closed the pipe")
+        return line
+
+    def call(self, obj):
+        return self.unpack(self.round_trip(self.pack(obj)))
+
+    def close(self):
+        self.proc.stdin.close()
+        self.proc.wait()
+
+
+def check_host_op(binary_path, framing, workers):
+    """READFMO over a host_op round trip; returns an error message or None."""
+    extra = ["--workers", str(workers)] if workers else []
+    with tempfile.TemporaryDirectory() as ghost_root:
+        with open(os.path.join(ghost_root, "fmo.dic"), "w", encoding="utf-8") as f:
+            f.write('OnFmo\n{\n\t"fmo=" + READFMO("Sakura")\n}\n')
+        helper = Helper(binary_path, framing, extra)
+        try:
+            if not helper.call({"cmd": "load", "ghost_root": ghost_root, "dic": ["fmo.dic"]}).get("ok"):
+                return "load failed"
+            helper.write(helper.pack({"cmd": "request", "method": "GET", "id": "OnFmo", "ref": []}))
+            op = helper.unpack(helper.read())
+            if op.get("host_op") != "fmo":
+                return "expected a host_op, got %r" % op
+            reply = {"ok": True, "snapshot": "X"}
+            for key in ("host_op_id", "instance"):
+                if key in op:
+                    reply[key] = op[key]
+            helper.write(helper.pack(reply))
+            # A lost reply leaves the helper waiting forever, so bound the wait.
+            if not select.select([helper.proc.stdout], [], [], 10)[0]:
+                return "no response within 10s after the host_op reply"
+            response = helper.unpack(helper.read())
+            if response.get("value") != "fmo=X":
+                return "expected fmo=X, got %r" % response
+            return None
+        finally:
+            helper.close()
+
+
+def check_oversize(binary_path, workers):
+    """A frame over the limit must be skipped whole; returns an error message or None."""
+    extra = ["--workers", str(workers)] if workers else []
+    helper = Helper(binary_path, "binary", extra)
+    try:
+        length = 64 * 1024 * 1024 + 1
+        helper.write(struct.pack("<I", length) + bytes(length))
+        error = helper.unpack(helper.read())
+        if error.get("ok") is not False or error.get("error") != "frame too large":
+            return "expected a frame too large error, got %r" % error
+        try:
+            reply = helper.call({"cmd": "handshake", "framing": "binary"})
+        except EOFError:
+            return "helper closed the pipe after the oversize frame"
+        if not reply.get("ok"):
+            return "next frame after the oversize one failed: %r" % reply
+        return None
+    finally:
+        helper.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("requests", nargs="?", type=int, default=100000)
+    parser.add_argument("--helper", choices=["yaya", "satori"], default="yaya")
+    parser.add_argument("--bin", help="helper binary (default: <helper>_core/build/<helper>_core)")
+    args = parser.parse_args()
+
+    name = args.helper + "_core"
+    binary_path = args.bin or os.path.join(REPO, name, "build", name)
+    if args.helper == "yaya":
+        load = {"cmd": "load", "ghost_root": os.path.join(REPO, "yaya_core", "examples"),
+                "dic": ["simple_ghost.dic"], "encoding": "utf-8"}
+        request = {"cmd": "request", "method": "GET", "id": "OnMouseDoubleClick",
+                   "ref": ["0", "0", "0", "0", "Head", "0"]}
+    else:
+        load = {"cmd": "load", "ghost_root": os.path.join(REPO, "satori_core", "tests", "fixtures", "basic")}
+        request = {"cmd": "request", "method": "GET", "id": "OnEchoReference",
+                   "ref": ["\\0\\s[0]ping\\e"]}
+
+    results = {}
+    for framing in ("json", "binary"):
+        helper = Helper(binary_path, framing)
+        if not helper.call(load).get("ok"):
+            sys.exit("%s: load failed" % framing)
+        packed = helper.pack(request)
+        raw = []
+        start = time.perf_counter()
+        for _ in range(args.requests):
+            raw.append(helper.round_trip(packed))
+        elapsed = time.perf_counter() - start
+        helper.close()
+        results[framing] = [helper.unpack(r) for r in raw]
+        print("%-6s %d round trips: %.2fs (%.0f/s)" % (framing, args.requests, elapsed, args.requests / elapsed))
+
+    failed = False
+    if results["json"] == results["binary"]:
+        print("responses: identical")
+    else:
+        print("responses: DIFFER")
+        failed = True
+
+    if args.helper == "yaya":
+        for framing in ("json", "binary"):
+            for workers in (0, 2):
+                error = check_host_op(binary_path, framing, workers)
+                label = "%s%s" % (framing, " --workers %d" % workers if workers else "")
+                print("host_op %-19s %s" % (label, error or "ok"))
+                failed = failed or error is not None
+        for workers in (0, 2):
+            error = check_oversize(binary_path, workers)
+            label = "binary%s" % (" --workers %d" % workers if workers else "")
+            print("oversize %-18s %s" % (label, error or "ok"))
+            failed = failed or error is not None
+    if failed:
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
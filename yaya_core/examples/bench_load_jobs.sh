@@ -0,0 +1,45 @@
+#!/bin/bash
+# Serial vs. parallel dictionary loading of the bundled Emily/4 ghost.
+# Loads the ghost's dictionaries with each "jobs" value (default: 1, 2, 4 and 0 = one
+# worker per hardware thread), prints the wall time and the "Loaded ... dictionaries in"
+# line, and fails if a setting answers a few deterministic requests differently from
+# the first one.
+#
+# usage: examples/bench_load_jobs.sh [runs per setting] [yaya_core binary] [jobs...]
+
+set -euo pipefail
+
+cd "$(dirname "$0")/.."
+
+runs="${1:-3}"
+bin="${2:-./build/yaya_core}"
+shift $(( $# < 2 ? $# : 2 ))
+jobs_list=("$@")
+[ ${#jobs_list[@]} -gt 0 ] || jobs_list=(1 2 4 0)
+ghost_root="$(cd ../emily4/ghost/master && pwd)"
+work="$(mktemp -d)"
+trap 'rm -rf "$work"' EXIT
+
+source examples/ghost_dic_entries.sh
+entries="$(ghost_dic_entries "$ghost_root")"
+
+for jobs in "${jobs_list[@]}"; do
+    {
+        printf '{"cmd":"load","ghost_root":"%s","dic_entries":%s,"jobs":%d}\n' \
+            "$ghost_root" "$entries" "$jobs"
+        echo '{"cmd":"request","method":"GET","id":"OnSecondChange","ref":["0","0","0","1","1"]}'
+        echo '{"cmd":"request","method":"GET","id":"OnMouseMove","ref":["100","100","0","0","0head","0"]}'
+    } > "$work/load.jsonl"
+
+    for ((i = 1; i <= runs; i++)); do
+        TIMEFORMAT="$(printf 'jobs=%-3s %%3Rs' "$jobs")"
+        time "$bin" < "$work/load.jsonl" 2> "$work/load.err" > "$work/jobs$jobs.out"
+        grep -o 'Loaded [0-9]*/[0-9]* dictionaries in .*' "$work/load.err" || true
+    done
+
+    if ! cmp -s "$work/jobs${jobs_list[0]}.out" "$work/jobs$jobs.out"; then
+        echo "responses: jobs=$jobs differs from jobs=${jobs_list[0]}"
+        exit 1
+    fi
+done
+echo "responses: identical"
@@ -0,0 +1,38 @@
+#!/bin/bash
+# Load time and peak memory of the bundled Emily/4 ghost.
+# Each run starts yaya_core, sends one load, and waits for the reply. It then reads the
+# process's peak resident set size (VmHWM in /proc/<pid>/status) before closing stdin.
+# The "Loaded ... dictionaries in" line yaya_core prints is shown next to it, so that
+# loader changes (mmap, copies, tokenizer buffers) can be compared between builds.
+#
+# usage: examples/bench_load_memory.sh [runs] [yaya_core binary...]
+
+set -euo pipefail
+
+cd "$(dirname "$0")/.."
+
+runs="${1:-5}"
+shift $(( $# < 1 ? $# : 1 ))
+bins=("$@")
+[ ${#bins[@]} -gt 0 ] || bins=(./build/yaya_core)
+ghost_root="$(cd ../emily4/ghost/master && pwd)"
+work="$(mktemp -d)"
+trap 'rm -rf "$work"' EXIT
+
+source examples/ghost_dic_entries.sh
+load="$(printf '{"cmd":"load","ghost_root":"%s","dic_entries":%s}' \
+    "$ghost_root" "$(ghost_dic_entries "$ghost_root")")"
+
+for bin in "${bins[@]}"; do
+    for ((i = 1; i <= runs; i++)); do
+        coproc YAYA { exec "$bin" 2> "$work/load.err"; }
+        pid=$YAYA_PID
+        echo "$load" >&"${YAYA[1]}"
+        read -r _ <&"${YAYA[0]}"
+        hwm="$(awk '/^VmHWM/ {print $2 $3}' "/proc/$pid/status")"
+        exec {YAYA[1]}>&-
+        wait "$pid" || true
+        printf '%-28s peak %-9s %s\n' "$bin" "$hwm" \
+            "$(grep -o 'Loaded [0-9]*/[0-9]* dictionaries in .*' "$work/load.err" || true)"
+    done
+done
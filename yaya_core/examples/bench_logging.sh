@@ -0,0 +1,62 @@
+#!/bin/bash
+# Request latency of the Emily/4 ghost under each diagnostic log setting.
+# Replays OnSecondChange / OnMouseMove N times each with:
+#   default      no log fields in load (all levels written synchronously, the old behaviour)
+#   trace-async  "log_level":"trace","log_async":true (same lines via the ring buffer)
+#   warn         "log_level":"warn" (warnings and errors only)
+#   off          "log_level":"off"
+# stderr goes to a file (not /dev/null) so the cost of the writes is included.
+# Prints the wall time, mean time per request and stderr size per setting, and
+# fails if any setting answers differently from the first.
+#
+# usage: examples/bench_logging.sh [iterations] [yaya_core binary]
+
+set -euo pipefail
+
+cd "$(dirname "$0")/.."
+
+iterations="${1:-20000}"
+bin="${2:-./build/yaya_core}"
+ghost_root="$(cd ../emily4/ghost/master && pwd)"
+work="$(mktemp -d)"
+trap 'rm -rf "$work"' EXIT
+
+source examples/ghost_dic_entries.sh
+entries="$(ghost_dic_entries "$ghost_root")"
+
+settings=(default trace-async warn off)
+declare -A fields=(
+    [default]=''
+    [trace-async]=',"log_level":"trace","log_async":true'
+    [warn]=',"log_level":"warn"'
+    [off]=',"log_level":"off"'
+)
+
+requests=$((iterations * 2))
+for setting in "${settings[@]}"; do
+    {
+        printf '{"cmd":"load","ghost_root":"%s","dic_entries":%s%s}\n' \
+            "$ghost_root" "$entries" "${fields[$setting]}"
+        for ((i = 0; i < iterations; i++)); do
+            echo '{"cmd":"request","method":"GET","id":"OnSecondChange","ref":["0","0","0","1","1"]}'
+            echo '{"cmd":"request","method":"GET","id":"OnMouseMove","ref":["100","100","0","0","0head","0"]}'
+        done
+    } > "$work/$setting.jsonl"
+
+    start=$EPOCHREALTIME
+    "$bin" < "$work/$setting.jsonl" 2> "$work/$setting.err" > "$work/$setting.out"
+    end=$EPOCHREALTIME
+    awk -v s="$start" -v e="$end" -v n="$requests" -v name="$setting" \
+        -v bytes="$(wc -c < "$work/$setting.err")" \
+        'BEGIN { printf "%-12s %d requests: %6.2fs  %7.1f us/request  stderr %d KB\n",
+                 name, n, e - s, (e - s) * 1e6 / n, bytes / 1024 }'
+done
+
+for setting in "${settings[@]:1}"; do
+    if ! cmp -s "$work/${settings[0]}.out" "$work/$setting.out"; then
+        echo "responses: DIFFER (${settings[0]} vs $setting)"
+        diff "$work/${settings[0]}.out" "$work/$setting.out" | head -20
+        exit 1
+    fi
+done
+echo "responses: identical"
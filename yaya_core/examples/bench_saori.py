@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+"""REQUESTLIB through the in-process SAORI host versus the host_op "plugin" route.
+
+Builds satori_core/tests/fixtures/external_saori.cpp (a POSIX SAORI-universal module)
+into <ghost>/saori/external_saori.so and loads a generated dictionary. The dictionary
+calls LOADLIB once and then REQUESTLIB in a loop. The name is written as
+'saori\\external_saori.dll', so the Windows-name mapping is exercised too. Two helper
+runs are timed:
+
+  in_process  load with "saori_in_process": true; no host_op expected
+  host_op     load without it; this script plays the host and calls the same module
+              through ctypes for every host_op "plugin"
+
+Both runs must return the same Result and valueex0.
+
+usage:
+  examples/bench_saori.py [requests] [--bin PATH]
+"""
+
+import argparse
+import ctypes
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.abspath(os.path.join(HERE, ".."))
+FIXTURE = os.path.join(ROOT, "..", "satori_core", "tests", "fixtures", "external_saori.cpp")
+
+DIC = """OnSaoriLoop
+{{
+	_crlf = CHR(13) + CHR(10)
+	_loaded = LOADLIB('saori\\external_saori.dll')
+	for _i = 0; _i < {requests}; _i++ {{
+		_r = REQUESTLIB('saori\\external_saori.dll', 'EXECUTE SAORI/1.0' + _crlf + 'Charset: UTF-8' + _crlf + 'Argument0: ' + _i + _crlf + _crlf)
+	}}
+	"loaded=%(_loaded) result=%(_r) value0=%(valueex0)"
+}}
+"""
+
+
+def build_fixture(ghost):
+    os.makedirs(os.path.join(ghost, "saori"))
+    out = os.path.join(ghost, "saori", "external_saori.so")
+    cmd = [os.environ.get("CXX", "c++"), "-std=c++17", "-O2", "-shared", "-fPIC", FIXTURE, "-o", out]
+    subprocess.run(cmd, check=True)
+    return out
+
+
+class HostSide:
+    """The host's SAORI path: the module is called through the POSIX ABI from here."""
+
+    def __init__(self, path):
+        self.libc = ctypes.CDLL(None)
+        self.libc.malloc.restype = ctypes.c_void_p
+        self.libc.malloc.argtypes = [ctypes.c_size_t]
+        self.libc.free.argtypes = [ctypes.c_void_p]
+        self.lib = ctypes.CDLL(path)
+        self.lib.load.argtypes = [ctypes.c_void_p, ctypes.c_long]
+        self.lib.request.restype = ctypes.c_void_p
+        self.lib.request.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_long)]
+        self.lib.load(self.copy(os.path.dirname(path).encode() + b"/"), len(os.path.dirname(path)) + 1)
+
+    def copy(self, data):
+        buf = self.libc.malloc(len(data) + 1)
+        ctypes.memmove(buf, data + b"\0", len(data) + 1)
+        return buf
+
+    def request(self, text):
+        data = text.encode("utf-8")
+        length = ctypes.c_long(len(data))
+        out = self.lib.request(self.copy(data), ctypes.byref(length))
+        response = ctypes.string_at(out, length.value).decode("utf-8")
+        self.libc.free(out)
+        return response
+
+
+def run(binary, ghost, in_process, host):
+    load = {"cmd": "load", "ghost_root": ghost, "dic": ["saori.dic"], "saori_in_process": in_process}
+    proc = subprocess.Popen([binary], stdin=subprocess.PIPE, stdout=subprocess.PIPE,
+                            stderr=subprocess.DEVNULL, text=True, bufsize=1)
+
+    def send(obj):
+        proc.stdin.write(json.dumps(obj) + "\n")
+        proc.stdin.flush()
+
+    send(load)
+    json.loads(proc.stdout.readline())
+    host_ops = 0
+    start = time.perf_counter()
+    send({"cmd": "request", "method": "GET", "id": "OnSaoriLoop", "ref": []})
+    while True:
+        reply = json.loads(proc.stdout.readline())
+        if "host_op" not in reply:
+            break
+        host_ops += 1
+        op = reply["params"]["operation"]
+        if op == "saori_request":
+            send({"ok": True, "response": host.request(reply["params"]["params"]["request"])})
+        else:
+            send({"ok": True})
+    elapsed = time.perf_counter() - start
+    proc.stdin.close()
+    proc.wait()
+    return elapsed, host_ops, reply.get("value", "")
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("requests", nargs="?", type=int, default=20000)
+    parser.add_argument("--bin", default=os.path.join(ROOT, "build", "yaya_core"))
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as ghost:
+        with open(os.path.join(ghost, "saori.dic"), "w") as f:
+            f.write(DIC.format(requests=args.requests))
+        host = HostSide(build_fixture(ghost))
+        results = [
+            ("in_process", *run(args.bin, ghost, True, host)),
+            ("host_op", *run(args.bin, ghost, False, host)),
+        ]
+
+    print("%-10s %8s %10s %12s  %s" % ("mode", "requests", "wall", "us/request", "result"))
+    for mode, elapsed, host_ops, value in results:
+        print("%-10s %8d %9.3fs %12.2f  %s host_ops=%d" %
+              (mode, args.requests, elapsed, elapsed * 1e6 / args.requests, value, host_ops))
+    expected = "loaded=1 result=external-saori-ok value0=fixture-value"
+    ok = results[0][2] == 0 and results[1][2] == args.requests + 1
+    ok = ok and all(value == expected for _, _, _, value in results)
+    if not ok:
+        print("unexpected result (expected '%s', no host_op in process)" % expected)
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
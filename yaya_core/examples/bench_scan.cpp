@@ -0,0 +1,200 @@
+// Byte-scanning kernels (src/TextScan.cpp) on the Emily/4 dictionaries, per implementation.
+// For each of scalar / SSE2 / AVX2 (whichever the CPU has) it times
+//
+//   classify   the ASCII / UTF-8 check decodeContent runs on every dictionary
+//   cp932      the same check on the dictionaries converted to CP932 (rejected early)
+//   tokenize   Lexer::tokenize, whose whitespace, comment and string scanning use the kernels
+//
+// Before timing, it fuzzes every SIMD implementation against the scalar one:
+// classify, blankRun and findFirstOf on random buffers (ASCII, UTF-8, broken and
+// truncated sequences, at random alignments), and Lexer token streams on random sources.
+// A mismatch exits 1.
+//
+// usage: bench_scan [ghost root] [rounds]
+//   c++ -std=c++17 -O2 -I src examples/bench_scan.cpp src/TextScan.cpp src/Lexer.cpp -o bench_scan
+
+#include "Lexer.hpp"
+#include "TextScan.hpp"
+#include "Transcode.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using text_scan::Level;
+
+const char* levelName(Level level) {
+    switch (level) {
+        case Level::Scalar: return "scalar";
+        case Level::Sse2: return "sse2";
+        case Level::Avx2: return "avx2";
+    }
+    return "?";
+}
+
+std::vector<Level> availableLevels() {
+    std::vector<Level> levels;
+    for (Level wanted : {Level::Scalar, Level::Sse2, Level::Avx2}) {
+        Level got = text_scan::setLevel(wanted);
+        if (got == wanted) levels.push_back(got);
+    }
+    return levels;
+}
+
+std::vector<std::string> readDictionaries(const std::string& ghostRoot) {
+    std::vector<std::string> texts;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(ghostRoot)) {
+        if (entry.path().extension() != ".dic") continue;
+        std::ifstream file(entry.path(), std::ios::binary);
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        texts.push_back(buffer.str());
+    }
+    return texts;
+}
+
+std::string tokenDump(const std::string& source) {
+    Lexer lexer{std::string_view(source)};
+    std::string out;
+    for (const Token& token : lexer.tokenize()) {
+        out += std::to_string(static_cast<int>(token.type)) + ' ' + std::to_string(token.line) + ' ' +
+               std::to_string(token.column) + ' ';
+        out.append(token.value.data(), token.value.size());
+        out += '\n';
+    }
+    return out;
+}
+
+int failures = 0;
+
+void mismatch(const char* what, Level level, const std::string& input) {
+    if (++failures <= 10) {
+        std::fprintf(stderr, "MISMATCH %s (%s, %zu bytes):", what, levelName(level), input.size());
+        for (unsigned char c : input.substr(0, 48)) std::fprintf(stderr, " %02X", c);
+        std::fprintf(stderr, "\n");
+    }
+}
+
+// ASCII・UTF-8 の断片・壊れた列を混ぜた入力
+std::string randomText(std::mt19937& rng, size_t maxLength) {
+    static const char* const pieces[] = {
+        " ", "\t", "\r", "\n", "\v", "\f", "//", "/*", "*/", "*", "\"", "'", "\\", "#", "--", "a", "if",
+        "あ", "é", "😀", "\xC0", "\xE3\x81", "\xF0\x9F\x98", "\x80", "\xBF", "\xF8", "\xFF", "\xED\xA0\x80",
+        "                                ", "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t", "abcdefghijklmnopqrstuvwxyz0123"};
+    const size_t count = sizeof(pieces) / sizeof(pieces[0]);
+    std::string text;
+    const size_t length = rng() % (maxLength + 1);
+    while (text.size() < length) {
+        const unsigned pick = rng() % (count + 3);
+        if (pick == count) text.push_back('\0');
+        else if (pick > count) text.push_back(static_cast<char>(rng() & 0xFF));
+        else text += pieces[pick];
+    }
+    return text;
+}
+
+void fuzz(const std::vector<Level>& levels, const std::vector<std::string>& dictionaries, int rounds) {
+    std::mt19937 rng(7);
+    std::vector<std::string> inputs = dictionaries;
+    for (int i = 0; i < rounds; ++i) inputs.push_back(randomText(rng, i % 10 == 0 ? 2000 : 100));
+    const char needles[][4] = {{'\n', '\0', '\n', '\0'}, {'*', '\n', '\0', '*'}, {'"', '\\', '\0', '\n'}};
+
+    for (const std::string& input : inputs) {
+        // 32 バイト境界に対する位置を変えるため、先頭を 0〜31 バイトずらして置く
+        const size_t shift = rng() % 32;
+        const std::string shifted = std::string(shift, 'x') + input;
+        const char* p = shifted.data() + shift;
+        const size_t n = input.size();
+        text_scan::setLevel(Level::Scalar);
+        const text_scan::Encoding encoding = text_scan::classify(std::string_view(p, n));
+        const size_t start = n == 0 ? 0 : rng() % n;
+        const size_t blanks = text_scan::blankRun(p + start, n - start);
+        size_t found[3];
+        for (int k = 0; k < 3; ++k) {
+            found[k] = text_scan::findFirstOf(p + start, n - start, needles[k][0], needles[k][1], needles[k][2], needles[k][3]);
+        }
+        const std::string tokens = tokenDump(input);
+
+        for (Level level : levels) {
+            if (level == Level::Scalar) continue;
+            text_scan::setLevel(level);
+            if (text_scan::classify(std::string_view(p, n)) != encoding) mismatch("classify", level, input);
+            if (text_scan::blankRun(p + start, n - start) != blanks) mismatch("blankRun", level, input);
+            for (int k = 0; k < 3; ++k) {
+                if (text_scan::findFirstOf(p + start, n - start, needles[k][0], needles[k][1], needles[k][2],
+                                           needles[k][3]) != found[k]) {
+                    mismatch("findFirstOf", level, input);
+                }
+            }
+            if (tokenDump(input) != tokens) mismatch("Lexer tokens", level, input);
+        }
+    }
+}
+
+template <typename Body>
+double bestOf(int runs, Body body) {
+    double best = 1e30;
+    for (int i = 0; i < runs; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        body();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::string ghostRoot = argc > 1 ? argv[1] : "../emily4/ghost/master";
+    const int rounds = argc > 2 ? std::atoi(argv[2]) : 20000;
+
+    const std::vector<std::string> dictionaries = readDictionaries(ghostRoot);
+    std::vector<std::string> cp932;
+    size_t bytes = 0;
+    for (const std::string& text : dictionaries) {
+        bytes += text.size();
+        std::string converted;
+        transcode::utf8ToCp932Escaping(text, converted);
+        cp932.push_back(std::move(converted));
+    }
+    const std::vector<Level> levels = availableLevels();
+
+    fuzz(levels, dictionaries, rounds);
+
+    std::printf("%zu dictionaries, %.1f MB\n", dictionaries.size(), bytes / 1e6);
+    std::printf("%-8s %14s %14s %14s\n", "kernels", "classify ms", "cp932 ms", "tokenize ms");
+    size_t sink = 0;
+    for (Level level : levels) {
+        text_scan::setLevel(level);
+        const double classify = bestOf(20, [&] {
+            for (const std::string& text : dictionaries) sink += static_cast<size_t>(text_scan::classify(text));
+        });
+        const double rejected = bestOf(20, [&] {
+            for (const std::string& text : cp932) sink += static_cast<size_t>(text_scan::classify(text));
+        });
+        const double tokenize = bestOf(5, [&] {
+            for (const std::string& text : dictionaries) {
+                Lexer lexer{std::string_view(text)};
+                sink += lexer.tokenize().size();
+            }
+        });
+        std::printf("%-8s %14.3f %14.3f %14.1f\n", levelName(level), classify, rejected, tokenize);
+    }
+    if (sink == 0) std::printf("\n");
+
+    if (failures > 0) {
+        std::printf("%d mismatches against the scalar kernels\n", failures);
+        return 1;
+    }
+    std::printf("fuzz: %zu inputs, SIMD kernels identical to scalar\n", dictionaries.size() + static_cast<size_t>(rounds));
+    return 0;
+}
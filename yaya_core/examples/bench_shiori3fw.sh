@@ -0,0 +1,61 @@
+#!/bin/bash
+# Time Emily/4 SHIORI requests with the SHIORI3FW request() parsed by the dictionary
+# and with "shiori3fw_native": true (the VM sets the same variables directly).
+# Replays OnSecondChange / OnMouseMove / OnMouseDoubleClick N times each and prints
+# the wall time per mode. The SHIORI responses of both modes are diffed too, and
+# the script fails if Emily/4's request is not recognized as the stock one (with and
+# without constant folding), since the native mode then silently falls back.
+#
+# usage: examples/bench_shiori3fw.sh [iterations] [yaya_core binary]
+
+set -euo pipefail
+
+cd "$(dirname "$0")/.."
+
+iterations="${1:-20000}"
+bin="${2:-./build/yaya_core}"
+ghost_root="$(cd ../emily4/ghost/master && pwd)"
+work="$(mktemp -d)"
+trap 'rm -rf "$work"' EXIT
+
+source examples/ghost_dic_entries.sh
+entries="$(ghost_dic_entries "$ghost_root")"
+
+# 代行が使われたかは debug ログの "native" で見る
+for optimize in true false; do
+    {
+        printf '{"cmd":"load","ghost_root":"%s","dic_entries":%s,"shiori3fw_native":true,"optimize":%s,"log_level":"debug"}\n' \
+            "$ghost_root" "$entries" "$optimize"
+        echo '{"cmd":"request","method":"GET","id":"OnSecondChange","ref":["0","0","0","1","1"]}'
+    } | "$bin" 2> "$work/check.log" > /dev/null
+    if ! grep -q 'dispatcher (.*, native)' "$work/check.log"; then
+        echo "native path not taken (optimize=$optimize):"
+        grep 'stock SHIORI3FW' "$work/check.log" || true
+        exit 1
+    fi
+done
+
+for mode in dictionary native; do
+    native=false
+    [ "$mode" = native ] && native=true
+    {
+        printf '{"cmd":"load","ghost_root":"%s","dic_entries":%s,"shiori3fw_native":%s}\n' \
+            "$ghost_root" "$entries" "$native"
+        for ((i = 0; i < iterations; i++)); do
+            echo '{"cmd":"request","method":"GET","id":"OnSecondChange","ref":["0","0","0","1","1"]}'
+            echo '{"cmd":"request","method":"GET","id":"OnMouseMove","ref":["100","100","0","0","0head","0"]}'
+            echo '{"cmd":"request","method":"NOTIFY","id":"OnMouseDoubleClick","ref":["100","100","0","0","0bust","0"]}'
+        done
+    } > "$work/$mode.jsonl"
+
+    TIMEFORMAT="$(printf '%-10s %d x 3 requests: %%2Rs' "$mode" "$iterations")"
+    time "$bin" < "$work/$mode.jsonl" 2>/dev/null > "$work/$mode.out"
+done
+
+if cmp -s "$work/dictionary.out" "$work/native.out"; then
+    echo "responses: identical"
+else
+    echo "responses: DIFFER"
+    diff "$work/dictionary.out" "$work/native.out" | head -20
+    exit 1
+fi
@@ -0,0 +1,35 @@
+#!/bin/bash
+# Cold vs. warm startup of the bundled Emily/4 ghost with the parsed AST cache.
+# The first load runs against an empty cache_dir (full decode/preprocess/parse, then
+# the cache is written); the following loads reuse it. The "Loaded ... dictionaries in"
+# line yaya_core prints for each load is shown along with the wall time.
+#
+# usage: examples/bench_startup.sh [warm runs] [yaya_core binary]
+
+set -euo pipefail
+
+cd "$(dirname "$0")/.."
+
+runs="${1:-5}"
+bin="${2:-./build/yaya_core}"
+ghost_root="$(cd ../emily4/ghost/master && pwd)"
+work="$(mktemp -d)"
+trap 'rm -rf "$work"' EXIT
+
+source examples/ghost_dic_entries.sh
+entries="$(ghost_dic_entries "$ghost_root")"
+
+load_once() {
+    local label="$1" cache_dir="$2"
+    printf '{"cmd":"load","ghost_root":"%s","dic_entries":%s,"cache_dir":"%s"}\n' \
+        "$ghost_root" "$entries" "$cache_dir" > "$work/load.jsonl"
+    TIMEFORMAT="$(printf '%-6s %%3Rs' "$label")"
+    time "$bin" < "$work/load.jsonl" 2> "$work/load.err" > /dev/null
+    grep -o 'Loaded [0-9]*/[0-9]* dictionaries in .*' "$work/load.err" || true
+}
+
+load_once none ""
+load_once cold "$work/cache"
+for ((i = 1; i <= runs; i++)); do
+    load_once warm "$work/cache"
+done
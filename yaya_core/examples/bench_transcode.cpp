@@ -0,0 +1,213 @@
+// CP932 ⇔ UTF-8 conversions per second (src/Transcode.hpp) against the iconv path.
+// Three implementations are timed on a 187-byte SakuraScript response and on a 2 MB
+// dictionary built from the Emily/4 dictionaries:
+//
+//   iconv_open  iconv_open / iconv / iconv_close on every call (the old helpers)
+//   cached      transcode::iconvConvert (one descriptor per thread)
+//   table       transcode::cp932ToUtf8 / utf8ToCp932 / utf8ToCp932Escaping
+//
+// Every result is compared with the iconv_open path, and so is the SATORI-style
+// escaping of characters CP932 lacks (also on random byte strings). A mismatch exits 1.
+//
+// usage: bench_transcode [ghost root] [seconds per case]
+//   c++ -std=c++17 -O2 -I src examples/bench_transcode.cpp -o bench_transcode   (add -liconv on macOS)
+
+#include "Transcode.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// 変換のたびに記述子を開いて閉じる（置き換え前の DictionaryManager / satori_core と同じ）
+bool iconvOnce(const char* to, const char* from, const std::string& input, std::string& output) {
+    iconv_t cd = iconv_open(to, from);
+    if (cd == reinterpret_cast<iconv_t>(-1)) return false;
+    std::string result(input.size() * 2 + 16, '\0');
+    char* in = const_cast<char*>(input.data());
+    size_t inLeft = input.size();
+    size_t used = 0;
+    while (inLeft > 0) {
+        char* out = &result[used];
+        size_t outLeft = result.size() - used;
+        size_t rc = iconv(cd, &in, &inLeft, &out, &outLeft);
+        used = result.size() - outLeft;
+        if (rc != static_cast<size_t>(-1)) break;
+        if (errno != E2BIG) {
+            iconv_close(cd);
+            return false;
+        }
+        result.resize(result.size() * 2);
+    }
+    iconv_close(cd);
+    result.resize(used);
+    output = std::move(result);
+    return true;
+}
+
+// satori_core の UTF8toSJISEscapingUnknown（置き換え前）: 1 文字ずつ iconv_open で変換する
+std::string escapingOnce(const std::string& source) {
+    std::string output;
+    for (size_t index = 0; index < source.size();) {
+        const unsigned char first = static_cast<unsigned char>(source[index]);
+        size_t length = 1;
+        uint32_t scalar = first;
+        if ((first & 0xE0) == 0xC0) {
+            length = 2;
+            scalar = first & 0x1F;
+        } else if ((first & 0xF0) == 0xE0) {
+            length = 3;
+            scalar = first & 0x0F;
+        } else if ((first & 0xF8) == 0xF0) {
+            length = 4;
+            scalar = first & 0x07;
+        }
+        if (index + length > source.size()) {
+            length = 1;
+            scalar = first;
+        }
+        for (size_t offset = 1; offset < length; ++offset) {
+            scalar = (scalar << 6) | (static_cast<unsigned char>(source[index + offset]) & 0x3F);
+        }
+        std::string converted;
+        if (iconvOnce("CP932", "UTF-8", source.substr(index, length), converted)) {
+            output += converted;
+        } else {
+            char escaped[40];
+            std::snprintf(escaped, sizeof(escaped), "?escape!unicode[0x%X]", scalar);
+            output += escaped;
+        }
+        index += length;
+    }
+    return output;
+}
+
+// 2 MB の UTF-8 辞書（CP932 にある文字だけの行）
+std::string buildDictionary(const std::string& ghostRoot) {
+    std::string lines;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(ghostRoot)) {
+        if (entry.path().extension() != ".dic") continue;
+        std::ifstream file(entry.path(), std::ios::binary);
+        std::string line;
+        std::string unused;
+        while (std::getline(file, line)) {
+            line += '\n';
+            if (iconvOnce("CP932", "UTF-8", line, unused)) lines += line;
+        }
+    }
+    if (lines.empty()) lines = "OnBoot\n{\n\t\"\\0\\s[0]こんにちは。\\e\"\n}\n";
+    std::string text;
+    while (text.size() < 2u * 1024u * 1024u) text += lines;
+    return text;
+}
+
+double measure(double seconds, const std::function<void()>& body) {
+    using Clock = std::chrono::steady_clock;
+    long calls = 0;
+    const auto start = Clock::now();
+    double elapsed = 0;
+    do {
+        for (int i = 0; i < 8; ++i) body();
+        calls += 8;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (elapsed < seconds);
+    return calls / elapsed;
+}
+
+int failures = 0;
+
+void expectSame(const char* what, const std::string& expected, const std::string& actual) {
+    if (expected == actual) return;
+    std::fprintf(stderr, "MISMATCH %s (%zu vs %zu bytes)\n", what, expected.size(), actual.size());
+    ++failures;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::string ghostRoot = argc > 1 ? argv[1] : "../emily4/ghost/master";
+    const double seconds = argc > 2 ? std::atof(argv[2]) : 1.0;
+
+    const std::string script =
+        "\\0\\s[0]ねえ、今日はいい天気だね。\\w9\\w9\\1\\s[10]そうだな。散歩にでも行くか？\\w9"
+        "\\0\\s[5]うん、行こう！\\_w[500]\\n\\n[half]\\q[はい,OnYes]\\q[いいえ,OnNo]\\e";
+    const std::string dictionary = buildDictionary(ghostRoot);
+    std::string scriptCp932;
+    std::string dictionaryCp932;
+    iconvOnce("CP932", "UTF-8", script, scriptCp932);
+    iconvOnce("CP932", "UTF-8", dictionary, dictionaryCp932);
+
+    // 結果の一致
+    std::string expected;
+    std::string actual;
+    for (const std::string* text : {&script, &dictionary}) {
+        iconvOnce("CP932", "UTF-8", *text, expected);
+        transcode::utf8ToCp932(*text, actual);
+        expectSame("utf8ToCp932", expected, actual);
+        transcode::utf8ToCp932Escaping(*text, actual);
+        expectSame("utf8ToCp932Escaping", expected, actual);
+        std::string back;
+        transcode::cp932ToUtf8(actual, back);
+        expectSame("cp932ToUtf8", *text, back);
+    }
+    std::mt19937 rng(1);
+    const char* pieces[] = {"a", "\\", "~", "あ", "ｱ", "¥", "‾", "−", "〜", "①", "髙", "😀", "\xEF\xBB\xBF",
+                            "\xC0\x80", "\xED\xA0\x80", "\x80", "\xE3\x81", "\xF8", "\xF4\x90\x80\x80", "\xFF"};
+    for (int round = 0; round < 20000; ++round) {
+        std::string text;
+        const int count = static_cast<int>(rng() % 12);
+        for (int i = 0; i < count; ++i) {
+            if (rng() % 4 == 0) text.push_back(static_cast<char>(rng() & 0xFF));
+            else text += pieces[rng() % (sizeof(pieces) / sizeof(pieces[0]))];
+        }
+        transcode::utf8ToCp932Escaping(text, actual);
+        expectSame("utf8ToCp932Escaping (random)", escapingOnce(text), actual);
+        const bool expectedOk = iconvOnce("CP932", "UTF-8", text, expected);
+        const bool actualOk = transcode::utf8ToCp932(text, actual);
+        if (expectedOk != actualOk) expectSame("utf8ToCp932 (random) result", "", "x");
+        else if (expectedOk) expectSame("utf8ToCp932 (random)", expected, actual);
+        // 同じバイト列を CP932 として読む
+        const bool decodedOk = iconvOnce("UTF-8", "CP932", text, expected);
+        if (decodedOk != transcode::cp932ToUtf8(text, actual)) expectSame("cp932ToUtf8 (random) result", "", "x");
+        else if (decodedOk) expectSame("cp932ToUtf8 (random)", expected, actual);
+    }
+
+    struct Case {
+        const char* name;
+        const std::string* utf8;
+        const std::string* cp932;
+    };
+    const Case cases[] = {{"script 187B", &script, &scriptCp932}, {"dictionary 2MB", &dictionary, &dictionaryCp932}};
+    std::printf("%-16s %-12s %14s %14s %14s\n", "input", "direction", "iconv_open/s", "cached/s", "table/s");
+    for (const Case& c : cases) {
+        std::string out;
+        std::printf("%-16s %-12s %14.0f %14.0f %14.0f\n", c.name, "UTF-8>CP932",
+                    measure(seconds, [&] { iconvOnce("CP932", "UTF-8", *c.utf8, out); }),
+                    measure(seconds, [&] { transcode::iconvConvert("CP932", "UTF-8", *c.utf8, out); }),
+                    measure(seconds, [&] { transcode::utf8ToCp932(*c.utf8, out); }));
+        std::printf("%-16s %-12s %14.0f %14.0f %14.0f\n", c.name, "CP932>UTF-8",
+                    measure(seconds, [&] { iconvOnce("UTF-8", "CP932", *c.cp932, out); }),
+                    measure(seconds, [&] { transcode::iconvConvert("UTF-8", "CP932", *c.cp932, out); }),
+                    measure(seconds, [&] { transcode::cp932ToUtf8(*c.cp932, out); }));
+    }
+    std::printf("%-16s %-12s %14.0f %14s %14.0f\n", "script 187B", "escaping",
+                measure(seconds, [&] { escapingOnce(script); }), "-",
+                measure(seconds, [&] {
+                    std::string out;
+                    transcode::utf8ToCp932Escaping(script, out);
+                }));
+
+    if (failures > 0) {
+        std::printf("%d mismatches against iconv\n", failures);
+        return 1;
+    }
+    std::printf("results: identical to iconv\n");
+    return 0;
+}
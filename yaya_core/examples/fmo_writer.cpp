@@ -0,0 +1,86 @@
+// Stand-in for the host's FMO publisher (see src/FmoSegment.hpp).
+// Creates the shared-memory segment and republishes an SSP-style snapshot in a loop
+// until SIGINT/SIGTERM, then removes the segment. Every publish bumps a generation
+// number written as the first and the last record, so a reader can detect a torn
+// snapshot by comparing the two.
+//
+// usage: fmo_writer NAME [interval_us] [ghosts]
+//   c++ -std=c++17 -O2 -I src examples/fmo_writer.cpp -o fmo_writer   (add -lrt on older glibc)
+
+#include "FmoSegment.hpp"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <chrono>
+
+namespace {
+
+volatile std::sig_atomic_t stopping = 0;
+
+void onSignal(int) { stopping = 1; }
+
+// 0.generation / 9.generation を固定幅にして、読み手が位置だけで取り出せるようにする
+std::string buildSnapshot(unsigned generation, int ghosts) {
+    char gen[16];
+    std::snprintf(gen, sizeof gen, "%010u", generation);
+    std::string out = std::string("0.generation\x01") + gen + "\r\n";
+    for (int i = 1; i <= ghosts; ++i) {
+        const std::string id = std::to_string(i);
+        const std::string path = "/Users/ourin/Documents/Ourin/ghost/ghost" + id + "/";
+        out += id + ".name\x01" "sakura" + id + "\r\n";
+        out += id + ".keroname\x01" "unyuu" + id + "\r\n";
+        out += id + ".fullname\x01" "Ghost " + id + "\r\n";
+        out += id + ".ghostname\x01" "Ghost " + id + "\r\n";
+        out += id + ".path\x01/Applications/Ourin.app/\r\n";
+        out += id + ".ghostpath\x01" + path + "\r\n";
+        out += id + ".sakura.surface\x01" + std::to_string(generation % 10) + "\r\n";
+        out += id + ".kero.surface\x01" "10\r\n";
+        out += id + ".hwnd\x01" + std::to_string(1000 + i) + "\r\n";
+        out += id + ".kerohwnd\x01" + std::to_string(2000 + i) + "\r\n";
+        out += id + ".hwndlist\x01" + std::to_string(1000 + i) + "," + std::to_string(2000 + i) + "\r\n";
+        out += id + ".modulestate\x01shiori:running\r\n";
+        out += id + ".shell\x01master\r\n";
+        out += id + ".balloon\x01" "default\r\n";
+    }
+    out += std::string("9.generation\x01") + gen + "\r\n";
+    return out;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s NAME [interval_us] [ghosts]\n", argv[0]);
+        return 2;
+    }
+    const std::string name = argv[1];
+    const long intervalUs = argc > 2 ? std::atol(argv[2]) : 0;
+    const int ghosts = argc > 3 ? std::atoi(argv[3]) : 3;
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    fmo_segment::Writer writer;
+    if (!writer.create(name)) {
+        std::perror("fmo_writer: shm_open");
+        return 1;
+    }
+    unsigned generation = 0;
+    writer.publish(buildSnapshot(generation, ghosts));
+    // 準備ができたことを親に知らせる
+    std::printf("ready\n");
+    std::fflush(stdout);
+
+    while (!stopping) {
+        if (!writer.publish(buildSnapshot(++generation, ghosts))) {
+            std::fprintf(stderr, "fmo_writer: snapshot exceeds segment capacity\n");
+            return 1;
+        }
+        if (intervalUs > 0) std::this_thread::sleep_for(std::chrono::microseconds(intervalUs));
+    }
+    std::fprintf(stderr, "fmo_writer: published %u snapshots\n", generation + 1);
+    return 0;
+}
@@ -0,0 +1,24 @@
+# Helper sourced by the bench_*.sh scripts.
+# ghost_dic_entries <ghost_root> prints the "dic_entries" JSON array for a load
+# request, following the include / dic lines of the ghost's yaya.txt.
+
+# yaya.txt の include / dic 行を辿って dic_entries の要素を出力する
+_ghost_dic_entries_from() {
+    local root="$1" file="$2"
+    local kind path enc
+    while IFS=, read -r kind path enc _; do
+        kind="$(echo "$kind" | tr -d '\r\357\273\277' | xargs)"
+        path="$(echo "$path" | sed 's|//.*||' | tr -d '\r' | xargs)"
+        enc="$(echo "${enc:-}" | sed 's|//.*||' | tr -d '\r' | xargs)"
+        case "$kind" in
+            include) _ghost_dic_entries_from "$root" "$path" ;;
+            dic) printf '{"path":"%s","encoding":"%s"},' "$path" "$enc" ;;
+        esac
+    done < "$root/$file"
+}
+
+ghost_dic_entries() {
+    local entries
+    entries="$(_ghost_dic_entries_from "$1" yaya.txt)"
+    echo "[${entries%,}]"
+}
@@ -0,0 +1,46 @@
+#!/bin/bash
+# Profile a YAYA ghost (Emily/4 by default) with the "profile" command.
+# Starts the profiler before load, replays OnSecondChange / OnMouseMove /
+# OnMouseDoubleClick N times each, then dumps:
+#   <out>.folded  collapsed stacks weighted by self time in microseconds
+#                 (flamegraph.pl <out>.folded > <out>.svg, or open in speedscope)
+#   <out>.json    per-event / function / builtin / %() call counts and
+#                 inclusive / exclusive times
+# and prints the ten functions with the highest inclusive time.
+#
+# usage: examples/profile_ghost.sh [iterations] [yaya_core binary] [output prefix] [ghost root]
+
+set -euo pipefail
+
+cd "$(dirname "$0")/.."
+
+iterations="${1:-200}"
+bin="${2:-./build/yaya_core}"
+out="$(realpath -m "${3:-profile}")"
+ghost_root="$(cd "${4:-../emily4/ghost/master}" && pwd)"
+
+source examples/ghost_dic_entries.sh
+entries="$(ghost_dic_entries "$ghost_root")"
+
+{
+    echo '{"cmd":"profile","action":"start"}'
+    printf '{"cmd":"load","ghost_root":"%s","dic_entries":%s,"log_level":"warn"}\n' "$ghost_root" "$entries"
+    for ((i = 0; i < iterations; i++)); do
+        echo '{"cmd":"request","method":"GET","id":"OnSecondChange","ref":["0","0","0","1","1"]}'
+        echo '{"cmd":"request","method":"GET","id":"OnMouseMove","ref":["100","100","0","0","0head","0"]}'
+        echo '{"cmd":"request","method":"GET","id":"OnMouseDoubleClick","ref":["0","0","0","0","Head","0"]}'
+    done
+    printf '{"cmd":"profile","action":"dump","include_collapsed":false,"collapsed_path":"%s","summary_path":"%s"}\n' \
+        "$out.folded" "$out.json"
+} | "$bin" 2>/dev/null | tail -1 | grep -q '"ok":true' || { echo "profile dump failed" >&2; exit 1; }
+
+echo "wrote $out.folded and $out.json"
+python3 - "$out.json" <<'EOF'
+import json, sys
+summary = json.load(open(sys.argv[1]))
+print("total %.1f ms" % (summary["total_us"] / 1000))
+print("%10s %10s %8s  %s" % ("incl ms", "self ms", "calls", "function"))
+for row in summary["functions"][:10]:
+    print("%10.1f %10.1f %8d  %s (%s)" % (row["inclusive_us"] / 1000, row["exclusive_us"] / 1000,
+                                       row["calls"], row["name"], row["source"]))
+EOF
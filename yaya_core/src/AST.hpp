@@ -1,8 +1,11 @@
 #pragma once
 
+#include "Value.hpp"
 #include <string>
 #include <vector>
 #include <memory>
+#include <unordered_map>
+#include <utility>
 
 namespace AST {
 
@@ -30,22 +33,108 @@ enum class NodeType {
     Parallel
 };
 
+// 演算子（パーサがトークンから直接決める。評価時の文字列比較を避ける）
+enum class BinaryOperator {
+    Add, Sub, Mul, Div, Mod,
+    Eq, Ne, Lt, Gt, Le, Ge,
+    LogicalAnd, LogicalOr, BitAnd, In
+};
+
+enum class UnaryOperator {
+    Not, Negate, Reference
+};
+
 struct Node {
     NodeType type;
     virtual ~Node() = default;
 };
 
+// VM が解決した変数スロットのキャッシュ。
+// scope は解決に使った表（VM のグローバル表、または関数ごとのローカルレイアウト）の識別子で、
+// 実行時の表と一致するときだけ index をそのまま使う。0 は未解決。
+struct VarSlot {
+    unsigned long long scope = 0;
+    int index = -1;
+};
+
+// VM の関数表で解決した呼び出し先のキャッシュ（scope が VM の関数表と一致するときだけ index を使う）
+struct FunctionSlot {
+    unsigned long long scope = 0;
+    int index = -1;
+};
+
+// 呼び出しノードの種類。パーサが生成する内部関数名（__assign__ 等）をノード生成時に判別し、
+// 実行時に名前を比較しない。Function は通常の関数（組み込み/ユーザー定義）呼び出し。
+enum class CallKind {
+    Function,
+    ArrayLiteral,       // __array_literal__
+    ArrayConcatAssign,  // __array_concat_assign__
+    Range,              // __range__
+    Index,              // __index__
+    PostInc, PostDec, PreInc, PreDec,
+    Assign, PlusAssign, MinusAssign, StarAssign, SlashAssign, PercentAssign, ConcatAssign,
+    Swap                // E.Swap
+};
+
+inline CallKind classifyCall(const std::string& name) {
+    if (name.size() < 4 || (name[0] != '_' && name != "E.Swap")) return CallKind::Function;
+    static const std::pair<const char*, CallKind> kinds[] = {
+        {"__array_literal__", CallKind::ArrayLiteral},
+        {"__array_concat_assign__", CallKind::ArrayConcatAssign},
+        {"__range__", CallKind::Range},
+        {"__index__", CallKind::Index},
+        {"__postinc__", CallKind::PostInc},
+        {"__postdec__", CallKind::PostDec},
+        {"__preinc__", CallKind::PreInc},
+        {"__predec__", CallKind::PreDec},
+        {"__assign__", CallKind::Assign},
+        {"__plus_assign__", CallKind::PlusAssign},
+        {"__minus_assign__", CallKind::MinusAssign},
+        {"__star_assign__", CallKind::StarAssign},
+        {"__slash_assign__", CallKind::SlashAssign},
+        {"__percent_assign__", CallKind::PercentAssign},
+        {"__concat_assign__", CallKind::ConcatAssign},
+        {"E.Swap", CallKind::Swap},
+    };
+    for (const auto& k : kinds) {
+        if (name == k.first) return k.second;
+    }
+    return CallKind::Function;
+}
+
+// 文字列リテラル中の %(...) を分解したテンプレートの1片
+// Text: そのまま連結する文字列（SSP 変数や不正な %( もここに入る）
+// Expression: 事前にパースした埋め込み式。評価失敗時は source を変数名として参照する
+// Fallback: パースできなかった埋め込み式。source を変数名として参照する
+struct InterpolationSegment {
+    enum class Kind { Text, Expression, Fallback };
+    Kind kind = Kind::Text;
+    std::string source;
+    std::vector<std::shared_ptr<Node>> body;
+};
+
 struct LiteralNode : Node {
-    std::string value;
+    std::string value;   // 文字列リテラルの内容 / 数値リテラルのソース表記
     bool isString;
-    
-    explicit LiteralNode(const std::string& v, bool str = false) : value(v), isString(str) {
+    // 数値リテラルの値（パース時にデコード済み）
+    Value number;
+    // 埋め込み式テンプレートのキャッシュ（初回評価時に VM が構築する）
+    mutable std::shared_ptr<const std::vector<InterpolationSegment>> interpolation;
+
+    // 文字列リテラル
+    explicit LiteralNode(const std::string& v) : value(v), isString(true) {
+        type = NodeType::Literal;
+    }
+    // 数値リテラル
+    LiteralNode(const std::string& text, const Value& num) : value(text), isString(false), number(num) {
         type = NodeType::Literal;
     }
 };
 
 struct VariableNode : Node {
     std::string name;
+    mutable VarSlot slot;
+    mutable FunctionSlot function;  // 未定義変数を同名関数の呼び出しとして扱うときの解決先
     
     explicit VariableNode(const std::string& n) : name(n) {
         type = NodeType::Variable;
@@ -53,21 +142,21 @@ struct VariableNode : Node {
 };
 
 struct BinaryOpNode : Node {
-    std::string op;
+    BinaryOperator op;
     std::shared_ptr<Node> left;
     std::shared_ptr<Node> right;
     
-    BinaryOpNode(const std::string& o, std::shared_ptr<Node> l, std::shared_ptr<Node> r)
+    BinaryOpNode(BinaryOperator o, std::shared_ptr<Node> l, std::shared_ptr<Node> r)
         : op(o), left(l), right(r) {
         type = NodeType::BinaryOp;
     }
 };
 
 struct UnaryOpNode : Node {
-    std::string op;
+    UnaryOperator op;
     std::shared_ptr<Node> operand;
     
-    UnaryOpNode(const std::string& o, std::shared_ptr<Node> operand)
+    UnaryOpNode(UnaryOperator o, std::shared_ptr<Node> operand)
         : op(o), operand(operand) {
         type = NodeType::UnaryOp;
     }
@@ -87,9 +176,11 @@ struct TernaryNode : Node {
 struct CallNode : Node {
     std::string functionName;
     std::vector<std::shared_ptr<Node>> arguments;
+    CallKind kind;
+    mutable FunctionSlot target;
     
     CallNode(const std::string& name, const std::vector<std::shared_ptr<Node>>& args)
-        : functionName(name), arguments(args) {
+        : functionName(name), arguments(args), kind(classifyCall(name)) {
         type = NodeType::Call;
     }
 };
@@ -97,6 +188,7 @@ struct CallNode : Node {
 struct ArrayAccessNode : Node {
     std::string arrayName;
     std::shared_ptr<Node> index;
+    mutable VarSlot slot;
     
     ArrayAccessNode(const std::string& name, std::shared_ptr<Node> idx)
         : arrayName(name), index(idx) {
@@ -107,6 +199,7 @@ struct ArrayAccessNode : Node {
 struct AssignmentNode : Node {
     std::string variableName;
     std::shared_ptr<Node> value;
+    mutable VarSlot slot;
     
     AssignmentNode(const std::string& name, std::shared_ptr<Node> val)
         : variableName(name), value(val) {
@@ -162,6 +255,7 @@ struct ForeachNode : Node {
     std::shared_ptr<Node> arrayExpr; // expression yielding the array to iterate
     std::string varName;             // loop variable name
     std::vector<std::shared_ptr<Node>> body;
+    mutable VarSlot slot;            // loop variable slot
 
     ForeachNode(std::shared_ptr<Node> arr, const std::string& var,
                 const std::vector<std::shared_ptr<Node>>& b)
@@ -213,12 +307,24 @@ struct WhenClauseNode : Node {
     }
 };
 
+// case の when 値の索引。先頭から続く「一致値がすべて文字列/整数リテラルの句」について、
+// 値の文字列表現から最初にその値を持つ句の番号を引く。Value の == は実数どうし・実数と
+// 数値の比較を除けば文字列表現の一致と同じなので、検査値が実数でなければ順に比較した
+// ときと同じ句が選ばれる。ただし配列の文字列表現は比較のたびに乱数で要素を選ぶので、
+// 配列も索引を使わない（caseIndexable）。hashedClauses 番目以降の句は従来どおり順に評価する。
+struct CaseTable {
+    std::unordered_map<std::string, int> index;
+    size_t hashedClauses = 0;
+};
+
 // 'case expr { when ... { } ... others { } }' — evaluates expr once and runs the
 // first matching when clause (or the others/default fallback).
 struct CaseNode : Node {
     std::shared_ptr<Node> expression;                       // evaluated exactly once
     std::vector<std::shared_ptr<WhenClauseNode>> whenClauses;
     std::vector<std::shared_ptr<Node>> othersBody;          // optional others/default body
+    // when 値の索引（初回評価/コンパイル時に caseTable が構築する。小さい case では空）
+    mutable std::shared_ptr<const CaseTable> table;
 
     CaseNode(std::shared_ptr<Node> expr,
              const std::vector<std::shared_ptr<WhenClauseNode>>& clauses,
@@ -228,6 +334,59 @@ struct CaseNode : Node {
     }
 };
 
+// 検査値で索引を引けるか（実数と配列は順に比較する）
+inline bool caseIndexable(const Value& test) {
+    return test.getType() != Value::Type::Real && test.getType() != Value::Type::Array;
+}
+
+// リテラルの when 値なら索引のキー（実行時の値の文字列表現）を返す
+inline bool caseKey(const std::shared_ptr<Node>& node, std::string& key) {
+    if (!node || node->type != NodeType::Literal) return false;
+    const auto& lit = static_cast<const LiteralNode&>(*node);
+    if (lit.isString) {
+        if (lit.value.find("%(") != std::string::npos) return false;
+        key = lit.value;
+        return true;
+    }
+    if (lit.number.getType() != Value::Type::Integer && lit.number.getType() != Value::Type::String) return false;
+    key = lit.number.asString();
+    return true;
+}
+
+// 索引を引くのは一致値がこの数以上あるときだけ（少なければ順に比較する方が速い）
+constexpr size_t kMinCaseTableValues = 8;
+
+inline const CaseTable& caseTable(const CaseNode& node) {
+    if (node.table) return *node.table;
+    auto table = std::make_shared<CaseTable>();
+    std::string key;
+    size_t values = 0;
+    for (size_t i = 0; i < node.whenClauses.size(); ++i) {
+        const auto& clause = node.whenClauses[i];
+        if (!clause) break;
+        bool literal = true;
+        for (const auto& mv : clause->matchValues) {
+            if (!caseKey(mv, key)) {
+                literal = false;
+                break;
+            }
+        }
+        if (!literal) break;
+        for (const auto& mv : clause->matchValues) {
+            caseKey(mv, key);
+            table->index.emplace(key, static_cast<int>(i));  // 同じ値は先の句が優先
+            values++;
+        }
+        table->hashedClauses = i + 1;
+    }
+    if (values < kMinCaseTableValues) {
+        table->index.clear();
+        table->hashedClauses = 0;
+    }
+    node.table = table;
+    return *node.table;
+}
+
 // 'parallel expr' — 式が返す配列を個々の出力候補として展開する（YAYA の parallel 修飾子）。
 // array/sequential 関数の候補収集では各要素を個別に積み、それ以外の文脈では1要素を
 // ランダムに選択して返す。
@@ -251,4 +410,94 @@ struct ContinueNode : Node {
     }
 };
 
+// 子ノードを順に f(std::shared_ptr<Node>&) へ渡す（VM の解決パスなど AST 全体の走査用）。
+// case の when 句は句ノード自体ではなく、その一致値と本体を直接渡す。
+template <typename F>
+void forEachChild(Node& node, F&& f) {
+    auto each = [&f](std::vector<std::shared_ptr<Node>>& nodes) {
+        for (auto& n : nodes) if (n) f(n);
+    };
+    auto one = [&f](std::shared_ptr<Node>& n) {
+        if (n) f(n);
+    };
+    switch (node.type) {
+        case NodeType::Function: each(static_cast<FunctionNode&>(node).body); break;
+        case NodeType::Block: each(static_cast<BlockNode&>(node).statements); break;
+        case NodeType::Return: one(static_cast<ReturnNode&>(node).value); break;
+        case NodeType::Assignment: one(static_cast<AssignmentNode&>(node).value); break;
+        case NodeType::If: {
+            auto& n = static_cast<IfNode&>(node);
+            one(n.condition);
+            each(n.thenBody);
+            each(n.elseBody);
+            break;
+        }
+        case NodeType::While: {
+            auto& n = static_cast<WhileNode&>(node);
+            one(n.condition);
+            each(n.body);
+            break;
+        }
+        case NodeType::For: {
+            auto& n = static_cast<ForNode&>(node);
+            one(n.init);
+            one(n.cond);
+            one(n.incr);
+            each(n.body);
+            break;
+        }
+        case NodeType::Foreach: {
+            auto& n = static_cast<ForeachNode&>(node);
+            one(n.arrayExpr);
+            each(n.body);
+            break;
+        }
+        case NodeType::Switch: {
+            auto& n = static_cast<SwitchNode&>(node);
+            one(n.expression);
+            each(n.cases);
+            break;
+        }
+        case NodeType::Case: {
+            auto& n = static_cast<CaseNode&>(node);
+            one(n.expression);
+            for (auto& clause : n.whenClauses) {
+                if (!clause) continue;
+                each(clause->matchValues);
+                each(clause->body);
+            }
+            each(n.othersBody);
+            break;
+        }
+        case NodeType::WhenClause: {
+            auto& n = static_cast<WhenClauseNode&>(node);
+            each(n.matchValues);
+            each(n.body);
+            break;
+        }
+        case NodeType::BinaryOp: {
+            auto& n = static_cast<BinaryOpNode&>(node);
+            one(n.left);
+            one(n.right);
+            break;
+        }
+        case NodeType::UnaryOp: one(static_cast<UnaryOpNode&>(node).operand); break;
+        case NodeType::Ternary: {
+            auto& n = static_cast<TernaryNode&>(node);
+            one(n.condition);
+            one(n.trueBranch);
+            one(n.falseBranch);
+            break;
+        }
+        case NodeType::Call: each(static_cast<CallNode&>(node).arguments); break;
+        case NodeType::ArrayAccess: one(static_cast<ArrayAccessNode&>(node).index); break;
+        case NodeType::Parallel: one(static_cast<ParallelNode&>(node).expr); break;
+        case NodeType::Break:
+        case NodeType::Continue:
+        case NodeType::Variable:
+        case NodeType::Literal:
+            break;
+    }
+}
+
 } // namespace AST
@@ -0,0 +1,150 @@
+#include "ArrayOps.hpp"
+#include "TextScan.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+namespace array_ops {
+
+namespace {
+
+bool isNumber(const Value& v) {
+    return v.getType() == Value::Type::Integer || v.getType() == Value::Type::Real;
+}
+
+// 比較キーを要素ごとに一度だけ求めて安定ソートする
+template <typename KeyFn>
+std::vector<Value> sortByKey(const std::vector<Value>& arr, bool descend, KeyFn keyOf) {
+    using Key = std::invoke_result_t<KeyFn, const Value&>;
+    std::vector<std::pair<Key, uint32_t>> keyed;
+    keyed.reserve(arr.size());
+    for (size_t i = 0; i < arr.size(); ++i) keyed.emplace_back(keyOf(arr[i]), static_cast<uint32_t>(i));
+    std::stable_sort(keyed.begin(), keyed.end(), [descend](const auto& a, const auto& b) {
+        return descend ? b.first < a.first : a.first < b.first;
+    });
+    std::vector<Value> result;
+    result.reserve(arr.size());
+    for (const auto& k : keyed) result.push_back(arr[k.second]);
+    return result;
+}
+
+} // namespace
+
+Index::Index(const Value& array) : array_(array), elements_(&array_.asArray()) {
+    for (size_t i = 0; i < elements_->size(); ++i) add(i);
+}
+
+void Index::add(size_t position) {
+    const Value& v = (*elements_)[position];
+    uint32_t pos = static_cast<uint32_t>(position);
+    byString_[v.asString()].push_back(pos);
+    if (isNumber(v)) byNumber_[v.asReal()].push_back(pos);
+}
+
+int Index::firstEqual(const std::vector<uint32_t>* positions, const Value& value, size_t start) const {
+    if (!positions) return -1;
+    auto it = std::lower_bound(positions->begin(), positions->end(), start);
+    for (; it != positions->end(); ++it) {
+        if ((*elements_)[*it] == value) return static_cast<int>(*it);
+    }
+    return -1;
+}
+
+int Index::find(const Value& value, size_t start) const {
+    // 等しい要素は必ず文字列表現か数値のどちらかのバケツに入っている
+    auto s = byString_.find(value.asString());
+    int found = firstEqual(s != byString_.end() ? &s->second : nullptr, value, start);
+    if (isNumber(value)) {
+        auto n = byNumber_.find(value.asReal());
+        int numeric = firstEqual(n != byNumber_.end() ? &n->second : nullptr, value, start);
+        if (numeric >= 0 && (found < 0 || numeric < found)) found = numeric;
+    }
+    return found;
+}
+
+std::vector<Value> dedup(const std::vector<Value>& arr) {
+    std::vector<Value> result;
+    Index seen;
+    seen.elements_ = &result;
+    for (const auto& v : arr) {
+        if (seen.find(v) >= 0) continue;
+        result.push_back(v);
+        seen.add(result.size() - 1);
+    }
+    return result;
+}
+
+std::vector<Value> sort(const std::vector<Value>& arr, const std::string& options) {
+    enum class Mode { String, Int, Real, Length } mode = Mode::String;
+    bool descend = false;
+    size_t pos = 0;
+    while (pos <= options.size()) {
+        size_t comma = options.find(',', pos);
+        if (comma == std::string::npos) comma = options.size();
+        std::string opt;
+        for (size_t i = pos; i < comma; ++i) {
+            unsigned char c = static_cast<unsigned char>(options[i]);
+            if (!std::isspace(c)) opt += static_cast<char>(std::tolower(c));
+        }
+        if (opt == "int" || opt == "integer") mode = Mode::Int;
+        else if (opt == "real" || opt == "double") mode = Mode::Real;
+        else if (opt == "length") mode = Mode::Length;
+        else if (opt == "string") mode = Mode::String;
+        else if (opt == "descend" || opt == "descending" || opt == "desc") descend = true;
+        else if (opt == "ascend" || opt == "ascending" || opt == "asc") descend = false;
+        pos = comma + 1;
+    }
+
+    switch (mode) {
+        case Mode::Int:
+            return sortByKey(arr, descend, [](const Value& v) { return v.asInt(); });
+        case Mode::Real:
+            return sortByKey(arr, descend, [](const Value& v) {
+                double d = v.asReal();
+                // NaN は比較できないので先頭に寄せる
+                return std::isnan(d) ? -std::numeric_limits<double>::infinity() : d;
+            });
+        case Mode::Length:
+            // STRLEN と同じく文字数で比べる
+            return sortByKey(arr, descend, [](const Value& v) { return text_scan::utf8Length(v.asString()); });
+        case Mode::String:
+            break;
+    }
+    return sortByKey(arr, descend, [](const Value& v) { return v.asString(); });
+}
+
+int SearchCache::find(const Value& array, const Value& value, size_t start) {
+    const std::vector<Value>& arr = array.asArray();
+    for (auto it = lru_.begin(); it != lru_.end(); ++it) {
+        if (it->body() != &arr) continue;
+        if (it != lru_.begin()) lru_.splice(lru_.begin(), lru_, it);
+        return lru_.front().find(value, start);
+    }
+
+    if (arr.size() >= kMinIndexedSize) {
+        if (lastScanned_ == &arr && lastScannedSize_ == arr.size()) {
+            scans_++;
+        } else {
+            lastScanned_ = &arr;
+            lastScannedSize_ = arr.size();
+            scans_ = 1;
+        }
+        if (scans_ >= kScansBeforeIndex) {
+            lru_.emplace_front(array);
+            if (lru_.size() > capacity_) lru_.pop_back();
+            lastScanned_ = nullptr;
+            scans_ = 0;
+            return lru_.front().find(value, start);
+        }
+    }
+
+    for (size_t i = start; i < arr.size(); ++i) {
+        if (arr[i] == value) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+} // namespace array_ops
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Value.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 配列の組み込み関数（ARRAYDEDUP / ASORT / ASEARCH 系）の下回り。
+// 一致判定は Value の == と同じ結果になるようにしている:
+//   - 数値どうし（整数/実数）は数値として比較する
+//   - それ以外の組み合わせは文字列表現（asString）の一致（配列どうし・辞書どうしは常に不一致）
+// そのため「文字列表現」と「数値」の 2 つのハッシュで候補を絞り、最後に == で確かめる。
+namespace array_ops {
+
+// Value の == で等しい要素を引く索引（要素の位置は昇順に並ぶ）
+class Index {
+public:
+    explicit Index(const Value& array);
+
+    // 索引を作った配列本体（コピーオンライトなので、この索引が持っている間は内容が変わらない）
+    const std::vector<Value>* body() const { return &array_.asArray(); }
+
+    // start 以降で value と等しい最初の要素の位置（無ければ -1）
+    int find(const Value& value, size_t start = 0) const;
+
+private:
+    Index() = default;
+    friend std::vector<Value> dedup(const std::vector<Value>& arr);
+
+    // elements_ の position 番目を索引に入れる
+    void add(size_t position);
+
+    Value array_;
+    const std::vector<Value>* elements_ = nullptr;
+    std::unordered_map<std::string, std::vector<uint32_t>> byString_;
+    std::unordered_map<double, std::vector<uint32_t>> byNumber_;
+
+    int firstEqual(const std::vector<uint32_t>* positions, const Value& value, size_t start) const;
+};
+
+// 最初に現れた要素を残して重複を除く（O(n)）
+std::vector<Value> dedup(const std::vector<Value>& arr);
+
+// 並べ替えの方式: options は "string"（既定）/ "int" / "real"（"double"）/ "length" と
+// "ascend"（既定）/ "descend" をカンマ区切りで組み合わせる。
+// 比較に使うキーは要素ごとに一度だけ求め、同じキーの要素は元の順序を保つ。
+std::vector<Value> sort(const std::vector<Value>& arr, const std::string& options);
+
+// 繰り返し検索される配列の索引キャッシュ（VM ごと）。
+// 同じ配列本体（同じ要素数）が続けて何度か検索されたら索引を作り、直近の数個を保持する。
+// 索引は配列の値を共有して持つので、変数側で配列を書き換えると別の本体になり、
+// 古い索引は使われなくなる（やがて LRU で捨てられる）。
+class SearchCache {
+public:
+    explicit SearchCache(size_t capacity = 4) : capacity_(capacity) {}
+
+    // start 以降で value と等しい最初の要素の位置（無ければ -1）
+    int find(const Value& array, const Value& value, size_t start = 0);
+
+private:
+    // これより小さい配列は毎回そのまま走査する
+    static constexpr size_t kMinIndexedSize = 64;
+    // 同じ配列をこの回数走査したら索引を作る（追加しながら検索する配列では作らない）
+    static constexpr int kScansBeforeIndex = 3;
+
+    size_t capacity_;
+    std::list<Index> lru_;  // 先頭が直近に使ったもの
+    // 直前に走査だけした配列本体と要素数（同じ配列かの目安にだけ使い、参照はしない）
+    const std::vector<Value>* lastScanned_ = nullptr;
+    size_t lastScannedSize_ = 0;
+    int scans_ = 0;
+};
+
+} // namespace array_ops
@@ -1,5 +1,6 @@
 #include "Base64.hpp"
 #include <string>
+#include <cstddef>
 
 namespace Base64 {
     std::string encode(const std::string& input) {
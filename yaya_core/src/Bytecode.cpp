@@ -0,0 +1,606 @@
+#include "Bytecode.hpp"
+#include "VM.hpp"
+#include "Log.hpp"
+#include <chrono>
+
+namespace Bytecode {
+
+namespace {
+
+class Compiler {
+public:
+    explicit Compiler(Chunk& chunk) : chunk_(chunk) {}
+
+    void compileFunction(const AST::FunctionNode& function) {
+        const std::string& ftype = function.functionType;
+        chunk_.collect = (ftype.find("array") != std::string::npos ||
+                          ftype.find("sequential") != std::string::npos);
+
+        // loops[0]: 関数本体。ループ外の break/continue は本体の終端へ抜ける
+        chunk_.loops.push_back(LoopTarget{});
+
+        if (chunk_.collect) {
+            for (const auto& stmt : function.body) {
+                if (!stmt) continue;
+                if (stmt->type == AST::NodeType::Parallel) {
+                    compileExpr(static_cast<AST::ParallelNode&>(*stmt).expr);
+                    emit(OpCode::CollectExpand);
+                    continue;
+                }
+                compileStatement(stmt);
+                emit(stmt->type == AST::NodeType::Assignment ? OpCode::Pop : OpCode::Collect);
+            }
+            chunk_.loops[0].depth = 0;
+        } else {
+            compileBlock(function.body);
+            chunk_.loops[0].depth = 1;
+        }
+
+        int end = here();
+        emit(OpCode::End);
+        chunk_.loops[0].breakTarget = end;
+        chunk_.loops[0].continueTarget = end;
+        for (int at : functionExits_) chunk_.code[at].b = end;
+    }
+
+private:
+    Chunk& chunk_;
+    int depth_ = 0;                        // コンパイル時のスタック深さ
+    std::vector<int> loopStack_;           // 囲んでいるループの LoopTarget index
+    std::vector<int> functionExits_;       // 関数終端へ飛ぶ Unwind（終端位置は最後に埋める）
+    struct PendingUnwind {
+        int at;
+        int loop;
+        bool isBreak;
+    };
+    std::vector<PendingUnwind> pendingUnwinds_;  // ループ内の break/continue（ループ終了時に埋める）
+
+    int here() const { return static_cast<int>(chunk_.code.size()); }
+
+    int emit(OpCode op, int32_t a = 0, int32_t b = 0, int32_t c = 0) {
+        chunk_.code.push_back(Instr{op, a, b, c});
+        depth_ += stackEffect(op, a, b);
+        return here() - 1;
+    }
+
+    static int stackEffect(OpCode op, int32_t a, int32_t b) {
+        switch (op) {
+            case OpCode::PushConst:
+            case OpCode::PushVoid:
+            case OpCode::LoadVar:
+            case OpCode::IncDec:
+            case OpCode::Eval:
+            case OpCode::ForeachInit:
+                return 1;
+            case OpCode::Pop:
+            case OpCode::Keep:
+            case OpCode::BinOp:
+            case OpCode::JumpIfFalse:
+            case OpCode::JumpIfTrue:
+            case OpCode::Collect:
+            case OpCode::CollectExpand:
+            case OpCode::Return:
+                return -1;
+            case OpCode::PopN:
+                return -a;
+            case OpCode::MakeArray:
+                return 1 - a;
+            case OpCode::Call:
+                return 1 - b;
+            default:
+                return 0;
+        }
+    }
+
+    void patch(int at, int32_t target) { chunk_.code[at].a = target; }
+
+    int currentLoop() const { return loopStack_.empty() ? 0 : loopStack_.back(); }
+
+    int addNode(const std::shared_ptr<AST::Node>& node) {
+        chunk_.nodes.push_back(node);
+        return static_cast<int>(chunk_.nodes.size()) - 1;
+    }
+
+    int addConstant(Value v) {
+        chunk_.constants.push_back(std::move(v));
+        return static_cast<int>(chunk_.constants.size()) - 1;
+    }
+
+    // ブロック: 代入文以外の最後の文の値を残す（VM::executeBlock と同じ規則）
+    void compileBlock(const std::vector<std::shared_ptr<AST::Node>>& statements) {
+        emit(OpCode::PushVoid);
+        for (const auto& stmt : statements) {
+            if (!stmt) continue;
+            compileStatement(stmt);
+            if (stmt->type == AST::NodeType::Assignment) {
+                emit(OpCode::Pop);
+            } else {
+                emit(OpCode::Keep, 0);
+            }
+        }
+    }
+
+    void compileUnwind(bool isBreak) {
+        int loop = currentLoop();
+        if (loop == 0) {
+            int at = emit(OpCode::Unwind, chunk_.collect ? 0 : 1, 0);
+            functionExits_.push_back(at);
+        } else {
+            int at = emit(OpCode::Unwind, 0, 0);
+            pendingUnwinds_.push_back({at, loop, isBreak});
+        }
+    }
+
+    void finishLoop(int loop) {
+        const LoopTarget& lt = chunk_.loops[loop];
+        for (auto& p : pendingUnwinds_) {
+            if (p.loop != loop) continue;
+            chunk_.code[p.at].a = lt.depth;
+            chunk_.code[p.at].b = p.isBreak ? lt.breakTarget : lt.continueTarget;
+        }
+        loopStack_.pop_back();
+    }
+
+    int beginLoop() {
+        chunk_.loops.push_back(LoopTarget{});
+        int loop = static_cast<int>(chunk_.loops.size()) - 1;
+        chunk_.loops[loop].depth = depth_;
+        loopStack_.push_back(loop);
+        return loop;
+    }
+
+    // 文: 必ず値を1つ積む
+    void compileStatement(const std::shared_ptr<AST::Node>& node) {
+        switch (node->type) {
+            case AST::NodeType::Return: {
+                auto& ret = static_cast<AST::ReturnNode&>(*node);
+                if (ret.value) {
+                    compileExpr(ret.value);
+                } else {
+                    emit(OpCode::PushVoid);
+                }
+                emit(OpCode::Return);
+                emit(OpCode::PushVoid);  // 到達しない（深さの整合用）
+                return;
+            }
+            case AST::NodeType::Break:
+                compileUnwind(true);
+                emit(OpCode::PushVoid);
+                return;
+            case AST::NodeType::Continue:
+                compileUnwind(false);
+                emit(OpCode::PushVoid);
+                return;
+            default:
+                compileExpr(node);
+                return;
+        }
+    }
+
+    void compileEval(const std::shared_ptr<AST::Node>& node) {
+        emit(OpCode::Eval, addNode(node), 0, currentLoop());
+    }
+
+    // 式: 必ず値を1つ積む
+    void compileExpr(const std::shared_ptr<AST::Node>& node) {
+        if (!node) {
+            emit(OpCode::PushVoid);
+            return;
+        }
+        switch (node->type) {
+            case AST::NodeType::Literal: {
+                auto& lit = static_cast<AST::LiteralNode&>(*node);
+                if (!lit.isString) {
+                    emit(OpCode::PushConst, addConstant(lit.number));
+                } else if (lit.value.find("%(") == std::string::npos) {
+                    emit(OpCode::PushConst, addConstant(Value(lit.value)));
+                } else {
+                    // 埋め込み式はノードのテンプレートキャッシュを使う
+                    compileEval(node);
+                }
+                return;
+            }
+            case AST::NodeType::Variable:
+                emit(OpCode::LoadVar, addNode(node), 0, currentLoop());
+                return;
+            case AST::NodeType::ArrayAccess: {
+                auto& acc = static_cast<AST::ArrayAccessNode&>(*node);
+                compileExpr(acc.index);
+                emit(OpCode::LoadElem, addNode(node));
+                return;
+            }
+            case AST::NodeType::Assignment: {
+                auto& assign = static_cast<AST::AssignmentNode&>(*node);
+                compileExpr(assign.value);
+                emit(OpCode::StoreVar, addNode(node));
+                return;
+            }
+            case AST::NodeType::BinaryOp: {
+                auto& bin = static_cast<AST::BinaryOpNode&>(*node);
+                compileExpr(bin.left);
+                compileExpr(bin.right);
+                emit(OpCode::BinOp, static_cast<int32_t>(bin.op));
+                return;
+            }
+            case AST::NodeType::UnaryOp: {
+                auto& un = static_cast<AST::UnaryOpNode&>(*node);
+                compileExpr(un.operand);
+                emit(OpCode::UnOp, static_cast<int32_t>(un.op));
+                return;
+            }
+            case AST::NodeType::Ternary: {
+                auto& t = static_cast<AST::TernaryNode&>(*node);
+                compileExpr(t.condition);
+                int jf = emit(OpCode::JumpIfFalse);
+                compileExpr(t.trueBranch);
+                int jend = emit(OpCode::Jump);
+                depth_--;
+                patch(jf, here());
+                compileExpr(t.falseBranch);
+                patch(jend, here());
+                return;
+            }
+            case AST::NodeType::If: {
+                auto& n = static_cast<AST::IfNode&>(*node);
+                compileExpr(n.condition);
+                int jf = emit(OpCode::JumpIfFalse);
+                compileBlock(n.thenBody);
+                int jend = emit(OpCode::Jump);
+                depth_--;
+                patch(jf, here());
+                compileBlock(n.elseBody);
+                patch(jend, here());
+                return;
+            }
+            case AST::NodeType::Block:
+                compileBlock(static_cast<AST::BlockNode&>(*node).statements);
+                return;
+            case AST::NodeType::While: {
+                auto& n = static_cast<AST::WhileNode&>(*node);
+                emit(OpCode::PushVoid);  // ループの値
+                int cond = here();
+                compileExpr(n.condition);
+                int jf = emit(OpCode::JumpIfFalse);
+                int loop = beginLoop();
+                compileBlock(n.body);
+                emit(OpCode::Keep, 0);
+                // continue も Loop を通して実行予算を消費させる
+                int back = emit(OpCode::Loop, cond);
+                patch(jf, here());
+                chunk_.loops[loop].breakTarget = here();
+                chunk_.loops[loop].continueTarget = back;
+                finishLoop(loop);
+                return;
+            }
+            case AST::NodeType::For: {
+                auto& n = static_cast<AST::ForNode&>(*node);
+                if (n.init) {
+                    compileExpr(n.init);
+                    emit(OpCode::Pop);
+                }
+                emit(OpCode::PushVoid);  // ループの値
+                int cond = here();
+                int jf = -1;
+                if (n.cond) {
+                    compileExpr(n.cond);
+                    jf = emit(OpCode::JumpIfFalse);
+                }
+                int loop = beginLoop();
+                compileBlock(n.body);
+                emit(OpCode::Keep, 0);
+                int incr = here();
+                if (n.incr) {
+                    compileExpr(n.incr);
+                    emit(OpCode::Pop);
+                }
+                emit(OpCode::Loop, cond);
+                if (jf >= 0) patch(jf, here());
+                chunk_.loops[loop].breakTarget = here();
+                chunk_.loops[loop].continueTarget = incr;
+                finishLoop(loop);
+                return;
+            }
+            case AST::NodeType::Foreach: {
+                auto& n = static_cast<AST::ForeachNode&>(*node);
+                emit(OpCode::PushVoid);  // ループの値
+                compileExpr(n.arrayExpr);
+                emit(OpCode::ForeachInit);
+                int next = emit(OpCode::ForeachNext, addNode(node));
+                int loop = beginLoop();
+                compileBlock(n.body);
+                emit(OpCode::Keep, 2);
+                int back = emit(OpCode::Loop, next);
+                int end = here();
+                chunk_.code[next].b = end;
+                emit(OpCode::PopN, 2);
+                chunk_.loops[loop].breakTarget = end;
+                chunk_.loops[loop].continueTarget = back;
+                finishLoop(loop);
+                return;
+            }
+            case AST::NodeType::Case: {
+                // 式は1回だけ評価し、最初に一致した when 句（なければ others）の本体を実行する
+                auto& n = static_cast<AST::CaseNode&>(*node);
+                compileExpr(n.expression);
+                // リテラルの when 句が多ければ索引で本体へ直接飛ぶ（外れたら残りの句を順に比較）
+                const AST::CaseTable& table = AST::caseTable(n);
+                int dispatch = -1;
+                int jumps = -1;
+                if (!table.index.empty()) {
+                    jumps = static_cast<int>(chunk_.caseJumps.size());
+                    chunk_.caseJumps.push_back({n.table, std::vector<int32_t>(n.whenClauses.size(), -1)});
+                    dispatch = emit(OpCode::CaseDispatch, jumps);
+                }
+                std::vector<int> endJumps;
+                for (size_t i = 0; i < n.whenClauses.size(); ++i) {
+                    const auto& clause = n.whenClauses[i];
+                    if (!clause) continue;
+                    if (dispatch >= 0 && i == table.hashedClauses) chunk_.code[dispatch].b = here();
+                    std::vector<int> bodyJumps;
+                    for (const auto& mv : clause->matchValues) {
+                        compileExpr(mv);
+                        emit(OpCode::MatchEq);
+                        bodyJumps.push_back(emit(OpCode::JumpIfTrue));
+                    }
+                    int jnext = emit(OpCode::Jump);
+                    for (int at : bodyJumps) patch(at, here());
+                    if (jumps >= 0) chunk_.caseJumps[jumps].bodies[i] = here();
+                    emit(OpCode::Pop);
+                    compileBlock(clause->body);
+                    endJumps.push_back(emit(OpCode::Jump));
+                    patch(jnext, here());
+                    // 次の句の入口では検査値だけが積まれている
+                }
+                if (dispatch >= 0 && table.hashedClauses == n.whenClauses.size()) chunk_.code[dispatch].b = here();
+                emit(OpCode::Pop);
+                if (!n.othersBody.empty()) {
+                    compileBlock(n.othersBody);
+                } else {
+                    emit(OpCode::PushVoid);
+                }
+                for (int at : endJumps) patch(at, here());
+                return;
+            }
+            case AST::NodeType::WhenClause:
+                // case の外の when は何も実行しない（VM::executeNode と同じ）
+                emit(OpCode::PushVoid);
+                return;
+            case AST::NodeType::Call:
+                compileCall(node);
+                return;
+            case AST::NodeType::Return:
+            case AST::NodeType::Break:
+            case AST::NodeType::Continue:
+                compileStatement(node);
+                return;
+            default:
+                compileEval(node);
+                return;
+        }
+    }
+
+    void compileCall(const std::shared_ptr<AST::Node>& node) {
+        auto& call = static_cast<AST::CallNode&>(*node);
+        const AST::CallKind kind = call.kind;
+
+        if (kind == AST::CallKind::ArrayLiteral) {
+            for (const auto& arg : call.arguments) compileExpr(arg);
+            emit(OpCode::MakeArray, static_cast<int32_t>(call.arguments.size()));
+            return;
+        }
+
+        bool isIncDec = (kind == AST::CallKind::PostInc || kind == AST::CallKind::PostDec ||
+                         kind == AST::CallKind::PreInc || kind == AST::CallKind::PreDec);
+        if (isIncDec && call.arguments.size() == 1 && call.arguments[0] &&
+            call.arguments[0]->type == AST::NodeType::Variable) {
+            int delta = (kind == AST::CallKind::PostInc || kind == AST::CallKind::PreInc) ? 1 : -1;
+            int post = (kind == AST::CallKind::PostInc || kind == AST::CallKind::PostDec) ? 1 : 0;
+            emit(OpCode::IncDec, addNode(call.arguments[0]), delta, post);
+            return;
+        }
+
+        // 代入演算子・範囲/添字・参照渡しなど引数を AST のまま扱う呼び出しは tree-walker に委ねる
+        bool special = (kind != AST::CallKind::Function && kind != AST::CallKind::Swap) ||
+                       (kind == AST::CallKind::Swap && call.arguments.size() == 2) ||
+                       call.functionName.empty();
+        if (special) {
+            compileEval(node);
+            return;
+        }
+
+        for (const auto& arg : call.arguments) compileExpr(arg);
+        emit(OpCode::Call, addNode(node), static_cast<int32_t>(call.arguments.size()), currentLoop());
+    }
+};
+
+} // namespace
+
+std::shared_ptr<const Chunk> compile(const AST::FunctionNode& function) {
+    auto chunk = std::make_shared<Chunk>();
+    Compiler compiler(*chunk);
+    compiler.compileFunction(function);
+    return chunk;
+}
+
+} // namespace Bytecode
+
+// ---- VM: バイトコードの実行ループ ----
+
+Value VM::runBytecode(const Bytecode::Chunk& chunk, std::vector<Value>* collected) {
+    using Bytecode::OpCode;
+    auto& st = bytecodeStack_;
+    const size_t base = st.size();
+    const Bytecode::Instr* code = chunk.code.data();
+    size_t pc = 0;
+
+    for (;;) {
+        const Bytecode::Instr& in = code[pc++];
+        switch (in.op) {
+            case OpCode::PushConst:
+                st.push_back(chunk.constants[in.a]);
+                break;
+            case OpCode::PushVoid:
+                st.emplace_back();
+                break;
+            case OpCode::Pop:
+                st.pop_back();
+                break;
+            case OpCode::PopN:
+                st.resize(st.size() - in.a);
+                break;
+            case OpCode::Keep: {
+                Value v = std::move(st.back());
+                st.pop_back();
+                st[st.size() - 1 - in.a] = std::move(v);
+                break;
+            }
+            case OpCode::LoadVar: {
+                Value v = loadVariable(static_cast<AST::VariableNode&>(*chunk.nodes[in.a]));
+                st.push_back(std::move(v));
+                break;
+            }
+            case OpCode::LoadElem: {
+                int index = st.back().asInt();
+                st.back() = loadArrayElement(static_cast<AST::ArrayAccessNode&>(*chunk.nodes[in.a]), index);
+                break;
+            }
+            case OpCode::StoreVar:
+                assignVariable(static_cast<AST::AssignmentNode&>(*chunk.nodes[in.a]), st.back());
+                break;
+            case OpCode::IncDec:
+                st.push_back(incDecVariable(static_cast<AST::VariableNode&>(*chunk.nodes[in.a]), in.b, in.c != 0));
+                break;
+            case OpCode::BinOp: {
+                Value right = std::move(st.back());
+                st.pop_back();
+                st.back() = evaluateBinaryOp(static_cast<AST::BinaryOperator>(in.a), st.back(), right);
+                break;
+            }
+            case OpCode::UnOp:
+                st.back() = evaluateUnaryOp(static_cast<AST::UnaryOperator>(in.a), st.back());
+                break;
+            case OpCode::MatchEq: {
+                Value v = std::move(st.back());
+                st.pop_back();
+                bool eq = (st.back() == v);
+                st.emplace_back(eq ? 1 : 0);
+                break;
+            }
+            case OpCode::CaseDispatch: {
+                const Value& test = st.back();
+                if (!AST::caseIndexable(test)) break;
+                const auto& jumps = chunk.caseJumps[in.a];
+                auto it = jumps.table->index.find(test.asString());
+                pc = (it != jumps.table->index.end()) ? jumps.bodies[it->second] : in.b;
+                break;
+            }
+            case OpCode::MakeArray: {
+                std::vector<Value> elements(std::make_move_iterator(st.end() - in.a),
+                                            std::make_move_iterator(st.end()));
+                st.resize(st.size() - in.a);
+                st.emplace_back(std::move(elements));
+                break;
+            }
+            case OpCode::Call: {
+                std::vector<Value> args(std::make_move_iterator(st.end() - in.b),
+                                        std::make_move_iterator(st.end()));
+                st.resize(st.size() - in.b);
+                const auto& call = static_cast<const AST::CallNode&>(*chunk.nodes[in.a]);
+                Value v = callFunction(resolveFunction(call.functionName, call.target), std::move(args));
+                st.push_back(std::move(v));
+                break;
+            }
+            case OpCode::Eval: {
+                Value v = executeNode(chunk.nodes[in.a]);
+                st.push_back(std::move(v));
+                break;
+            }
+            case OpCode::Jump:
+                pc = in.a;
+                break;
+            case OpCode::Loop: {
+                // ループの後方ジャンプで実行予算を 1 消費する（tree-walker はループの 1 周ごと）
+                if (!tick()) {
+                    st.resize(base);
+                    return Value();
+                }
+                pc = in.a;
+                break;
+            }
+            case OpCode::JumpIfFalse: {
+                bool cond = st.back().toBool();
+                st.pop_back();
+                if (!cond) pc = in.a;
+                break;
+            }
+            case OpCode::JumpIfTrue: {
+                bool cond = st.back().toBool();
+                st.pop_back();
+                if (cond) pc = in.a;
+                break;
+            }
+            case OpCode::Unwind:
+                st.resize(base + in.a);
+                pc = in.b;
+                break;
+            case OpCode::ForeachInit:
+                // 配列以外は0回の反復（スナップショットとして値を保持する）
+                if (st.back().getType() != Value::Type::Array) {
+                    st.back() = Value(std::vector<Value>());
+                }
+                st.emplace_back(0);
+                break;
+            case OpCode::ForeachNext: {
+                size_t index = static_cast<size_t>(st.back().asInt());
+                const Value& arr = st[st.size() - 2];
+                if (index >= arr.asArray().size()) {
+                    pc = in.b;
+                    break;
+                }
+                Value elem = arr.asArray()[index];
+                st.back() = Value(static_cast<int>(index + 1));
+                auto& fe = static_cast<AST::ForeachNode&>(*chunk.nodes[in.a]);
+                variableRef(fe.varName, fe.slot) = std::move(elem);
+                break;
+            }
+            case OpCode::Collect: {
+                Value v = std::move(st.back());
+                st.pop_back();
+                if (!v.isVoid()) collected->push_back(std::move(v));
+                break;
+            }
+            case OpCode::CollectExpand: {
+                Value v = std::move(st.back());
+                st.pop_back();
+                if (v.getType() == Value::Type::Array) {
+                    for (const auto& elem : v.asArray()) collected->push_back(elem);
+                } else if (!v.isVoid()) {
+                    collected->push_back(std::move(v));
+                }
+                break;
+            }
+            case OpCode::Return:
+                returnValue_ = std::move(st.back());
+                completion_ = Completion::Return;
+                st.resize(base);
+                return Value();
+            case OpCode::End: {
+                Value result = st.size() > base ? std::move(st.back()) : Value();
+                st.resize(base);
+                return result;
+            }
+        }
+
+        // 呼び出し先（EVAL 等）が残した return/break/continue・予算切れをこの関数の制御へ反映する
+        if (completion_ != Completion::Normal) {
+            if (completion_ == Completion::Return || completion_ == Completion::Abort) {
+                st.resize(base);
+                return Value();
+            }
+            const Bytecode::LoopTarget& loop = chunk.loops[in.c];
+            pc = (completion_ == Completion::Break) ? loop.breakTarget : loop.continueTarget;
+            st.resize(base + loop.depth);
+            completion_ = Completion::Normal;
+        }
+    }
+}
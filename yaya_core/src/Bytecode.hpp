@@ -0,0 +1,81 @@
+#pragma once
+
+#include "AST.hpp"
+#include "Value.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// YAYA 関数本体のバイトコード表現（VM の bytecode エンジン用）。
+// AST::FunctionNode をスタックマシン向けの平坦な命令列へ変換する。
+// 演算子はデコード済みの列挙値、数値リテラルは定数プールに持ち、if/while/for/foreach/case は
+// ジャンプで表す。直接コンパイルしない構文（switch、parallel、範囲アクセスや複合代入などの
+// 特殊呼び出し、%(...) を含む文字列）は Eval 命令で AST のまま VM::executeNode に委ねる。
+namespace Bytecode {
+
+enum class OpCode : uint8_t {
+    PushConst,      // a: 定数プール index
+    PushVoid,
+    Pop,
+    PopN,           // a: 取り除く個数
+    Keep,           // 先頭を取り出し、その下 a 番目（0 = 直下）へ格納する（文の値の蓄積）
+    LoadVar,        // a: VariableNode。未定義なら同名関数の呼び出しへフォールバック
+    LoadElem,       // a: ArrayAccessNode。先頭の添字を要素値に置き換える
+    StoreVar,       // a: AssignmentNode。先頭の値を代入し、値はスタックに残す
+    IncDec,         // a: VariableNode, b: 増分(+1/-1), c: 1 なら後置
+    BinOp,          // a: AST::BinaryOperator
+    UnOp,           // a: AST::UnaryOperator
+    MatchEq,        // [test, v] -> [test, test == v]
+    CaseDispatch,   // a: caseJumps index。[test] を索引で引き、一致した句の本体へ飛ぶ。
+                    // 外れたら b へ（実数の検査値は索引を使わず次の命令へ）
+    MakeArray,      // a: 要素数
+    Call,           // a: CallNode（呼び出し先は CallNode::target に解決済み）, b: 引数の個数
+    Eval,           // a: AST ノード（tree-walker で評価）
+    Jump,           // a: 飛び先
+    Loop,           // a: 飛び先（ループの後方ジャンプ。実行予算を 1 消費する）
+    JumpIfFalse,    // a: 飛び先（先頭を取り出して判定）
+    JumpIfTrue,     // a: 飛び先（先頭を取り出して判定）
+    Unwind,         // break/continue: スタックを a の深さまで戻して b へ飛ぶ
+    ForeachInit,    // [array] -> [array(snapshot), 0]
+    ForeachNext,    // a: ForeachNode, b: 終了時の飛び先
+    Collect,        // array/sequential 関数の候補として先頭を積む（void は除く）
+    CollectExpand,  // parallel 文: 配列なら各要素を候補として積む
+    Return,         // 先頭を戻り値として関数を抜ける
+    End             // 関数本体の終端（先頭があればそれが関数の値）
+};
+
+struct Instr {
+    OpCode op;
+    int32_t a = 0;
+    int32_t b = 0;
+    // LoadVar/Call/Eval: 呼び出し先が break/continue を残したときに使う LoopTarget の index
+    int32_t c = 0;
+};
+
+// break/continue の飛び先。index 0 は関数本体（ループ外の break/continue は本体の終端へ）
+struct LoopTarget {
+    int32_t breakTarget = 0;
+    int32_t continueTarget = 0;
+    int32_t depth = 0;  // 飛ぶ前に戻すスタックの深さ（関数のベースからの相対）
+};
+
+struct Chunk {
+    std::vector<Instr> code;
+    std::vector<Value> constants;
+    std::vector<std::shared_ptr<AST::Node>> nodes;
+    std::vector<LoopTarget> loops;
+    // CaseDispatch の飛び先: case ノードの索引と、句ごとの本体の入口
+    struct CaseJumps {
+        std::shared_ptr<const AST::CaseTable> table;
+        std::vector<int32_t> bodies;
+    };
+    std::vector<CaseJumps> caseJumps;
+    // array/sequential 関数: 文の値を Collect で候補として集める
+    bool collect = false;
+};
+
+// 関数本体をコンパイルする。未対応の構文は Eval 命令に落とすため失敗しない。
+std::shared_ptr<const Chunk> compile(const AST::FunctionNode& function);
+
+} // namespace Bytecode
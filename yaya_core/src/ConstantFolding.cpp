@@ -0,0 +1,175 @@
+// 登録前の定数畳み込みと到達しない分岐の除去（VM::foldConstants）。
+// 畳み込んだ値は VM 自身の executeNode で評価するので、実行時と同じ結果になる。
+// 対象は副作用の無いノードだけ:
+//   - 定数オペランドの二項/単項演算（& 参照渡しは除く）
+//   - 定数引数の配列リテラル・添字・範囲、および決定的な組み込み関数の呼び出し
+//   - 条件が定数の if / 三項演算子 / case
+// %(...) を含む文字列リテラルは実行時の変数に依存するので定数として扱わない。
+#include "VM.hpp"
+#include <unordered_set>
+
+namespace {
+
+// 引数だけで結果が決まり、VM の状態にも触れない組み込み関数
+// （RAND / ANY / 時刻 / ファイル / 変数操作 / 正規表現の結果を残すものなどは含めない）
+const std::unordered_set<std::string>& pureBuiltins() {
+    static const std::unordered_set<std::string> names = {
+        "STRLEN", "STRFORM", "SPRINTF", "ARRAYSIZE", "GETSTRBYTES",
+        "TOINT", "TOSTR", "TOREAL", "TOAUTO", "CVINT", "CVSTR", "CVREAL", "CVAUTO", "GETTYPE",
+        "TOUPPER", "TOLOWER", "SUBSTR", "REPLACE", "ERASE", "INSERT", "CUTSPACE",
+        "CHR", "CHRCODE", "ZEN2HAN", "HAN2ZEN", "ISINTSTR", "ISREALSTR",
+        "FLOOR", "CEIL", "ROUND", "SQRT", "POW", "LOG", "LOG10", "EXP", "SIN", "COS", "TAN",
+        "BITWISE_AND", "BITWISE_OR", "BITWISE_XOR", "BITWISE_NOT", "BITWISE_SHIFT",
+        "TOHEXSTR", "HEXSTRTOI", "TOBINSTR", "BINSTRTOI",
+    };
+    return names;
+}
+
+bool isConstant(const std::shared_ptr<AST::Node>& node) {
+    if (!node || node->type != AST::NodeType::Literal) return false;
+    const auto& lit = static_cast<const AST::LiteralNode&>(*node);
+    return !lit.isString || lit.value.find("%(") == std::string::npos;
+}
+
+Value constantValue(const AST::Node& node) {
+    const auto& lit = static_cast<const AST::LiteralNode&>(node);
+    return lit.isString ? Value(lit.value) : lit.number;
+}
+
+bool allConstant(const std::vector<std::shared_ptr<AST::Node>>& nodes) {
+    for (const auto& n : nodes) {
+        if (!isConstant(n)) return false;
+    }
+    return true;
+}
+
+size_t countNodes(AST::Node& node) {
+    size_t count = 1;
+    AST::forEachChild(node, [&count](std::shared_ptr<AST::Node>& child) { count += countNodes(*child); });
+    return count;
+}
+
+// 値をそのまま返すリテラル（数値リテラルと同じ扱い。文字列でも %() の展開はしない）
+std::shared_ptr<AST::Node> makeConstant(const Value& value) {
+    std::string text = value.getType() == Value::Type::Array ? std::string() : value.asString();
+    return std::make_shared<AST::LiteralNode>(text, value);
+}
+
+std::shared_ptr<AST::Node> makeBlock(const std::vector<std::shared_ptr<AST::Node>>& statements) {
+    return std::make_shared<AST::BlockNode>(statements);
+}
+
+} // namespace
+
+VM::FoldStats& VM::FoldStats::operator+=(const FoldStats& other) {
+    nodesBefore += other.nodesBefore;
+    nodesAfter += other.nodesAfter;
+    foldedExpressions += other.foldedExpressions;
+    prunedBranches += other.prunedBranches;
+    return *this;
+}
+
+VM::FoldStats VM::foldConstants(AST::FunctionNode& function) {
+    FoldStats stats;
+    stats.nodesBefore = countNodes(function);
+    // 畳み込みの評価はプロファイラに記録しない
+    yaya_profile::Profiler* profiler = profiler_;
+    profiler_ = nullptr;
+    for (auto& stmt : function.body) {
+        if (stmt) foldNode(stmt, stats);
+    }
+    profiler_ = profiler;
+    stats.nodesAfter = countNodes(function);
+    return stats;
+}
+
+void VM::foldNode(std::shared_ptr<AST::Node>& node, FoldStats& stats) {
+    // 子から先に畳む（置き換えは親の持つ shared_ptr を差し替える）
+    AST::forEachChild(*node, [this, &stats](std::shared_ptr<AST::Node>& child) { foldNode(child, stats); });
+
+    bool foldable = false;
+    switch (node->type) {
+        case AST::NodeType::BinaryOp: {
+            auto& n = static_cast<AST::BinaryOpNode&>(*node);
+            foldable = isConstant(n.left) && isConstant(n.right);
+            break;
+        }
+        case AST::NodeType::UnaryOp: {
+            auto& n = static_cast<AST::UnaryOpNode&>(*node);
+            foldable = n.op != AST::UnaryOperator::Reference && isConstant(n.operand);
+            break;
+        }
+        case AST::NodeType::Call: {
+            auto& n = static_cast<AST::CallNode&>(*node);
+            switch (n.kind) {
+                case AST::CallKind::ArrayLiteral:
+                case AST::CallKind::Index:
+                case AST::CallKind::Range:
+                    foldable = allConstant(n.arguments);
+                    break;
+                case AST::CallKind::Function:
+                    foldable = pureBuiltins().count(n.functionName) && builtins_.count(n.functionName) &&
+                               allConstant(n.arguments);
+                    break;
+                default:
+                    break;
+            }
+            break;
+        }
+        case AST::NodeType::Ternary: {
+            // 選ばれた分岐をそのまま置く。代入と parallel は文として置くと意味が変わるので残す
+            auto& n = static_cast<AST::TernaryNode&>(*node);
+            if (!isConstant(n.condition)) break;
+            auto& branch = constantValue(*n.condition).toBool() ? n.trueBranch : n.falseBranch;
+            if (!branch) {
+                node = makeConstant(Value());
+                stats.prunedBranches++;
+            } else if (branch->type != AST::NodeType::Assignment && branch->type != AST::NodeType::Parallel) {
+                node = branch;
+                stats.prunedBranches++;
+            }
+            return;
+        }
+        case AST::NodeType::If: {
+            // 選ばれた側だけのブロックにする（executeBlock の規則は同じ）
+            auto& n = static_cast<AST::IfNode&>(*node);
+            if (!isConstant(n.condition)) return;
+            node = makeBlock(constantValue(*n.condition).toBool() ? n.thenBody : n.elseBody);
+            stats.prunedBranches++;
+            return;
+        }
+        case AST::NodeType::Case: {
+            // 一致が決まるまでの when 値がすべて定数なら、選ばれた本体だけのブロックにする
+            auto& n = static_cast<AST::CaseNode&>(*node);
+            if (!isConstant(n.expression)) return;
+            Value testValue = constantValue(*n.expression);
+            for (const auto& clause : n.whenClauses) {
+                if (!clause) continue;
+                for (const auto& mv : clause->matchValues) {
+                    if (!isConstant(mv)) return;
+                    if (testValue == constantValue(*mv)) {
+                        node = makeBlock(clause->body);
+                        stats.prunedBranches++;
+                        return;
+                    }
+                }
+            }
+            node = makeBlock(n.othersBody);
+            stats.prunedBranches++;
+            return;
+        }
+        default:
+            break;
+    }
+    if (!foldable) return;
+
+    Value value;
+    try {
+        value = executeNode(node);
+    } catch (const std::exception&) {
+        // 評価で例外になる式は実行時に任せる
+        return;
+    }
+    node = makeConstant(value);
+    stats.foldedExpressions++;
+}
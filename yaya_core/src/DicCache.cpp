@@ -0,0 +1,476 @@
+#include "DicCache.hpp"
+#include "Log.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// 構文木の形（AST.hpp のノード定義・シリアライズ形式）を変えたら上げる
+constexpr char kMagic[4] = {'Y', 'D', 'C', '1'};
+constexpr uint32_t kFormatVersion = 1;
+constexpr uint8_t kNullNode = 0xFF;
+
+uint64_t fnv1a(const char* data, size_t size) {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= static_cast<unsigned char>(data[i]);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// ---- 書き出し ----
+
+class Writer {
+public:
+    std::string out;
+
+    void u8(uint8_t v) { out.push_back(static_cast<char>(v)); }
+    void u32(uint32_t v) { out.append(reinterpret_cast<const char*>(&v), sizeof v); }
+    void u64(uint64_t v) { out.append(reinterpret_cast<const char*>(&v), sizeof v); }
+    void str(const std::string& s) {
+        u32(static_cast<uint32_t>(s.size()));
+        out.append(s);
+    }
+    void defines(const DicCache::Defines& defs) {
+        u32(static_cast<uint32_t>(defs.size()));
+        for (const auto& d : defs) {
+            str(d.first);
+            str(d.second);
+        }
+    }
+
+    void nodes(const std::vector<std::shared_ptr<AST::Node>>& list) {
+        u32(static_cast<uint32_t>(list.size()));
+        for (const auto& n : list) node(n.get());
+    }
+
+    void node(const AST::Node* n) {
+        if (!n) {
+            u8(kNullNode);
+            return;
+        }
+        u8(static_cast<uint8_t>(n->type));
+        switch (n->type) {
+            case AST::NodeType::Function: {
+                auto* f = static_cast<const AST::FunctionNode*>(n);
+                str(f->name);
+                str(f->functionType);
+                nodes(f->body);
+                break;
+            }
+            case AST::NodeType::Block:
+                nodes(static_cast<const AST::BlockNode*>(n)->statements);
+                break;
+            case AST::NodeType::Return:
+                node(static_cast<const AST::ReturnNode*>(n)->value.get());
+                break;
+            case AST::NodeType::Assignment: {
+                auto* a = static_cast<const AST::AssignmentNode*>(n);
+                str(a->variableName);
+                node(a->value.get());
+                break;
+            }
+            case AST::NodeType::If: {
+                auto* i = static_cast<const AST::IfNode*>(n);
+                node(i->condition.get());
+                nodes(i->thenBody);
+                nodes(i->elseBody);
+                break;
+            }
+            case AST::NodeType::While: {
+                auto* w = static_cast<const AST::WhileNode*>(n);
+                node(w->condition.get());
+                nodes(w->body);
+                break;
+            }
+            case AST::NodeType::For: {
+                auto* f = static_cast<const AST::ForNode*>(n);
+                node(f->init.get());
+                node(f->cond.get());
+                node(f->incr.get());
+                nodes(f->body);
+                break;
+            }
+            case AST::NodeType::Foreach: {
+                auto* f = static_cast<const AST::ForeachNode*>(n);
+                node(f->arrayExpr.get());
+                str(f->varName);
+                nodes(f->body);
+                break;
+            }
+            case AST::NodeType::Switch: {
+                auto* s = static_cast<const AST::SwitchNode*>(n);
+                node(s->expression.get());
+                nodes(s->cases);
+                break;
+            }
+            case AST::NodeType::Case: {
+                auto* c = static_cast<const AST::CaseNode*>(n);
+                node(c->expression.get());
+                u32(static_cast<uint32_t>(c->whenClauses.size()));
+                for (const auto& w : c->whenClauses) node(w.get());
+                nodes(c->othersBody);
+                break;
+            }
+            case AST::NodeType::WhenClause: {
+                auto* w = static_cast<const AST::WhenClauseNode*>(n);
+                nodes(w->matchValues);
+                nodes(w->body);
+                break;
+            }
+            case AST::NodeType::Break:
+            case AST::NodeType::Continue:
+                break;
+            case AST::NodeType::BinaryOp: {
+                auto* b = static_cast<const AST::BinaryOpNode*>(n);
+                u8(static_cast<uint8_t>(b->op));
+                node(b->left.get());
+                node(b->right.get());
+                break;
+            }
+            case AST::NodeType::UnaryOp: {
+                auto* u = static_cast<const AST::UnaryOpNode*>(n);
+                u8(static_cast<uint8_t>(u->op));
+                node(u->operand.get());
+                break;
+            }
+            case AST::NodeType::Ternary: {
+                auto* t = static_cast<const AST::TernaryNode*>(n);
+                node(t->condition.get());
+                node(t->trueBranch.get());
+                node(t->falseBranch.get());
+                break;
+            }
+            case AST::NodeType::Call: {
+                auto* c = static_cast<const AST::CallNode*>(n);
+                str(c->functionName);
+                nodes(c->arguments);
+                break;
+            }
+            case AST::NodeType::Variable:
+                str(static_cast<const AST::VariableNode*>(n)->name);
+                break;
+            case AST::NodeType::Literal: {
+                auto* l = static_cast<const AST::LiteralNode*>(n);
+                str(l->value);
+                u8(l->isString ? 1 : 0);
+                if (!l->isString) {
+                    // 数値リテラルはデコード済みの値ごと保存する
+                    if (l->number.isReal()) {
+                        double d = l->number.asReal();
+                        u8(1);
+                        out.append(reinterpret_cast<const char*>(&d), sizeof d);
+                    } else {
+                        u8(0);
+                        u32(static_cast<uint32_t>(l->number.asInt()));
+                    }
+                }
+                break;
+            }
+            case AST::NodeType::ArrayAccess: {
+                auto* a = static_cast<const AST::ArrayAccessNode*>(n);
+                str(a->arrayName);
+                node(a->index.get());
+                break;
+            }
+            case AST::NodeType::Parallel:
+                node(static_cast<const AST::ParallelNode*>(n)->expr.get());
+                break;
+        }
+    }
+};
+
+// ---- 読み込み（mmap した領域から。範囲外や不正なタグは ok_ を落として打ち切る） ----
+
+class Reader {
+public:
+    Reader(const char* p, const char* end) : p_(p), end_(end) {}
+
+    bool ok() const { return ok_; }
+
+    bool bytes(void* dst, size_t n) {
+        if (!ok_ || static_cast<size_t>(end_ - p_) < n) {
+            ok_ = false;
+            return false;
+        }
+        std::memcpy(dst, p_, n);
+        p_ += n;
+        return true;
+    }
+    uint8_t u8() { uint8_t v = 0; bytes(&v, sizeof v); return v; }
+    uint32_t u32() { uint32_t v = 0; bytes(&v, sizeof v); return v; }
+    uint64_t u64() { uint64_t v = 0; bytes(&v, sizeof v); return v; }
+    std::string str() {
+        uint32_t n = u32();
+        if (!ok_ || static_cast<size_t>(end_ - p_) < n) {
+            ok_ = false;
+            return std::string();
+        }
+        std::string s(p_, n);
+        p_ += n;
+        return s;
+    }
+    DicCache::Defines defines() {
+        DicCache::Defines defs;
+        uint32_t n = u32();
+        for (uint32_t i = 0; i < n && ok_; ++i) {
+            std::string name = str();
+            std::string value = str();
+            defs.emplace_back(std::move(name), std::move(value));
+        }
+        return defs;
+    }
+
+    std::vector<std::shared_ptr<AST::Node>> nodes() {
+        std::vector<std::shared_ptr<AST::Node>> list;
+        uint32_t n = u32();
+        for (uint32_t i = 0; i < n && ok_; ++i) list.push_back(node());
+        return list;
+    }
+
+    std::shared_ptr<AST::Node> node() {
+        uint8_t tag = u8();
+        if (!ok_ || tag == kNullNode) return nullptr;
+        if (tag > static_cast<uint8_t>(AST::NodeType::Parallel)) {
+            ok_ = false;
+            return nullptr;
+        }
+        switch (static_cast<AST::NodeType>(tag)) {
+            case AST::NodeType::Function: {
+                std::string name = str();
+                std::string functionType = str();
+                auto f = std::make_shared<AST::FunctionNode>(name, nodes());
+                f->functionType = std::move(functionType);
+                return f;
+            }
+            case AST::NodeType::Block:
+                return std::make_shared<AST::BlockNode>(nodes());
+            case AST::NodeType::Return:
+                return std::make_shared<AST::ReturnNode>(node());
+            case AST::NodeType::Assignment: {
+                std::string name = str();
+                return std::make_shared<AST::AssignmentNode>(name, node());
+            }
+            case AST::NodeType::If: {
+                auto cond = node();
+                auto thenBody = nodes();
+                return std::make_shared<AST::IfNode>(cond, thenBody, nodes());
+            }
+            case AST::NodeType::While: {
+                auto cond = node();
+                return std::make_shared<AST::WhileNode>(cond, nodes());
+            }
+            case AST::NodeType::For: {
+                auto init = node();
+                auto cond = node();
+                auto incr = node();
+                return std::make_shared<AST::ForNode>(init, cond, incr, nodes());
+            }
+            case AST::NodeType::Foreach: {
+                auto arr = node();
+                std::string var = str();
+                return std::make_shared<AST::ForeachNode>(arr, var, nodes());
+            }
+            case AST::NodeType::Switch: {
+                auto expr = node();
+                return std::make_shared<AST::SwitchNode>(expr, nodes());
+            }
+            case AST::NodeType::Case: {
+                auto expr = node();
+                std::vector<std::shared_ptr<AST::WhenClauseNode>> clauses;
+                uint32_t n = u32();
+                for (uint32_t i = 0; i < n && ok_; ++i) {
+                    auto clause = std::dynamic_pointer_cast<AST::WhenClauseNode>(node());
+                    if (!clause) {
+                        ok_ = false;
+                        break;
+                    }
+                    clauses.push_back(clause);
+                }
+                return std::make_shared<AST::CaseNode>(expr, clauses, nodes());
+            }
+            case AST::NodeType::WhenClause: {
+                auto values = nodes();
+                return std::make_shared<AST::WhenClauseNode>(values, nodes());
+            }
+            case AST::NodeType::Break:
+                return std::make_shared<AST::BreakNode>();
+            case AST::NodeType::Continue:
+                return std::make_shared<AST::ContinueNode>();
+            case AST::NodeType::BinaryOp: {
+                auto op = static_cast<AST::BinaryOperator>(u8());
+                auto left = node();
+                return std::make_shared<AST::BinaryOpNode>(op, left, node());
+            }
+            case AST::NodeType::UnaryOp: {
+                auto op = static_cast<AST::UnaryOperator>(u8());
+                return std::make_shared<AST::UnaryOpNode>(op, node());
+            }
+            case AST::NodeType::Ternary: {
+                auto cond = node();
+                auto t = node();
+                return std::make_shared<AST::TernaryNode>(cond, t, node());
+            }
+            case AST::NodeType::Call: {
+                std::string name = str();
+                return std::make_shared<AST::CallNode>(name, nodes());
+            }
+            case AST::NodeType::Variable:
+                return std::make_shared<AST::VariableNode>(str());
+            case AST::NodeType::Literal: {
+                std::string value = str();
+                if (u8()) return std::make_shared<AST::LiteralNode>(value);
+                if (u8()) {
+                    double d = 0.0;
+                    bytes(&d, sizeof d);
+                    return std::make_shared<AST::LiteralNode>(value, Value(d));
+                }
+                return std::make_shared<AST::LiteralNode>(value, Value(static_cast<int>(u32())));
+            }
+            case AST::NodeType::ArrayAccess: {
+                std::string name = str();
+                return std::make_shared<AST::ArrayAccessNode>(name, node());
+            }
+            case AST::NodeType::Parallel:
+                return std::make_shared<AST::ParallelNode>(node());
+        }
+        ok_ = false;
+        return nullptr;
+    }
+
+private:
+    const char* p_;
+    const char* end_;
+    bool ok_ = true;
+};
+
+void writeKey(Writer& w, const DicCache::Key& key) {
+    w.out.append(kMagic, sizeof kMagic);
+    w.u32(kFormatVersion);
+    w.str(key.path);
+    w.u64(static_cast<uint64_t>(key.mtime));
+    w.u64(key.size);
+    w.u64(key.contentHash);
+    w.str(key.encoding);
+    w.defines(key.globalDefines);
+}
+
+bool keyMatches(Reader& r, const DicCache::Key& key) {
+    char magic[sizeof kMagic];
+    if (!r.bytes(magic, sizeof magic) || std::memcmp(magic, kMagic, sizeof kMagic) != 0) return false;
+    if (r.u32() != kFormatVersion) return false;
+    if (r.str() != key.path) return false;
+    if (static_cast<int64_t>(r.u64()) != key.mtime) return false;
+    if (r.u64() != key.size) return false;
+    if (r.u64() != key.contentHash) return false;
+    if (r.str() != key.encoding) return false;
+    return r.defines() == key.globalDefines && r.ok();
+}
+
+} // namespace
+
+bool DicCache::makeKey(const std::string& path, std::string_view raw, const std::string& encoding,
+                       const Defines& globalDefines, Key& key) {
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) return false;
+    key.path = path;
+    key.mtime = static_cast<int64_t>(st.st_mtime);
+    key.size = static_cast<uint64_t>(st.st_size);
+    key.contentHash = fnv1a(raw.data(), raw.size());
+    key.encoding = encoding;
+    key.globalDefines = globalDefines;
+    return true;
+}
+
+uint64_t DicCache::fingerprint(const AST::Node& node) {
+    Writer w;
+    w.node(&node);
+    return fnv1a(w.out.data(), w.out.size());
+}
+
+std::string DicCache::cacheFileFor(const std::string& path) const {
+    char name[32];
+    std::snprintf(name, sizeof name, "%016llx.ydc",
+                  static_cast<unsigned long long>(fnv1a(path.data(), path.size())));
+    return directory_ + "/" + name;
+}
+
+bool DicCache::read(const Key& key, Entry& entry) const {
+    int fd = ::open(cacheFileFor(key.path).c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) return false;
+
+    const char* begin = static_cast<const char*>(map);
+    Reader r(begin, begin + size);
+    bool ok = keyMatches(r, key);
+    if (ok) {
+        entry.addedGlobalDefines = r.defines();
+        uint32_t count = r.u32();
+        for (uint32_t i = 0; i < count && r.ok(); ++i) {
+            auto func = std::dynamic_pointer_cast<AST::FunctionNode>(r.node());
+            if (!func) {
+                ok = false;
+                break;
+            }
+            entry.functions.push_back(func);
+        }
+        ok = ok && r.ok();
+    }
+    ::munmap(map, size);
+    if (!ok) {
+        entry.functions.clear();
+        entry.addedGlobalDefines.clear();
+    }
+    return ok;
+}
+
+bool DicCache::write(const Key& key, const Entry& entry) const {
+    Writer w;
+    writeKey(w, key);
+    w.defines(entry.addedGlobalDefines);
+    w.u32(static_cast<uint32_t>(entry.functions.size()));
+    for (const auto& func : entry.functions) w.node(func.get());
+
+    ::mkdir(directory_.c_str(), 0755);
+    std::string file = cacheFileFor(key.path);
+    // 一時ファイル名はプロセスとスレッドごとに分ける。同じ辞書を別のインスタンスや
+    // 別プロセスが同時に書いても、互いの書きかけを rename しないようにする
+    std::ostringstream tmpName;
+    tmpName << file << ".tmp." << ::getpid() << '.' << std::this_thread::get_id();
+    std::string tmp = tmpName.str();
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            YAYA_LOG(Warn, "[DicCache] Failed to write cache: " << tmp);
+            return false;
+        }
+        out.write(w.out.data(), static_cast<std::streamsize>(w.out.size()));
+        if (!out) {
+            YAYA_LOG(Warn, "[DicCache] Failed to write cache: " << tmp);
+            out.close();
+            std::remove(tmp.c_str());
+            return false;
+        }
+    }
+    if (std::rename(tmp.c_str(), file.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "AST.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/// 辞書ファイルごとの構文木キャッシュ。
+/// パース済みの関数表をバイナリ形式でキャッシュディレクトリに保存し、次回の load では
+/// mmap して構文木を復元する（文字コード変換・#define 展開・字句解析・構文解析を省く）。
+/// キー（パス、mtime、サイズ、内容ハッシュ、エンコーディング、その時点で有効な
+/// #globaldefine の並び）と形式バージョンが一致しないファイルは使わず、通常のパースに戻る。
+class DicCache {
+public:
+    using Defines = std::vector<std::pair<std::string, std::string>>;
+
+    struct Key {
+        std::string path;
+        int64_t mtime = 0;
+        uint64_t size = 0;
+        uint64_t contentHash = 0;
+        std::string encoding;
+        Defines globalDefines;
+    };
+
+    struct Entry {
+        std::vector<std::shared_ptr<AST::FunctionNode>> functions;
+        // この辞書自身が登録した #globaldefine（キャッシュ利用時に再登録する）
+        Defines addedGlobalDefines;
+    };
+
+    explicit DicCache(const std::string& directory) : directory_(directory) {}
+
+    // 読み込んだ生バイト列と stat からキーを作る。stat できなければ false。
+    static bool makeKey(const std::string& path, std::string_view raw, const std::string& encoding,
+                        const Defines& globalDefines, Key& key);
+    // 構文木の内容ハッシュ（キャッシュと同じ直列化の fnv1a。行番号やコメントの違いは含まない）
+    static uint64_t fingerprint(const AST::Node& node);
+
+    // キーが一致するキャッシュがあれば entry に復元して true
+    bool read(const Key& key, Entry& entry) const;
+    // キャッシュを書き出す（一時ファイルへ書いて rename）。失敗しても load は続行できる。
+    bool write(const Key& key, const Entry& entry) const;
+
+private:
+    std::string directory_;
+    std::string cacheFileFor(const std::string& path) const;
+};
@@ -1,48 +1,24 @@
 #include "DictionaryManager.hpp"
+#include "DicCache.hpp"
 #include "Lexer.hpp"
+#include "MappedFile.hpp"
 #include "Parser.hpp"
 #include "Value.hpp"
+#include "Log.hpp"
+#include "TextScan.hpp"
+#include "Transcode.hpp"
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <chrono>
 #include <algorithm>
 #include <cctype>
-#include <cerrno>
 #include <vector>
-#include <iconv.h>
+#include <atomic>
+#include <thread>
 
 namespace {
 
-// UTF-8 として妥当なバイト列かを検査する（構造チェックのみ）
-bool isValidUTF8(const std::string& s) {
-    const unsigned char* b = reinterpret_cast<const unsigned char*>(s.data());
-    size_t n = s.size();
-    size_t i = 0;
-    while (i < n) {
-        unsigned char c = b[i];
-        size_t len;
-        if (c < 0x80) { i++; continue; }
-        else if ((c & 0xE0) == 0xC0) len = 2;
-        else if ((c & 0xF0) == 0xE0) len = 3;
-        else if ((c & 0xF8) == 0xF0) len = 4;
-        else return false;
-        if (i + len > n) return false;
-        for (size_t j = 1; j < len; ++j) {
-            if ((b[i + j] & 0xC0) != 0x80) return false;
-        }
-        i += len;
-    }
-    return true;
-}
-
-bool hasNonAscii(const std::string& s) {
-    for (unsigned char c : s) {
-        if (c >= 0x80) return true;
-    }
-    return false;
-}
-
 // yaya.txt の charset 表記ゆれを吸収する。戻り値: "UTF-8" / "CP932" / "AUTO"
 std::string normalizeEncodingName(std::string enc) {
     std::transform(enc.begin(), enc.end(), enc.begin(),
@@ -54,38 +30,66 @@ std::string normalizeEncodingName(std::string enc) {
     if (enc == "shiftjis" || enc == "sjis" || enc == "cp932" ||
         enc == "windows31j" || enc == "ms932" || enc == "ms_kanji") return "CP932";
     if (enc.empty() || enc == "auto" || enc == "default") return "AUTO";
-    std::cerr << "[DictionaryManager] Unknown encoding name '" << enc
-              << "', falling back to auto-detection" << std::endl;
+    YAYA_LOG(Warn, "[DictionaryManager] Unknown encoding name '" << enc
+                   << "', falling back to auto-detection");
     return "AUTO";
 }
 
-bool convertWithIconv(const std::string& input, const char* fromCode, std::string& output) {
-    iconv_t cd = iconv_open("UTF-8", fromCode);
-    if (cd == (iconv_t)-1) {
-        std::cerr << "[DictionaryManager] iconv_open(UTF-8, " << fromCode
-                  << ") failed: " << strerror(errno) << std::endl;
-        return false;
-    }
-    std::string result;
-    result.reserve(input.size() * 2);
-    std::vector<char> buf(65536);
-    char* inPtr = const_cast<char*>(input.data());
-    size_t inLeft = input.size();
-    bool ok = true;
-    while (inLeft > 0) {
-        char* outPtr = buf.data();
-        size_t outLeft = buf.size();
-        size_t rc = iconv(cd, &inPtr, &inLeft, &outPtr, &outLeft);
-        result.append(buf.data(), buf.size() - outLeft);
-        if (rc == (size_t)-1) {
-            if (errno == E2BIG) continue; // 出力バッファ満杯 → 続行
-            ok = false;
-            break;
+// "#keyword NAME value..." を分解。NAME は最初の空白まで、value は行末まで（前方空白除去）。
+bool parseDirective(const std::string& line, const char* keyword,
+                    std::string& name, std::string& value) {
+    size_t klen = std::char_traits<char>::length(keyword);
+    if (line.compare(0, klen, keyword) != 0) return false;
+    size_t p = klen;
+    if (p >= line.size() || (line[p] != ' ' && line[p] != '\t')) return false;
+    while (p < line.size() && (line[p] == ' ' || line[p] == '\t')) p++;
+    size_t nameEnd = p;
+    while (nameEnd < line.size() && line[nameEnd] != ' ' && line[nameEnd] != '\t') nameEnd++;
+    if (nameEnd == p) return false;
+    name = line.substr(p, nameEnd - p);
+    size_t valStart = nameEnd;
+    while (valStart < line.size() && (line[valStart] == ' ' || line[valStart] == '\t')) valStart++;
+    value = line.substr(valStart);
+    while (!value.empty() && value.back() == '\r') value.pop_back();
+    while (!name.empty() && name.back() == '\r') name.pop_back();
+    return true;
+}
+
+// ファイル中の #globaldefine 宣言だけを登録順に拾う（置換は行わない）。
+// ディレクティブ行は置換前の生の行で解釈されるため、前のファイルの定義に依存しない。
+DicCache::Defines collectGlobalDefines(std::string_view content) {
+    DicCache::Defines defines;
+    size_t lineStart = 0;
+    while (lineStart < content.size()) {
+        size_t lineEnd = content.find('\n', lineStart);
+        if (lineEnd == std::string::npos) lineEnd = content.size();
+        if (content.compare(lineStart, 13, "#globaldefine") == 0) {
+            std::string name, value;
+            if (parseDirective(std::string(content.substr(lineStart, lineEnd - lineStart)), "#globaldefine", name, value)) {
+                defines.emplace_back(name, value);
+            }
         }
+        lineStart = lineEnd + 1;
     }
-    iconv_close(cd);
-    if (ok) output = std::move(result);
-    return ok;
+    return defines;
+}
+
+// [0, count) を最大 jobs 本のスレッドで処理する（jobs <= 1 なら呼び出し元スレッドで順に実行）
+template <typename F>
+void parallelFor(size_t count, int jobs, F&& fn) {
+    if (jobs <= 1 || count <= 1) {
+        for (size_t i = 0; i < count; ++i) fn(i);
+        return;
+    }
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> workers;
+    size_t threads = std::min(count, static_cast<size_t>(jobs));
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&]() {
+            for (size_t i = next++; i < count; i = next++) fn(i);
+        });
+    }
+    for (auto& w : workers) w.join();
 }
 
 } // namespace
@@ -101,24 +105,22 @@ void DictionaryManager::setCallback(VMCallback* callback) {
     }
 }
 
-std::string DictionaryManager::loadFile(const std::string& path) {
-    std::ifstream file(path, std::ios::binary);
-    if (!file.is_open()) {
-        std::cerr << "[DictionaryManager] Failed to open file: " << path << std::endl;
-        return "";
+std::unique_ptr<MappedFile> DictionaryManager::loadFile(const std::string& path) {
+    auto file = std::make_unique<MappedFile>(path);
+    if (!file->ok()) {
+        YAYA_LOG(Error, "[DictionaryManager] Failed to open file: " << path);
     }
-
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
+    return file;
 }
 
 // 辞書バイト列を UTF-8 テキストに正規化する。
 // 優先順位: UTF-8 BOM → 指定エンコーディング → 自動判定（UTF-8妥当性 → CP932変換）。
 // 既存の UTF-8 辞書を壊さないため、宣言が CP932 でも内容が妥当な非ASCII UTF-8 なら UTF-8 として扱う。
-std::string DictionaryManager::decodeContent(const std::string& raw,
-                                             const std::string& encoding,
-                                             const std::string& filename) {
+// UTF-8 のままで良いときは raw の一部を指すだけでコピーせず、変換したときだけ converted を指す。
+std::string_view DictionaryManager::decodeContent(std::string_view raw,
+                                                  const std::string& encoding,
+                                                  const std::string& filename,
+                                                  std::string& converted) {
     // UTF-8 BOM があれば除去して UTF-8 として確定
     if (raw.size() >= 3 &&
         (unsigned char)raw[0] == 0xEF &&
@@ -128,77 +130,56 @@ std::string DictionaryManager::decodeContent(const std::string& raw,
     }
 
     const std::string norm = normalizeEncodingName(encoding);
+    // ASCII か・UTF-8 として妥当かを 1 回の走査で調べる（UTF-8 は構造チェックのみ）
+    const text_scan::Encoding detected = text_scan::classify(raw);
 
     if (norm == "UTF-8") {
-        if (isValidUTF8(raw)) return raw;
-        std::string converted;
-        if (convertWithIconv(raw, "CP932", converted)) {
-            std::cerr << "[DictionaryManager] WARNING: " << filename
-                      << " declared UTF-8 but contains invalid UTF-8; converted from CP932" << std::endl;
+        if (detected != text_scan::Encoding::Invalid) return raw;
+        if (transcode::cp932ToUtf8(raw, converted)) {
+            YAYA_LOG(Warn, "[DictionaryManager] WARNING: " << filename
+                           << " declared UTF-8 but contains invalid UTF-8; converted from CP932");
             return converted;
         }
-        std::cerr << "[DictionaryManager] ERROR: " << filename
-                  << " is not valid UTF-8 and CP932 conversion failed; loading raw bytes (may mis-parse)" << std::endl;
+        YAYA_LOG(Error, "[DictionaryManager] ERROR: " << filename
+                        << " is not valid UTF-8 and CP932 conversion failed; loading raw bytes (may mis-parse)");
         return raw;
     }
 
     if (norm == "CP932") {
         // 宣言と異なり実体が UTF-8 のケース（作者が charset 更新を忘れた等）を保護する
-        if (hasNonAscii(raw) && isValidUTF8(raw)) {
-            std::cerr << "[DictionaryManager] WARNING: " << filename
-                      << " declared Shift_JIS/CP932 but content is valid UTF-8; using as UTF-8" << std::endl;
+        if (detected == text_scan::Encoding::Utf8) {
+            YAYA_LOG(Warn, "[DictionaryManager] WARNING: " << filename
+                           << " declared Shift_JIS/CP932 but content is valid UTF-8; using as UTF-8");
             return raw;
         }
-        std::string converted;
-        if (convertWithIconv(raw, "CP932", converted)) {
+        if (transcode::cp932ToUtf8(raw, converted)) {
             return converted;
         }
-        std::cerr << "[DictionaryManager] ERROR: " << filename
-                  << ": CP932 -> UTF-8 conversion failed; loading raw bytes (may mis-parse)" << std::endl;
+        YAYA_LOG(Error, "[DictionaryManager] ERROR: " << filename
+                        << ": CP932 -> UTF-8 conversion failed; loading raw bytes (may mis-parse)");
         return raw;
     }
 
     // AUTO: UTF-8 として妥当ならそのまま、そうでなければ CP932 とみなして変換
-    if (isValidUTF8(raw)) return raw;
-    std::string converted;
-    if (convertWithIconv(raw, "CP932", converted)) {
-        std::cerr << "[DictionaryManager] " << filename
-                  << ": detected CP932/Shift_JIS, converted to UTF-8" << std::endl;
+    if (detected != text_scan::Encoding::Invalid) return raw;
+    if (transcode::cp932ToUtf8(raw, converted)) {
+        YAYA_LOG(Info, "[DictionaryManager] " << filename
+                       << ": detected CP932/Shift_JIS, converted to UTF-8");
         return converted;
     }
-    std::cerr << "[DictionaryManager] ERROR: " << filename
-              << ": encoding detection failed (not UTF-8, CP932 conversion failed); loading raw bytes" << std::endl;
+    YAYA_LOG(Error, "[DictionaryManager] ERROR: " << filename
+                    << ": encoding detection failed (not UTF-8, CP932 conversion failed); loading raw bytes");
     return raw;
 }
 
 // 行頭 #define / #globaldefine ディレクティブを解釈し、宣言行より後ろの行へ
 // 登録順の単純テキスト置換を適用する（本家 YAYA プリプロセッサ互換の生置換）。
 // - #define は当該ファイル内のみ有効
-// - #globaldefine は以降にロードされる全ファイルにも有効（メンバに蓄積）
+// - #globaldefine は以降にロードされる全ファイルにも有効（globalDefines に追記）
 // - 適用順は「global（登録順）→ ファイル内 define（登録順）」
 // - ディレクティブ行自体は残置する（Lexer の '#' 行コメント読み飛ばしが安全網）
-std::string DictionaryManager::preprocessDirectives(const std::string& content) {
-    std::vector<std::pair<std::string, std::string>> fileDefines;
-
-    // "#keyword NAME value..." を分解。NAME は最初の空白まで、value は行末まで（前方空白除去）。
-    auto parseDirective = [](const std::string& line, const char* keyword,
-                             std::string& name, std::string& value) -> bool {
-        size_t klen = std::char_traits<char>::length(keyword);
-        if (line.compare(0, klen, keyword) != 0) return false;
-        size_t p = klen;
-        if (p >= line.size() || (line[p] != ' ' && line[p] != '\t')) return false;
-        while (p < line.size() && (line[p] == ' ' || line[p] == '\t')) p++;
-        size_t nameEnd = p;
-        while (nameEnd < line.size() && line[nameEnd] != ' ' && line[nameEnd] != '\t') nameEnd++;
-        if (nameEnd == p) return false;
-        name = line.substr(p, nameEnd - p);
-        size_t valStart = nameEnd;
-        while (valStart < line.size() && (line[valStart] == ' ' || line[valStart] == '\t')) valStart++;
-        value = line.substr(valStart);
-        while (!value.empty() && value.back() == '\r') value.pop_back();
-        while (!name.empty() && name.back() == '\r') name.pop_back();
-        return true;
-    };
+std::string DictionaryManager::preprocessDirectives(std::string_view content, Defines& globalDefines) {
+    Defines fileDefines;
 
     auto replaceAll = [](std::string& s, const std::string& from, const std::string& to) {
         if (from.empty()) return;
@@ -214,18 +195,17 @@ std::string DictionaryManager::preprocessDirectives(const std::string& content)
     size_t lineStart = 0;
     while (lineStart <= content.size()) {
         size_t lineEnd = content.find('\n', lineStart);
-        std::string line = (lineEnd == std::string::npos)
+        std::string line(lineEnd == std::string::npos
             ? content.substr(lineStart)
-            : content.substr(lineStart, lineEnd - lineStart);
+            : content.substr(lineStart, lineEnd - lineStart));
 
         std::string name, value;
         if (parseDirective(line, "#globaldefine", name, value)) {
-            preprocessorGlobalDefines_.emplace_back(name, value);
-            if (vm_) vm_->registerGlobalDefine(name, value);
+            globalDefines.emplace_back(name, value);
         } else if (parseDirective(line, "#define", name, value)) {
             fileDefines.emplace_back(name, value);
-        } else if (!preprocessorGlobalDefines_.empty() || !fileDefines.empty()) {
-            for (const auto& def : preprocessorGlobalDefines_) {
+        } else if (!globalDefines.empty() || !fileDefines.empty()) {
+            for (const auto& def : globalDefines) {
                 replaceAll(line, def.first, def.second);
             }
             for (const auto& def : fileDefines) {
@@ -241,52 +221,76 @@ std::string DictionaryManager::preprocessDirectives(const std::string& content)
     return out;
 }
 
-bool DictionaryManager::parseDictionary(const std::string& content, const std::string& sourceName) {
+bool DictionaryManager::needsPreprocess(std::string_view content, const Defines& globalDefines) {
+    return !globalDefines.empty() ||
+           content.find("#define") != std::string_view::npos ||
+           content.find("#globaldefine") != std::string_view::npos;
+}
+
+bool DictionaryManager::parseSource(std::string_view content, Defines& globalDefines,
+                                    std::vector<std::shared_ptr<AST::FunctionNode>>& functions,
+                                    std::string& error) {
     try {
         // std::cerr << "[DictionaryManager] Tokenizing..." << std::endl;
         auto start_time = std::chrono::steady_clock::now();
 
-        // 行頭 #define / #globaldefine を解釈・置換してから字句解析へ
-        std::string preprocessed = preprocessDirectives(content);
+        // 行頭 #define / #globaldefine を解釈・置換してから字句解析へ。
+        // 置換するものが無ければ前処理は内容を変えないので、content をそのまま字句解析する。
+        std::string preprocessed;
+        std::string_view source = content;
+        if (needsPreprocess(content, globalDefines)) {
+            preprocessed = preprocessDirectives(content, globalDefines);
+            source = preprocessed;
+        }
 
-        // Tokenize
-        Lexer lexer(preprocessed);
+        // Tokenize（トークンは source を指すので、パースが終わるまで source を保つ）
+        Lexer lexer(source);
         auto tokens = lexer.tokenize();
 
-        auto tokenize_time = std::chrono::steady_clock::now();
-        auto tokenize_duration = std::chrono::duration_cast<std::chrono::milliseconds>(tokenize_time - start_time).count();
-        // std::cerr << "[DictionaryManager] Got " << tokens.size() << " tokens in " << tokenize_duration << "ms, parsing AST..." << std::endl;
-
-        // Parse with timeout check
+        // Parse
         Parser parser(tokens);
-        // std::cerr << "[DictionaryManager] Parser created, calling parse()..." << std::endl;
-        auto functions = parser.parse();
+        functions = parser.parse();
 
         auto end_time = std::chrono::steady_clock::now();
-        auto parse_duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - tokenize_time).count();
         auto total_duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
 
-        // std::cerr << "[DictionaryManager] Parsed " << functions.size() << " functions" << std::endl;
-        // std::cerr << "[DictionaryManager] Timing: tokenize=" << tokenize_duration << "ms, parse=" << parse_duration << "ms, total=" << total_duration << "ms" << std::endl;
-
         // ★ パフォーマンス警告（デバッグ用） - 重要なので残す
         if (total_duration > 3000) { // 3秒以上
-            std::cerr << "[DictionaryManager] WARNING: Parsing took " << total_duration << "ms (>3s)" << std::endl;
+            YAYA_LOG(Warn, "[DictionaryManager] WARNING: Parsing took " << total_duration << "ms (>3s)");
         }
-
-        // Register functions in VM under a fresh source scope (for DICLOAD/DICUNLOAD ownership).
-        // std::cerr << "[DictionaryManager] Registering " << functions.size() << " functions..." << std::endl;
-        vm_->beginSource(sourceName);
-        for (const auto& func : functions) {
-            vm_->registerFunction(func->name, func);
-        }
-
-        // std::cerr << "[DictionaryManager] Registration complete" << std::endl;
         return true;
     } catch (const std::exception& e) {
-        std::cerr << "[DictionaryManager] Parse error: " << e.what() << std::endl;
+        error = e.what();
+        return false;
+    }
+}
+
+bool DictionaryManager::parseDictionary(std::string_view content, const std::string& sourceName) {
+    size_t definesBefore = preprocessorGlobalDefines_.size();
+    std::vector<std::shared_ptr<AST::FunctionNode>> functions;
+    std::string error;
+    bool ok = parseSource(content, preprocessorGlobalDefines_, functions, error);
+    // #globaldefine は構文エラーのファイルでも前処理の時点で有効になる
+    for (size_t i = definesBefore; i < preprocessorGlobalDefines_.size(); ++i) {
+        vm_->registerGlobalDefine(preprocessorGlobalDefines_[i].first, preprocessorGlobalDefines_[i].second);
+    }
+    if (!ok) {
+        YAYA_LOG(Error, "[DictionaryManager] Parse error: " << error);
         return false;
     }
+
+    // Register functions in VM under a fresh source scope (for DICLOAD/DICUNLOAD ownership).
+    vm_->beginSource(sourceName);
+    VM::FoldStats folding;
+    for (const auto& func : functions) {
+        if (optimize_) folding += vm_->foldConstants(*func);
+        vm_->registerFunction(func->name, func);
+    }
+    if (optimize_) {
+        YAYA_LOG(Debug, "[DictionaryManager] " << sourceName << ": constant folding " << folding.nodesBefore
+                        << " -> " << folding.nodesAfter << " nodes");
+    }
+    return true;
 }
 
 bool DictionaryManager::load(const std::vector<std::string>& dicPaths,
@@ -309,61 +313,152 @@ bool DictionaryManager::load(const std::vector<DicEntry>& dicEntries,
     vm_ = std::make_unique<VM>();
     if (storedCallback_) vm_->setCallback(storedCallback_);  // preserve callback through reset
     if (!ghostRoot_.empty()) vm_->setGhostRootPath(ghostRoot_);
+    vm_->setEngine(engine_);
+    vm_->setBudget(budget_);
+    vm_->setProfiler(profiler_);
     loadedDicFiles_.clear();
     preprocessorGlobalDefines_.clear();
 
     int success_count = 0;
     int fail_count = 0;
+    int cacheHits = 0;
+    VM::FoldStats folding;
+
+    // 読み込み・変換・前処理・パースはファイルごとに独立なのでワーカーへ分散し、
+    // VM への登録だけを宣言順に逐次で行う（結果は逐次ロードと同一）。
+    struct PendingDic {
+        std::string filename;
+        std::string encoding;
+        std::unique_ptr<MappedFile> file;
+        std::string_view raw;       // ファイルの生バイト列（file を指す。キャッシュキー用）
+        std::string converted;      // CP932 などから変換したときだけの UTF-8 の内容
+        std::string_view text;      // UTF-8 の内容（raw か converted を指す）
+        bool loaded = false;
+        bool decoded = false;
+        Defines ownDefines;         // このファイルの #globaldefine（登録順）
+        Defines definesBefore;      // このファイルより前に宣言された #globaldefine
+        DicCache::Entry parsed;
+        bool ok = false;
+        bool fromCache = false;
+        std::string error;
+    };
+    std::vector<PendingDic> pending(dicEntries.size());
 
-    // Load and parse each dictionary file
-    for (size_t i = 0; i < dicEntries.size(); ++i) {
+    // 1) 読み込みと #globaldefine の抽出
+    parallelFor(dicEntries.size(), jobs_, [&](size_t i) {
         const auto& entry = dicEntries[i];
-        const auto& path = entry.path;
-        auto file_start = std::chrono::steady_clock::now();
+        auto& dic = pending[i];
 
         // ファイル名のみ表示（パスが長すぎる場合）
-        std::string filename = path;
-        auto lastSlash = path.find_last_of("/\\");
+        dic.filename = entry.path;
+        auto lastSlash = entry.path.find_last_of("/\\");
         if (lastSlash != std::string::npos) {
-            filename = path.substr(lastSlash + 1);
+            dic.filename = entry.path.substr(lastSlash + 1);
+        }
+        // 文字コードを UTF-8 に正規化。per-dic エンコーディング優先、次にデフォルト。
+        dic.encoding = entry.encoding.empty() ? defaultEncoding : entry.encoding;
+
+        dic.file = loadFile(entry.path);
+        dic.raw = dic.file->view();
+        dic.loaded = !dic.raw.empty();
+        if (!dic.loaded) return;
+        // #globaldefine は後続ファイルの前処理に影響するので、含むファイルだけ先に変換して拾っておく
+        if (dic.raw.find("#globaldefine") != std::string_view::npos) {
+            dic.text = decodeContent(dic.raw, dic.encoding, dic.filename, dic.converted);
+            dic.decoded = true;
+            dic.ownDefines = collectGlobalDefines(dic.text);
+        }
+    });
+
+    // 2) 各ファイルの前処理で有効になる #globaldefine（宣言順の累積）
+    Defines active;
+    for (auto& dic : pending) {
+        dic.definesBefore = active;
+        active.insert(active.end(), dic.ownDefines.begin(), dic.ownDefines.end());
+    }
+
+    // 3) キャッシュ照合、または変換・前処理・字句解析・構文解析
+    parallelFor(dicEntries.size(), jobs_, [&](size_t i) {
+        const auto& path = dicEntries[i].path;
+        auto& dic = pending[i];
+        if (!dic.loaded) return;
+
+        // 構文木キャッシュ: キーが一致すれば変換・前処理・パースを省く
+        DicCache::Key cacheKey;
+        bool cacheable = !cacheDir_.empty() &&
+            DicCache::makeKey(path, dic.raw, dic.encoding, dic.definesBefore, cacheKey);
+        if (cacheable && DicCache(cacheDir_).read(cacheKey, dic.parsed)) {
+            dic.ok = true;
+            dic.fromCache = true;
+            dic.file.reset();
+            return;
+        }
+
+        if (!dic.decoded) {
+            dic.text = decodeContent(dic.raw, dic.encoding, dic.filename, dic.converted);
         }
+        Defines globalDefines = dic.definesBefore;
+        dic.ok = parseSource(dic.text, globalDefines, dic.parsed.functions, dic.error);
+        // 構文木は文字列をコピーして持つので、元のバイト列はここで手放す
+        dic.text = dic.raw = std::string_view();
+        std::string().swap(dic.converted);
+        dic.file.reset();
+        if (dic.ok && cacheable) {
+            dic.parsed.addedGlobalDefines = dic.ownDefines;
+            DicCache(cacheDir_).write(cacheKey, dic.parsed);
+        }
+    });
 
-        // std::cerr << "[DictionaryManager] [" << (i+1) << "/" << dicEntries.size() << "] Loading: " << filename << std::endl;
+    // 4) 宣言順に VM へ登録
+    for (size_t i = 0; i < dicEntries.size(); ++i) {
+        const auto& path = dicEntries[i].path;
+        auto& dic = pending[i];
 
-        std::string content = loadFile(path);
-        if (content.empty()) {
-            std::cerr << "[DictionaryManager] Failed to load file: " << filename << std::endl;
+        if (!dic.loaded) {
+            YAYA_LOG(Error, "[DictionaryManager] Failed to load file: " << dic.filename);
             fail_count++;
             continue;
         }
 
-        // 文字コードを UTF-8 に正規化。per-dic エンコーディング優先、次にデフォルト。
-        std::string effectiveEncoding = entry.encoding.empty() ? defaultEncoding : entry.encoding;
-        content = decodeContent(content, effectiveEncoding, filename);
-
-        // std::cerr << "[DictionaryManager] Loaded " << content.size() << " bytes, parsing..." << std::endl;
+        // #globaldefine は構文エラーのファイルでも前処理の時点で有効になる
+        for (const auto& def : dic.ownDefines) {
+            preprocessorGlobalDefines_.push_back(def);
+            vm_->registerGlobalDefine(def.first, def.second);
+        }
 
-        if (!parseDictionary(content, path)) {
-            std::cerr << "[DictionaryManager] Failed to parse: " << filename << std::endl;
+        if (!dic.ok) {
+            YAYA_LOG(Error, "[DictionaryManager] Parse error: " << dic.error);
+            YAYA_LOG(Error, "[DictionaryManager] Failed to parse: " << dic.filename);
             fail_count++;
             // Continue loading other files even if one fails
-        } else {
-            auto file_end = std::chrono::steady_clock::now();
-            auto file_duration = std::chrono::duration_cast<std::chrono::milliseconds>(file_end - file_start).count();
-            // std::cerr << "[DictionaryManager] Successfully parsed: " << filename << " (took " << file_duration << "ms)" << std::endl;
-            loadedDicFiles_.push_back(path);  // Store successfully loaded file path
-            success_count++;
+            continue;
         }
+
+        vm_->beginSource(path);
+        // 定数畳み込みは登録直前に行う（構文木キャッシュには畳み込む前の木を書く）
+        for (const auto& func : dic.parsed.functions) {
+            if (optimize_) folding += vm_->foldConstants(*func);
+            vm_->registerFunction(func->name, func);
+        }
+        loadedDicFiles_.push_back(path);  // Store successfully loaded file path
+        success_count++;
+        if (dic.fromCache) cacheHits++;
     }
 
     auto load_end = std::chrono::steady_clock::now();
     auto total_duration = std::chrono::duration_cast<std::chrono::milliseconds>(load_end - load_start).count();
 
     // 簡潔なサマリーのみ出力
-    std::cerr << "[DictionaryManager] Loaded " << success_count << "/" << dicEntries.size()
-              << " dictionaries in " << total_duration << "ms" << std::endl;
+    YAYA_LOG(Info, "[DictionaryManager] Loaded " << success_count << "/" << dicEntries.size()
+                   << " dictionaries in " << total_duration << "ms"
+                   << (cacheDir_.empty() ? std::string() : " (" + std::to_string(cacheHits) + " from cache)"));
+    if (optimize_) {
+        YAYA_LOG(Info, "[DictionaryManager] Constant folding: " << folding.nodesBefore << " -> "
+                       << folding.nodesAfter << " nodes (" << folding.foldedExpressions << " expressions, "
+                       << folding.prunedBranches << " branches)");
+    }
     if (fail_count > 0) {
-        std::cerr << "[DictionaryManager] " << fail_count << " failed" << std::endl;
+        YAYA_LOG(Error, "[DictionaryManager] " << fail_count << " failed");
     }
 
     // 全辞書が読めなかった場合のみ失敗扱い（一部失敗は継続）
@@ -378,11 +473,11 @@ void DictionaryManager::unload() {
 std::string DictionaryManager::execute(const std::string& functionName,
                                        const std::vector<std::string>& args) {
     if (!vm_) {
-        std::cerr << "[DictionaryManager::execute] ERROR: VM is null!" << std::endl;
+        YAYA_LOG(Error, "[DictionaryManager::execute] ERROR: VM is null!");
         return "";
     }
 
-    std::cerr << "[DictionaryManager::execute] Function: " << functionName << ", args: " << args.size() << std::endl;
+    YAYA_LOG(Debug, "[DictionaryManager::execute] Function: " << functionName << ", args: " << args.size());
 
     // Set SHIORI references
     vm_->setReferences(args);
@@ -394,22 +489,53 @@ std::string DictionaryManager::execute(const std::string& functionName,
     }
 
     // Execute the function
-    std::cerr << "[DictionaryManager::execute] Calling vm_->execute()..." << std::endl;
+    YAYA_LOG(Debug, "[DictionaryManager::execute] Calling vm_->execute()...");
     Value result = vm_->execute(functionName, valueArgs);
-    std::cerr << "[DictionaryManager::execute] VM execution complete, converting result..." << std::endl;
+    YAYA_LOG(Debug, "[DictionaryManager::execute] VM execution complete, converting result...");
 
     // Return the result as a string
     std::string resultStr = result.asString();
-    std::cerr << "[DictionaryManager::execute] Result length: " << resultStr.length() << std::endl;
+    YAYA_LOG(Debug, "[DictionaryManager::execute] Result length: " << resultStr.length());
 
     return resultStr;
 }
 
+bool DictionaryManager::executeShioriRequest(const std::string& method, const VM::ShioriHeaders& headers,
+                                             const std::string& requestText, std::string& response) {
+    if (!vm_) return false;
+    Value result;
+    if (!vm_->executeShioriRequest(method, headers, requestText, result)) return false;
+    response = result.asString();
+    return true;
+}
+
 void DictionaryManager::setGhostRoot(const std::string& root) {
     ghostRoot_ = root;
     if (vm_) vm_->setGhostRootPath(root);
 }
 
+void DictionaryManager::setEngine(VM::Engine engine) {
+    engine_ = engine;
+    if (vm_) vm_->setEngine(engine);
+}
+
+void DictionaryManager::setBudget(uint64_t ticks) {
+    budget_ = ticks;
+    if (vm_) vm_->setBudget(ticks);
+}
+
+void DictionaryManager::setProfiler(yaya_profile::Profiler* profiler) {
+    profiler_ = profiler;
+    if (vm_) vm_->setProfiler(profiler);
+}
+
+void DictionaryManager::setJobs(int jobs) {
+    if (jobs <= 0) {
+        jobs = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    jobs_ = jobs > 0 ? jobs : 1;
+}
+
 bool DictionaryManager::dicLoad(const std::string& relativePath, const std::string& encoding) {
     if (!vm_) return false;
     // Sandbox: reject absolute paths and parent traversal.
@@ -421,9 +547,11 @@ bool DictionaryManager::dicLoad(const std::string& relativePath, const std::stri
     if (!fullPath.empty() && fullPath.back() != '/') fullPath += '/';
     fullPath += relativePath;
 
-    std::string content = loadFile(fullPath);
-    if (content.empty()) return false;
-    content = decodeContent(content, encoding.empty() ? "auto" : encoding, relativePath);
+    auto file = loadFile(fullPath);
+    if (file->size() == 0) return false;
+    std::string converted;
+    std::string_view content = decodeContent(file->view(), encoding.empty() ? "auto" : encoding,
+                                             relativePath, converted);
     if (!parseDictionary(content, fullPath)) return false;
     // Avoid duplicate tracking in the loaded-files list.
     if (std::find(loadedDicFiles_.begin(), loadedDicFiles_.end(), fullPath) == loadedDicFiles_.end()) {
@@ -1,10 +1,13 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 #include "VM.hpp"
 
+class MappedFile;
+
 class DictionaryManager {
 public:
     DictionaryManager();
@@ -29,6 +32,11 @@ public:
     std::string execute(const std::string& functionName,
                         const std::vector<std::string>& args);
 
+    // SHIORI3FW の request を要求文字列の辞書側の解析なしで実行する（VM::executeShioriRequest）。
+    // 扱えなければ false（呼び出し側は execute("request", {requestText}) に戻る）
+    bool executeShioriRequest(const std::string& method, const VM::ShioriHeaders& headers,
+                              const std::string& requestText, std::string& response);
+
     // Check if a function exists in the loaded dictionaries
     bool hasFunction(const std::string& functionName) const;
 
@@ -44,20 +52,53 @@ public:
     bool appendRuntimeDic(const std::string& code);
     // Set the base directory used to anchor relative paths.
     void setGhostRoot(const std::string& root);
+    // Select the function execution engine (AST tree-walker or bytecode); kept across VM resets.
+    void setEngine(VM::Engine engine);
+    // Execution budget for each following execute() (VM::setBudget; 0 = only the time limit); kept across VM resets.
+    void setBudget(uint64_t ticks);
+    // Whether the last execute() was aborted by the budget, and the function that was running then.
+    bool budgetExhausted() const { return vm_ && vm_->budgetExhausted(); }
+    std::string budgetExhaustedIn() const { return vm_ ? vm_->budgetExhaustedIn() : std::string(); }
+    // Fold constant expressions and dead branches before registering functions (default on).
+    void setOptimize(bool optimize) { optimize_ = optimize; }
+    // Attach the profiler to the current and every later VM (nullptr detaches).
+    void setProfiler(yaya_profile::Profiler* profiler);
+    // Directory for the per-dictionary parsed AST cache (DicCache). Empty disables the cache.
+    void setCacheDirectory(const std::string& dir) { cacheDir_ = dir; }
+    // Worker threads used by load() for reading and parsing (0 = one per hardware thread).
+    // Registration stays sequential in declaration order, so the result does not depend on it.
+    void setJobs(int jobs);
 
 private:
+    using Defines = std::vector<std::pair<std::string, std::string>>;
+
     std::unique_ptr<VM> vm_;
     VMCallback* storedCallback_ = nullptr;  // preserved across VM resets
     std::vector<std::string> loadedDicFiles_;  // Paths of successfully loaded dic files
     std::string ghostRoot_;
+    VM::Engine engine_ = VM::Engine::Ast;
+    uint64_t budget_ = 0;
+    bool optimize_ = true;
+    yaya_profile::Profiler* profiler_ = nullptr;
+    std::string cacheDir_;
+    int jobs_ = 1;
     // #globaldefine で登録された置換（登録順を保持）。load() 開始時にクリアされ、
     // 登録以降にロードされる全ファイルへ適用される。
-    std::vector<std::pair<std::string, std::string>> preprocessorGlobalDefines_;
-    std::string loadFile(const std::string& path);
-    std::string decodeContent(const std::string& raw,
-                              const std::string& encoding,
-                              const std::string& filename);
-    // 行頭 #define / #globaldefine ディレクティブの解釈とテキスト置換（本家YAYA互換）
-    std::string preprocessDirectives(const std::string& content);
-    bool parseDictionary(const std::string& content, const std::string& sourceName);
+    Defines preprocessorGlobalDefines_;
+    // 辞書ファイルを読み取り専用で mmap する（開けなければ size() == 0）
+    std::unique_ptr<MappedFile> loadFile(const std::string& path);
+    std::string_view decodeContent(std::string_view raw,
+                                   const std::string& encoding,
+                                   const std::string& filename,
+                                   std::string& converted);
+    // 行頭 #define / #globaldefine ディレクティブの解釈とテキスト置換（本家YAYA互換）。
+    // 見つけた #globaldefine は globalDefines に追記する（VM への登録は呼び出し側）。
+    static std::string preprocessDirectives(std::string_view content, Defines& globalDefines);
+    // ディレクティブも適用する置換も無ければ前処理は内容を変えない
+    static bool needsPreprocess(std::string_view content, const Defines& globalDefines);
+    // 前処理・字句解析・構文解析のみ（VM に触れないのでワーカースレッドから呼べる）
+    static bool parseSource(std::string_view content, Defines& globalDefines,
+                            std::vector<std::shared_ptr<AST::FunctionNode>>& functions,
+                            std::string& error);
+    bool parseDictionary(std::string_view content, const std::string& sourceName);
 };
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ホストが FMO スナップショットを公開する POSIX 共有メモリ（shm_open）の読み書き。
+// yaya_core / satori_core はここからロックを取らずに読むので、READFMO のたびに
+// host_op でホストへ往復しなくて済む（セグメントが無ければ従来の host_op に戻る）。
+//
+//   offset 0   char[4]  magic "OFMO"
+//          4   u32      version(=1)
+//          8   u32      capacity（data に使えるバイト数）
+//          12  u32      sequence（seqlock。奇数の間は書き込み中）
+//          16  u32      length（data の有効バイト数）
+//          20  u32      reserved
+//          24  data[capacity]  スナップショット（id.key\x01value\r\n の並び、UTF-8）
+//
+// 書き手は 1 つ（ホスト）だけ。sequence を奇数にしてから length と data を書き、偶数に戻す。
+// 読み手は sequence が前後で同じ偶数だったときだけ写し取った内容を使う。
+namespace fmo_segment {
+
+constexpr char kMagic[4] = {'O', 'F', 'M', 'O'};
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kDefaultCapacity = 64u * 1024u;
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t capacity;
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint32_t> length;
+    uint32_t reserved;
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "seqlock needs lock-free 32-bit atomics");
+static_assert(sizeof(Header) == 24, "FMO segment header layout");
+
+namespace detail {
+
+// shm_open の名前は "/" で始める
+inline std::string shmName(const std::string& name) {
+    return !name.empty() && name.front() == '/' ? name : "/" + name;
+}
+
+inline char* dataOf(Header* header) { return reinterpret_cast<char*>(header + 1); }
+
+} // namespace detail
+
+// 読み手。read() は直前に読んだ世代から変わっていなければ写し直さない
+class Reader {
+public:
+    Reader() = default;
+    ~Reader() { close(); }
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+    // 見つからない・形式が違うときは false（開いていたものは閉じる）
+    bool open(const std::string& name) {
+        close();
+        int fd = ::shm_open(detail::shmName(name).c_str(), O_RDONLY, 0);
+        if (fd < 0) return false;
+        struct stat st;
+        void* map = MAP_FAILED;
+        if (::fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(Header)) {
+            map = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (map == MAP_FAILED) return false;
+        auto* header = static_cast<Header*>(map);
+        size_t size = static_cast<size_t>(st.st_size);
+        if (std::memcmp(header->magic, kMagic, sizeof kMagic) != 0 || header->version != kVersion ||
+            header->capacity > size - sizeof(Header)) {
+            ::munmap(map, size);
+            return false;
+        }
+        header_ = header;
+        mapSize_ = size;
+        return true;
+    }
+
+    void close() {
+        if (header_) ::munmap(header_, mapSize_);
+        header_ = nullptr;
+        mapSize_ = 0;
+        cachedSequence_ = 1;
+        cached_.clear();
+    }
+
+    bool isOpen() const { return header_ != nullptr; }
+    // 最後に read() できたスナップショットの世代（同じ値なら内容も同じ）
+    uint32_t generation() const { return cachedSequence_; }
+
+    // 一貫したスナップショット（次の read() まで有効）。
+    // 書き込みが続いて取れない・書き手が書き込み途中で止まっているときは nullptr
+    const std::string* read() {
+        if (!header_) return nullptr;
+        const char* data = detail::dataOf(header_);
+        for (int attempt = 0; attempt < kMaxAttempts; ++attempt) {
+            uint32_t before = header_->sequence.load(std::memory_order_acquire);
+            if (before & 1u) {
+                ::sched_yield();
+                continue;
+            }
+            if (before == cachedSequence_) return &cached_;
+            uint32_t length = header_->length.load(std::memory_order_relaxed);
+            if (length <= header_->capacity) {
+                scratch_.assign(data, length);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (header_->sequence.load(std::memory_order_relaxed) == before) {
+                    cached_.swap(scratch_);
+                    cachedSequence_ = before;
+                    return &cached_;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+private:
+    static constexpr int kMaxAttempts = 64;
+
+    Header* header_ = nullptr;
+    size_t mapSize_ = 0;
+    uint32_t cachedSequence_ = 1;  // 奇数は有効な世代にならない
+    std::string cached_;
+    std::string scratch_;
+};
+
+// 書き手（ホストと、その代わりをする検証用プロセス）
+class Writer {
+public:
+    Writer() = default;
+    ~Writer() { close(); }
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    // 作り直して空のスナップショットを公開する。unlinkOnClose なら close() で名前も消す
+    bool create(const std::string& name, uint32_t capacity = kDefaultCapacity, bool unlinkOnClose = true) {
+        close();
+        std::string shm = detail::shmName(name);
+        ::shm_unlink(shm.c_str());
+        int fd = ::shm_open(shm.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) return false;
+        size_t size = sizeof(Header) + capacity;
+        void* map = MAP_FAILED;
+        if (::ftruncate(fd, static_cast<off_t>(size)) == 0) {
+            map = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (map == MAP_FAILED) {
+            ::shm_unlink(shm.c_str());
+            return false;
+        }
+        // ftruncate で 0 埋めされているので、sequence=0 / length=0 のまま形式だけ書く
+        header_ = static_cast<Header*>(map);
+        header_->version = kVersion;
+        header_->capacity = capacity;
+        std::memcpy(header_->magic, kMagic, sizeof kMagic);
+        mapSize_ = size;
+        name_ = shm;
+        unlink_ = unlinkOnClose;
+        return true;
+    }
+
+    void close() {
+        if (header_) ::munmap(header_, mapSize_);
+        if (header_ && unlink_) ::shm_unlink(name_.c_str());
+        header_ = nullptr;
+        mapSize_ = 0;
+        name_.clear();
+    }
+
+    // capacity を超えるものは公開しない（前の内容が残る）
+    bool publish(std::string_view snapshot) {
+        if (!header_ || snapshot.size() > header_->capacity) return false;
+        uint32_t sequence = header_->sequence.load(std::memory_order_relaxed);
+        header_->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        header_->length.store(static_cast<uint32_t>(snapshot.size()), std::memory_order_relaxed);
+        std::memcpy(detail::dataOf(header_), snapshot.data(), snapshot.size());
+        header_->sequence.store(sequence + 2, std::memory_order_release);
+        return true;
+    }
+
+private:
+    Header* header_ = nullptr;
+    size_t mapSize_ = 0;
+    std::string name_;
+    bool unlink_ = true;
+};
+
+} // namespace fmo_segment
@@ -0,0 +1,203 @@
+#include "InstanceHost.hpp"
+#include "Log.hpp"
+#include <iostream>
+
+using json = nlohmann::json;
+
+InstanceHost::InstanceHost(int workers) : workers_(workers) {
+    if (workers_ <= 0) {
+        workers_ = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    if (workers_ <= 0) workers_ = 1;
+}
+
+void InstanceHost::run(std::istream& in, std::ostream& out) {
+    out_ = &out;
+    YAYA_LOG(Info, "[InstanceHost] Multi-instance mode with " << workers_ << " workers");
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < workers_; ++i) {
+        threads.emplace_back([this]() { workerLoop(); });
+    }
+
+    shiori_frame::Framing framing = shiori_frame::Framing::JsonLines;
+    for (;;) {
+        json req;
+        try {
+            if (framing == shiori_frame::Framing::Binary) {
+                std::string payload;
+                if (!shiori_frame::readFrame(in, payload)) break;
+                req = shiori_frame::decode(payload);
+            } else {
+                std::string line;
+                if (!std::getline(in, line)) break;
+                req = json::parse(line);
+            }
+        } catch (const std::exception& e) {
+            json response;
+            response["ok"] = false;
+            response["status"] = 500;
+            response["error"] = e.what();
+            writeMessage(response);
+            if (!in) break;  // 枠が読めなくなった入力は回復できない
+            continue;
+        }
+
+        if (req.is_object() && req.value("cmd", "") == "handshake") {
+            framing = handshake(req, framing);
+            continue;
+        }
+
+        // host_op への応答は待っているワーカーへ渡す
+        if (req.is_object() && req.contains("host_op_id")) {
+            deliverHostReply(std::move(req));
+            continue;
+        }
+
+        std::string id;
+        if (req.is_object() && req.contains("instance")) {
+            id = req["instance"].is_string() ? req["instance"].get<std::string>() : req["instance"].dump();
+        }
+        enqueue(id, std::move(req));
+    }
+
+    // 入力が閉じたら応答の来ない host_op を空応答で終わらせ、残りの要求を処理してから終了する
+    {
+        std::lock_guard<std::mutex> lock(hostMutex_);
+        inputClosed_ = true;
+    }
+    hostCv_.notify_all();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closing_ = true;
+    }
+    readyCv_.notify_all();
+    for (auto& t : threads) t.join();
+}
+
+void InstanceHost::enqueue(const std::string& id, json req) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& slot = instances_[id];
+    if (!slot) {
+        slot = std::make_unique<Instance>();
+        slot->id = id;
+        slot->core.setHostTransport([this, id](const json& request) {
+            return hostOperation(id, request);
+        });
+    }
+    slot->pending.push_back(std::move(req));
+    if (!slot->scheduled) {
+        slot->scheduled = true;
+        ready_.push_back(slot.get());
+        readyCv_.notify_one();
+    }
+}
+
+void InstanceHost::workerLoop() {
+    for (;;) {
+        Instance* instance = nullptr;
+        json req;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            readyCv_.wait(lock, [this]() { return closing_ || !ready_.empty(); });
+            if (ready_.empty()) return;
+            instance = ready_.front();
+            ready_.pop_front();
+            req = std::move(instance->pending.front());
+            instance->pending.pop_front();
+        }
+
+        json response = instance->core.processRequest(req);
+        if (req.is_object() && req.contains("instance")) {
+            response["instance"] = req["instance"];
+        }
+        writeMessage(response);
+
+        // 次の要求があれば列の末尾へ戻す（1 要求ごとに他のインスタンスへ順番を譲る）
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!instance->pending.empty()) {
+            ready_.push_back(instance);
+            readyCv_.notify_one();
+        } else {
+            instance->scheduled = false;
+            if (req.is_object() && req.value("cmd", "") == "unload") {
+                instances_.erase(instance->id);
+            }
+        }
+    }
+}
+
+void InstanceHost::deliverHostReply(json reply) {
+    // JSON Lines では符号なし、バイナリフレームでは符号付き整数として届く
+    uint64_t id = 0;
+    const json& hostOpId = reply["host_op_id"];
+    if (hostOpId.is_number_unsigned()) {
+        id = hostOpId.get<uint64_t>();
+    } else if (hostOpId.is_number_integer() && hostOpId.get<int64_t>() >= 0) {
+        id = static_cast<uint64_t>(hostOpId.get<int64_t>());
+    }
+    reply.erase("host_op_id");
+    reply.erase("instance");
+
+    std::lock_guard<std::mutex> lock(hostMutex_);
+    auto it = hostReplies_.find(id);
+    if (it == hostReplies_.end()) {
+        YAYA_LOG(Warn, "[InstanceHost] Unexpected host_op reply: host_op_id=" << id);
+        return;
+    }
+    it->second = reply.dump();
+    hostCv_.notify_all();
+}
+
+std::string InstanceHost::hostOperation(const std::string& instanceId, json request) {
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock(hostMutex_);
+        id = nextHostOpId_++;
+        hostReplies_[id];
+    }
+    request["instance"] = instanceId;
+    request["host_op_id"] = id;
+    writeMessage(request);
+
+    std::unique_lock<std::mutex> lock(hostMutex_);
+    hostCv_.wait(lock, [&]() { return hostReplies_[id].has_value() || inputClosed_; });
+    std::string reply = hostReplies_[id].value_or("{}");
+    hostReplies_.erase(id);
+    return reply;
+}
+
+shiori_frame::Framing InstanceHost::handshake(const json& req, shiori_frame::Framing current) {
+    std::string framingName = req.value("framing", "json");
+    shiori_frame::Framing framing;
+    json response;
+    if (!shiori_frame::parseFraming(framingName, framing)) {
+        response["ok"] = false;
+        response["status"] = 400;
+        response["error"] = "unsupported framing: " + framingName;
+        writeMessage(response);
+        return current;
+    }
+    response["ok"] = true;
+    response["status"] = 200;
+    response["framing"] = framingName;
+
+    // 応答は切り替え前の形式で書き、以降の出力から新しい形式にする
+    std::lock_guard<std::mutex> lock(outMutex_);
+    if (outFraming_ == shiori_frame::Framing::Binary) {
+        shiori_frame::writeFrame(*out_, shiori_frame::encode(response));
+    } else {
+        *out_ << response.dump() << std::endl;
+    }
+    outFraming_ = framing;
+    return framing;
+}
+
+void InstanceHost::writeMessage(const json& message) {
+    std::lock_guard<std::mutex> lock(outMutex_);
+    if (outFraming_ == shiori_frame::Framing::Binary) {
+        shiori_frame::writeFrame(*out_, shiori_frame::encode(message));
+    } else {
+        *out_ << message.dump() << std::endl;
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "ShioriFrame.hpp"
+#include "YayaCore.hpp"
+
+/// 1 プロセスで複数のゴーストを扱うマルチインスタンスモード（`yaya_core --workers N`）。
+/// 要求の "instance" ごとに YayaCore（辞書・VM・変数・乱数・ファイルハンドル）を分けて持ち、
+/// 異なるインスタンスの要求を N 本のワーカースレッドで並行に処理する。
+/// - 同じインスタンスの要求は受け取った順に 1 つずつ処理し、応答もその順に返す
+/// - 応答には要求の "instance" を付ける（インスタンス間の応答順は不定）
+/// - host_op は "instance" と "host_op_id" を付けて送り、ホストは同じ "host_op_id" を含む
+///   メッセージで応答する（stdin の読み手は 1 つなので ID で待ち手に振り分ける）
+/// - "unload" を処理し終えて待ち要求の無いインスタンスは破棄する
+/// - "handshake" はインスタンスに関係なくプロセス全体の枠付け（JSON Lines / バイナリ）を切り替える
+class InstanceHost {
+public:
+    // workers <= 0 ならハードウェアスレッド数
+    explicit InstanceHost(int workers);
+
+    // in が閉じるまで要求を読み、全要求の処理を終えてから戻る
+    void run(std::istream& in, std::ostream& out);
+
+private:
+    struct Instance {
+        std::string id;
+        YayaCore core;
+        std::deque<nlohmann::json> pending;
+        bool scheduled = false;  // ready_ に並んでいるか処理中
+    };
+
+    int workers_;
+    std::ostream* out_ = nullptr;
+    std::mutex outMutex_;
+    shiori_frame::Framing outFraming_ = shiori_frame::Framing::JsonLines;  // outMutex_ で保護
+
+    std::mutex mutex_;
+    std::condition_variable readyCv_;
+    std::unordered_map<std::string, std::unique_ptr<Instance>> instances_;
+    std::deque<Instance*> ready_;
+    bool closing_ = false;
+
+    std::mutex hostMutex_;
+    std::condition_variable hostCv_;
+    uint64_t nextHostOpId_ = 1;
+    std::unordered_map<uint64_t, std::optional<std::string>> hostReplies_;
+    bool inputClosed_ = false;
+
+    void enqueue(const std::string& id, nlohmann::json req);
+    void workerLoop();
+    void deliverHostReply(nlohmann::json reply);
+    std::string hostOperation(const std::string& instanceId, nlohmann::json request);
+    void writeMessage(const nlohmann::json& message);
+    shiori_frame::Framing handshake(const nlohmann::json& req, shiori_frame::Framing current);
+};
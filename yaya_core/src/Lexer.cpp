@@ -1,9 +1,13 @@
 #include "Lexer.hpp"
+#include "TextScan.hpp"
 #include <cctype>
 
-Lexer::Lexer(const std::string& source)
+Lexer::Lexer(std::string_view source)
     : source_(source), pos_(0), line_(1), column_(1) {}
 
+Lexer::Lexer(std::string&& source)
+    : storage_(std::move(source)), source_(storage_), pos_(0), line_(1), column_(1) {}
+
 char Lexer::current() const {
     if (pos_ >= source_.length()) return '\0';
     return source_[pos_];
@@ -27,32 +31,35 @@ void Lexer::advance() {
     }
 }
 
+// pos_ から n バイト進める（改行を含まない範囲に限る）
+void Lexer::skipBytes(size_t n) {
+    pos_ += n;
+    column_ += static_cast<int>(n);
+}
+
 void Lexer::skipWhitespace() {
-    while (current() != '\0' && std::isspace(current()) && current() != '\n') {
-        advance();
-    }
+    // '\n' は Newline トークンにするので含めない
+    skipBytes(text_scan::blankRun(source_.data() + pos_, source_.size() - pos_));
 }
 
 void Lexer::skipComment() {
+    // 行コメントは '\n'（または '\0'）の手前まで
+    auto skipLine = [this]() {
+        skipBytes(text_scan::findFirstOf(source_.data() + pos_, source_.size() - pos_, '\n', '\0', '\n', '\0'));
+    };
     // Line comment //
     if (current() == '/' && peek() == '/') {
-        while (current() != '\0' && current() != '\n') {
-            advance();
-        }
+        skipLine();
         return;
     }
     // Line comment -- (YAYA/Lua-style)
     if (current() == '-' && peek() == '-') {
-        while (current() != '\0' && current() != '\n') {
-            advance();
-        }
+        skipLine();
         return;
     }
     // Line comment starting with '#'
     if (current() == '#') {
-        while (current() != '\0' && current() != '\n') {
-            advance();
-        }
+        skipLine();
         return;
     }
     
@@ -60,7 +67,10 @@ void Lexer::skipComment() {
     if (current() == '/' && peek() == '*') {
         advance(); // /
         advance(); // *
-        while (current() != '\0') {
+        while (true) {
+            // '*' か改行までまとめて進む（改行は advance で行を数える）
+            skipBytes(text_scan::findFirstOf(source_.data() + pos_, source_.size() - pos_, '*', '\n', '\0', '*'));
+            if (current() == '\0') break;
             if (current() == '*' && peek() == '/') {
                 advance(); // *
                 advance(); // /
@@ -74,10 +84,28 @@ void Lexer::skipComment() {
 Token Lexer::readString() {
     int startLine = line_;
     int startCol = column_;
-    std::string value;
     char quote = current(); // Can be '"' or '\''
     
     advance(); // Skip opening quote
+
+    // 中身が元テキストと同じ間はその範囲を指すだけにし、\\ / \" のように文字が変わる
+    // エスケープに出会ったときだけ、それまでの分を value にコピーして組み立てる
+    size_t begin = pos_;
+    bool copied = false;
+    std::string value;
+    auto keep = [&](size_t n) {
+        if (copied) value.append(source_.substr(pos_, n));
+        for (size_t i = 0; i < n; ++i) advance();
+    };
+    auto unescape = [&](char c) {
+        if (!copied) {
+            value.assign(source_.substr(begin, pos_ - begin));
+            copied = true;
+        }
+        value += c;
+        advance(); // backslash
+        advance(); // escaped character
+    };
     
     while (current() != '\0' && current() != quote) {
         if (current() == '\\') {
@@ -97,8 +125,7 @@ Token Lexer::readString() {
                     after_quote == ']' || after_quote == '\n' || after_quote == '\r' ||
                     after_quote == ' ' || after_quote == '\t' || after_quote == '\0') {
                     // This is a literal backslash at end of string
-                    value += '\\';
-                    advance(); // consume the backslash
+                    keep(1); // consume the backslash
                     break; // Let the main loop consume the quote
                 }
             }
@@ -107,135 +134,116 @@ Token Lexer::readString() {
             // In YAYA, backslashes are mostly literal (for SakuraScript tags like \t, \u, \s, \w, etc.)
             // Only handle specific escape sequences: \\, \", \'
             // All other backslashes should be preserved as-is
-            advance();
-            if (current() != '\0') {
-                switch (current()) {
-                    case '\\':
-                        // \\ -> single backslash
-                        value += '\\';
-                        advance();
-                        break;
-                    case '"':
-                        // \" -> quote (only if quote matches string delimiter)
-                        if (quote == '"') {
-                            value += '"';
-                            advance();
-                        } else {
-                            // Not escaping, backslash is literal
-                            value += '\\';
-                            value += current();
-                            advance();
-                        }
-                        break;
-                    case '\'':
-                        // \' -> quote (only if quote matches string delimiter)
-                        if (quote == '\'') {
-                            value += '\'';
-                            advance();
-                        } else {
-                            // Not escaping, backslash is literal
-                            value += '\\';
-                            value += current();
-                            advance();
-                        }
-                        break;
-                    default:
-                        // All other cases: preserve backslash + character
-                        // This includes SakuraScript tags like \t, \u, \s, \w, \n, etc.
-                        value += '\\';
-                        value += current();
-                        advance();
-                        break;
+            if (next == '\0') {
+                // Backslash at end of input is dropped
+                if (!copied) {
+                    value.assign(source_.substr(begin, pos_ - begin));
+                    copied = true;
                 }
+                advance();
+            } else if (next == '\\') {
+                // \\ -> single backslash
+                unescape('\\');
+            } else if (next == quote) {
+                // \" or \' -> quote (only if quote matches string delimiter)
+                unescape(quote);
+            } else {
+                // All other cases: preserve backslash + character
+                // This includes SakuraScript tags like \t, \u, \s, \w, \n, etc.
+                keep(2);
             }
         } else {
-            value += current();
-            advance();
+            // 引用符・'\\'・改行の手前までは元テキストのまま
+            size_t n = text_scan::findFirstOf(source_.data() + pos_, source_.size() - pos_, quote, '\\', '\0', '\n');
+            if (n == 0) {
+                keep(1); // '\n'
+                continue;
+            }
+            if (copied) value.append(source_.substr(pos_, n));
+            skipBytes(n);
         }
     }
+
+    std::string_view text = source_.substr(begin, pos_ - begin);
+    if (copied) {
+        unescaped_.push_back(std::move(value));
+        text = unescaped_.back();
+    }
     
     if (current() == quote) {
         advance(); // Skip closing quote
     }
     
-    return Token(TokenType::String, value, startLine, startCol);
+    return Token(TokenType::String, text, startLine, startCol);
 }
 
 Token Lexer::readNumber() {
     int startLine = line_;
     int startCol = column_;
-    std::string value;
+    size_t begin = pos_;
 
     // Hex literal: 0x... or 0X...
     if (current() == '0' && (peek() == 'x' || peek() == 'X')) {
-        value += current();      // '0'
-        advance();
-        value += current();      // 'x' or 'X'
-        advance();
+        advance(); // '0'
+        advance(); // 'x' or 'X'
 
         // Read at least one hex digit (0-9, a-f, A-F)
         bool hasHexDigit = false;
         while (std::isxdigit(static_cast<unsigned char>(current()))) {
             hasHexDigit = true;
-            value += current();
             advance();
         }
 
         // If no hex digits followed, treat as integer 0
         if (!hasHexDigit) {
-            value = "0";
+            return Token(TokenType::Integer, "0", startLine, startCol);
         }
 
-        return Token(TokenType::Integer, value, startLine, startCol);
+        return Token(TokenType::Integer, source_.substr(begin, pos_ - begin), startLine, startCol);
     }
 
     // Decimal integer (or real if a single '.' followed by a digit is present)
     while (std::isdigit(static_cast<unsigned char>(current()))) {
-        value += current();
         advance();
     }
 
     // Real number: a '.' followed by at least one digit (e.g. 1.5, 3.14).
     // We require a trailing digit so that "1." (member access etc.) is not consumed.
     if (current() == '.' && std::isdigit(static_cast<unsigned char>(peek()))) {
-        value += current(); // '.'
-        advance();
+        advance(); // '.'
         while (std::isdigit(static_cast<unsigned char>(current()))) {
-            value += current();
             advance();
         }
     }
 
-    return Token(TokenType::Integer, value, startLine, startCol);
+    return Token(TokenType::Integer, source_.substr(begin, pos_ - begin), startLine, startCol);
 }
 
 Token Lexer::readIdentifier() {
     int startLine = line_;
     int startCol = column_;
-    std::string value;
+    size_t begin = pos_;
     
     // Allow ASCII alphanumeric, underscore, backslash, and UTF-8 multi-byte characters
     while (current() != '\0') {
         unsigned char ch = static_cast<unsigned char>(current());
         // ASCII alphanumeric or underscore
         if (std::isalnum(ch) || ch == '_') {
-            value += current();
             advance();
         }
         // Backslash (for function names like On_\ms)
         else if (ch == '\\') {
-            value += current();
             advance();
         }
         // UTF-8 multi-byte character (0x80-0xFF)
         else if (ch >= 0x80) {
-            value += current();
             advance();
         }
         else {
             break;
         }
     }
+    std::string_view value = source_.substr(begin, pos_ - begin);
     
     // Check for keywords
     TokenType type = TokenType::Identifier;
@@ -440,7 +448,7 @@ std::vector<Token> Lexer::tokenize() {
             case ';': tokens.push_back(Token(TokenType::Semicolon, ";", startLine, startCol)); break;
             case '&': tokens.push_back(Token(TokenType::Ampersand, "&", startLine, startCol)); break;
             default:
-                tokens.push_back(Token(TokenType::Unknown, std::string(1, ch), startLine, startCol));
+                tokens.push_back(Token(TokenType::Unknown, source_.substr(pos_, 1), startLine, startCol));
                 break;
         }
         
@@ -454,7 +462,8 @@ std::vector<Token> Lexer::tokenize() {
 Token Lexer::readHereDoc(char quote) {
     int startLine = line_;
     int startCol = column_;
-    std::string value;
+    size_t begin = pos_;
+    size_t end = std::string_view::npos;
 
     // Read until a line that begins (ignoring spaces/tabs) with quote + ">>"
     bool atLineStart = true;
@@ -468,6 +477,7 @@ Token Lexer::readHereDoc(char quote) {
             }
             if (k + 2 < source_.size() && source_[k] == quote && source_[k+1] == '>' && source_[k+2] == '>') {
                 // Advance past the terminator
+                end = pos_;
                 pos_ = k + 3;
                 column_ += static_cast<int>((k + 3) - pos_); // column_ will be corrected below on newline
                 // Consume optional CR/LF after terminator
@@ -478,7 +488,6 @@ Token Lexer::readHereDoc(char quote) {
         }
 
         char c = current();
-        value += c;
         advance();
 
         if (c == '\n') {
@@ -491,5 +500,6 @@ Token Lexer::readHereDoc(char quote) {
         }
     }
 
-    return Token(TokenType::String, value, startLine, startCol);
+    if (end == std::string_view::npos) end = pos_;
+    return Token(TokenType::String, source_.substr(begin, end - begin), startLine, startCol);
 }
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <deque>
 #include <string>
+#include <string_view>
 #include <vector>
 
 enum class TokenType {
@@ -76,23 +78,33 @@ enum class TokenType {
     Unknown
 };
 
+// value は字句解析した元テキスト（またはエスケープを解いた Lexer 内の文字列）を指すだけで、
+// トークンを使う間は Lexer を生かしておくこと。
 struct Token {
     TokenType type;
-    std::string value;
+    std::string_view value;
     int line;
     int column;
     
-    Token(TokenType t, const std::string& v = "", int l = 0, int c = 0)
+    Token(TokenType t, std::string_view v = {}, int l = 0, int c = 0)
         : type(t), value(v), line(l), column(c) {}
 };
 
 class Lexer {
 public:
-    explicit Lexer(const std::string& source);
+    // source を参照するだけでコピーしない（tokenize の結果を使い終えるまで source を保つこと）
+    explicit Lexer(std::string_view source);
+    // 一時文字列は Lexer が引き取る
+    explicit Lexer(std::string&& source);
+    Lexer(const Lexer&) = delete;
+    Lexer& operator=(const Lexer&) = delete;
+
     std::vector<Token> tokenize();
     
 private:
-    std::string source_;
+    std::string storage_;       // 引き取ったソース（参照のみのときは空）
+    std::string_view source_;
+    std::deque<std::string> unescaped_;  // \\ / \" を解いた文字列リテラル（元テキストと異なるものだけ）
     size_t pos_;
     int line_;
     int column_;
@@ -100,6 +112,7 @@ private:
     char current() const;
     char peek(int offset = 1) const;
     void advance();
+    void skipBytes(size_t n);
     void skipWhitespace();
     void skipComment();
     
@@ -0,0 +1,196 @@
+#include "Log.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace yaya_log {
+
+std::atomic<int> g_level{static_cast<int>(Level::Trace)};
+
+namespace {
+
+// 複数書き手・単一読み手の有界リングバッファ（スロットごとの通し番号で受け渡す）。
+// 書き手は CAS だけで場所を確保し、ロックも確保もしない（文字列はムーブで置く）。
+class Ring {
+public:
+    static constexpr size_t kCapacity = 4096;  // 2 の冪
+
+    Ring() : slots_(new Slot[kCapacity]) {
+        for (size_t i = 0; i < kCapacity; ++i) {
+            slots_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // 満杯なら false
+    bool push(std::string&& line) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots_[pos & (kCapacity - 1)];
+            size_t seq = slot.seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.text = std::move(line);
+                    slot.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // 読み手（ドレインスレッド）専用
+    bool pop(std::string& out) {
+        Slot& slot = slots_[head_ & (kCapacity - 1)];
+        size_t seq = slot.seq.load(std::memory_order_acquire);
+        if (seq != head_ + 1) return false;
+        out = std::move(slot.text);
+        slot.text.clear();
+        slot.seq.store(head_ + kCapacity, std::memory_order_release);
+        ++head_;
+        return true;
+    }
+
+    // これまでに確保された行数
+    size_t pushed() const { return tail_.load(std::memory_order_acquire); }
+
+private:
+    struct Slot {
+        std::atomic<size_t> seq;
+        std::string text;
+    };
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<size_t> tail_{0};
+    size_t head_ = 0;
+};
+
+// 非同期出力。一度起動したらプロセス終了まで残す（同期へ戻しても、切り替えの瞬間に
+// 積まれた行を取りこぼさないため）。終了時にデストラクタで残りを書き出す。
+class AsyncSink {
+public:
+    AsyncSink() : thread_([this]() { drainLoop(); }) {}
+
+    ~AsyncSink() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_one();
+        thread_.join();
+    }
+
+    void write(std::string&& line) {
+        if (!ring_.push(std::move(line))) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void flush() {
+        size_t target = ring_.pushed();
+        while (written_.load(std::memory_order_acquire) < target) {
+            cv_.notify_one();
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+
+private:
+    Ring ring_;
+    std::atomic<size_t> dropped_{0};
+    std::atomic<size_t> written_{0};
+    std::mutex mutex_;  // 待機と停止の通知だけに使う（書き手は取らない）
+    std::condition_variable cv_;
+    bool stop_ = false;
+    std::thread thread_;
+
+    void drainLoop() {
+        std::string batch;
+        std::string line;
+        for (;;) {
+            size_t count = 0;
+            while (ring_.pop(line)) {
+                batch += line;
+                batch += '\n';
+                ++count;
+            }
+            size_t dropped = dropped_.exchange(0, std::memory_order_relaxed);
+            if (dropped > 0) {
+                batch += "[yaya_log] " + std::to_string(dropped) + " line(s) dropped (buffer full)\n";
+            }
+            if (!batch.empty()) {
+                std::fwrite(batch.data(), 1, batch.size(), stderr);
+                std::fflush(stderr);
+                batch.clear();
+            }
+            if (count > 0) {
+                written_.fetch_add(count, std::memory_order_release);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (stop_) return;
+            cv_.wait_for(lock, std::chrono::milliseconds(2));
+        }
+    }
+};
+
+std::mutex g_configMutex;
+std::unique_ptr<AsyncSink> g_sink;          // g_configMutex で生成
+std::atomic<AsyncSink*> g_asyncSink{nullptr};  // null なら同期出力
+
+} // namespace
+
+bool parseLevel(const std::string& name, Level& level) {
+    std::string s = name;
+    std::transform(s.begin(), s.end(), s.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (s == "off" || s == "none" || s == "0") level = Level::Off;
+    else if (s == "error" || s == "1") level = Level::Error;
+    else if (s == "warn" || s == "warning" || s == "2") level = Level::Warn;
+    else if (s == "info" || s == "3") level = Level::Info;
+    else if (s == "debug" || s == "4") level = Level::Debug;
+    else if (s == "trace" || s == "5") level = Level::Trace;
+    else return false;
+    return true;
+}
+
+void setLevel(Level level) {
+    g_level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+void configure(Level level, bool async) {
+    std::lock_guard<std::mutex> lock(g_configMutex);
+    setLevel(level);
+    if (async) {
+        if (!g_sink) g_sink = std::make_unique<AsyncSink>();
+        g_asyncSink.store(g_sink.get(), std::memory_order_release);
+    } else if (g_asyncSink.load(std::memory_order_acquire)) {
+        g_asyncSink.store(nullptr, std::memory_order_release);
+        g_sink->flush();
+    }
+}
+
+void write(Level, std::string line) {
+    if (AsyncSink* sink = g_asyncSink.load(std::memory_order_acquire)) {
+        sink->write(std::move(line));
+        return;
+    }
+    std::cerr << line << std::endl;
+}
+
+void flush() {
+    if (AsyncSink* sink = g_asyncSink.load(std::memory_order_acquire)) {
+        sink->flush();
+    }
+}
+
+} // namespace yaya_log
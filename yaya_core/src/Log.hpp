@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <sstream>
+#include <string>
+
+// yaya_core の診断ログ（stderr）。
+// - レベルは load コマンドの "log_level" で切り替える（プロセス全体で共有）
+// - 無効なレベルの YAYA_LOG は atomic の読み出し 1 回だけで、メッセージを組み立てない
+// - YAYA_LOG_MAX_LEVEL（ビルド時の上限）を超えるレベルの呼び出しはコンパイル時に消える
+// - "log_async" が有効なら、書き込みはロックフリーのリングバッファへ積むだけで、
+//   バックグラウンドスレッドがまとめて stderr へ書き出す（満杯時は破棄して件数を報告）
+namespace yaya_log {
+
+enum class Level : int {
+    Off = 0,
+    Error = 1,
+    Warn = 2,
+    Info = 3,   // 読み込み・要求ごとの概要
+    Debug = 4,  // 要求の処理経路、結果のプレビュー
+    Trace = 5   // 関数呼び出しごと（VM::execute, SHIORI3FW 代入）
+};
+
+#ifndef YAYA_LOG_MAX_LEVEL
+#define YAYA_LOG_MAX_LEVEL 5
+#endif
+
+// 現在のレベル（既定は従来どおり全て出力する Trace）
+extern std::atomic<int> g_level;
+
+inline bool enabled(Level level) {
+    return static_cast<int>(level) <= YAYA_LOG_MAX_LEVEL &&
+           static_cast<int>(level) <= g_level.load(std::memory_order_relaxed);
+}
+
+// "off" / "error" / "warn" / "info" / "debug" / "trace"（大文字小文字は区別しない）または 0-5
+bool parseLevel(const std::string& name, Level& level);
+
+// レベルと出力方式を設定する。同期出力へ戻すときは溜まっている分を書き出してから戻す。
+void configure(Level level, bool async);
+void setLevel(Level level);
+
+// 1 行を書く（改行は付けて出力する）
+void write(Level level, std::string line);
+
+// 非同期モードで溜まっている行を書き出し終えるまで待つ
+void flush();
+
+} // namespace yaya_log
+
+// YAYA_LOG(Warn, "[VM] x=" << x);  レベルが無効なら右辺は評価されない
+#define YAYA_LOG(level, expr)                                                      \
+    do {                                                                           \
+        if (::yaya_log::enabled(::yaya_log::Level::level)) {                       \
+            std::ostringstream yaya_log_os_;                                       \
+            yaya_log_os_ << expr;                                                  \
+            ::yaya_log::write(::yaya_log::Level::level, yaya_log_os_.str());       \
+        }                                                                          \
+    } while (0)
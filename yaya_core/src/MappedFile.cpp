@@ -0,0 +1,40 @@
+#include "MappedFile.hpp"
+#include <fstream>
+#include <iterator>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    ok_ = true;
+    if (size_ == 0) {
+        ::close(fd);
+        return;
+    }
+    void* map = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map != MAP_FAILED) {
+        map_ = map;
+        data_ = static_cast<const char*>(map);
+        return;
+    }
+    // mmap できないファイルシステムでは普通に読む
+    std::ifstream in(path, std::ios::binary);
+    fallback_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    ok_ = static_cast<bool>(in) || in.eof();
+    data_ = fallback_.data();
+    size_ = fallback_.size();
+}
+
+MappedFile::~MappedFile() {
+    if (map_) ::munmap(map_, size_);
+}
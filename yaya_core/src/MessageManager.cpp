@@ -1,4 +1,5 @@
 #include "MessageManager.hpp"
+#include "Log.hpp"
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -6,7 +7,7 @@
 bool MessageManager::load(const std::string& path) {
     std::ifstream file(path);
     if (!file.is_open()) {
-        std::cerr << "[MessageManager] Failed to open message file: " << path << std::endl;
+        YAYA_LOG(Error, "[MessageManager] Failed to open message file: " << path);
         return false;
     }
 
@@ -56,7 +57,7 @@ bool MessageManager::parseMessageTxt(const std::string& content) {
             auto it = sectionToType.find(sectionName);
             if (it != sectionToType.end()) {
                 currentSection = it->second;
-                std::cerr << "[MessageManager] Entering section: " << currentSection << std::endl;
+                YAYA_LOG(Debug, "[MessageManager] Entering section: " << currentSection);
             }
             continue;
         }
@@ -104,11 +105,13 @@ bool MessageManager::parseMessageTxt(const std::string& content) {
         }
     }
 
-    std::cerr << "[MessageManager] Loaded messages: ";
-    for (const auto& pair : messages_) {
-        std::cerr << pair.first << "=" << pair.second.size() << " ";
+    if (yaya_log::enabled(yaya_log::Level::Info)) {
+        std::string counts;
+        for (const auto& pair : messages_) {
+            counts += pair.first + "=" + std::to_string(pair.second.size()) + " ";
+        }
+        YAYA_LOG(Info, "[MessageManager] Loaded messages: " << counts);
     }
-    std::cerr << std::endl;
 
     return true;
 }
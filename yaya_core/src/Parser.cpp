@@ -1,9 +1,34 @@
 #include "Parser.hpp"
+#include "Log.hpp"
 #include <stdexcept>
 #include <iostream>
 #include <algorithm>
 #include <cctype>
 
+namespace {
+
+// 数値リテラル（10進/16進/実数）をパース時に Value へデコードする
+Value numericLiteralValue(const std::string& s) {
+    try {
+        // Support hex literals like 0xFF / 0Xff
+        if (s.size() > 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+            // Parse hex (skip 0x prefix)
+            int v = std::stoi(s.substr(2), nullptr, 16);
+            return Value(v);
+        }
+        // Real literal: contains a decimal point
+        if (s.find('.') != std::string::npos) {
+            return Value(std::stod(s));
+        }
+        // Decimal fallback
+        return Value(std::stoi(s, nullptr, 10));
+    } catch (...) {
+        return Value(0);
+    }
+}
+
+} // namespace
+
 Parser::Parser(const std::vector<Token>& tokens) : tokens_(tokens), pos_(0) {}
 
 const Token& Parser::current() const {
@@ -69,15 +94,15 @@ std::vector<std::shared_ptr<AST::FunctionNode>> Parser::parse() {
 
         // プログレス保証: 位置が進んでいない場合は強制的に進める
         if (pos_ == pos_before) {
-            std::cerr << "[Parser::parse] WARNING: No progress at token '"
-                      << current().value << "' (type=" << static_cast<int>(current().type)
-                      << ") line " << current().line << ", advancing" << std::endl;
+            YAYA_LOG(Warn, "[Parser::parse] WARNING: No progress at token '"
+                           << current().value << "' (type=" << static_cast<int>(current().type)
+                           << ") line " << current().line << ", advancing");
             advance();  // 強制的に進む
         }
 
         // 無限ループ検出
         if (++safety_counter > MAX_ITERATIONS) {
-            std::cerr << "[Parser::parse] ERROR: Infinite loop detected, aborting" << std::endl;
+            YAYA_LOG(Error, "[Parser::parse] ERROR: Infinite loop detected, aborting");
             break;
         }
     }
@@ -109,11 +134,11 @@ std::shared_ptr<AST::FunctionNode> Parser::parseFunction() {
     }
 
     // Function name can be dotted (e.g., E.EvalEmbedValue)
-    std::string name = current().value;
+    std::string name(current().value);
     advance();
     while (check(TokenType::Dot) && peek().type == TokenType::Identifier) {
         advance(); // consume '.'
-        name += "." + current().value;
+        name += "." + std::string(current().value);
         advance(); // consume identifier
     }
 
@@ -151,10 +176,10 @@ std::shared_ptr<AST::FunctionNode> Parser::parseFunction() {
 
         // ★★ 重要: 位置が進んでいない場合は強制的に進める
         if (pos_ == pos_before) {
-            std::cerr << "[Parser] WARNING: No progress in function '" << name
-                      << "' at token '" << current().value
-                      << "' (type=" << static_cast<int>(current().type)
-                      << ") line " << current().line << std::endl;
+            YAYA_LOG(Warn, "[Parser] WARNING: No progress in function '" << name
+                           << "' at token '" << current().value
+                           << "' (type=" << static_cast<int>(current().type)
+                           << ") line " << current().line);
 
             // 次のトークンへ強制的に進む
             advance();
@@ -162,8 +187,8 @@ std::shared_ptr<AST::FunctionNode> Parser::parseFunction() {
 
         // ★★ 安全装置: 無限ループ検出
         if (++safety_counter > MAX_ITERATIONS) {
-            std::cerr << "[Parser] ERROR: Infinite loop detected in function '"
-                      << name << "', aborting parse" << std::endl;
+            YAYA_LOG(Error, "[Parser] ERROR: Infinite loop detected in function '"
+                            << name << "', aborting parse");
             break;
         }
     }
@@ -176,8 +201,8 @@ std::shared_ptr<AST::FunctionNode> Parser::parseFunction() {
             advance(); // consume the label
         }
     } else {
-        std::cerr << "[Parser] WARNING: Function '" << name
-                  << "' ended at EOF instead of '}'" << std::endl;
+        YAYA_LOG(Warn, "[Parser] WARNING: Function '" << name
+                       << "' ended at EOF instead of '}'");
     }
 
     auto fn = std::make_shared<AST::FunctionNode>(name, body);
@@ -458,7 +483,7 @@ std::shared_ptr<AST::Node> Parser::parseStatement() {
 
     // ★ 不明なトークンをスキップ
     if (check(TokenType::Unknown)) {
-        std::cerr << "[Parser] Skipping unknown token at line " << current().line << std::endl;
+        YAYA_LOG(Warn, "[Parser] Skipping unknown token at line " << current().line);
         advance();
         return nullptr;
     }
@@ -467,7 +492,7 @@ std::shared_ptr<AST::Node> Parser::parseStatement() {
     try {
         return parseExpression();
     } catch (const std::exception& e) {
-        std::cerr << "[Parser] Error parsing expression: " << e.what() << std::endl;
+        YAYA_LOG(Error, "[Parser] Error parsing expression: " << e.what());
         // ★ 進行保証: 未処理トークンで例外が出た場合（parsePrimary の
         //   "Unexpected token" 等）、現在位置に留まったままだと呼び出し元の文ループ
         //   （parseBlock/parseWhile/parseFor/parseForeach）が同じトークンで永久に
@@ -496,7 +521,7 @@ std::shared_ptr<AST::Node> Parser::parseAssignment() {
             if (!check(TokenType::Identifier)) {
                 throw std::runtime_error("Expected identifier after '.' in assignment at line " + std::to_string(current().line));
             }
-            varName += "." + current().value;
+            varName += "." + std::string(current().value);
             advance();
         }
     } else if (check(TokenType::Identifier)) {
@@ -507,7 +532,7 @@ std::shared_ptr<AST::Node> Parser::parseAssignment() {
             if (!check(TokenType::Identifier)) {
                 throw std::runtime_error("Expected identifier after '.' in assignment at line " + std::to_string(current().line));
             }
-            varName += "." + current().value;
+            varName += "." + std::string(current().value);
             advance();
         }
     } else {
@@ -532,14 +557,14 @@ std::shared_ptr<AST::Node> Parser::parseAssignment() {
             match(TokenType::StarAssign) || match(TokenType::SlashAssign) ||
             match(TokenType::PercentAssign)) {
             TokenType lastOpType = tokens_[pos_-1].type;
-            std::string op;
+            AST::BinaryOperator op;
             switch (lastOpType) {
-                case TokenType::PlusAssign: op = "+"; break;
-                case TokenType::MinusAssign: op = "-"; break;
-                case TokenType::StarAssign: op = "*"; break;
-                case TokenType::SlashAssign: op = "/"; break;
-                case TokenType::PercentAssign: op = "%"; break;
-                default: op = "+"; break;
+                case TokenType::PlusAssign: op = AST::BinaryOperator::Add; break;
+                case TokenType::MinusAssign: op = AST::BinaryOperator::Sub; break;
+                case TokenType::StarAssign: op = AST::BinaryOperator::Mul; break;
+                case TokenType::SlashAssign: op = AST::BinaryOperator::Div; break;
+                case TokenType::PercentAssign: op = AST::BinaryOperator::Mod; break;
+                default: op = AST::BinaryOperator::Add; break;
             }
             auto rhs = parseExpression();
             // Create array access node for left side (use first index)
@@ -569,14 +594,14 @@ std::shared_ptr<AST::Node> Parser::parseAssignment() {
         // Instead, check the previous token type via peek(-1) is not available.
         // Work around: we re-derive operator by looking at tokens_[pos_-1].
         TokenType lastOpType = tokens_[pos_-1].type;
-        std::string op;
+        AST::BinaryOperator op;
         switch (lastOpType) {
-            case TokenType::PlusAssign: op = "+"; break;
-            case TokenType::MinusAssign: op = "-"; break;
-            case TokenType::StarAssign: op = "*"; break;
-            case TokenType::SlashAssign: op = "/"; break;
-            case TokenType::PercentAssign: op = "%"; break;
-            default: op = "+"; break;
+            case TokenType::PlusAssign: op = AST::BinaryOperator::Add; break;
+            case TokenType::MinusAssign: op = AST::BinaryOperator::Sub; break;
+            case TokenType::StarAssign: op = AST::BinaryOperator::Mul; break;
+            case TokenType::SlashAssign: op = AST::BinaryOperator::Div; break;
+            case TokenType::PercentAssign: op = AST::BinaryOperator::Mod; break;
+            default: op = AST::BinaryOperator::Add; break;
         }
         auto rhs = parseExpression();
         auto leftVar = std::make_shared<AST::VariableNode>(varName);
@@ -613,7 +638,7 @@ std::shared_ptr<AST::Node> Parser::parseIf() {
             advance();
         }
         // Use dummy condition
-        condition = std::make_shared<AST::LiteralNode>("1", false);
+        condition = std::make_shared<AST::LiteralNode>("1", Value(1));
     }
     // Then body: either a braced block or a single statement
     std::vector<std::shared_ptr<AST::Node>> thenBody;
@@ -641,7 +666,7 @@ std::shared_ptr<AST::Node> Parser::parseIf() {
                 elifCond = parseExpression();
             } catch (...) {
                 while (!check(TokenType::LeftBrace) && !check(TokenType::EndOfFile)) advance();
-                elifCond = std::make_shared<AST::LiteralNode>("1", false);
+                elifCond = std::make_shared<AST::LiteralNode>("1", Value(1));
             }
             // Body: either a braced block or a single statement
             std::vector<std::shared_ptr<AST::Node>> elifBody;
@@ -671,7 +696,7 @@ std::shared_ptr<AST::Node> Parser::parseIf() {
                     elifCond = parseExpression();
                 } catch (...) {
                     while (!check(TokenType::LeftBrace) && !check(TokenType::EndOfFile)) advance();
-                    elifCond = std::make_shared<AST::LiteralNode>("1", false);
+                    elifCond = std::make_shared<AST::LiteralNode>("1", Value(1));
                 }
                 // Body: either a braced block or a single statement
                 std::vector<std::shared_ptr<AST::Node>> elifBody;
@@ -812,20 +837,20 @@ std::shared_ptr<AST::Node> Parser::parseForeach() {
     if (!check(TokenType::Identifier)) {
         throw std::runtime_error("Expected identifier for array in foreach at line " + std::to_string(current().line));
     }
-    std::string arrayName = current().value;
+    std::string arrayName(current().value);
     advance();
     while (match(TokenType::Dot)) {
         if (!check(TokenType::Identifier)) {
             throw std::runtime_error("Expected identifier after '.' in foreach array at line " + std::to_string(current().line));
         }
-        arrayName += "." + current().value;
+        arrayName += "." + std::string(current().value);
         advance();
     }
     auto arrayExpr = std::make_shared<AST::VariableNode>(arrayName);
     
     // Expect semicolon separator (don't skip newlines before it!)
     if (!check(TokenType::Semicolon)) {
-        throw std::runtime_error("Expected ';' after array in foreach (got '" + current().value + "' type=" + std::to_string(static_cast<int>(current().type)) + ") at line " + std::to_string(current().line));
+        throw std::runtime_error("Expected ';' after array in foreach (got '" + std::string(current().value) + "' type=" + std::to_string(static_cast<int>(current().type)) + ") at line " + std::to_string(current().line));
     }
     advance(); // consume semicolon
     skipNewlines();
@@ -834,7 +859,7 @@ std::shared_ptr<AST::Node> Parser::parseForeach() {
     if (!check(TokenType::Identifier)) {
         throw std::runtime_error("Expected identifier after ';' in foreach at line " + std::to_string(current().line));
     }
-    std::string varName = current().value;
+    std::string varName(current().value);
     advance();
     skipNewlines();
     
@@ -1118,7 +1143,7 @@ std::shared_ptr<AST::Node> Parser::parseLogicalOr() {
     
     while (match(TokenType::Or)) {
         auto right = parseLogicalAnd();
-        left = std::make_shared<AST::BinaryOpNode>("||", left, right);
+        left = std::make_shared<AST::BinaryOpNode>(AST::BinaryOperator::LogicalOr, left, right);
     }
     
     return left;
@@ -1129,7 +1154,7 @@ std::shared_ptr<AST::Node> Parser::parseLogicalAnd() {
 
     while (match(TokenType::And)) {
         auto right = parseBitwiseAnd();
-        left = std::make_shared<AST::BinaryOpNode>("&&", left, right);
+        left = std::make_shared<AST::BinaryOpNode>(AST::BinaryOperator::LogicalAnd, left, right);
     }
 
     return left;
@@ -1142,7 +1167,7 @@ std::shared_ptr<AST::Node> Parser::parseBitwiseAnd() {
     // '&&' is tokenized separately by the lexer, so this never matches it.
     while (match(TokenType::Ampersand)) {
         auto right = parseEquality();
-        left = std::make_shared<AST::BinaryOpNode>("&", left, right);
+        left = std::make_shared<AST::BinaryOpNode>(AST::BinaryOperator::BitAnd, left, right);
     }
 
     return left;
@@ -1154,20 +1179,20 @@ std::shared_ptr<AST::Node> Parser::parseEquality() {
     while (true) {
         if (match(TokenType::Equal)) {
             auto right = parseComparison();
-            left = std::make_shared<AST::BinaryOpNode>("==", left, right);
+            left = std::make_shared<AST::BinaryOpNode>(AST::BinaryOperator::Eq, left, right);
         } else if (match(TokenType::NotEqual)) {
             auto right = parseComparison();
-            left = std::make_shared<AST::BinaryOpNode>("!=", left, right);
+            left = std::make_shared<AST::BinaryOpNode>(AST::BinaryOperator::Ne, left, right);
         } else if (check(TokenType::Not) && peek().type == TokenType::In) {
             // Handle !_in_ as negated _in_ operator
             advance(); // consume '!'
             advance(); // consume '_in_'
             auto right = parseComparison();
-            auto inNode = std::make_shared<AST::BinaryOpNode>("_in_", left, right);
-            left = std::make_shared<AST::UnaryOpNode>("!", inNode);
+            auto inNode = std::make_shared<AST::BinaryOpNode>(AST::BinaryOperator::In, left, right);
+            left = std::make_shared<AST::UnaryOpNode>(AST::UnaryOperator::Not, inNode);
         } else if (match(TokenType::In)) {
             auto right = parseComparison();
-            left = std::make_shared<AST::BinaryOpNode>("_in_", left, right);
+            left = std::make_shared<AST::BinaryOpNode>(AST::BinaryOperator::In, left, right);
         } else {
             break;
         }
@@ -1182,16 +1207,16 @@ std::shared_ptr<AST::Node> Parser::parseComparison() {
     while (true) {
         if (match(TokenType::Less)) {
             auto right = parseAddition();
-            left = std::make_shared<AST::BinaryOpNode>("<", left, right);
+            left = std::make_shared<AST::BinaryOpNode>(AST::BinaryOperator::Lt, left, right);
         } else if (match(TokenType::Greater)) {
             auto right = parseAddition();
-            left = std::make_shared<AST::BinaryOpNode>(">", left, right);
+            left = std::make_shared<AST::BinaryOpNode>(AST::BinaryOperator::Gt, left, right);
         } else if (match(TokenType::LessEqual)) {
             auto right = parseAddition();
-            left = std::make_shared<AST::BinaryOpNode>("<=", left, right);
+            left = std::make_shared<AST::BinaryOpNode>(AST::BinaryOperator::Le, left, right);
         } else if (match(TokenType::GreaterEqual)) {
             auto right = parseAddition();
-            left = std::make_shared<AST::BinaryOpNode>(">=", left, right);
+            left = std::make_shared<AST::BinaryOpNode>(AST::BinaryOperator::Ge, left, right);
         } else {
             break;
         }
@@ -1206,10 +1231,10 @@ std::shared_ptr<AST::Node> Parser::parseAddition() {
     while (true) {
         if (match(TokenType::Plus)) {
             auto right = parseMultiplication();
-            left = std::make_shared<AST::BinaryOpNode>("+", left, right);
+            left = std::make_shared<AST::BinaryOpNode>(AST::BinaryOperator::Add, left, right);
         } else if (match(TokenType::Minus)) {
             auto right = parseMultiplication();
-            left = std::make_shared<AST::BinaryOpNode>("-", left, right);
+            left = std::make_shared<AST::BinaryOpNode>(AST::BinaryOperator::Sub, left, right);
         } else {
             break;
         }
@@ -1224,13 +1249,13 @@ std::shared_ptr<AST::Node> Parser::parseMultiplication() {
     while (true) {
         if (match(TokenType::Star)) {
             auto right = parseUnary();
-            left = std::make_shared<AST::BinaryOpNode>("*", left, right);
+            left = std::make_shared<AST::BinaryOpNode>(AST::BinaryOperator::Mul, left, right);
         } else if (match(TokenType::Slash)) {
             auto right = parseUnary();
-            left = std::make_shared<AST::BinaryOpNode>("/", left, right);
+            left = std::make_shared<AST::BinaryOpNode>(AST::BinaryOperator::Div, left, right);
         } else if (match(TokenType::Percent)) {
             auto right = parseUnary();
-            left = std::make_shared<AST::BinaryOpNode>("%", left, right);
+            left = std::make_shared<AST::BinaryOpNode>(AST::BinaryOperator::Mod, left, right);
         } else {
             break;
         }
@@ -1242,12 +1267,12 @@ std::shared_ptr<AST::Node> Parser::parseMultiplication() {
 std::shared_ptr<AST::Node> Parser::parseUnary() {
     if (match(TokenType::Not)) {
         auto operand = parseUnary();
-        return std::make_shared<AST::UnaryOpNode>("!", operand);
+        return std::make_shared<AST::UnaryOpNode>(AST::UnaryOperator::Not, operand);
     }
     
     if (match(TokenType::Minus)) {
         auto operand = parseUnary();
-        return std::make_shared<AST::UnaryOpNode>("-", operand);
+        return std::make_shared<AST::UnaryOpNode>(AST::UnaryOperator::Negate, operand);
     }
     // Unary plus (no-op)
     if (match(TokenType::Plus)) {
@@ -1265,7 +1290,7 @@ std::shared_ptr<AST::Node> Parser::parseUnary() {
     // は将来 CallNode 引数評価で UnaryOpNode("&") を検出して実装する余地を残す。
     if (match(TokenType::Ampersand)) {
         auto operand = parseUnary();
-        return std::make_shared<AST::UnaryOpNode>("&", operand);
+        return std::make_shared<AST::UnaryOpNode>(AST::UnaryOperator::Reference, operand);
     }
 
     return parsePrimary();
@@ -1303,31 +1328,31 @@ std::shared_ptr<AST::Node> Parser::parsePrimary() {
             // Any other token likely indicates end of this pseudo-literal
             break;
         }
-        return std::make_shared<AST::LiteralNode>(accum, true);
+        return std::make_shared<AST::LiteralNode>(accum);
     }
     // String literal
     if (check(TokenType::String)) {
-        auto value = current().value;
+        std::string value(current().value);
         advance();
-        return std::make_shared<AST::LiteralNode>(value, true);
+        return std::make_shared<AST::LiteralNode>(value);
     }
     
     // Integer literal
     if (check(TokenType::Integer)) {
-        auto value = current().value;
+        std::string value(current().value);
         advance();
-        return std::make_shared<AST::LiteralNode>(value, false);
+        return std::make_shared<AST::LiteralNode>(value, numericLiteralValue(value));
     }
     
     // Identifier (variable, member, function call) with postfix support ([], etc.)
     if (check(TokenType::Identifier)) {
-        std::string name = current().value;
+        std::string name(current().value);
         advance();
 
         // Member access: identifier.member (flatten into dotted name)
         while (match(TokenType::Dot)) {
             if (check(TokenType::Identifier)) {
-                name += "." + current().value;
+                name += "." + std::string(current().value);
                 advance();
             } else {
                 throw std::runtime_error("Expected identifier after '.' at line " + std::to_string(current().line));
@@ -1496,12 +1521,13 @@ std::shared_ptr<AST::Node> Parser::parsePrimary() {
     error_msg += " in expression at line " + std::to_string(current().line);
 
     // ★ Debug: show surrounding tokens for context
-    std::cerr << "[Parser] Context: ";
-    for (int i = -2; i <= 2; i++) {
-        const Token& t = peek(i);
-        std::cerr << "'" << t.value << "' ";
+    if (yaya_log::enabled(yaya_log::Level::Debug)) {
+        std::string context;
+        for (int i = -2; i <= 2; i++) {
+            context += "'" + std::string(peek(i).value) + "' ";
+        }
+        YAYA_LOG(Debug, "[Parser] Context: " << context);
     }
-    std::cerr << std::endl;
 
     throw std::runtime_error(error_msg);
 }
@@ -0,0 +1,157 @@
+#include "Profiler.hpp"
+#include <algorithm>
+#include <atomic>
+
+namespace yaya_profile {
+
+namespace {
+
+std::atomic<unsigned long long> g_nextGeneration{1};
+
+const char* kindName(Kind kind) {
+    switch (kind) {
+        case Kind::Event: return "event";
+        case Kind::Function: return "function";
+        case Kind::Builtin: return "builtin";
+        case Kind::Interpolation: return "interpolation";
+    }
+    return "";
+}
+
+int64_t toMicros(int64_t ns) { return ns / 1000; }
+
+} // namespace
+
+Profiler::Profiler() : generation_(g_nextGeneration++) {
+    nodes_.push_back(Node{-1, -1});
+}
+
+int Profiler::key(Kind kind, const std::string& name, const std::string& source) {
+    std::string id;
+    id.reserve(name.size() + source.size() + 2);
+    id += static_cast<char>('0' + static_cast<int>(kind));
+    id += name;
+    id += '\0';
+    id += source;
+    auto it = keyIndex_.find(id);
+    if (it != keyIndex_.end()) return it->second;
+    int k = static_cast<int>(keys_.size());
+    keys_.push_back(Key{kind, name, source});
+    keyIndex_.emplace(std::move(id), k);
+    return k;
+}
+
+void Profiler::enter(int key) {
+    int parent = stack_.empty() ? 0 : stack_.back().node;
+    uint64_t edge = (static_cast<uint64_t>(parent) << 32) | static_cast<uint32_t>(key);
+    auto it = children_.find(edge);
+    int node;
+    if (it != children_.end()) {
+        node = it->second;
+    } else {
+        node = static_cast<int>(nodes_.size());
+        nodes_.push_back(Node{key, parent});
+        children_.emplace(edge, node);
+    }
+    nodes_[node].calls++;
+    Key& k = keys_[key];
+    k.calls++;
+    k.active++;
+    stack_.push_back(Frame{node, Clock::now()});
+}
+
+void Profiler::exit() {
+    if (stack_.empty()) return;
+    Frame frame = stack_.back();
+    stack_.pop_back();
+    int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - frame.start).count();
+    int64_t self = elapsed - frame.childNs;
+
+    Node& node = nodes_[frame.node];
+    node.inclusiveNs += elapsed;
+    node.exclusiveNs += self;
+    Key& k = keys_[node.key];
+    k.exclusiveNs += self;
+    if (--k.active == 0) k.inclusiveNs += elapsed;
+
+    if (!stack_.empty()) stack_.back().childNs += elapsed;
+}
+
+void Profiler::reset() {
+    keys_.clear();
+    keyIndex_.clear();
+    nodes_.assign(1, Node{-1, -1});
+    children_.clear();
+    stack_.clear();
+    // 呼び出し側にキャッシュされた key を無効にする
+    generation_ = g_nextGeneration++;
+}
+
+std::string Profiler::frameName(int key) const {
+    const Key& k = keys_[key];
+    std::string name;
+    switch (k.kind) {
+        case Kind::Event: name = "[event] " + k.name; break;
+        case Kind::Function: name = k.source.empty() ? k.name : k.name + " (" + k.source + ")"; break;
+        case Kind::Builtin: name = "[builtin] " + k.name; break;
+        case Kind::Interpolation: name = "[%()]"; break;
+    }
+    // folded 形式の区切り文字を含めない
+    std::replace(name.begin(), name.end(), ';', ':');
+    std::replace(name.begin(), name.end(), '\n', ' ');
+    return name;
+}
+
+std::string Profiler::collapsed() const {
+    std::string out;
+    std::vector<int> path;
+    for (size_t i = 1; i < nodes_.size(); ++i) {
+        int64_t us = toMicros(nodes_[i].exclusiveNs);
+        if (us <= 0) continue;
+        path.clear();
+        for (int n = static_cast<int>(i); n > 0; n = nodes_[n].parent) path.push_back(n);
+        for (auto it = path.rbegin(); it != path.rend(); ++it) {
+            if (it != path.rbegin()) out += ';';
+            out += frameName(nodes_[*it].key);
+        }
+        out += ' ';
+        out += std::to_string(us);
+        out += '\n';
+    }
+    return out;
+}
+
+nlohmann::json Profiler::summary() const {
+    std::vector<int> order(keys_.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = static_cast<int>(i);
+    std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+        return keys_[a].inclusiveNs > keys_[b].inclusiveNs;
+    });
+
+    nlohmann::json out = {
+        {"events", nlohmann::json::array()},
+        {"functions", nlohmann::json::array()},
+        {"builtins", nlohmann::json::array()},
+        {"interpolations", nlohmann::json::array()},
+    };
+    int64_t totalNs = 0;
+    for (int i : order) {
+        const Key& k = keys_[i];
+        nlohmann::json row = {
+            {"name", k.name},
+            {"calls", k.calls},
+            {"inclusive_us", toMicros(k.inclusiveNs)},
+            {"exclusive_us", toMicros(k.exclusiveNs)},
+        };
+        if (k.kind == Kind::Function) row["source"] = k.source;
+        out[std::string(kindName(k.kind)) + "s"].push_back(std::move(row));
+    }
+    // 根の直下の区間の包含時間の和 = 計測した総時間
+    for (size_t i = 1; i < nodes_.size(); ++i) {
+        if (nodes_[i].parent == 0) totalNs += nodes_[i].inclusiveNs;
+    }
+    out["total_us"] = toMicros(totalNs);
+    return out;
+}
+
+} // namespace yaya_profile
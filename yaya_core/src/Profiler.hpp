@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+// 辞書の計測プロファイラ（"profile" コマンドで開始・停止・出力する）。
+// - 区間は イベント（要求 ID）/ ユーザー関数（関数名 + 辞書ファイル）/ 組み込み関数 / %() 展開
+// - 呼び出し木のノードごとに呼び出し回数・包含時間・自己時間を積算し、
+//   folded 形式（flamegraph.pl / speedscope 用、重みは自己時間 µs）と JSON の集計を出す
+// - 停止中は VM 側のフックがポインタの null 判定 1 回だけになる
+namespace yaya_profile {
+
+enum class Kind { Event, Function, Builtin, Interpolation };
+
+class Profiler {
+public:
+    Profiler();
+
+    // プロファイラごとに異なる番号。呼び出し側がキャッシュした key の有効性の確認に使う
+    unsigned long long generation() const { return generation_; }
+
+    // 区間の種類と名前（関数は辞書ファイル名も）を番号にする
+    int key(Kind kind, const std::string& name, const std::string& source = "");
+
+    void enter(int key);
+    void exit();
+
+    // 集計を捨てる（区間の途中では呼ばない）
+    void reset();
+
+    // folded 形式: "frame;frame;frame <自己時間 µs>" を 1 行ずつ
+    std::string collapsed() const;
+    // 種類ごとの集計（包含時間の降順）
+    nlohmann::json summary() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Key {
+        Kind kind;
+        std::string name;
+        std::string source;
+        uint64_t calls = 0;
+        int64_t inclusiveNs = 0;  // 再帰の内側の呼び出しは重ねて数えない
+        int64_t exclusiveNs = 0;
+        int active = 0;           // スタック上にある数
+    };
+    struct Node {
+        int key;
+        int parent;
+        uint64_t calls = 0;
+        int64_t inclusiveNs = 0;
+        int64_t exclusiveNs = 0;
+    };
+    struct Frame {
+        int node;
+        Clock::time_point start;
+        int64_t childNs = 0;
+    };
+
+    unsigned long long generation_;
+    std::vector<Key> keys_;
+    std::unordered_map<std::string, int> keyIndex_;
+    std::vector<Node> nodes_;                        // 0 は根（区間ではない）
+    std::unordered_map<uint64_t, int> children_;     // (親ノード, key) -> ノード
+    std::vector<Frame> stack_;
+
+    std::string frameName(int key) const;
+};
+
+// 区間の RAII。profiler が null なら何もしない
+class Scope {
+public:
+    Scope(Profiler* profiler, int key) : profiler_(profiler) {
+        if (profiler_) profiler_->enter(key);
+    }
+    ~Scope() {
+        if (profiler_) profiler_->exit();
+    }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    Profiler* profiler_;
+};
+
+} // namespace yaya_profile
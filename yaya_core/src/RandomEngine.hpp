@@ -5,12 +5,32 @@
 // RAND/ANY ビルトイン、および Value::asString() の array→文字列（雑談配列のランダム選択）が
 // 共有する乱数エンジン。SRAND(seed) はこのエンジンを再シードすることで、YAYA スクリプトから
 // 見える全てのランダム選択（配列アクセスも含む）を決定的に再現可能にする。
-// プロセスにつき VM は 1 インスタンスのみのため、関数ローカル static で単一エンジンとして共有する。
+// 1 プロセスで複数のゴースト（YayaCore インスタンス）を扱う場合に乱数列が混ざらないよう、
+// 実行中のインスタンスが Scope で自分のエンジンを現在のスレッドに設定する。
+// Scope が無い場合はプロセス共有の既定エンジンを使う。
 namespace yaya_rng {
 
+inline std::mt19937*& current() {
+    thread_local std::mt19937* engine = nullptr;
+    return engine;
+}
+
 inline std::mt19937& engine() {
+    if (std::mt19937* active = current()) return *active;
     static std::mt19937 gen(std::random_device{}());
     return gen;
 }
 
+// 生存期間中、現在のスレッドの乱数エンジンを差し替える
+class Scope {
+public:
+    explicit Scope(std::mt19937& engine) : previous_(current()) { current() = &engine; }
+    ~Scope() { current() = previous_; }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    std::mt19937* previous_;
+};
+
 } // namespace yaya_rng
@@ -0,0 +1,242 @@
+#include "RegexEngine.hpp"
+#include <cctype>
+#include <cstring>
+#include <regex>
+
+namespace yaya_regex {
+
+namespace {
+
+// ---- std::regex バックエンド ----------------------------------------------
+
+void storeGroups(const std::smatch& m, std::vector<Group>& groups) {
+    for (size_t i = 0; i < m.size(); ++i) {
+        Group g;
+        g.str = m[i].str();
+        if (m[i].matched) {
+            g.position = static_cast<int>(m.position(i));
+            g.length = static_cast<int>(m.length(i));
+        }
+        groups.push_back(std::move(g));
+    }
+}
+
+class StdRegexProgram : public Program {
+public:
+    StdRegexProgram(const std::string& pattern, int options) {
+        auto flags = std::regex::ECMAScript;
+        if (options & IgnoreCase) flags |= std::regex::icase;
+        if (options & Multiline) flags |= std::regex::multiline;
+        re_ = std::regex(pattern, flags);
+    }
+
+    bool search(const std::string& s, std::vector<Group>* groups) const override {
+        if (!groups) return std::regex_search(s, re_);
+        std::smatch m;
+        if (!std::regex_search(s, m, re_)) return false;
+        storeGroups(m, *groups);
+        return true;
+    }
+
+    bool match(const std::string& s, std::vector<Group>* groups) const override {
+        if (!groups) return std::regex_match(s, re_);
+        std::smatch m;
+        if (!std::regex_match(s, m, re_)) return false;
+        storeGroups(m, *groups);
+        return true;
+    }
+
+    void searchAll(const std::string& s, std::vector<Group>& matches) const override {
+        for (std::sregex_iterator it(s.begin(), s.end(), re_), end; it != end; ++it) {
+            Group g;
+            g.str = it->str();
+            g.position = static_cast<int>(it->position());
+            g.length = static_cast<int>(it->length());
+            matches.push_back(std::move(g));
+        }
+    }
+
+    std::string replace(const std::string& s, const std::string& format) const override {
+        return std::regex_replace(s, re_, format);
+    }
+
+    std::vector<std::string> split(const std::string& s) const override {
+        std::vector<std::string> out;
+        std::sregex_token_iterator it(s.begin(), s.end(), re_, -1), end;
+        for (; it != end; ++it) out.push_back(it->str());
+        return out;
+    }
+
+private:
+    std::regex re_;
+};
+
+// ---- 部分文字列バックエンド ------------------------------------------------
+// ECMAScript のメタ文字を含まない空でないパターンはリテラル一致と同じなので、
+// std::string::find（大小無視は ASCII の折り畳み。std::regex の icase も "C" ロケールでは
+// ASCII のみ）で照合する。
+
+bool isLiteralPattern(const std::string& pattern) {
+    if (pattern.empty()) return false;
+    return pattern.find_first_of("^$\\.*+?()[]{}|") == std::string::npos;
+}
+
+inline char foldAscii(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+class LiteralProgram : public Program {
+public:
+    LiteralProgram(const std::string& pattern, int options)
+        : literal_(pattern), icase_((options & IgnoreCase) != 0) {
+        if (icase_) {
+            for (auto& c : literal_) c = foldAscii(c);
+        }
+    }
+
+    bool search(const std::string& s, std::vector<Group>* groups) const override {
+        size_t pos = find(s, 0);
+        if (pos == std::string::npos) return false;
+        if (groups) groups->push_back(group(s, pos));
+        return true;
+    }
+
+    bool match(const std::string& s, std::vector<Group>* groups) const override {
+        if (s.size() != literal_.size() || !equalAt(s, 0)) return false;
+        if (groups) groups->push_back(group(s, 0));
+        return true;
+    }
+
+    void searchAll(const std::string& s, std::vector<Group>& matches) const override {
+        for (size_t pos = find(s, 0); pos != std::string::npos; pos = find(s, pos + literal_.size())) {
+            matches.push_back(group(s, pos));
+        }
+    }
+
+    std::string replace(const std::string& s, const std::string& format) const override {
+        std::string out;
+        size_t last = 0;  // 直前のマッチの終端（$` の開始）
+        for (size_t pos = find(s, 0); pos != std::string::npos; pos = find(s, last)) {
+            out.append(s, last, pos - last);
+            appendFormat(out, s, last, pos, format);
+            last = pos + literal_.size();
+        }
+        out.append(s, last, std::string::npos);
+        return out;
+    }
+
+    std::vector<std::string> split(const std::string& s) const override {
+        std::vector<std::string> out;
+        size_t last = 0;
+        for (size_t pos = find(s, 0); pos != std::string::npos; pos = find(s, last)) {
+            out.push_back(s.substr(last, pos - last));
+            last = pos + literal_.size();
+        }
+        // マッチが無ければ文字列全体（空でも 1 要素）、あれば末尾の残りは空でないときだけ
+        if (out.empty() || last < s.size()) out.push_back(s.substr(last));
+        return out;
+    }
+
+private:
+    std::string literal_;  // icase の場合は折り畳み済み
+    bool icase_;
+
+    bool equalAt(const std::string& s, size_t pos) const {
+        if (!icase_) return s.compare(pos, literal_.size(), literal_) == 0;
+        for (size_t i = 0; i < literal_.size(); ++i) {
+            if (foldAscii(s[pos + i]) != literal_[i]) return false;
+        }
+        return true;
+    }
+
+    size_t find(const std::string& s, size_t from) const {
+        if (!icase_) return s.find(literal_, from);
+        if (s.size() < literal_.size()) return std::string::npos;
+        for (size_t pos = from; pos + literal_.size() <= s.size(); ++pos) {
+            if (equalAt(s, pos)) return pos;
+        }
+        return std::string::npos;
+    }
+
+    Group group(const std::string& s, size_t pos) const {
+        Group g;
+        g.str = s.substr(pos, literal_.size());
+        g.position = static_cast<int>(pos);
+        g.length = static_cast<int>(literal_.size());
+        return g;
+    }
+
+    // std::match_results::format（ECMAScript 書式）と同じ展開。グループは 0 のみ。
+    void appendFormat(std::string& out, const std::string& s, size_t prefixStart, size_t pos,
+                      const std::string& format) const {
+        size_t end = pos + literal_.size();
+        size_t i = 0;
+        while (i < format.size()) {
+            size_t dollar = format.find('$', i);
+            if (dollar == std::string::npos) break;
+            out.append(format, i, dollar - i);
+            size_t next = dollar + 1;
+            if (next == format.size()) {
+                out += '$';
+            } else if (format[next] == '$') {
+                out += '$';
+                ++next;
+            } else if (format[next] == '&') {
+                out.append(s, pos, literal_.size());
+                ++next;
+            } else if (format[next] == '`') {
+                out.append(s, prefixStart, pos - prefixStart);
+                ++next;
+            } else if (format[next] == '\'') {
+                out.append(s, end, std::string::npos);
+                ++next;
+            } else if (std::isdigit(static_cast<unsigned char>(format[next]))) {
+                long num = format[next++] - '0';
+                if (next < format.size() && std::isdigit(static_cast<unsigned char>(format[next]))) {
+                    num = num * 10 + (format[next++] - '0');
+                }
+                if (num == 0) out.append(s, pos, literal_.size());
+            } else {
+                out += '$';
+            }
+            i = next;
+        }
+        if (i < format.size()) out.append(format, i, std::string::npos);
+    }
+};
+
+} // namespace
+
+std::shared_ptr<const Program> compile(const std::string& pattern, int options) {
+    options &= (IgnoreCase | Multiline);
+    if (isLiteralPattern(pattern)) {
+        return std::make_shared<LiteralProgram>(pattern, options);
+    }
+    return std::make_shared<StdRegexProgram>(pattern, options);
+}
+
+std::shared_ptr<const Program> Cache::get(const std::string& pattern, int options) {
+    options &= (IgnoreCase | Multiline);
+    std::string key;
+    key.reserve(pattern.size() + 2);
+    key += static_cast<char>('0' + options);
+    key += ':';
+    key += pattern;
+
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return it->second->second;
+    }
+
+    auto program = compile(pattern, options);
+    lru_.emplace_front(key, program);
+    index_[key] = lru_.begin();
+    if (lru_.size() > capacity_) {
+        index_.erase(lru_.back().first);
+        lru_.pop_back();
+    }
+    return program;
+}
+
+} // namespace yaya_regex
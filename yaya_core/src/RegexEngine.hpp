@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// RE_* ビルトインの正規表現。パターンごとに照合エンジン（バックエンド）を選んでコンパイルし、
+// (パターン, RE_OPTION) の組で LRU キャッシュする。
+// - メタ文字を含まないパターン: 部分文字列検索（線形時間。std::regex を生成しない）
+// - それ以外: std::regex（ECMAScript）
+// どのバックエンドも std::regex と同じ結果（マッチ位置、グループ、$ 置換書式、分割）を返す。
+namespace yaya_regex {
+
+enum Option {
+    IgnoreCase = 1,  // RE_OPTION bit0
+    Multiline = 2    // RE_OPTION bit1
+};
+
+// マッチしたグループ（index 0 = マッチ全体）。参加しなかったグループは position/length = -1
+struct Group {
+    std::string str;
+    int position = -1;
+    int length = -1;
+};
+
+class Program {
+public:
+    virtual ~Program() = default;
+
+    // regex_search 相当。groups が null なら有無の判定だけ
+    virtual bool search(const std::string& s, std::vector<Group>* groups) const = 0;
+    // regex_match 相当（全体一致）
+    virtual bool match(const std::string& s, std::vector<Group>* groups) const = 0;
+    // sregex_iterator 相当: 重ならない全マッチのグループ 0 を順に追加する
+    virtual void searchAll(const std::string& s, std::vector<Group>& matches) const = 0;
+    // regex_replace 相当（ECMAScript の $&, $n, $`, $', $$ 書式）
+    virtual std::string replace(const std::string& s, const std::string& format) const = 0;
+    // sregex_token_iterator(..., -1) 相当
+    virtual std::vector<std::string> split(const std::string& s) const = 0;
+};
+
+// パターンをコンパイルする。不正なパターンは std::regex_error を投げる。
+std::shared_ptr<const Program> compile(const std::string& pattern, int options);
+
+// コンパイル済みパターンの LRU キャッシュ（VM ごと）
+class Cache {
+public:
+    explicit Cache(size_t capacity = 64) : capacity_(capacity) {}
+
+    // キャッシュに無ければコンパイルして登録する。不正なパターンは std::regex_error。
+    std::shared_ptr<const Program> get(const std::string& pattern, int options);
+
+private:
+    using Entry = std::pair<std::string, std::shared_ptr<const Program>>;
+    size_t capacity_;
+    std::list<Entry> lru_;  // 先頭が直近に使ったもの
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+};
+
+} // namespace yaya_regex
@@ -0,0 +1,236 @@
+#include "SaoriHost.hpp"
+#include "Log.hpp"
+#include "Transcode.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <dlfcn.h>
+
+namespace {
+
+using LoadFn = bool (*)(char*, long);
+using UnloadFn = bool (*)();
+using RequestFn = char* (*)(char*, long*);
+
+const char kVersionRequest[] = "GET Version SAORI/1.0\r\nCharset: UTF-8\r\nSender: Ourin\r\n\r\n";
+
+// CHARSETLIB の表記ゆれを吸収する（UTF-8 は空文字列 = 変換しない）
+std::string iconvName(const std::string& charset) {
+    std::string key;
+    for (unsigned char c : charset) {
+        if (c != '-' && c != '_' && c != ' ') key.push_back(static_cast<char>(std::tolower(c)));
+    }
+    if (key.empty() || key == "utf8") return std::string();
+    if (key == "shiftjis" || key == "sjis" || key == "cp932" || key == "windows31j" || key == "ms932") return "CP932";
+    return charset;
+}
+
+// Windows の名前（saori\foo.dll）を macOS / Linux のモジュール名の候補にする
+std::vector<std::string> moduleVariants(const std::string& fileName) {
+    std::string stem = fileName;
+    size_t dot = stem.rfind('.');
+    if (dot != std::string::npos) stem.erase(dot);
+    std::vector<std::string> variants = {fileName, stem + ".dylib", "lib" + stem + ".dylib", stem + ".so", "lib" + stem + ".so"};
+    variants.erase(std::unique(variants.begin(), variants.end()), variants.end());
+    return variants;
+}
+
+} // namespace
+
+struct SaoriHost::Module {
+    std::string path;
+    void* handle = nullptr;
+    LoadFn loadFn = nullptr;
+    UnloadFn unloadFn = nullptr;
+    RequestFn requestFn = nullptr;
+    int refs = 0;
+    std::mutex mutex;  // モジュールは再入できるとは限らない
+
+    // 生の要求を渡して応答を受け取る（応答が無ければ空）
+    std::string call(const std::string& request) {
+        std::lock_guard<std::mutex> lock(mutex);
+        long length = static_cast<long>(request.size());
+        char* input = static_cast<char*>(std::malloc(request.size() + 1));
+        if (input == nullptr) return std::string();
+        std::memcpy(input, request.c_str(), request.size() + 1);
+        char* output = requestFn(input, &length);
+        if (output == nullptr) return std::string();
+        std::string response(output, length > 0 ? static_cast<size_t>(length) : 0);
+        std::free(output);
+        return response;
+    }
+};
+
+namespace {
+
+std::mutex registryMutex;
+std::unordered_map<std::string, std::unique_ptr<SaoriHost::Module>>& registry() {
+    static std::unordered_map<std::string, std::unique_ptr<SaoriHost::Module>> modules;
+    return modules;
+}
+
+} // namespace
+
+SaoriHost::Module* SaoriHost::acquire(const std::string& path) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    auto& modules = registry();
+    auto it = modules.find(path);
+    if (it != modules.end()) {
+        it->second->refs++;
+        return it->second.get();
+    }
+
+    void* handle = ::dlopen(path.c_str(), RTLD_LAZY);
+    if (handle == nullptr) {
+        const char* error = ::dlerror();
+        YAYA_LOG(Warn, "[SaoriHost] dlopen failed: " << path << ": " << (error ? error : "unknown"));
+        return nullptr;
+    }
+    auto module = std::make_unique<Module>();
+    module->path = path;
+    module->handle = handle;
+    module->loadFn = reinterpret_cast<LoadFn>(::dlsym(handle, "load"));
+    module->unloadFn = reinterpret_cast<UnloadFn>(::dlsym(handle, "unload"));
+    module->requestFn = reinterpret_cast<RequestFn>(::dlsym(handle, "request"));
+    if (module->requestFn == nullptr) {
+        YAYA_LOG(Warn, "[SaoriHost] request is not exported: " << path);
+        ::dlclose(handle);
+        return nullptr;
+    }
+    if (module->loadFn != nullptr) {
+        std::string directory = std::filesystem::path(path).parent_path().string() + "/";
+        char* input = static_cast<char*>(std::malloc(directory.size() + 1));
+        if (input == nullptr) {
+            ::dlclose(handle);
+            return nullptr;
+        }
+        std::memcpy(input, directory.c_str(), directory.size() + 1);
+        if (!module->loadFn(input, static_cast<long>(directory.size()))) {
+            YAYA_LOG(Warn, "[SaoriHost] load() failed: " << path);
+            ::dlclose(handle);
+            return nullptr;
+        }
+    }
+    // ホスト側の SaoriManager と同じく、GET Version に 200 / 204 で答えるものだけを使う
+    std::string version = module->call(kVersionRequest);
+    if (version.rfind("SAORI/1.0 200", 0) != 0 && version.rfind("SAORI/1.0 204", 0) != 0) {
+        YAYA_LOG(Warn, "[SaoriHost] GET Version failed: " << path);
+        if (module->unloadFn != nullptr) module->unloadFn();
+        ::dlclose(handle);
+        return nullptr;
+    }
+    YAYA_LOG(Info, "[SaoriHost] Loaded in-process: " << path);
+    module->refs = 1;
+    Module* raw = module.get();
+    modules.emplace(path, std::move(module));
+    return raw;
+}
+
+void SaoriHost::release(Module* module) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    if (--module->refs > 0) return;
+    if (module->unloadFn != nullptr) module->unloadFn();
+    ::dlclose(module->handle);
+    registry().erase(module->path);
+}
+
+SaoriHost::~SaoriHost() {
+    unloadAll();
+}
+
+void SaoriHost::configure(const std::string& ghostRoot, const std::vector<std::string>& searchPaths) {
+    unloadAll();
+    ghostRoot_ = ghostRoot;
+    searchPaths_ = searchPaths;
+    resolved_.clear();
+}
+
+void SaoriHost::unloadAll() {
+    for (auto& kv : loaded_) release(kv.second);
+    loaded_.clear();
+}
+
+const std::string& SaoriHost::resolve(const std::string& module) {
+    auto it = resolved_.find(module);
+    if (it != resolved_.end()) return it->second;
+
+    namespace fs = std::filesystem;
+    std::string name = module;
+    std::replace(name.begin(), name.end(), '\\', '/');
+    fs::path written(name);
+    std::vector<fs::path> directories;
+    directories.push_back(written.is_absolute() ? written.parent_path() : fs::path(ghostRoot_) / written.parent_path());
+    for (const auto& dir : searchPaths_) directories.push_back(dir);
+
+    std::string found;
+    std::error_code ec;
+    for (const auto& dir : directories) {
+        for (const auto& variant : moduleVariants(written.filename().string())) {
+            fs::path candidate = (dir / variant).lexically_normal();
+            if (fs::is_regular_file(candidate, ec)) {
+                found = candidate.string();
+                break;
+            }
+        }
+        if (!found.empty()) break;
+    }
+    return resolved_.emplace(module, std::move(found)).first->second;
+}
+
+SaoriHost::Module* SaoriHost::find(const std::string& module, bool loadIfMissing) {
+    const std::string& path = resolve(module);
+    if (path.empty()) return nullptr;
+    auto it = loaded_.find(path);
+    if (it != loaded_.end()) return it->second;
+    if (!loadIfMissing) return nullptr;
+    Module* loaded = acquire(path);
+    if (loaded == nullptr) {
+        // 開けなかったものは以後ホスト経由にする（呼び出しのたびに dlopen し直さない）
+        resolved_[module].clear();
+        return nullptr;
+    }
+    loaded_.emplace(path, loaded);
+    return loaded;
+}
+
+bool SaoriHost::load(const std::string& module) {
+    return find(module, true) != nullptr;
+}
+
+bool SaoriHost::unload(const std::string& module) {
+    Module* loaded = find(module, false);
+    if (loaded == nullptr) return false;
+    loaded_.erase(loaded->path);
+    release(loaded);
+    return true;
+}
+
+bool SaoriHost::request(const std::string& module, const std::string& request, const std::string& charset,
+                        std::string& response) {
+    Module* loaded = find(module, true);
+    if (loaded == nullptr) return false;
+    std::string encoded;
+    if (!convert(charset, true, request, encoded)) return false;
+    std::string raw = loaded->call(encoded);
+    // 宣言と違う文字コードで返すモジュールもあるので、戻せなければそのまま渡す（ホスト側と同じ）
+    if (!convert(charset, false, raw, response)) response = std::move(raw);
+    return true;
+}
+
+bool SaoriHost::convert(const std::string& charset, bool toModule, const std::string& input, std::string& output) {
+    const std::string name = iconvName(charset);
+    if (name.empty()) {
+        output = input;
+        return true;
+    }
+    const char* to = toModule ? name.c_str() : "UTF-8";
+    const char* from = toModule ? "UTF-8" : name.c_str();
+    if (!transcode::iconvSupported(to, from)) {
+        YAYA_LOG(Warn, "[SaoriHost] Unsupported charset: " << charset);
+        return false;
+    }
+    return transcode::convert(to, from, input, output);
+}
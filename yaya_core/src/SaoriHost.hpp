@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// SAORI-universal モジュールを yaya_core のプロセス内で dlopen して呼ぶ（"load" の "saori_in_process"）。
+// ABI は satori_core の SakuraDLLClient と同じ POSIX 版:
+//   bool  load(char* dir, long len)        dir は malloc した領域（モジュール側で free）
+//   bool  unload()
+//   char* request(char* req, long* len)    req は malloc した領域（モジュール側で free）、
+//                                          戻り値は malloc した応答（呼び出し側で free）
+// 見つからない・開けない・GET Version に答えないモジュールは false を返し、
+// 呼び出し側（YayaCore）は従来どおりホスト経由の host_op "plugin" に戻る。
+//
+// 読み込んだモジュールはプロセス全体で共有する（パスごとに 1 つ。参照数が 0 になったら
+// unload して dlclose）。--workers で複数のゴーストが同じモジュールを使うときは、
+// モジュールごとのロックで呼び出しを 1 つずつにする。
+class SaoriHost {
+public:
+    SaoriHost() = default;
+    ~SaoriHost();
+    SaoriHost(const SaoriHost&) = delete;
+    SaoriHost& operator=(const SaoriHost&) = delete;
+
+    // モジュール名の解決に使う場所を設定し、読み込み済みのものはすべて解放する。
+    // 相対名はまず ghostRoot から、見つからなければ searchPaths の下をファイル名だけで探す。
+    void configure(const std::string& ghostRoot, const std::vector<std::string>& searchPaths);
+    void unloadAll();
+
+    bool load(const std::string& module);
+    // このインスタンスが読み込んでいなければ false
+    bool unload(const std::string& module);
+    // 読み込んでいなければ先に読み込む。request / response は UTF-8 で、
+    // charset が UTF-8 以外ならモジュールとの間で変換する
+    bool request(const std::string& module, const std::string& request, const std::string& charset,
+                 std::string& response);
+
+    // プロセス全体で共有する読み込み済みモジュール（SaoriHost.cpp）
+    struct Module;
+
+private:
+    std::string ghostRoot_;
+    std::vector<std::string> searchPaths_;
+    // 書かれたモジュール名 → 解決したパス（見つからなかった名前は空文字列）
+    std::unordered_map<std::string, std::string> resolved_;
+    // このインスタンスが参照しているモジュール（キーは解決したパス）
+    std::unordered_map<std::string, Module*> loaded_;
+
+    // プロセス全体の表から参照を取る（初めてなら dlopen して load と GET Version）／返す
+    static Module* acquire(const std::string& path);
+    static void release(Module* module);
+
+    const std::string& resolve(const std::string& module);
+    Module* find(const std::string& module, bool loadIfMissing);
+    // UTF-8 ならそのまま（変換は Transcode.hpp。CP932 は表引き）。変換できなければ false
+    bool convert(const std::string& charset, bool toModule, const std::string& input, std::string& output);
+};
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <nlohmann/json.hpp>
+
+// yaya_core / satori_core とホストの間の長さ付きバイナリフレーム（JSON Lines の代替）。
+// ハンドシェイク {"cmd":"handshake","framing":"binary"} への JSON 応答を返した後、
+// 両方向とも次の形式のフレームに切り替わる（host_op とその応答も同じ）。
+//
+//   frame   := u32le payloadLength, payload
+//   payload := u8 version(=1), varint fieldCount, field*
+//   field   := str key, u8 tag, value
+//   str     := varint byteLength, bytes（UTF-8 のまま。エスケープしない）
+//
+//   tag 's' str / 'i' zigzag varint / 'b' u8 / 'n' (値なし)
+//       'a' varint count, str*            （文字列だけの配列: ref 等）
+//       'm' varint count, (str, str)*     （文字列だけのオブジェクト: headers 等）
+//       'j' str                           （それ以外の値の JSON テキスト）
+//
+// トップレベルのオブジェクトをそのまま写すため、コマンドの意味は JSON Lines と同一。
+namespace shiori_frame {
+
+enum class Framing { JsonLines, Binary };
+
+constexpr uint8_t kVersion = 1;
+constexpr uint32_t kMaxPayload = 64u * 1024u * 1024u;
+
+// "json" / "binary" を解釈する（それ以外は false）
+inline bool parseFraming(const std::string& name, Framing& framing) {
+    if (name == "json") { framing = Framing::JsonLines; return true; }
+    if (name == "binary") { framing = Framing::Binary; return true; }
+    return false;
+}
+
+namespace detail {
+
+inline void putVarint(std::string& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+inline void putString(std::string& out, const std::string& s) {
+    putVarint(out, s.size());
+    out.append(s);
+}
+
+class Reader {
+public:
+    explicit Reader(const std::string& data) : data_(data) {}
+
+    uint8_t byte() {
+        if (pos_ >= data_.size()) throw std::runtime_error("truncated frame");
+        return static_cast<uint8_t>(data_[pos_++]);
+    }
+    uint64_t varint() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t b = byte();
+            v |= static_cast<uint64_t>(b & 0x7F) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        throw std::runtime_error("malformed varint in frame");
+    }
+    std::string string() {
+        uint64_t n = varint();
+        if (n > data_.size() - pos_) throw std::runtime_error("truncated frame");
+        std::string s = data_.substr(pos_, static_cast<size_t>(n));
+        pos_ += static_cast<size_t>(n);
+        return s;
+    }
+    bool done() const { return pos_ == data_.size(); }
+
+private:
+    const std::string& data_;
+    size_t pos_ = 0;
+};
+
+inline bool allStrings(const nlohmann::json& v) {
+    for (const auto& e : v) {
+        if (!e.is_string()) return false;
+    }
+    return true;
+}
+
+} // namespace detail
+
+// トップレベルのオブジェクトを payload へ符号化する
+inline std::string encode(const nlohmann::json& object) {
+    std::string out;
+    out.push_back(static_cast<char>(kVersion));
+    detail::putVarint(out, object.size());
+    for (const auto& [key, value] : object.items()) {
+        detail::putString(out, key);
+        if (value.is_string()) {
+            out.push_back('s');
+            detail::putString(out, value.get_ref<const std::string&>());
+        } else if (value.is_number_integer()) {
+            int64_t n = value.get<int64_t>();
+            out.push_back('i');
+            detail::putVarint(out, (static_cast<uint64_t>(n) << 1) ^ static_cast<uint64_t>(n >> 63));
+        } else if (value.is_boolean()) {
+            out.push_back('b');
+            out.push_back(value.get<bool>() ? 1 : 0);
+        } else if (value.is_null()) {
+            out.push_back('n');
+        } else if (value.is_array() && detail::allStrings(value)) {
+            out.push_back('a');
+            detail::putVarint(out, value.size());
+            for (const auto& e : value) detail::putString(out, e.get_ref<const std::string&>());
+        } else if (value.is_object() && detail::allStrings(value)) {
+            out.push_back('m');
+            detail::putVarint(out, value.size());
+            for (const auto& [k, v] : value.items()) {
+                detail::putString(out, k);
+                detail::putString(out, v.get_ref<const std::string&>());
+            }
+        } else {
+            out.push_back('j');
+            detail::putString(out, value.dump());
+        }
+    }
+    return out;
+}
+
+// payload をオブジェクトへ復号する。壊れたフレームは std::runtime_error。
+inline nlohmann::json decode(const std::string& payload) {
+    detail::Reader in(payload);
+    if (in.byte() != kVersion) throw std::runtime_error("unsupported frame version");
+    nlohmann::json object = nlohmann::json::object();
+    uint64_t fields = in.varint();
+    for (uint64_t i = 0; i < fields; ++i) {
+        std::string key = in.string();
+        uint8_t tag = in.byte();
+        nlohmann::json& value = object[key];
+        switch (tag) {
+            case 's': value = in.string(); break;
+            case 'i': {
+                uint64_t z = in.varint();
+                value = static_cast<int64_t>((z >> 1) ^ (~(z & 1) + 1));
+                break;
+            }
+            case 'b': value = in.byte() != 0; break;
+            case 'n': value = nullptr; break;
+            case 'a': {
+                value = nlohmann::json::array();
+                uint64_t n = in.varint();
+                for (uint64_t k = 0; k < n; ++k) value.push_back(in.string());
+                break;
+            }
+            case 'm': {
+                value = nlohmann::json::object();
+                uint64_t n = in.varint();
+                for (uint64_t k = 0; k < n; ++k) {
+                    std::string name = in.string();
+                    value[name] = in.string();
+                }
+                break;
+            }
+            case 'j': value = nlohmann::json::parse(in.string()); break;
+            default: throw std::runtime_error("unknown field tag in frame");
+        }
+    }
+    if (!in.done()) throw std::runtime_error("trailing bytes in frame");
+    return object;
+}
+
+// 1 フレーム読む。EOF（フレーム境界での終端）なら false、途中で切れたフレームは std::runtime_error。
+// 上限を超えるフレームも std::runtime_error だが、本体は読み飛ばすので次のフレームから続けられる。
+inline bool readFrame(std::istream& in, std::string& payload) {
+    unsigned char header[4];
+    if (!in.read(reinterpret_cast<char*>(header), 1)) return false;
+    if (!in.read(reinterpret_cast<char*>(header) + 1, 3)) throw std::runtime_error("truncated frame header");
+    uint32_t length = static_cast<uint32_t>(header[0]) | (static_cast<uint32_t>(header[1]) << 8) |
+                      (static_cast<uint32_t>(header[2]) << 16) | (static_cast<uint32_t>(header[3]) << 24);
+    if (length > kMaxPayload) {
+        // 本体を読み飛ばしてから報告する。読み飛ばさないと本体の途中を次のヘッダとして読んでしまう。
+        // istream::ignore は最後の 1 バイトの次を覗くため、パイプでは次のフレームが来るまで戻らない
+        char chunk[4096];
+        for (uint32_t left = length; left > 0;) {
+            uint32_t n = left < sizeof(chunk) ? left : static_cast<uint32_t>(sizeof(chunk));
+            if (!in.read(chunk, n)) throw std::runtime_error("truncated frame");
+            left -= n;
+        }
+        throw std::runtime_error("frame too large");
+    }
+    payload.resize(length);
+    if (length > 0 && !in.read(&payload[0], length)) throw std::runtime_error("truncated frame");
+    return true;
+}
+
+inline void writeFrame(std::ostream& out, const std::string& payload) {
+    uint32_t length = static_cast<uint32_t>(payload.size());
+    char header[4] = {
+        static_cast<char>(length & 0xFF), static_cast<char>((length >> 8) & 0xFF),
+        static_cast<char>((length >> 16) & 0xFF), static_cast<char>((length >> 24) & 0xFF)
+    };
+    out.write(header, 4);
+    out.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+    out.flush();
+}
+
+} // namespace shiori_frame
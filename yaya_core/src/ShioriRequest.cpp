@@ -0,0 +1,364 @@
+// SHIORI3FW の request の代行（VM::executeShioriRequest）。
+// yaya_shiori3.dic の request は、yaya_core が組み立てた要求文字列を STRSTR / SUBSTR で 1 行ずつ
+// 切り出して変数に入れ直しており、要求のたびにこの解析が構文木の実行として走る。
+// ここではヘッダの並びを受け取り、辞書と同じ変数を同じ順序で設定し、辞書と同じ関数を呼ぶ。
+// 辞書側の関数（TranslateEvent / IsImportantEvent / MakeEmptyResponse / TOAUTOEX / OnRequest）は
+// VM で実行するので、ゴーストがそれらを上書きしていてもそのまま使われる。
+#include "VM.hpp"
+#include "DicCache.hpp"
+#include "Lexer.hpp"
+#include "Log.hpp"
+#include "Parser.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// 標準の request（Emily/4 同梱の yaya_shiori3.dic のもの）。読み込んだ辞書の request とは
+// 構文木（DicCache::fingerprint）で比べるので、コメントや空白・改行コードは結果に関係しない。
+// 構文木は DicCache の形式や定数畳み込みの規則で変わるので、比べる値は実行時にここから求める。
+constexpr const char* kStockRequestSource = R"dic(request
+{
+	//For TEST
+	//test(_argv[0])
+	//return
+	
+	if SUBSTR(_argv[0],0,3) == '?? ' { //玉でのテスト用
+		'!! ' + JOIN(AyaTest.Eval(ERASE(_argv[0],0,3)),',')
+		return
+	}
+	
+	_reqdata = _argv[0]
+	_linestart = 0
+	_lineend = STRSTR(_reqdata, C_CRLF, _linestart)
+	
+	if _lineend <= 0 {
+		//1行目すらない！
+		"SHIORI/3.0 400 Bad Request%(C_CRLF)Charset: %(S_CHARSET)%(C_CRLF2)"
+		return
+	}
+	_lin = SUBSTR(_reqdata,_linestart,(_lineend - _linestart))
+
+	// リクエスト種別とプロトコル名の取得　エラーなら400
+	REQ.COMMAND  = _lin[0," SHIORI"]
+	REQ.PROTOCOL = "SHIORI" + _lin[1," SHIORI"]
+
+	// リクエストヘッダの取得
+	var.req.key   = IARRAY
+	var.req.value = IARRAY
+	var.req.rawvalue = IARRAY
+	
+	_linenum = 0
+	_idparsed = 0
+	
+	status = ''
+	SHIORI3FW.Eventid=''
+	SHIORI3FW.SecurityLevel='Internal' //互換性のためデフォルトはInternal
+	
+	while _lineend > _linestart {
+		//行分割
+		_linestart = _lineend + 2
+		_lineend = STRSTR(_reqdata, C_CRLF, _linestart)
+		
+		//空行もしくはみつからなかった
+		if _lineend <= _linestart {
+			break
+		}
+		
+		_linenum += 1
+		if SHIORI3FW.REQUEST_LINES_LIMIT {
+			if _linenum > SHIORI3FW.REQUEST_LINES_LIMIT {
+				if _idparsed {
+					break
+				}
+			}
+		}
+		
+		_lin = SUBSTR(_reqdata,_linestart,(_lineend - _linestart))
+				
+		// キーと値を取得
+		_len = STRLEN(_lin)
+		_pos = STRSTR(_lin,": ",0)
+		var.req.key ,= (_key = SUBSTR(_lin,0,_pos))
+		_value       = SUBSTR(_lin,(_pos + 2),(_len - _pos - 2))
+		
+		if var.req.key == '' {
+			break
+		}
+
+		// イベントID名称を取得
+		if _key == "Charset" {
+			if S_CHARSET != _value {
+				void SETSETTING('charset.output',_value)
+				S_CHARSET = _value
+			}
+		}
+		elseif _key == "ID" {
+			// 取得　名前先頭が"On"でないなら付加
+			SHIORI3FW.Eventid = _value
+			if SUBSTR(SHIORI3FW.Eventid, 0, 2) != "On" {
+				SHIORI3FW.Eventid = "On_" + SHIORI3FW.Eventid
+			}
+			
+			if SHIORI3FW.Eventid == 'OnAiTalk' || SHIORI3FW.Eventid == 'OnAITalk' {
+				SHIORI3FW.Eventid = 'OnAITalkNewEvent'
+			}
+
+			SHIORI3FW.EventidTranslate = SHIORI3FW.TranslateEvent(SHIORI3FW.Eventid)
+
+			// ハンドラが無い場合は即返る
+			if !ISFUNC(SHIORI3FW.EventidTranslate) && !SHIORI3FW.IsImportantEvent {
+				SHIORI3FW.MakeEmptyResponse(SHIORI3FW.Eventid)
+				--
+				C_CRLF
+				
+				return
+			}
+			_idparsed = 1
+		}
+		// セキュリティレベル
+		elseif _key == 'SecurityLevel' {
+			SHIORI3FW.SecurityLevel = _value
+		}
+		// ベースウェア名取得
+		elseif _key == 'Sender' {
+			if basewarenameex == '' {
+				basewarenameex = _value
+			}
+			basewarename = _value
+			sender = _value
+		}
+		//Status
+		elseif _key == 'Status' {
+			status = _value
+		}
+
+		//特定のイベントを除きExternalなら204で返る
+		if SHIORI3FW.SecurityLevel == 'External' && SHIORI3FW.Eventid != 'OnXUkagakaLinkOpen' {
+			SHIORI3FW.MakeEmptyResponse
+			return
+		}
+
+		// キーと値を記憶
+		var.req.rawvalue ,= _value
+		
+		if SHIORI3FW.AUTO_DATA_CONVERT {
+			if ISINTSTR(_value) {
+				var.req.value ,= TOINT(_value)
+			}
+			elseif ISREALSTR(_value) {
+				var.req.value ,= TOREAL(_value)
+			}
+			else {
+				var.req.value ,= REPLACE(_value, C_BYTE1, ",")	// バイト値1はカンマ化してしまう
+			}
+		}
+		else {
+			var.req.value ,= TOAUTOEX(_value)
+		}
+	}
+
+	OnRequest
+})dic";
+
+// yaya_config.txt の既定値。#globaldefine で展開されて値ごとに構文木が変わるので、
+// 代行が再現する値（行数の制限なし・値の自動変換なし）で展開したものと比べる
+constexpr std::pair<const char*, const char*> kStockDefines[] = {
+    {"SHIORI3FW.REQUEST_LINES_LIMIT", "0"},
+    {"SHIORI3FW.AUTO_DATA_CONVERT", "0"},
+};
+
+// 辞書の解析（STRSTR はバイト位置、SUBSTR は文字位置）と同じ結果になるのは ASCII だけ。
+// 改行を含む値は行の区切りが変わるので、これも辞書に任せる
+bool isPlainAscii(const std::string& s) {
+    for (unsigned char c : s) {
+        if (c >= 0x80 || c == '\r' || c == '\n') return false;
+    }
+    return true;
+}
+
+} // namespace
+
+const std::vector<uint64_t>& VM::stockRequestFingerprints() {
+    if (!stockRequestFingerprints_.empty()) return stockRequestFingerprints_;
+    std::string source = kStockRequestSource;
+    for (const auto& define : kStockDefines) {
+        const std::string name = define.first;
+        for (size_t pos = 0; (pos = source.find(name, pos)) != std::string::npos;) {
+            source.replace(pos, name.size(), define.second);
+            pos += std::char_traits<char>::length(define.second);
+        }
+    }
+    try {
+        Lexer lexer{std::string_view(source)};
+        Parser parser(lexer.tokenize());
+        for (const auto& func : parser.parse()) {
+            if (!func || func->name != "request") continue;
+            // 定数畳み込み（load の "optimize"）の有無で形が変わるので両方を持つ
+            stockRequestFingerprints_.push_back(DicCache::fingerprint(*func));
+            foldConstants(*func);
+            stockRequestFingerprints_.push_back(DicCache::fingerprint(*func));
+        }
+    } catch (const std::exception& e) {
+        YAYA_LOG(Error, "[VM] stock SHIORI3FW request failed to parse: " << e.what());
+    }
+    return stockRequestFingerprints_;
+}
+
+bool VM::hasStockShioriRequest() {
+    if (stockRequestEpoch_ == functionEpoch_) return stockRequest_;
+    stockRequestEpoch_ = functionEpoch_;
+    stockRequest_ = false;
+    auto it = functions_.find("request");
+    if (it == functions_.end()) return false;
+    const FunctionDecl* decl = nullptr;
+    for (const auto& d : it->second) {
+        if (!d.enabled) continue;
+        if (decl) return false;
+        decl = &d;
+    }
+    if (!decl || !decl->node) return false;
+    const uint64_t fingerprint = DicCache::fingerprint(*decl->node);
+    const std::vector<uint64_t>& stock = stockRequestFingerprints();
+    stockRequest_ = std::find(stock.begin(), stock.end(), fingerprint) != stock.end();
+    if (!stockRequest_) {
+        YAYA_LOG(Warn, "[VM] request is not the stock SHIORI3FW one (fingerprint "
+                       << std::hex << fingerprint << std::dec << "); using the dictionary parser");
+    }
+    return stockRequest_;
+}
+
+bool VM::executeShioriRequest(const std::string& method, const ShioriHeaders& headers,
+                              const std::string& requestText, Value& result) {
+    if (recursion_depth_ != 0 || !hasStockShioriRequest()) return false;
+    // "?? " で始まる要求は request 冒頭のテスト用の分岐に入る
+    if (method.compare(0, 3, "?? ") == 0 || !isPlainAscii(method)) return false;
+    for (const auto& header : headers) {
+        if (!isPlainAscii(header.first) || !isPlainAscii(header.second) ||
+            header.first.find(": ") != std::string::npos) {
+            return false;
+        }
+    }
+
+    // 名前で指定するグローバル変数（代入は値を作ってから。関数呼び出しで表が伸びると参照は無効になる）
+    auto global = [this](const char* name) -> Value& {
+        AST::VarSlot slot;
+        return variableRef(name, slot);
+    };
+    // 裸の名前の読み出し（loadVariable と同じく、空なら同名の関数を呼ぶ）
+    auto load = [this](const std::string& name) -> Value {
+        AST::VarSlot slot;
+        const Value* v = findVariable(name, slot);
+        if (v && !v->isVoid()) return *v;
+        int fn = internFunction(name);
+        const FunctionEntry& entry = functionEntry(fn);
+        return (entry.defined || entry.builtin) ? callFunction(fn, {}) : Value();
+    };
+    auto call = [this](const std::string& name, std::vector<Value> args) {
+        return callFunction(internFunction(name), std::move(args));
+    };
+    // var ,= value（配列でなければ空の配列から）
+    auto append = [this](const char* name, const Value& value) {
+        AST::VarSlot slot;
+        Value& target = variableRef(name, slot);
+        if (target.getType() != Value::Type::Array) target = Value(std::vector<Value>());
+        target.arrayConcat(value);
+    };
+    using Op = AST::BinaryOperator;
+
+    auto body = [&]() -> Value {
+        // _lin[0," SHIORI"] / _lin[1," SHIORI"] はこの VM では [start, length] の切り出しになる
+        const Value firstLine(method + " SHIORI/3.0");
+        const int length = Value(std::string(" SHIORI")).asInt();
+        global("REQ.COMMAND") = sliceValue(firstLine, 0, length);
+        global("REQ.PROTOCOL") = evaluateBinaryOp(Op::Add, Value("SHIORI"), sliceValue(firstLine, 1, length));
+
+        global("var.req.key") = Value(std::vector<Value>());
+        global("var.req.value") = Value(std::vector<Value>());
+        global("var.req.rawvalue") = Value(std::vector<Value>());
+        global("status") = Value("");
+        global("SHIORI3FW.Eventid") = Value("");
+        global("SHIORI3FW.SecurityLevel") = Value("Internal");
+
+        // SHIORI3FW.REQUEST_LINES_LIMIT は 0（行数の制限なし）
+        for (const auto& header : headers) {
+            const std::string& key = header.first;
+            const std::string& value = header.second;
+            append("var.req.key", Value(key));
+            if (evaluateBinaryOp(Op::Eq, load("var.req.key"), Value("")).toBool()) break;
+
+            if (key == "Charset") {
+                if (evaluateBinaryOp(Op::Ne, load("S_CHARSET"), Value(value)).toBool()) {
+                    call("SETSETTING", {Value("charset.output"), Value(value)});
+                    global("S_CHARSET") = Value(value);
+                }
+            } else if (key == "ID") {
+                std::string eventid = value;
+                if (eventid.compare(0, 2, "On") != 0) eventid = "On_" + eventid;
+                if (eventid == "OnAiTalk" || eventid == "OnAITalk") eventid = "OnAITalkNewEvent";
+                global("SHIORI3FW.Eventid") = Value(eventid);
+                Value translated = call("SHIORI3FW.TranslateEvent", {load("SHIORI3FW.Eventid")});
+                global("SHIORI3FW.EventidTranslate") = std::move(translated);
+
+                // ハンドラが無い場合は空応答を作って即返る（値なしの return なので request の値は空）
+                Value hasHandler = call("ISFUNC", {load("SHIORI3FW.EventidTranslate")});
+                Value important = load("SHIORI3FW.IsImportantEvent");
+                if (evaluateBinaryOp(Op::LogicalAnd, evaluateUnaryOp(AST::UnaryOperator::Not, hasHandler),
+                                     evaluateUnaryOp(AST::UnaryOperator::Not, important)).toBool()) {
+                    call("SHIORI3FW.MakeEmptyResponse", {load("SHIORI3FW.Eventid")});
+                    return Value();
+                }
+            } else if (key == "SecurityLevel") {
+                global("SHIORI3FW.SecurityLevel") = Value(value);
+            } else if (key == "Sender") {
+                if (evaluateBinaryOp(Op::Eq, load("basewarenameex"), Value("")).toBool()) {
+                    global("basewarenameex") = Value(value);
+                }
+                global("basewarename") = Value(value);
+                global("sender") = Value(value);
+            } else if (key == "Status") {
+                global("status") = Value(value);
+            }
+
+            Value external = evaluateBinaryOp(Op::Eq, load("SHIORI3FW.SecurityLevel"), Value("External"));
+            Value linkOpen = evaluateBinaryOp(Op::Ne, load("SHIORI3FW.Eventid"), Value("OnXUkagakaLinkOpen"));
+            if (evaluateBinaryOp(Op::LogicalAnd, external, linkOpen).toBool()) {
+                load("SHIORI3FW.MakeEmptyResponse");
+                return Value();
+            }
+
+            append("var.req.rawvalue", Value(value));
+            // SHIORI3FW.AUTO_DATA_CONVERT は 0（TOAUTOEX で変換）
+            append("var.req.value", call("TOAUTOEX", {Value(value)}));
+            if (budgetExhausted_) return Value();
+        }
+        return load("OnRequest");
+    };
+
+    // トップレベルの request 呼び出しとして実行する（callFunction / executeFunctionDecl と同じ状態にする）
+    const int index = internFunction("request");
+    std::shared_ptr<const std::vector<const FunctionDecl*>> activeRef = functionEntry(index).active;
+    const FunctionDecl& decl = *activeRef->front();
+    references_.assign(1, Value(requestText));
+    resetBudget();
+    if (!tick()) {
+        result = Value();
+        return true;
+    }
+    recursion_depth_++;
+    completion_ = Completion::Normal;
+    const int caller = currentFunction_;
+    currentFunction_ = index;
+    {
+        yaya_profile::Scope profile(profiler_, profiler_ ? profileKey(decl) : -1);
+        result = body();
+    }
+    completion_ = Completion::Normal;
+    lastOutputNum_ = 1;
+    currentFunction_ = caller;
+    recursion_depth_--;
+    if (budgetExhausted_) result = Value();
+    return true;
+}
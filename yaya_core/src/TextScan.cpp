@@ -0,0 +1,316 @@
+#include "TextScan.hpp"
+
+#include <atomic>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define TEXT_SCAN_X86 1
+#endif
+
+namespace text_scan {
+
+namespace {
+
+// ---- 1 バイトずつ -------------------------------------------------------
+
+Encoding classifyScalar(const unsigned char* b, size_t n) {
+    bool ascii = true;
+    size_t i = 0;
+    while (i < n) {
+        unsigned char c = b[i];
+        size_t len;
+        if (c < 0x80) { i++; continue; }
+        else if ((c & 0xE0) == 0xC0) len = 2;
+        else if ((c & 0xF0) == 0xE0) len = 3;
+        else if ((c & 0xF8) == 0xF0) len = 4;
+        else return Encoding::Invalid;
+        if (i + len > n) return Encoding::Invalid;
+        for (size_t j = 1; j < len; ++j) {
+            if ((b[i + j] & 0xC0) != 0x80) return Encoding::Invalid;
+        }
+        ascii = false;
+        i += len;
+    }
+    return ascii ? Encoding::Ascii : Encoding::Utf8;
+}
+
+size_t blankRunScalar(const char* p, size_t n) {
+    size_t i = 0;
+    while (i < n && isBlank(p[i])) ++i;
+    return i;
+}
+
+size_t findFirstOfScalar(const char* p, size_t n, char a, char b, char c, char d) {
+    for (size_t i = 0; i < n; ++i) {
+        const char x = p[i];
+        if (x == a || x == b || x == c || x == d) return i;
+    }
+    return n;
+}
+
+#ifdef TEXT_SCAN_X86
+
+// ---- SSE2（16 バイトずつ） ----------------------------------------------
+//
+// UTF-8 の構造検査: 各バイトについて「直前 1 バイトが 0xC0 以上」「2 バイト前が 0xE0 以上」
+// 「3 バイト前が 0xF0 以上」のどれかなら続くバイト（0x80-0xBF）でなければならず、
+// どれでもなければ続くバイトであってはならない。0xF8 以上はどこにあっても不正。
+// 1 バイトずつの検査と同じく、先頭から区切ったときに各文字が揃っていることと同値になる。
+// 末尾は 0 で埋めたブロックで調べるので、途中で切れた文字は続くバイトの不足として見つかる。
+
+inline __m128i geSse2(__m128i v, __m128i bound) {
+    return _mm_cmpeq_epi8(_mm_max_epu8(v, bound), v);
+}
+
+// cur を k バイト後ろへずらし、空いた先頭に prev の末尾 k バイトを入れる
+template <int K>
+inline __m128i carrySse2(__m128i cur, __m128i prev) {
+    return _mm_or_si128(_mm_slli_si128(cur, K), _mm_srli_si128(prev, 16 - K));
+}
+
+struct Utf8StateSse2 {
+    __m128i prevC0 = _mm_setzero_si128();
+    __m128i prevE0 = _mm_setzero_si128();
+    __m128i prevF0 = _mm_setzero_si128();
+    __m128i error = _mm_setzero_si128();
+    __m128i high = _mm_setzero_si128();
+
+    void block(__m128i v) {
+        const __m128i geC0 = geSse2(v, _mm_set1_epi8(static_cast<char>(0xC0)));
+        const __m128i geE0 = geSse2(v, _mm_set1_epi8(static_cast<char>(0xE0)));
+        const __m128i geF0 = geSse2(v, _mm_set1_epi8(static_cast<char>(0xF0)));
+        const __m128i geF8 = geSse2(v, _mm_set1_epi8(static_cast<char>(0xF8)));
+        const __m128i ge80 = _mm_cmplt_epi8(v, _mm_setzero_si128());
+        const __m128i continuation = _mm_andnot_si128(geC0, ge80);
+        const __m128i needed = _mm_or_si128(_mm_or_si128(carrySse2<1>(geC0, prevC0), carrySse2<2>(geE0, prevE0)),
+                                            carrySse2<3>(geF0, prevF0));
+        error = _mm_or_si128(error, _mm_or_si128(_mm_xor_si128(needed, continuation), geF8));
+        high = _mm_or_si128(high, v);
+        prevC0 = geC0;
+        prevE0 = geE0;
+        prevF0 = geF0;
+    }
+};
+
+Encoding classifySse2(const unsigned char* b, size_t n) {
+    Utf8StateSse2 state;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        state.block(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+        // CP932 の辞書はすぐ不正になるので、ときどき打ち切りを確かめる
+        if ((i & 1023) == 1008 && _mm_movemask_epi8(state.error) != 0) return Encoding::Invalid;
+    }
+    alignas(16) unsigned char tail[16] = {};
+    if (n > i) std::memcpy(tail, b + i, n - i);
+    state.block(_mm_load_si128(reinterpret_cast<const __m128i*>(tail)));
+    if (_mm_movemask_epi8(state.error) != 0) return Encoding::Invalid;
+    return _mm_movemask_epi8(state.high) != 0 ? Encoding::Utf8 : Encoding::Ascii;
+}
+
+inline __m128i blankMaskSse2(__m128i v) {
+    __m128i m = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\v')));
+    return _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\f')));
+}
+
+size_t blankRunSse2(const char* p, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        const unsigned other = ~static_cast<unsigned>(_mm_movemask_epi8(blankMaskSse2(v))) & 0xFFFFu;
+        if (other != 0) return i + static_cast<size_t>(__builtin_ctz(other));
+    }
+    return i + blankRunScalar(p + i, n - i);
+}
+
+size_t findFirstOfSse2(const char* p, size_t n, char a, char b, char c, char d) {
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    const __m128i vc = _mm_set1_epi8(c);
+    const __m128i vd = _mm_set1_epi8(d);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        const __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)),
+                                       _mm_or_si128(_mm_cmpeq_epi8(v, vc), _mm_cmpeq_epi8(v, vd)));
+        const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(m));
+        if (mask != 0) return i + static_cast<size_t>(__builtin_ctz(mask));
+    }
+    return i + findFirstOfScalar(p + i, n - i, a, b, c, d);
+}
+
+// ---- AVX2（32 バイトずつ。SSE2 と同じ手順） ------------------------------
+
+#define TEXT_SCAN_AVX2 __attribute__((target("avx2")))
+
+TEXT_SCAN_AVX2 inline __m256i geAvx2(__m256i v, __m256i bound) {
+    return _mm256_cmpeq_epi8(_mm256_max_epu8(v, bound), v);
+}
+
+// 128 ビットの境目をまたいでずらすため、prev の上半分と cur の下半分を並べたものから取る
+template <int K>
+TEXT_SCAN_AVX2 inline __m256i carryAvx2(__m256i cur, __m256i prev) {
+    return _mm256_alignr_epi8(cur, _mm256_permute2x128_si256(prev, cur, 0x21), 16 - K);
+}
+
+struct Utf8StateAvx2 {
+    __m256i prevC0;
+    __m256i prevE0;
+    __m256i prevF0;
+    __m256i error;
+    __m256i high;
+
+    TEXT_SCAN_AVX2 void reset() {
+        prevC0 = prevE0 = prevF0 = error = high = _mm256_setzero_si256();
+    }
+
+    TEXT_SCAN_AVX2 void block(__m256i v) {
+        const __m256i geC0 = geAvx2(v, _mm256_set1_epi8(static_cast<char>(0xC0)));
+        const __m256i geE0 = geAvx2(v, _mm256_set1_epi8(static_cast<char>(0xE0)));
+        const __m256i geF0 = geAvx2(v, _mm256_set1_epi8(static_cast<char>(0xF0)));
+        const __m256i geF8 = geAvx2(v, _mm256_set1_epi8(static_cast<char>(0xF8)));
+        const __m256i ge80 = _mm256_cmpgt_epi8(_mm256_setzero_si256(), v);
+        const __m256i continuation = _mm256_andnot_si256(geC0, ge80);
+        const __m256i needed = _mm256_or_si256(
+            _mm256_or_si256(carryAvx2<1>(geC0, prevC0), carryAvx2<2>(geE0, prevE0)), carryAvx2<3>(geF0, prevF0));
+        error = _mm256_or_si256(error, _mm256_or_si256(_mm256_xor_si256(needed, continuation), geF8));
+        high = _mm256_or_si256(high, v);
+        prevC0 = geC0;
+        prevE0 = geE0;
+        prevF0 = geF0;
+    }
+};
+
+TEXT_SCAN_AVX2 Encoding classifyAvx2(const unsigned char* b, size_t n) {
+    Utf8StateAvx2 state;
+    state.reset();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        state.block(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+        if ((i & 1023) == 992 && !_mm256_testz_si256(state.error, state.error)) return Encoding::Invalid;
+    }
+    alignas(32) unsigned char tail[32] = {};
+    if (n > i) std::memcpy(tail, b + i, n - i);
+    state.block(_mm256_load_si256(reinterpret_cast<const __m256i*>(tail)));
+    if (!_mm256_testz_si256(state.error, state.error)) return Encoding::Invalid;
+    return _mm256_movemask_epi8(state.high) != 0 ? Encoding::Utf8 : Encoding::Ascii;
+}
+
+TEXT_SCAN_AVX2 size_t blankRunAvx2(const char* p, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        __m256i m = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\v')));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\f')));
+        const unsigned other = ~static_cast<unsigned>(_mm256_movemask_epi8(m));
+        if (other != 0) return i + static_cast<size_t>(__builtin_ctz(other));
+    }
+    return i + blankRunSse2(p + i, n - i);
+}
+
+TEXT_SCAN_AVX2 size_t findFirstOfAvx2(const char* p, size_t n, char a, char b, char c, char d) {
+    const __m256i va = _mm256_set1_epi8(a);
+    const __m256i vb = _mm256_set1_epi8(b);
+    const __m256i vc = _mm256_set1_epi8(c);
+    const __m256i vd = _mm256_set1_epi8(d);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        const __m256i m = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb)),
+                                          _mm256_or_si256(_mm256_cmpeq_epi8(v, vc), _mm256_cmpeq_epi8(v, vd)));
+        const unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(m));
+        if (mask != 0) return i + static_cast<size_t>(__builtin_ctz(mask));
+    }
+    return i + findFirstOfSse2(p + i, n - i, a, b, c, d);
+}
+
+#endif // TEXT_SCAN_X86
+
+// ---- 実装の選択 ---------------------------------------------------------
+
+struct Kernels {
+    Level level;
+    Encoding (*classify)(const unsigned char*, size_t);
+    size_t (*blankRun)(const char*, size_t);
+    size_t (*findFirstOf)(const char*, size_t, char, char, char, char);
+};
+
+const Kernels kScalar = {Level::Scalar, classifyScalar, blankRunScalar, findFirstOfScalar};
+#ifdef TEXT_SCAN_X86
+const Kernels kSse2 = {Level::Sse2, classifySse2, blankRunSse2, findFirstOfSse2};
+const Kernels kAvx2 = {Level::Avx2, classifyAvx2, blankRunAvx2, findFirstOfAvx2};
+#endif
+
+const Kernels& kernelsFor(Level wanted) {
+#ifdef TEXT_SCAN_X86
+    // x86-64 では SSE2 は必ずある
+    if (wanted == Level::Avx2 && __builtin_cpu_supports("avx2")) return kAvx2;
+    if (wanted != Level::Scalar) return kSse2;
+#else
+    (void)wanted;
+#endif
+    return kScalar;
+}
+
+std::atomic<const Kernels*>& current() {
+    static std::atomic<const Kernels*> kernels{&kernelsFor(Level::Avx2)};
+    return kernels;
+}
+
+inline const Kernels& active() {
+    return *current().load(std::memory_order_relaxed);
+}
+
+} // namespace
+
+Encoding classify(std::string_view text) {
+    return active().classify(reinterpret_cast<const unsigned char*>(text.data()), text.size());
+}
+
+size_t detail::blankRun(const char* p, size_t n) {
+    return active().blankRun(p, n);
+}
+
+size_t findFirstOf(const char* p, size_t n, char a, char b, char c, char d) {
+    return active().findFirstOf(p, n, a, b, c, d);
+}
+
+size_t utf8Length(std::string_view text) {
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(text.data());
+    const size_t n = text.size();
+    size_t count = 0;
+    size_t i = 0;
+    while (i < n) {
+        const unsigned char c = b[i];
+        size_t len;
+        if (c < 0x80) len = 1;
+        else if ((c & 0xE0) == 0xC0) len = 2;
+        else if ((c & 0xF0) == 0xE0) len = 3;
+        else if ((c & 0xF8) == 0xF0) len = 4;
+        else len = 0;
+        // 不正な先頭バイト・途中で切れた列・続くバイトの不足は 1 バイトで 1 文字
+        bool valid = len != 0 && i + len <= n;
+        for (size_t j = 1; valid && j < len; ++j) valid = (b[i + j] & 0xC0) == 0x80;
+        i += valid ? len : 1;
+        ++count;
+    }
+    return count;
+}
+
+Level level() {
+    return active().level;
+}
+
+Level setLevel(Level wanted) {
+    const Kernels& kernels = kernelsFor(wanted);
+    current().store(&kernels, std::memory_order_relaxed);
+    return kernels.level;
+}
+
+} // namespace text_scan
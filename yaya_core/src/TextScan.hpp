@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+// 辞書の読み込み（DictionaryManager::decodeContent）と字句解析（Lexer）などで使うバイト列の走査。
+// x86-64 では SSE2 / AVX2 の実装を実行時に選び、それ以外では 1 バイトずつ調べる。
+// どの実装でも結果は同じ（examples/bench_scan.cpp で突き合わせる）。
+namespace text_scan {
+
+enum class Encoding {
+    Ascii,    // 0x80 以上のバイトが無い
+    Utf8,     // 0x80 以上のバイトがあり、UTF-8 として妥当
+    Invalid,  // UTF-8 として不正
+};
+
+// UTF-8 の検査は構造（先頭バイトが示す数の続くバイトがあるか）だけで、
+// 短縮形・サロゲート・U+10FFFF 超は弾かない（以前の isValidUTF8 と同じ）
+Encoding classify(std::string_view text);
+
+// 字句解析の空白（'\n' 以外の isspace）
+inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+namespace detail {
+size_t blankRun(const char* p, size_t n);
+}
+
+// p から空白が続くバイト数
+inline size_t blankRun(const char* p, size_t n) {
+    // 字下げのタブや演算子の前後の空白は 1〜2 バイトなので、短いうちはここで数える
+    size_t i = 0;
+    while (i < n && i < 4 && isBlank(p[i])) ++i;
+    if (i < 4 || i == n) return i;
+    return i + detail::blankRun(p + i, n - i);
+}
+
+// p から a / b / c / d のどれかが最初に現れる位置（無ければ n）
+size_t findFirstOf(const char* p, size_t n, char a, char b, char c, char d);
+
+// 文字数（STRLEN・ASORT の "length"）。UTF-8 として読めないバイトは 1 バイトを 1 文字と数える
+size_t utf8Length(std::string_view text);
+
+enum class Level { Scalar, Sse2, Avx2 };
+
+// 使っている実装
+Level level();
+// 実装を切り替える（比較・計測用）。CPU が対応していなければ対応している中で最も近いものにし、それを返す
+Level setLevel(Level level);
+
+} // namespace text_scan
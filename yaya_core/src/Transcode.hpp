@@ -0,0 +1,361 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <iconv.h>
+
+// yaya_core / satori_core で共有する文字コード変換。
+// - iconv の変換記述子はスレッドごとに (to, from) の組で使い回す（変換のたびに iconv_open / iconv_close しない）。
+// - CP932 ⇔ UTF-8 は表引きで、呼び出し側の std::string に 1 パスで書き込む（output の領域は再利用される）。
+//   表は初めて使うときに実行環境の iconv から作る。glibc と macOS の libiconv では
+//   一方向の対応（U+00A5 → 0x5C 等）が違うので、どちらでも iconv と同じ結果になるようにするため。
+//   iconv が CP932 を持たない・表にできない対応があるときは iconv での変換に戻る。
+//
+// どの関数も成功時に output を変換結果で置き換える。失敗時の output の内容は不定。
+namespace transcode {
+
+namespace detail {
+
+inline iconv_t invalidDescriptor() { return reinterpret_cast<iconv_t>(-1); }
+
+// スレッドごとの変換記述子（開けなかった組も覚えておき、開き直さない）
+class IconvCache {
+public:
+    ~IconvCache() {
+        for (auto& kv : descriptors_) {
+            if (kv.second != invalidDescriptor()) iconv_close(kv.second);
+        }
+    }
+    iconv_t get(const char* to, const char* from) {
+        key_.assign(to).push_back('\0');
+        key_.append(from);
+        auto it = descriptors_.find(key_);
+        if (it == descriptors_.end()) it = descriptors_.emplace(key_, iconv_open(to, from)).first;
+        return it->second;
+    }
+
+private:
+    std::unordered_map<std::string, iconv_t> descriptors_;
+    std::string key_;
+};
+
+inline IconvCache& iconvCache() {
+    thread_local IconvCache cache;
+    return cache;
+}
+
+} // namespace detail
+
+// to / from の組を iconv で変換できるか
+inline bool iconvSupported(const char* to, const char* from) {
+    return detail::iconvCache().get(to, from) != detail::invalidDescriptor();
+}
+
+inline bool iconvConvert(const char* to, const char* from, std::string_view input, std::string& output) {
+    iconv_t cd = detail::iconvCache().get(to, from);
+    if (cd == detail::invalidDescriptor()) return false;
+    iconv(cd, nullptr, nullptr, nullptr, nullptr);  // 前回の変換状態を捨てる
+    output.resize(input.size() * 2 + 16);
+    char* in = const_cast<char*>(input.data());
+    size_t inLeft = input.size();
+    size_t used = 0;
+    // 入力を使い切ったら、状態を持つ文字コード（ISO-2022-JP 等）を初期状態に戻す列も書き出す
+    for (bool flushed = false; !flushed;) {
+        char* out = &output[used];
+        size_t outLeft = output.size() - used;
+        const bool flush = inLeft == 0;
+        size_t rc = flush ? iconv(cd, nullptr, nullptr, &out, &outLeft)
+                          : iconv(cd, &in, &inLeft, &out, &outLeft);
+        used = output.size() - outLeft;
+        if (rc != static_cast<size_t>(-1)) {
+            flushed = flush;
+            continue;
+        }
+        if (errno != E2BIG) return false;
+        output.resize(output.size() * 2);
+    }
+    output.resize(used);
+    return true;
+}
+
+namespace detail {
+
+constexpr uint16_t kUnmapped = 0xFFFF;
+constexpr uint16_t kLeadByte = 0xFFFE;
+
+// CP932 ⇔ Unicode (BMP) の対応表
+struct Cp932Tables {
+    bool usable = false;
+    // バイト → Unicode。2 バイト文字の先頭なら kLeadByte、どちらでもなければ kUnmapped
+    uint16_t single[256];
+    // 先頭バイト → doubles の行（先頭バイトでなければ -1）
+    int16_t leadRow[256];
+    std::vector<uint16_t> doubles;  // 行ごとに 2 バイト目 256 個
+    // Unicode → CP932（1 バイト文字は 0x00-0xFF、2 バイト文字は先頭 << 8 | 2 バイト目）
+    std::vector<uint16_t> encode;
+};
+
+// 1 文字ぶんの UTF-8 を BMP のコードポイントにする（1 文字でなければ kUnmapped）
+inline uint16_t singleBmpScalar(const char* text, size_t length) {
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(text);
+    if (length == 1 && b[0] < 0x80) return b[0];
+    if (length == 2 && (b[0] & 0xE0) == 0xC0 && (b[1] & 0xC0) == 0x80) {
+        return static_cast<uint16_t>(((b[0] & 0x1F) << 6) | (b[1] & 0x3F));
+    }
+    if (length == 3 && (b[0] & 0xF0) == 0xE0 && (b[1] & 0xC0) == 0x80 && (b[2] & 0xC0) == 0x80) {
+        uint16_t scalar = static_cast<uint16_t>(((b[0] & 0x0F) << 12) | ((b[1] & 0x3F) << 6) | (b[2] & 0x3F));
+        return scalar >= kLeadByte ? kUnmapped : scalar;
+    }
+    return kUnmapped;
+}
+
+inline size_t putUtf8(char* out, uint32_t scalar) {
+    if (scalar < 0x80) {
+        out[0] = static_cast<char>(scalar);
+        return 1;
+    }
+    if (scalar < 0x800) {
+        out[0] = static_cast<char>(0xC0 | (scalar >> 6));
+        out[1] = static_cast<char>(0x80 | (scalar & 0x3F));
+        return 2;
+    }
+    out[0] = static_cast<char>(0xE0 | (scalar >> 12));
+    out[1] = static_cast<char>(0x80 | ((scalar >> 6) & 0x3F));
+    out[2] = static_cast<char>(0x80 | (scalar & 0x3F));
+    return 3;
+}
+
+// iconv で 1 文字ずつ変換して表を作る（成功 = 出力あり、EINVAL = 入力が途中で切れている）
+inline Cp932Tables buildCp932Tables() {
+    Cp932Tables t;
+    iconv_t decoder = iconv_open("UTF-8", "CP932");
+    iconv_t encoder = iconv_open("CP932", "UTF-8");
+    auto run = [](iconv_t cd, const char* input, size_t length, char* out, size_t& outLength, int& error) {
+        iconv(cd, nullptr, nullptr, nullptr, nullptr);
+        char* in = const_cast<char*>(input);
+        char* o = out;
+        size_t inLeft = length;
+        size_t outLeft = 8;
+        size_t rc = iconv(cd, &in, &inLeft, &o, &outLeft);
+        outLength = 8 - outLeft;
+        error = rc == static_cast<size_t>(-1) ? errno : 0;
+        return rc != static_cast<size_t>(-1) && inLeft == 0;
+    };
+    if (decoder == invalidDescriptor() || encoder == invalidDescriptor()) {
+        if (decoder != invalidDescriptor()) iconv_close(decoder);
+        if (encoder != invalidDescriptor()) iconv_close(encoder);
+        return t;
+    }
+
+    bool exact = true;
+    char out[8];
+    size_t outLength = 0;
+    int error = 0;
+    for (int b = 0; b < 256; ++b) {
+        t.single[b] = kUnmapped;
+        t.leadRow[b] = -1;
+        const char in[1] = {static_cast<char>(b)};
+        if (run(decoder, in, 1, out, outLength, error)) {
+            t.single[b] = singleBmpScalar(out, outLength);
+            if (t.single[b] == kUnmapped) exact = false;
+        } else if (error == EINVAL) {
+            t.single[b] = kLeadByte;
+            t.leadRow[b] = static_cast<int16_t>(t.doubles.size() / 256);
+            t.doubles.resize(t.doubles.size() + 256, kUnmapped);
+        }
+    }
+    // ASCII はそのまま写す前提（ASCII の連続をまとめて写す）
+    for (int b = 0; b < 0x80; ++b) {
+        if (t.single[b] != b) exact = false;
+    }
+    for (int lead = 0; lead < 256 && exact; ++lead) {
+        if (t.leadRow[lead] < 0) continue;
+        uint16_t* row = &t.doubles[static_cast<size_t>(t.leadRow[lead]) * 256];
+        for (int trail = 0; trail < 256; ++trail) {
+            const char in[2] = {static_cast<char>(lead), static_cast<char>(trail)};
+            if (!run(decoder, in, 2, out, outLength, error)) continue;
+            row[trail] = singleBmpScalar(out, outLength);
+            if (row[trail] == kUnmapped) exact = false;
+        }
+    }
+
+    t.encode.assign(0x10000, kUnmapped);
+    for (uint32_t scalar = 0; scalar < 0x10000 && exact; ++scalar) {
+        if (scalar >= 0xD800 && scalar < 0xE000) continue;
+        char in[3];
+        const size_t length = putUtf8(in, scalar);
+        if (!run(encoder, in, length, out, outLength, error)) continue;
+        const unsigned char* o = reinterpret_cast<const unsigned char*>(out);
+        if (outLength == 1) t.encode[scalar] = o[0];
+        else if (outLength == 2 && o[0] != 0) t.encode[scalar] = static_cast<uint16_t>(o[0] << 8 | o[1]);
+        else exact = false;
+    }
+    iconv_close(decoder);
+    iconv_close(encoder);
+    t.usable = exact;
+    return t;
+}
+
+inline const Cp932Tables& cp932Tables() {
+    static const Cp932Tables tables = buildCp932Tables();
+    return tables;
+}
+
+// 先頭バイトから長さを決めて 1 文字ぶん読む（続くバイトは検査せずに下位 6 ビットを足す）。
+// valid は iconv が 1 文字として受け付ける UTF-8（短縮形でなく、サロゲートでなく、U+10FFFF 以下）のとき true
+inline size_t readUtf8(const unsigned char* p, const unsigned char* end, uint32_t& scalar, bool& valid) {
+    const unsigned char first = *p;
+    size_t length = 1;
+    scalar = first;
+    if ((first & 0xE0) == 0xC0) {
+        length = 2;
+        scalar = first & 0x1F;
+    } else if ((first & 0xF0) == 0xE0) {
+        length = 3;
+        scalar = first & 0x0F;
+    } else if ((first & 0xF8) == 0xF0) {
+        length = 4;
+        scalar = first & 0x07;
+    }
+    if (static_cast<size_t>(end - p) < length) {
+        length = 1;
+        scalar = first;
+    }
+    valid = first < 0x80;
+    if (length == 1) return 1;
+    bool continuation = true;
+    for (size_t i = 1; i < length; ++i) {
+        continuation = continuation && (p[i] & 0xC0) == 0x80;
+        scalar = (scalar << 6) | (p[i] & 0x3F);
+    }
+    static constexpr uint32_t kMinimum[5] = {0, 0, 0x80, 0x800, 0x10000};
+    valid = continuation && scalar >= kMinimum[length] && scalar <= 0x10FFFF &&
+            !(scalar >= 0xD800 && scalar < 0xE000);
+    return length;
+}
+
+// UTF-8 → CP932。escapeUnknown なら変換できない文字を "?escape!unicode[0x…]" にする
+inline bool utf8ToCp932(std::string_view input, std::string& output, bool escapeUnknown) {
+    const Cp932Tables& t = cp932Tables();
+    if (!t.usable) return false;
+    // 1 文字は UTF-8 でも CP932 以上の長さなので、置き換えが無ければ入力の長さで足りる
+    output.resize(input.size() + 16);
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(input.data());
+    const unsigned char* end = p + input.size();
+    size_t used = 0;
+    while (p < end) {
+        if (*p < 0x80) {
+            const unsigned char* run = p;
+            while (p < end && *p < 0x80) ++p;
+            std::memcpy(&output[used], run, static_cast<size_t>(p - run));
+            used += static_cast<size_t>(p - run);
+            continue;
+        }
+        uint32_t scalar = 0;
+        bool valid = false;
+        const size_t length = readUtf8(p, end, scalar, valid);
+        const uint16_t code = valid && scalar < 0x10000 ? t.encode[scalar] : kUnmapped;
+        if (code != kUnmapped) {
+            if (code >= 0x100) output[used++] = static_cast<char>(code >> 8);
+            output[used++] = static_cast<char>(code & 0xFF);
+        } else if (escapeUnknown) {
+            char escaped[40];
+            const int n = std::snprintf(escaped, sizeof(escaped), "?escape!unicode[0x%X]", scalar);
+            // 残りの入力を書く余地も残しておく
+            const size_t need = used + static_cast<size_t>(n) + static_cast<size_t>(end - p) + 16;
+            if (need > output.size()) output.resize(need * 2);
+            std::memcpy(&output[used], escaped, static_cast<size_t>(n));
+            used += static_cast<size_t>(n);
+        } else {
+            return false;
+        }
+        p += length;
+    }
+    output.resize(used);
+    return true;
+}
+
+} // namespace detail
+
+// CP932 → UTF-8（不正なバイト列や途中で切れた 2 バイト文字があれば false）
+inline bool cp932ToUtf8(std::string_view input, std::string& output) {
+    const detail::Cp932Tables& t = detail::cp932Tables();
+    if (!t.usable) return iconvConvert("UTF-8", "CP932", input, output);
+    // 日本語は 2 バイト → 3 バイト。半角カナ（1 バイト → 3 バイト）が続くときだけ広げる
+    output.resize(input.size() + input.size() / 2 + 16);
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(input.data());
+    const unsigned char* end = p + input.size();
+    size_t used = 0;
+    while (p < end) {
+        if (*p < 0x80) {
+            const unsigned char* run = p;
+            while (p < end && *p < 0x80) ++p;
+            std::memcpy(&output[used], run, static_cast<size_t>(p - run));
+            used += static_cast<size_t>(p - run);
+            continue;
+        }
+        uint16_t scalar = t.single[*p];
+        if (scalar == detail::kLeadByte) {
+            if (end - p < 2) return false;
+            scalar = t.doubles[static_cast<size_t>(t.leadRow[*p]) * 256 + p[1]];
+            p += 2;
+        } else {
+            p += 1;
+        }
+        if (scalar == detail::kUnmapped) return false;
+        if (output.size() - used < 3 + static_cast<size_t>(end - p)) {
+            output.resize(output.size() + output.size() / 2 + 16);
+        }
+        used += detail::putUtf8(&output[used], scalar);
+    }
+    output.resize(used);
+    return true;
+}
+
+// UTF-8 → CP932（CP932 に無い文字や不正な UTF-8 があれば false）
+inline bool utf8ToCp932(std::string_view input, std::string& output) {
+    if (!detail::cp932Tables().usable) return iconvConvert("CP932", "UTF-8", input, output);
+    return detail::utf8ToCp932(input, output, false);
+}
+
+// UTF-8 → CP932。CP932 に無い文字は "?escape!unicode[0xXXXX]" に置き換える（SATORI の書式）。
+// 不正な UTF-8 は先頭バイトから決めた長さを 1 文字として同じく置き換える
+inline void utf8ToCp932Escaping(std::string_view input, std::string& output) {
+    if (detail::cp932Tables().usable) {
+        detail::utf8ToCp932(input, output, true);
+        return;
+    }
+    // 表が無いときは 1 文字ずつ iconv に渡す
+    output.clear();
+    std::string converted;
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(input.data());
+    const unsigned char* end = p + input.size();
+    while (p < end) {
+        uint32_t scalar = 0;
+        bool valid = false;
+        const size_t length = detail::readUtf8(p, end, scalar, valid);
+        if (iconvConvert("CP932", "UTF-8", std::string_view(reinterpret_cast<const char*>(p), length), converted)) {
+            output += converted;
+        } else {
+            char escaped[40];
+            std::snprintf(escaped, sizeof(escaped), "?escape!unicode[0x%X]", scalar);
+            output += escaped;
+        }
+        p += length;
+    }
+}
+
+// 文字コード名（iconv の名前）の間の変換。CP932 ⇔ UTF-8 は表、それ以外は iconv を使う
+inline bool convert(const char* to, const char* from, std::string_view input, std::string& output) {
+    if (std::strcmp(from, "CP932") == 0 && std::strcmp(to, "UTF-8") == 0) return cp932ToUtf8(input, output);
+    if (std::strcmp(from, "UTF-8") == 0 && std::strcmp(to, "CP932") == 0) return utf8ToCp932(input, output);
+    return iconvConvert(to, from, input, output);
+}
+
+} // namespace transcode
@@ -1,6 +1,10 @@
 #include "VM.hpp"
 #include "Lexer.hpp"
 #include "Parser.hpp"
+#include "Log.hpp"
+#include "Profiler.hpp"
+#include "MappedFile.hpp"
+#include "VarSnapshot.hpp"
 #include <random>
 #include <stdexcept>
 #include <ctime>
@@ -12,18 +16,17 @@
 #include <set>
 #include <cstdlib>
 #include <fstream>
-#include <iostream>
 #include <map>
 #include <memory>
 #include <thread>
 #include <sys/wait.h>
-#include <regex>
 #include <unordered_set>
-#include <iconv.h>
-#include <cerrno>
+#include <atomic>
 #include <cstring>
 #include "Digest.hpp"
 #include "Base64.hpp"
+#include "Transcode.hpp"
+#include "TextScan.hpp"
 
 namespace {
 
@@ -42,34 +45,6 @@ std::string normalizeEncodingNameVM(std::string enc) {
     return "AUTO";
 }
 
-// iconv による汎用エンコーディング変換 (from -> to)。失敗時は false。
-bool convertEncodingVM(const std::string& input, const char* fromCode, const char* toCode, std::string& output) {
-    iconv_t cd = iconv_open(toCode, fromCode);
-    if (cd == (iconv_t)-1) {
-        return false;
-    }
-    std::string result;
-    result.reserve(input.size() * 2 + 16);
-    std::vector<char> buf(65536);
-    char* inPtr = const_cast<char*>(input.data());
-    size_t inLeft = input.size();
-    bool ok = true;
-    while (inLeft > 0) {
-        char* outPtr = buf.data();
-        size_t outLeft = buf.size();
-        size_t rc = iconv(cd, &inPtr, &inLeft, &outPtr, &outLeft);
-        result.append(buf.data(), buf.size() - outLeft);
-        if (rc == (size_t)-1) {
-            if (errno == E2BIG) continue; // 出力バッファ満杯 → 続行
-            ok = false;
-            break;
-        }
-    }
-    iconv_close(cd);
-    if (ok) output = std::move(result);
-    return ok;
-}
-
 // UTF-8 バイト列をコードポイント配列にデコードする。
 // 不正なバイトは置換せず、そのまま 1 バイト = 1 コードポイントとして扱い、
 // 元の文字列を壊さない（往復で同一バイト列に戻せる範囲を優先）。
@@ -137,6 +112,15 @@ std::string convertZenToHan(const std::string& s) {
     return out;
 }
 
+// ログ用の値の表示（最大 limit バイト）。配列の asString() は乱数で要素を選ぶので、
+// ログのレベルでスクリプトの結果が変わらないよう要素数だけを出す
+std::string logPreview(const Value& value, size_t limit) {
+    if (value.getType() == Value::Type::Array) return "[array " + std::to_string(value.asArray().size()) + "]";
+    std::string s = value.asString();
+    if (s.size() > limit) s = s.substr(0, limit) + "...";
+    return s;
+}
+
 // 半角英数字・記号・空白を全角へ変換する（HAN2ZEN）。
 // 対象: 半角 ASCII U+0021..U+007E と半角スペース U+0020。
 std::string convertHanToZen(const std::string& s) {
@@ -154,11 +138,6 @@ std::string convertHanToZen(const std::string& s) {
     return out;
 }
 
-// UTF-8 文字数（コードポイント数）を返す。
-size_t utf8Length(const std::string& s) {
-    return decodeUtf8(s).size();
-}
-
 // コードポイント列を [start, start+count) で切り出して UTF-8 文字列に再構築する。
 // start/count は文字（コードポイント）単位。範囲はクランプする。
 std::string utf8Slice(const std::vector<uint32_t>& cps, size_t start, size_t count) {
@@ -256,10 +235,152 @@ std::string formatPrintf(const std::string& format, const std::vector<Value>& ar
     return result;
 }
 
+// 変数スロット表の識別子。VM やレイアウトが作り直されても古いノードのキャッシュと衝突しないよう
+// プロセス内で一意に払い出す。
+unsigned long long newVarScopeId() {
+    static std::atomic<unsigned long long> next{1};
+    return next++;
+}
+
+inline bool isLocalVariableName(const std::string& name) {
+    return !name.empty() && name[0] == '_';
+}
+
 } // namespace
 
-VM::VM() {
+VM::VM() : functionScopeId_(newVarScopeId()), globalScopeId_(newVarScopeId()) {
     registerBuiltins();
+    resetBudget();
+}
+
+int VM::LocalLayout::find(const std::string& name) const {
+    auto it = index.find(name);
+    return it != index.end() ? it->second : -1;
+}
+
+int VM::LocalLayout::intern(const std::string& name) {
+    auto it = index.find(name);
+    if (it != index.end()) return it->second;
+    int idx = static_cast<int>(names.size());
+    names.push_back(name);
+    index.emplace(name, idx);
+    return idx;
+}
+
+std::shared_ptr<VM::LocalLayout> VM::localLayoutFor(const std::string& functionName) {
+    auto& layout = localLayouts_[functionName];
+    if (!layout) {
+        layout = std::make_shared<LocalLayout>();
+        layout->scopeId = newVarScopeId();
+        layout->intern("_argv");
+        layout->intern("_argc");
+    }
+    return layout;
+}
+
+const Value* VM::findVariable(const std::string& name, AST::VarSlot& slot) const {
+    if (isLocalVariableName(name) && localDepth_ > 0) {
+        const LocalFrame& frame = localScopes_[localDepth_ - 1];
+        if (slot.scope != frame.layout->scopeId) {
+            int idx = frame.layout->find(name);
+            if (idx < 0) return nullptr;
+            slot.scope = frame.layout->scopeId;
+            slot.index = idx;
+        }
+        if (slot.index >= static_cast<int>(frame.slots.size())) return nullptr;
+        return &frame.slots[slot.index];
+    }
+    if (slot.scope != globalScopeId_) {
+        auto it = globalIndex_.find(name);
+        if (it == globalIndex_.end()) return nullptr;
+        slot.scope = globalScopeId_;
+        slot.index = static_cast<int>(it->second);
+    }
+    const GlobalSlot& g = globals_[slot.index];
+    return g.defined ? &g.value : nullptr;
+}
+
+size_t VM::internGlobal(const std::string& name) {
+    auto it = globalIndex_.find(name);
+    if (it != globalIndex_.end()) return it->second;
+    size_t idx = globals_.size();
+    // 新しい変数は未保存（dirty）として次の SAVEVAR で符号化する
+    GlobalSlot g;
+    g.name = name;
+    globals_.push_back(std::move(g));
+    globalIndex_.emplace(name, idx);
+    return idx;
+}
+
+Value& VM::variableRef(const std::string& name, AST::VarSlot& slot) {
+    if (isLocalVariableName(name) && localDepth_ > 0) {
+        LocalFrame& frame = localScopes_[localDepth_ - 1];
+        if (slot.scope != frame.layout->scopeId) {
+            slot.scope = frame.layout->scopeId;
+            slot.index = frame.layout->intern(name);
+        }
+        if (slot.index >= static_cast<int>(frame.slots.size())) {
+            frame.slots.resize(frame.layout->names.size());
+        }
+        return frame.slots[slot.index];
+    }
+    if (slot.scope != globalScopeId_) {
+        slot.scope = globalScopeId_;
+        slot.index = static_cast<int>(internGlobal(name));
+    }
+    GlobalSlot& g = globals_[slot.index];
+    g.defined = true;
+    g.dirty = true;
+    return g.value;
+}
+
+void VM::resolveVariables(AST::Node& node, LocalLayout& layout) {
+    // ローカルはレイアウトへ、グローバルは表へ事前に割り当て、初回実行時の名前引きを省く
+    auto assign = [this, &layout](const std::string& name, AST::VarSlot& slot) {
+        if (name.empty()) return;
+        if (isLocalVariableName(name)) {
+            slot.scope = layout.scopeId;
+            slot.index = layout.intern(name);
+            return;
+        }
+        slot.scope = globalScopeId_;
+        slot.index = static_cast<int>(internGlobal(name));
+    };
+    switch (node.type) {
+        case AST::NodeType::Variable: {
+            auto& n = static_cast<AST::VariableNode&>(node);
+            assign(n.name, n.slot);
+            break;
+        }
+        case AST::NodeType::ArrayAccess: {
+            auto& n = static_cast<AST::ArrayAccessNode&>(node);
+            assign(n.arrayName, n.slot);
+            break;
+        }
+        case AST::NodeType::Assignment: {
+            auto& n = static_cast<AST::AssignmentNode&>(node);
+            assign(n.variableName, n.slot);
+            break;
+        }
+        case AST::NodeType::Foreach: {
+            auto& n = static_cast<AST::ForeachNode&>(node);
+            assign(n.varName, n.slot);
+            break;
+        }
+        case AST::NodeType::Call: {
+            // 呼び出し先も関数表の番号へ結び付けておく（中身の解決は初回呼び出し時）
+            auto& n = static_cast<AST::CallNode&>(node);
+            if (n.kind == AST::CallKind::Function && !n.functionName.empty()) {
+                resolveFunction(n.functionName, n.target);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    AST::forEachChild(node, [this, &layout](std::shared_ptr<AST::Node>& child) {
+        resolveVariables(*child, layout);
+    });
 }
 
 int VM::beginSource(const std::string& sourceName) {
@@ -284,6 +405,9 @@ void VM::registerFunction(const std::string& name, std::shared_ptr<AST::Function
     // vector (so dicUnload can still retract by source), and the dispatcher picks
     // the last registered enabled declaration. Here we only need to drop earlier
     // declarations of the same name once the name has entered nonoverload mode.
+    if (func) {
+        resolveVariables(*func, *localLayoutFor(name));
+    }
     auto& vec = functions_[name];
     bool nameIsNonoverload = decl.nonoverload;
     for (const auto& d : vec) if (d.nonoverload) { nameIsNonoverload = true; break; }
@@ -291,6 +415,7 @@ void VM::registerFunction(const std::string& name, std::shared_ptr<AST::Function
         vec.clear();
     }
     vec.push_back(std::move(decl));
+    invalidateFunctions();
 }
 
 void VM::unloadSource(int sourceId) {
@@ -307,6 +432,7 @@ void VM::unloadSource(int sourceId) {
         else ++it;
     }
     sourceNames_.erase(sourceId);
+    invalidateFunctions();
 }
 
 int VM::findSource(const std::string& sourceName) const {
@@ -330,6 +456,7 @@ bool VM::undefFunction(const std::string& name) {
     for (auto& d : it->second) {
         if (d.enabled) { d.enabled = false; any = true; }
     }
+    invalidateFunctions();
     return any;
 }
 
@@ -350,6 +477,9 @@ bool VM::funcDeclWrite(const std::string& name, const std::string& decl) {
     // re-derive attribute flags
     it->second.front().nonoverload = (decl.find("nonoverload") != std::string::npos);
     it->second.front().isWhen = (decl.find("when") != std::string::npos);
+    // array/sequential の別はコンパイル済みの命令列に焼き込まれているため作り直す
+    it->second.front().bytecode.reset();
+    invalidateFunctions();
     return true;
 }
 
@@ -357,95 +487,153 @@ bool VM::funcDeclErase(const std::string& name) {
     auto it = functions_.find(name);
     if (it == functions_.end()) return false;
     functions_.erase(it);
+    invalidateFunctions();
     return true;
 }
 
+int VM::internFunction(const std::string& name) {
+    auto it = functionIndex_.find(name);
+    if (it != functionIndex_.end()) return it->second;
+    int idx = static_cast<int>(functionTable_.size());
+    auto entry = std::make_unique<FunctionEntry>();
+    entry->name = name;
+    functionTable_.push_back(std::move(entry));
+    functionIndex_.emplace(name, idx);
+    return idx;
+}
+
+int VM::resolveFunction(const std::string& name, AST::FunctionSlot& slot) {
+    if (slot.scope != functionScopeId_) {
+        slot.scope = functionScopeId_;
+        slot.index = internFunction(name);
+    }
+    return slot.index;
+}
+
+const VM::FunctionEntry& VM::functionEntry(int index) {
+    FunctionEntry& entry = *functionTable_[index];
+    if (entry.epoch == functionEpoch_) return entry;
+
+    entry.epoch = functionEpoch_;
+    auto bit = builtins_.find(entry.name);
+    entry.builtin = (bit != builtins_.end()) ? &bit->second : nullptr;
+    auto fit = functions_.find(entry.name);
+    entry.defined = (fit != functions_.end());
+    auto active = std::make_shared<std::vector<const FunctionDecl*>>();
+    entry.anyNonoverload = false;
+    if (fit != functions_.end()) {
+        for (const auto& d : fit->second) {
+            if (!d.enabled) continue;
+            active->push_back(&d);
+            if (d.nonoverload) entry.anyNonoverload = true;
+        }
+    }
+    entry.active = std::move(active);
+    if (!entry.builtin && entry.defined && !entry.layout) {
+        entry.layout = localLayoutFor(entry.name);
+    }
+    return entry;
+}
+
 Value VM::execute(const std::string& functionName, const std::vector<Value>& args) {
     // 空の関数名は無視（EVALで空文字列が渡されることがある）
     if (functionName.empty()) {
-        std::cerr << "[VM::execute] WARNING: Empty function name, returning void" << std::endl;
+        YAYA_LOG(Warn, "[VM::execute] WARNING: Empty function name, returning void");
         return Value();
     }
+    return callFunction(internFunction(functionName), args);
+}
+
+Value VM::callFunction(int index, std::vector<Value> args) {
+    // 実行予算: トップレベルの呼び出しで初期化し、呼び出しごとに 1 消費する
+    if (recursion_depth_ == 0) resetBudget();
+    if (!tick()) return Value();
+
+    const FunctionEntry& entry = functionEntry(index);
+    const std::string& functionName = entry.name;
 
     // 再帰深度チェック（無限ループ防止）
     recursion_depth_++;
     if (recursion_depth_ > MAX_RECURSION_DEPTH) {
-        std::cerr << "[VM::execute] ERROR: Maximum recursion depth (" << MAX_RECURSION_DEPTH
-                  << ") exceeded while calling: " << functionName << std::endl;
+        YAYA_LOG(Error, "[VM::execute] ERROR: Maximum recursion depth (" << MAX_RECURSION_DEPTH
+                        << ") exceeded while calling: " << functionName);
         recursion_depth_--;
         return Value();
     }
 
     // 再帰深度が深い場合は警告（デバッグ用）
     if (recursion_depth_ > 100 && recursion_depth_ % 100 == 0) {
-        std::cerr << "[VM::execute] WARNING: Recursion depth is " << recursion_depth_
-                  << " while calling: " << functionName << std::endl;
+        YAYA_LOG(Warn, "[VM::execute] WARNING: Recursion depth is " << recursion_depth_
+                       << " while calling: " << functionName);
     }
 
     if (recursion_depth_ <= 2) {
-        std::cerr << "[VM::execute] [depth=" << recursion_depth_ << "] Looking for function: " << functionName << std::endl;
+        YAYA_LOG(Trace, "[VM::execute] [depth=" << recursion_depth_ << "] Looking for function: " << functionName);
     }
 
     // Check if it's a built-in function
-    if (builtins_.find(functionName) != builtins_.end()) {
-        Value result = callBuiltin(functionName, args);
+    if (entry.builtin) {
+        yaya_profile::Scope profile(profiler_, profiler_ ? profileKey(*functionTable_[index]) : -1);
+        Value result = (*entry.builtin)(args);
         recursion_depth_--;
         return result;
     }
 
     // Check if it's a user-defined function
-    auto it = functions_.find(functionName);
-    if (it == functions_.end() || it->second.empty()) {
-        std::cerr << "[VM::execute] WARNING: Function not found: \"" << functionName << "\", returning void" << std::endl;
+    if (!entry.defined) {
+        YAYA_LOG(Warn, "[VM::execute] WARNING: Function not found: \"" << functionName << "\", returning void");
         recursion_depth_--;
         return Value();
     }
 
-    // Gather enabled declarations in declaration order.
-    std::vector<const FunctionDecl*> active;
-    for (const auto& d : it->second) {
-        if (d.enabled) active.push_back(&d);
-    }
+    // Enabled declarations in declaration order (precomputed by functionEntry).
+    // 呼び出し中に関数表が作り直されても一覧が残るよう参照を持っておく
+    std::shared_ptr<const std::vector<const FunctionDecl*>> activeRef = entry.active;
+    const auto& active = *activeRef;
     if (active.empty()) {
-        std::cerr << "[VM::execute] WARNING: Function disabled: \"" << functionName << "\", returning void" << std::endl;
+        YAYA_LOG(Warn, "[VM::execute] WARNING: Function disabled: \"" << functionName << "\", returning void");
         recursion_depth_--;
         return Value();
     }
 
-    std::cerr << "[VM::execute] Found user function: " << functionName
-              << " (" << active.size() << " decl(s)), executing..." << std::endl;
-    auto exec_start = std::chrono::steady_clock::now();
+    YAYA_LOG(Trace, "[VM::execute] Found user function: " << functionName
+                    << " (" << active.size() << " decl(s)), executing...");
+    // 所要時間は Trace ログのときだけ測る
+    const bool traceCall = yaya_log::enabled(yaya_log::Level::Trace);
+    std::chrono::steady_clock::time_point exec_start;
+    if (traceCall) {
+        exec_start = std::chrono::steady_clock::now();
+    }
 
-    // トップレベル関数の場合、実行開始時刻を記録
     if (recursion_depth_ == 1) {
-        execution_start_time_ = exec_start;
+        completion_ = Completion::Normal;
     }
+    const int caller = currentFunction_;
+    currentFunction_ = index;
 
     // Push new local variable scope (YAYA: variables starting with '_' are function-local)
-    localScopes_.emplace_back();
-
-    // Set _argv / _argc for this function call (now goes to local scope)
-    std::vector<Value> argArray;
-    for (const auto& a : args) {
-        argArray.push_back(a);
+    {
+        if (localDepth_ == localScopes_.size()) localScopes_.emplace_back();
+        LocalFrame& frame = localScopes_[localDepth_++];
+        frame.layout = entry.layout;
+        frame.slots.resize(frame.layout->names.size());
+        // Set _argv / _argc for this function call (layout slots 0 / 1)
+        frame.slots[1] = Value(static_cast<int>(args.size()));
+        frame.slots[0] = Value(std::move(args));
     }
-    setVariable("_argv", Value(argArray));
-    setVariable("_argc", Value(static_cast<int>(args.size())));
 
     // Dispatch: nonoverload (or single declaration) runs only the first enabled
     // declaration. Otherwise (YAYA overload default) every declaration runs in
     // declaration order and their return values concatenate.
     Value result;
-    bool anyNonoverload = false;
-    for (const auto* d : active) { if (d->nonoverload) { anyNonoverload = true; break; } }
-
-    if (active.size() == 1 || anyNonoverload) {
+    if (active.size() == 1 || entry.anyNonoverload) {
         result = executeFunctionDecl(*active.front());
     } else {
         // Overload concatenation: gather each declaration's result.
         std::vector<Value> collected;
         for (const auto* d : active) {
             Value v = executeFunctionDecl(*d);
+            if (completion_ == Completion::Abort) break;
             if (!v.isVoid()) collected.push_back(v);
         }
         // Determine target type from the first declaration.
@@ -460,7 +648,7 @@ Value VM::execute(const std::string& functionName, const std::vector<Value>& arg
                     flat.push_back(v);
                 }
             }
-            result = Value(flat);
+            result = Value(std::move(flat));
         } else {
             std::string s;
             for (const auto& v : collected) s += v.asString();
@@ -468,41 +656,130 @@ Value VM::execute(const std::string& functionName, const std::vector<Value>& arg
         }
     }
 
-    // Pop local variable scope
-    localScopes_.pop_back();
+    // Pop local variable scope（フレームは次の呼び出しで再利用する）
+    {
+        LocalFrame& frame = localScopes_[--localDepth_];
+        frame.slots.clear();
+        frame.layout.reset();
+    }
 
-    auto exec_end = std::chrono::steady_clock::now();
-    auto exec_duration = std::chrono::duration_cast<std::chrono::milliseconds>(exec_end - exec_start).count();
-    std::cerr << "[VM::execute] Function execution complete: " << functionName << " (took " << exec_duration << "ms)";
-    if (recursion_depth_ <= 3) {
-        std::string rv = result.asString();
-        if (rv.size() > 100) rv = rv.substr(0, 100) + "...";
-        std::cerr << " => \"" << rv << "\"";
+    if (traceCall) {
+        auto exec_end = std::chrono::steady_clock::now();
+        auto exec_duration = std::chrono::duration_cast<std::chrono::milliseconds>(exec_end - exec_start).count();
+        std::string preview;
+        if (recursion_depth_ <= 3) {
+            preview = " => \"" + logPreview(result, 100) + "\"";
+        }
+        YAYA_LOG(Trace, "[VM::execute] Function execution complete: " << functionName
+                        << " (took " << exec_duration << "ms)" << preview);
     }
-    std::cerr << std::endl;
 
+    currentFunction_ = caller;
     recursion_depth_--;
+    // 予算切れで打ち切った呼び出しは途中までの結果を返さない
+    if (recursion_depth_ == 0 && budgetExhausted_) return Value();
     return result;
 }
 
+void VM::resetBudget() {
+    execution_start_time_ = std::chrono::steady_clock::now();
+    ticksUsed_ = 0;
+    ticksBatch_ = budget_ ? static_cast<int64_t>(std::min<uint64_t>(kBudgetCheckInterval, budget_ + 1))
+                          : kBudgetCheckInterval;
+    ticksToCheck_ = ticksBatch_;
+    budgetExhausted_ = false;
+    exhaustedIn_.clear();
+    completion_ = Completion::Normal;
+}
+
+bool VM::checkBudget() {
+    if (!budgetExhausted_) {
+        ticksUsed_ += static_cast<uint64_t>(ticksBatch_);
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - execution_start_time_).count();
+        bool overBudget = budget_ && ticksUsed_ > budget_;
+        if (!overBudget && elapsed <= MAX_EXECUTION_TIME_MS) {
+            // 次の確認は一定回数後、または上限を超える 1 回目
+            ticksBatch_ = budget_ ? static_cast<int64_t>(std::min<uint64_t>(kBudgetCheckInterval,
+                                                                             budget_ - ticksUsed_ + 1))
+                                  : kBudgetCheckInterval;
+            ticksToCheck_ = ticksBatch_;
+            return true;
+        }
+        budgetExhausted_ = true;
+        exhaustedIn_ = currentFunction_ >= 0 ? functionTable_[currentFunction_]->name : std::string();
+        if (overBudget) {
+            YAYA_LOG(Error, "[VM] ERROR: Execution budget (" << budget_ << ") exhausted in "
+                            << exhaustedIn_ << ". Aborting...");
+        } else {
+            YAYA_LOG(Error, "[VM] ERROR: Execution timeout (" << MAX_EXECUTION_TIME_MS
+                            << "ms) exceeded in " << exhaustedIn_ << ". Aborting...");
+        }
+    }
+    // 打ち切った後は毎回ここへ来て false を返す
+    ticksToCheck_ = 1;
+    completion_ = Completion::Abort;
+    return false;
+}
+
+// プロファイラ上のキー（関数名と辞書ファイル）。プロファイラが作り直されたら引き直す
+int VM::profileKey(const FunctionDecl& decl) {
+    if (decl.profileGeneration != profiler_->generation()) {
+        // 辞書ファイルはゴーストルートからの相対パスで表示する
+        std::string source;
+        auto sit = sourceNames_.find(decl.sourceId);
+        if (sit != sourceNames_.end()) {
+            source = sit->second;
+            if (!ghostRootPath_.empty() && source.compare(0, ghostRootPath_.size(), ghostRootPath_) == 0) {
+                source.erase(0, ghostRootPath_.size());
+                while (!source.empty() && source.front() == '/') source.erase(0, 1);
+            }
+        }
+        decl.profileKey = profiler_->key(yaya_profile::Kind::Function,
+                                         decl.node ? decl.node->name : std::string(), source);
+        decl.profileGeneration = profiler_->generation();
+    }
+    return decl.profileKey;
+}
+
+int VM::profileKey(FunctionEntry& entry) {
+    if (entry.profileGeneration != profiler_->generation()) {
+        entry.profileKey = profiler_->key(yaya_profile::Kind::Builtin, entry.name);
+        entry.profileGeneration = profiler_->generation();
+    }
+    return entry.profileKey;
+}
+
 // Execute one function declaration body honoring its type modifier
 // (array/sequential/void). Used both for direct and overload calls.
 Value VM::executeFunctionDecl(const FunctionDecl& decl) {
     if (!decl.node) return Value();
+    yaya_profile::Scope profile(profiler_, profiler_ ? profileKey(decl) : -1);
     const auto& body = decl.node->body;
     const std::string& ftype = decl.node->functionType;
 
     bool isArray = (ftype.find("array") != std::string::npos);
     bool isSequential = (ftype.find("sequential") != std::string::npos);
 
+    if (engine_ == Engine::Bytecode && !decl.bytecode) {
+        decl.bytecode = Bytecode::compile(*decl.node);
+    }
+
     if (isArray || isSequential) {
         std::vector<Value> collected;
-        try {
+        if (engine_ == Engine::Bytecode) {
+            runBytecode(*decl.bytecode, &collected);
+            if (completion_ == Completion::Return) {
+                collected.clear();
+                collected.push_back(std::move(returnValue_));
+            }
+        } else {
             for (const auto& stmt : body) {
                 // parallel 文: 式の返す配列を個々の候補として展開（1段フラット化）
                 if (stmt && stmt->type == AST::NodeType::Parallel) {
                     auto* par = dynamic_cast<AST::ParallelNode*>(stmt.get());
                     Value pv = executeNode(par->expr);
+                    if (completion_ == Completion::Abort) break;
                     if (pv.getType() == Value::Type::Array) {
                         for (const auto& elem : pv.asArray()) {
                             collected.push_back(elem);
@@ -513,18 +790,25 @@ Value VM::executeFunctionDecl(const FunctionDecl& decl) {
                     continue;
                 }
                 Value v = executeNode(stmt);
+                if (completion_ == Completion::Return) {
+                    collected.clear();
+                    collected.push_back(std::move(returnValue_));
+                    break;
+                }
+                if (completion_ != Completion::Normal) {
+                    // ループ外の break/continue は関数本体の終端として扱う（予算切れも同じく打ち切る）
+                    break;
+                }
                 if (stmt && stmt->type != AST::NodeType::Assignment && !v.isVoid()) {
                     collected.push_back(v);
                 }
             }
-        } catch (const ReturnException& ret) {
-            collected.clear();
-            collected.push_back(ret.value);
         }
+        if (completion_ != Completion::Abort) completion_ = Completion::Normal;
         // OUTPUTNUM() 用: この array/sequential 関数が収集した候補数を記録する。
         lastOutputNum_ = static_cast<int>(collected.size());
         if (isArray) {
-            return Value(collected);
+            return Value(std::move(collected));
         } else {
             std::string s;
             for (const auto& v : collected) s += v.asString();
@@ -532,12 +816,12 @@ Value VM::executeFunctionDecl(const FunctionDecl& decl) {
         }
     }
 
-    Value result;
-    try {
-        result = executeBlock(body);
-    } catch (const ReturnException& ret) {
-        result = ret.value;
+    Value result = (engine_ == Engine::Bytecode) ? runBytecode(*decl.bytecode, nullptr)
+                                                 : executeBlock(body);
+    if (completion_ == Completion::Return) {
+        result = std::move(returnValue_);
     }
+    if (completion_ != Completion::Abort) completion_ = Completion::Normal;
     if (ftype.find("void") != std::string::npos) {
         result = Value();
     }
@@ -547,27 +831,14 @@ Value VM::executeFunctionDecl(const FunctionDecl& decl) {
 }
 
 void VM::setVariable(const std::string& name, const Value& value) {
-    if (!name.empty() && name[0] == '_' && !localScopes_.empty()) {
-        localScopes_.back()[name] = value;
-    } else {
-        variables_[name] = value;
-    }
+    AST::VarSlot slot;
+    variableRef(name, slot) = value;
 }
 
 Value VM::getVariable(const std::string& name) const {
-    if (!name.empty() && name[0] == '_' && !localScopes_.empty()) {
-        auto& scope = localScopes_.back();
-        auto it = scope.find(name);
-        if (it != scope.end()) {
-            return it->second;
-        }
-        return Value();
-    }
-    auto it = variables_.find(name);
-    if (it != variables_.end()) {
-        return it->second;
-    }
-    return Value(); // Return void for undefined variables
+    AST::VarSlot slot;
+    const Value* v = findVariable(name, slot);
+    return v ? *v : Value(); // Return void for undefined variables
 }
 
 void VM::setReferences(const std::vector<std::string>& refs) {
@@ -590,57 +861,28 @@ bool VM::hasFunction(const std::string& name) const {
 Value VM::executeNode(std::shared_ptr<AST::Node> node) {
     if (!node) return Value();
 
-    // タイムアウトチェック（無限ループ防止）
-    if (recursion_depth_ > 0) { // トップレベル関数内でのみチェック
-        auto now = std::chrono::steady_clock::now();
-        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - execution_start_time_).count();
-        if (elapsed > MAX_EXECUTION_TIME_MS) {
-            std::cerr << "[VM::executeNode] ERROR: Execution timeout (" << MAX_EXECUTION_TIME_MS
-                      << "ms) exceeded. Aborting..." << std::endl;
-            return Value(); // 空のValueを返して処理を中断
-        }
-    }
-
     switch (node->type) {
         case AST::NodeType::Literal: {
             auto* lit = dynamic_cast<AST::LiteralNode*>(node.get());
             if (lit->isString) {
                 // Interpolate embedded expressions in string literals
-                std::string interpolated = interpolateString(lit->value);
-                return Value(interpolated);
-            } else {
-                try {
-                    const std::string& s = lit->value;
-                    // Support hex literals like 0xFF / 0Xff
-                    if (s.size() > 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
-                        // Parse hex (skip 0x prefix)
-                        int v = std::stoi(s.substr(2), nullptr, 16);
-                        return Value(v);
-                    }
-                    // Real literal: contains a decimal point
-                    if (s.find('.') != std::string::npos) {
-                        return Value(std::stod(s));
-                    }
-                    // Decimal fallback
-                    return Value(std::stoi(s, nullptr, 10));
-                } catch (...) {
-                    return Value(0);
+                // 埋め込み式は初回評価時にパースしてノードへキャッシュする
+                if (!lit->interpolation) {
+                    lit->interpolation = compileInterpolation(lit->value);
                 }
+                const auto& segments = *lit->interpolation;
+                if (segments.size() == 1 && segments[0].kind == AST::InterpolationSegment::Kind::Text) {
+                    return Value(segments[0].source);
+                }
+                return Value(renderInterpolation(segments));
+            } else {
+                return lit->number;
             }
         }
         
         case AST::NodeType::Variable: {
             auto* var = dynamic_cast<AST::VariableNode*>(node.get());
-            // First try as a variable
-            Value val = getVariable(var->name);
-            if (!val.isVoid()) {
-                return val;
-            }
-            // If variable doesn't exist, try as a function call (YAYA allows bare function names)
-            if (functions_.find(var->name) != functions_.end() || builtins_.find(var->name) != builtins_.end()) {
-                return execute(var->name, {});
-            }
-            return Value();
+            return loadVariable(*var);
         }
         
         case AST::NodeType::BinaryOp: {
@@ -669,10 +911,9 @@ Value VM::executeNode(std::shared_ptr<AST::Node> node) {
         case AST::NodeType::Assignment: {
             auto* assign = dynamic_cast<AST::AssignmentNode*>(node.get());
             auto value = executeNode(assign->value);
-            if (assign->variableName.find("SHIORI3FW") == 0) {
-                std::cerr << "[VM::assign] " << assign->variableName << " = \"" << value.asString().substr(0, 50) << "\"" << std::endl;
-            }
-            setVariable(assign->variableName, value);
+            // 右辺の途中で予算が尽きたら代入しない
+            if (completion_ == Completion::Abort) return Value();
+            assignVariable(*assign, value);
             return value;
         }
         
@@ -707,14 +948,20 @@ Value VM::executeNode(std::shared_ptr<AST::Node> node) {
         case AST::NodeType::While: {
             auto* whileNode = dynamic_cast<AST::WhileNode*>(node.get());
             Value result;
-            while (executeNode(whileNode->condition).toBool()) {
-                try {
-                    result = executeBlock(whileNode->body);
-                } catch (const ContinueException&) {
+            while (tick() && executeNode(whileNode->condition).toBool()) {
+                Value v = executeBlock(whileNode->body);
+                if (completion_ == Completion::Continue) {
+                    completion_ = Completion::Normal;
                     continue;
-                } catch (const BreakException&) {
+                }
+                if (completion_ == Completion::Break) {
+                    completion_ = Completion::Normal;
+                    break;
+                }
+                if (completion_ == Completion::Return || completion_ == Completion::Abort) {
                     break;
                 }
+                result = std::move(v);
             }
             return result;
         }
@@ -725,13 +972,18 @@ Value VM::executeNode(std::shared_ptr<AST::Node> node) {
             // Run the initializer once.
             if (forNode->init) executeNode(forNode->init);
             // Missing condition is treated as always true.
-            while (!forNode->cond || executeNode(forNode->cond).toBool()) {
-                try {
-                    result = executeBlock(forNode->body);
-                } catch (const ContinueException&) {
+            while (tick() && (!forNode->cond || executeNode(forNode->cond).toBool())) {
+                Value v = executeBlock(forNode->body);
+                if (completion_ == Completion::Continue) {
                     // fall through to increment
-                } catch (const BreakException&) {
+                    completion_ = Completion::Normal;
+                } else if (completion_ == Completion::Break) {
+                    completion_ = Completion::Normal;
+                    break;
+                } else if (completion_ == Completion::Return || completion_ == Completion::Abort) {
                     break;
+                } else {
+                    result = std::move(v);
                 }
                 if (forNode->incr) executeNode(forNode->incr);
             }
@@ -747,33 +999,42 @@ Value VM::executeNode(std::shared_ptr<AST::Node> node) {
                 // Snapshot elements so mutation of the source array mid-loop is safe.
                 std::vector<Value> elems(arr.begin(), arr.end());
                 for (const auto& elem : elems) {
-                    setVariable(feNode->varName, elem);
-                    try {
-                        result = executeBlock(feNode->body);
-                    } catch (const ContinueException&) {
+                    if (!tick()) break;
+                    variableRef(feNode->varName, feNode->slot) = elem;
+                    Value v = executeBlock(feNode->body);
+                    if (completion_ == Completion::Continue) {
+                        completion_ = Completion::Normal;
                         continue;
-                    } catch (const BreakException&) {
+                    }
+                    if (completion_ == Completion::Break) {
+                        completion_ = Completion::Normal;
                         break;
                     }
+                    if (completion_ == Completion::Return || completion_ == Completion::Abort) {
+                        break;
+                    }
+                    result = std::move(v);
                 }
             }
             return result;
         }
         
         case AST::NodeType::Call: {
-            auto* call = dynamic_cast<AST::CallNode*>(node.get());
-            
+            auto* call = static_cast<AST::CallNode*>(node.get());
+            // パーサが生成する内部関数（代入・添字など）はノード生成時に判別済みの kind で分岐する
+            const AST::CallKind kind = call->kind;
+
             // Handle special array operations
-            if (call->functionName == "__array_literal__") {
+            if (kind == AST::CallKind::ArrayLiteral) {
                 // Create an array from the arguments
                 std::vector<Value> elements;
                 for (const auto& argNode : call->arguments) {
                     elements.push_back(executeNode(argNode));
                 }
-                return Value(elements);
+                return Value(std::move(elements));
             }
             
-            if (call->functionName == "__array_concat_assign__") {
+            if (kind == AST::CallKind::ArrayConcatAssign) {
                 // Array concatenation assignment: var ,= value
                 if (call->arguments.size() >= 2) {
                     auto* varNode = dynamic_cast<AST::VariableNode*>(call->arguments[0].get());
@@ -797,33 +1058,18 @@ Value VM::executeNode(std::shared_ptr<AST::Node> node) {
 
             // Range/slice: __range__(base, start, length)
             // YAYA syntax: str[start, length] or array[start, count]
-            if (call->functionName == "__range__") {
+            if (kind == AST::CallKind::Range) {
                 if (call->arguments.size() == 3) {
                     Value base = executeNode(call->arguments[0]);
                     int start = executeNode(call->arguments[1]).asInt();
                     int len   = executeNode(call->arguments[2]).asInt();
-
-                    if (base.getType() == Value::Type::String) {
-                        std::string s = base.asString();
-                        if (start < 0) start = 0;
-                        if (start >= static_cast<int>(s.size())) return Value(std::string(""));
-                        if (len < 0) len = 0;
-                        return Value(s.substr(start, len));
-                    }
-                    if (base.getType() == Value::Type::Array) {
-                        const auto& arr = base.asArray();
-                        std::vector<Value> sub;
-                        for (int i = start; i < start + len && i < static_cast<int>(arr.size()); i++) {
-                            if (i >= 0) sub.push_back(arr[i]);
-                        }
-                        return Value(sub);
-                    }
+                    return sliceValue(base, start, len);
                 }
                 return Value();
             }
 
             // Generic indexing on any expression: __index__(base, index)
-            if (call->functionName == "__index__") {
+            if (kind == AST::CallKind::Index) {
                 if (call->arguments.size() == 2) {
                     Value base = executeNode(call->arguments[0]);
                     Value idxV = executeNode(call->arguments[1]);
@@ -850,70 +1096,62 @@ Value VM::executeNode(std::shared_ptr<AST::Node> node) {
             
             // Increment / decrement: __postinc__, __postdec__, __preinc__, __predec__
             // Mutate the operand variable and return the appropriate value.
-            static const std::set<std::string> incdecOps = {
-                "__postinc__", "__postdec__", "__preinc__", "__predec__"
-            };
-            if (incdecOps.count(call->functionName) && call->arguments.size() == 1) {
+            const bool isIncDec = kind == AST::CallKind::PostInc || kind == AST::CallKind::PostDec ||
+                                  kind == AST::CallKind::PreInc || kind == AST::CallKind::PreDec;
+            if (isIncDec && call->arguments.size() == 1) {
                 // Operand must be a plain variable to mutate; otherwise safe no-op.
                 auto* var = dynamic_cast<AST::VariableNode*>(call->arguments[0].get());
                 if (!var) {
                     return executeNode(call->arguments[0]);
                 }
-                Value preVal = getVariable(var->name);
-                int delta = (call->functionName == "__postinc__" ||
-                             call->functionName == "__preinc__") ? 1 : -1;
-                Value newVal = evaluateBinaryOp("+", preVal, Value(delta));
-                setVariable(var->name, newVal);
-                bool isPost = (call->functionName == "__postinc__" ||
-                               call->functionName == "__postdec__");
-                return isPost ? preVal : newVal;
+                int delta = (kind == AST::CallKind::PostInc || kind == AST::CallKind::PreInc) ? 1 : -1;
+                bool isPost = (kind == AST::CallKind::PostInc || kind == AST::CallKind::PostDec);
+                return incDecVariable(*var, delta, isPost);
             }
 
             // Assignment operators: __assign__, __plus_assign__, etc.
-            static const std::set<std::string> assignOps = {
-                "__assign__", "__plus_assign__", "__minus_assign__",
-                "__star_assign__", "__slash_assign__", "__percent_assign__",
-                "__concat_assign__"
-            };
-            if (assignOps.count(call->functionName) &&
-                call->arguments.size() == 2) {
+            const bool isAssign = kind >= AST::CallKind::Assign && kind <= AST::CallKind::ConcatAssign;
+            if (isAssign && call->arguments.size() == 2) {
                 auto rhs = executeNode(call->arguments[1]);
 
-                // Determine target variable name from LHS AST node
+                // Determine target variable name (and its slot cache) from LHS AST node
                 std::string varName;
+                AST::VarSlot* slot = nullptr;
                 int arrayIdx = -1;
                 if (auto* var = dynamic_cast<AST::VariableNode*>(call->arguments[0].get())) {
                     varName = var->name;
+                    slot = &var->slot;
                 } else if (auto* acc = dynamic_cast<AST::ArrayAccessNode*>(call->arguments[0].get())) {
                     varName = acc->arrayName;
+                    slot = &acc->slot;
                     arrayIdx = executeNode(acc->index).asInt();
                 }
 
                 if (!varName.empty()) {
-                    if (call->functionName == "__assign__") {
+                    if (kind == AST::CallKind::Assign) {
                         if (arrayIdx >= 0) {
-                            Value arr = getVariable(varName);
-                            arr.arraySet(arrayIdx, rhs);
-                            setVariable(varName, arr);
+                            // 要素代入はスロット上の配列をその場で更新する
+                            variableRef(varName, *slot).arraySet(arrayIdx, rhs);
                         } else {
-                            setVariable(varName, rhs);
+                            variableRef(varName, *slot) = rhs;
                         }
                         return rhs;
                     }
                     // Compound assignments
-                    Value current = (arrayIdx >= 0) ? getVariable(varName).arrayGet(arrayIdx) : getVariable(varName);
+                    const Value* curVar = findVariable(varName, *slot);
+                    Value current = !curVar ? Value() : (arrayIdx >= 0) ? curVar->arrayGet(arrayIdx) : *curVar;
                     Value result;
-                    if (call->functionName == "__plus_assign__") {
-                        result = evaluateBinaryOp("+", current, rhs);
-                    } else if (call->functionName == "__minus_assign__") {
-                        result = evaluateBinaryOp("-", current, rhs);
-                    } else if (call->functionName == "__star_assign__") {
-                        result = evaluateBinaryOp("*", current, rhs);
-                    } else if (call->functionName == "__slash_assign__") {
-                        result = evaluateBinaryOp("/", current, rhs);
-                    } else if (call->functionName == "__percent_assign__") {
-                        result = evaluateBinaryOp("%", current, rhs);
-                    } else if (call->functionName == "__concat_assign__") {
+                    if (kind == AST::CallKind::PlusAssign) {
+                        result = evaluateBinaryOp(AST::BinaryOperator::Add, current, rhs);
+                    } else if (kind == AST::CallKind::MinusAssign) {
+                        result = evaluateBinaryOp(AST::BinaryOperator::Sub, current, rhs);
+                    } else if (kind == AST::CallKind::StarAssign) {
+                        result = evaluateBinaryOp(AST::BinaryOperator::Mul, current, rhs);
+                    } else if (kind == AST::CallKind::SlashAssign) {
+                        result = evaluateBinaryOp(AST::BinaryOperator::Div, current, rhs);
+                    } else if (kind == AST::CallKind::PercentAssign) {
+                        result = evaluateBinaryOp(AST::BinaryOperator::Mod, current, rhs);
+                    } else if (kind == AST::CallKind::ConcatAssign) {
                         // YAYA ,= operator: array append or string concat
                         if (current.getType() == Value::Type::Array) {
                             current.arrayConcat(rhs);
@@ -925,11 +1163,9 @@ Value VM::executeNode(std::shared_ptr<AST::Node> node) {
                         result = rhs;
                     }
                     if (arrayIdx >= 0) {
-                        Value arr = getVariable(varName);
-                        arr.arraySet(arrayIdx, result);
-                        setVariable(varName, arr);
+                        variableRef(varName, *slot).arraySet(arrayIdx, result);
                     } else {
-                        setVariable(varName, result);
+                        variableRef(varName, *slot) = result;
                     }
                     return result;
                 }
@@ -938,7 +1174,7 @@ Value VM::executeNode(std::shared_ptr<AST::Node> node) {
 
             // E.Swap(&a, &b): YAYA の参照渡し（&）で2つの変数/配列要素を in-place 交換する。
             // 両引数が前置 '&' の参照であれば元の格納場所へ書き戻す。E.Swap は void。
-            if (call->functionName == "E.Swap" && call->arguments.size() == 2) {
+            if (kind == AST::CallKind::Swap && call->arguments.size() == 2) {
                 auto refA = tryResolveReference(call->arguments[0]);
                 auto refB = tryResolveReference(call->arguments[1]);
                 if (refA && refB) {
@@ -950,34 +1186,22 @@ Value VM::executeNode(std::shared_ptr<AST::Node> node) {
                 return Value();
             }
 
-            // Regular function call
+            // Regular function call（呼び出し先は関数表の番号でキャッシュ済み）
             std::vector<Value> args;
+            args.reserve(call->arguments.size());
             for (const auto& argNode : call->arguments) {
                 args.push_back(executeNode(argNode));
             }
-            return execute(call->functionName, args);
+            if (call->functionName.empty()) {
+                return execute(call->functionName, args);
+            }
+            return callFunction(resolveFunction(call->functionName, call->target), std::move(args));
         }
         
         case AST::NodeType::ArrayAccess: {
             auto* access = dynamic_cast<AST::ArrayAccessNode*>(node.get());
             auto indexVal = executeNode(access->index);
-            int index = indexVal.asInt();
-            
-            // Special case for "reference" array (SHIORI references)
-            if (access->arrayName == "reference") {
-                if (index >= 0 && index < static_cast<int>(references_.size())) {
-                    return references_[index];
-                }
-                return Value();
-            }
-            
-            // For other arrays, get from variables
-            Value arrayVar = getVariable(access->arrayName);
-            if (arrayVar.getType() == Value::Type::Array) {
-                return arrayVar.arrayGet(index);
-            }
-            
-            return Value();
+            return loadArrayElement(*access, indexVal.asInt());
         }
         
         case AST::NodeType::Switch: {
@@ -1000,7 +1224,19 @@ Value VM::executeNode(std::shared_ptr<AST::Node> node) {
             auto* caseNode = dynamic_cast<AST::CaseNode*>(node.get());
             Value testValue = executeNode(caseNode->expression);
 
-            for (const auto& clause : caseNode->whenClauses) {
+            // リテラルの when 句は索引で引き、外れたら残りの句だけを順に比較する
+            size_t first = 0;
+            const AST::CaseTable& table = AST::caseTable(*caseNode);
+            if (!table.index.empty() && AST::caseIndexable(testValue)) {
+                auto it = table.index.find(testValue.asString());
+                if (it != table.index.end()) {
+                    return executeBlock(caseNode->whenClauses[it->second]->body);
+                }
+                first = table.hashedClauses;
+            }
+
+            for (size_t i = first; i < caseNode->whenClauses.size(); ++i) {
+                const auto& clause = caseNode->whenClauses[i];
                 bool matched = false;
                 for (const auto& mv : clause->matchValues) {
                     Value mvValue = executeNode(mv);
@@ -1036,7 +1272,9 @@ Value VM::executeNode(std::shared_ptr<AST::Node> node) {
         case AST::NodeType::Return: {
             auto* returnNode = dynamic_cast<AST::ReturnNode*>(node.get());
             Value returnValue = returnNode->value ? executeNode(returnNode->value) : Value();
-            throw ReturnException(returnValue);
+            returnValue_ = std::move(returnValue);
+            completion_ = Completion::Return;
+            return Value();
         }
         
         case AST::NodeType::Block: {
@@ -1045,13 +1283,15 @@ Value VM::executeNode(std::shared_ptr<AST::Node> node) {
         }
 
         case AST::NodeType::Break: {
-            // Unwind to the nearest enclosing loop (caught in While/For/Foreach).
-            throw BreakException();
+            // Unwind to the nearest enclosing loop (consumed in While/For/Foreach).
+            completion_ = Completion::Break;
+            return Value();
         }
 
         case AST::NodeType::Continue: {
             // Skip to the next iteration of the nearest enclosing loop.
-            throw ContinueException();
+            completion_ = Completion::Continue;
+            return Value();
         }
         
         default:
@@ -1063,6 +1303,10 @@ Value VM::executeBlock(const std::vector<std::shared_ptr<AST::Node>>& statements
     Value lastValue;
     for (const auto& stmt : statements) {
         Value v = executeNode(stmt);
+        // return/break/continue・予算切れ: 残りの文は実行しない
+        if (completion_ != Completion::Normal) {
+            return lastValue;
+        }
         // 代入文は出力候補にならない（本家YAYA準拠）。副作用のみ実行し、
         // ブロックの値には反映しない（if の分岐値として配列代入が漏れるのを防ぐ）
         if (stmt && stmt->type != AST::NodeType::Assignment) {
@@ -1072,61 +1316,133 @@ Value VM::executeBlock(const std::vector<std::shared_ptr<AST::Node>>& statements
     return lastValue;
 }
 
-Value VM::evaluateBinaryOp(const std::string& op, const Value& left, const Value& right) {
-    if (op == "+") return left + right;
-    if (op == "-") return left - right;
-    if (op == "*") return left * right;
-    if (op == "/") return left / right;
-    if (op == "%") return left % right;
-    if (op == "==") return Value(left == right ? 1 : 0);
-    if (op == "!=") return Value(left != right ? 1 : 0);
-    if (op == "<") return Value(left < right ? 1 : 0);
-    if (op == ">") return Value(left > right ? 1 : 0);
-    if (op == "<=") return Value(left <= right ? 1 : 0);
-    if (op == ">=") return Value(left >= right ? 1 : 0);
-    if (op == "&&") return Value(left.toBool() && right.toBool() ? 1 : 0);
-    if (op == "||") return Value(left.toBool() || right.toBool() ? 1 : 0);
-    // '&' is integer bitwise-AND (per Ourin/YAYA spec: BitwiseAnd)
-    if (op == "&") return Value(left.asInt() & right.asInt());
-    if (op == "_in_") {
-        // String contains check: "substring" _in_ "full string"
-        // or array contains check: "value" _in_ array
-        if (right.getType() == Value::Type::Array) {
-            // Check if left is in array right
-            const auto& arr = right.asArray();
-            for (const auto& elem : arr) {
-                if (elem == left) {
-                    return Value(1);
+Value VM::sliceValue(const Value& base, int start, int len) {
+    if (base.getType() == Value::Type::String) {
+        std::string s = base.asString();
+        if (start < 0) start = 0;
+        if (start >= static_cast<int>(s.size())) return Value(std::string(""));
+        if (len < 0) len = 0;
+        return Value(s.substr(start, len));
+    }
+    if (base.getType() == Value::Type::Array) {
+        const auto& arr = base.asArray();
+        std::vector<Value> sub;
+        for (int i = start; i < start + len && i < static_cast<int>(arr.size()); i++) {
+            if (i >= 0) sub.push_back(arr[i]);
+        }
+        return Value(sub);
+    }
+    return Value();
+}
+
+Value VM::loadVariable(AST::VariableNode& var) {
+    // First try as a variable
+    const Value* val = findVariable(var.name, var.slot);
+    if (val && !val->isVoid()) {
+        return *val;
+    }
+    // If variable doesn't exist, try as a function call (YAYA allows bare function names)
+    if (var.name.empty()) return Value();
+    int fn = resolveFunction(var.name, var.function);
+    const FunctionEntry& entry = functionEntry(fn);
+    if (entry.defined || entry.builtin) {
+        return callFunction(fn, {});
+    }
+    return Value();
+}
+
+Value VM::loadArrayElement(AST::ArrayAccessNode& access, int index) {
+    // Special case for "reference" array (SHIORI references)
+    if (access.arrayName == "reference") {
+        if (index >= 0 && index < static_cast<int>(references_.size())) {
+            return references_[index];
+        }
+        return Value();
+    }
+
+    // For other arrays, get from variables (read in place; no array copy)
+    const Value* arrayVar = findVariable(access.arrayName, access.slot);
+    if (arrayVar && arrayVar->getType() == Value::Type::Array) {
+        return arrayVar->arrayGet(index);
+    }
+
+    return Value();
+}
+
+void VM::assignVariable(AST::AssignmentNode& assign, const Value& value) {
+    if (assign.variableName.find("SHIORI3FW") == 0) {
+        YAYA_LOG(Trace, "[VM::assign] " << assign.variableName << " = \"" << logPreview(value, 50) << "\"");
+    }
+    variableRef(assign.variableName, assign.slot) = value;
+}
+
+Value VM::incDecVariable(AST::VariableNode& var, int delta, bool isPost) {
+    const Value* cur = findVariable(var.name, var.slot);
+    Value preVal = cur ? *cur : Value();
+    Value newVal = evaluateBinaryOp(AST::BinaryOperator::Add, preVal, Value(delta));
+    variableRef(var.name, var.slot) = newVal;
+    return isPost ? preVal : newVal;
+}
+
+Value VM::evaluateBinaryOp(AST::BinaryOperator op, const Value& left, const Value& right) {
+    using Op = AST::BinaryOperator;
+    switch (op) {
+        case Op::Add: return left + right;
+        case Op::Sub: return left - right;
+        case Op::Mul: return left * right;
+        case Op::Div: return left / right;
+        case Op::Mod: return left % right;
+        case Op::Eq: return Value(left == right ? 1 : 0);
+        case Op::Ne: return Value(left != right ? 1 : 0);
+        case Op::Lt: return Value(left < right ? 1 : 0);
+        case Op::Gt: return Value(left > right ? 1 : 0);
+        case Op::Le: return Value(left <= right ? 1 : 0);
+        case Op::Ge: return Value(left >= right ? 1 : 0);
+        case Op::LogicalAnd: return Value(left.toBool() && right.toBool() ? 1 : 0);
+        case Op::LogicalOr: return Value(left.toBool() || right.toBool() ? 1 : 0);
+        // '&' is integer bitwise-AND (per Ourin/YAYA spec: BitwiseAnd)
+        case Op::BitAnd: return Value(left.asInt() & right.asInt());
+        case Op::In:
+            // String contains check: "substring" _in_ "full string"
+            // or array contains check: "value" _in_ array
+            if (right.getType() == Value::Type::Array) {
+                // Check if left is in array right
+                const auto& arr = right.asArray();
+                for (const auto& elem : arr) {
+                    if (elem == left) {
+                        return Value(1);
+                    }
                 }
+                return Value(0);
+            } else {
+                // String contains check
+                std::string haystack = right.asString();
+                std::string needle = left.asString();
+                return Value(haystack.find(needle) != std::string::npos ? 1 : 0);
             }
-            return Value(0);
-        } else {
-            // String contains check
-            std::string haystack = right.asString();
-            std::string needle = left.asString();
-            return Value(haystack.find(needle) != std::string::npos ? 1 : 0);
-        }
     }
     return Value();
 }
 
-Value VM::evaluateUnaryOp(const std::string& op, const Value& operand) {
-    if (op == "!") return Value(!operand.toBool() ? 1 : 0);
-    if (op == "-") {
-        if (operand.isReal()) return Value(-operand.asReal());
-        return Value(-operand.asInt());
-    }
-    // 前置 '&'（YAYA 参照演算子）: 汎用フォールバック。
-    // 真の参照渡しは Call サイトで tryResolveReference 経由で解決し、参照を取る
-    // ビルトイン（E.Swap 等）が in-place で格納場所へ書き戻す。ここに到達するのは
-    // 「参照を受け取らない関数へ &x を渡した」等のケースで、値渡し（恒等）が正しい挙動。
-    if (op == "&") return operand;
+Value VM::evaluateUnaryOp(AST::UnaryOperator op, const Value& operand) {
+    using Op = AST::UnaryOperator;
+    switch (op) {
+        case Op::Not: return Value(!operand.toBool() ? 1 : 0);
+        case Op::Negate:
+            if (operand.isReal()) return Value(-operand.asReal());
+            return Value(-operand.asInt());
+        // 前置 '&'（YAYA 参照演算子）: 汎用フォールバック。
+        // 真の参照渡しは Call サイトで tryResolveReference 経由で解決し、参照を取る
+        // ビルトイン（E.Swap 等）が in-place で格納場所へ書き戻す。ここに到達するのは
+        // 「参照を受け取らない関数へ &x を渡した」等のケースで、値渡し（恒等）が正しい挙動。
+        case Op::Reference: return operand;
+    }
     return Value();
 }
 
 std::optional<VM::RefTarget> VM::tryResolveReference(std::shared_ptr<AST::Node> node) {
     auto* unary = dynamic_cast<AST::UnaryOpNode*>(node.get());
-    if (!unary || unary->op != "&") return std::nullopt;
+    if (!unary || unary->op != AST::UnaryOperator::Reference) return std::nullopt;
     const auto& operand = unary->operand;
     if (auto* var = dynamic_cast<AST::VariableNode*>(operand.get())) {
         return RefTarget{ var->name, false, 0 };
@@ -1187,7 +1503,7 @@ void VM::registerBuiltins() {
     // STRLEN(str) - 文字列の長さ（UTF-8 コードポイント数）を返す
     builtins_["STRLEN"] = [](const std::vector<Value>& args) -> Value {
         if (args.empty()) return Value(0);
-        return Value(static_cast<int>(utf8Length(args[0].asString())));
+        return Value(static_cast<int>(text_scan::utf8Length(args[0].asString())));
     };
     
     // STRFORM(format, ...) - printf 風の書式整形
@@ -1223,7 +1539,8 @@ void VM::registerBuiltins() {
     builtins_["ISVAR"] = [this](const std::vector<Value>& args) -> Value {
         if (args.empty()) return Value(0);
         std::string varName = args[0].asString();
-        return Value(variables_.find(varName) != variables_.end() ? 1 : 0);
+        auto it = globalIndex_.find(varName);
+        return Value(it != globalIndex_.end() && globals_[it->second].defined ? 1 : 0);
     };
     
     // ISFUNC(funcname) - Check if function exists
@@ -1298,10 +1615,10 @@ void VM::registerBuiltins() {
             Value result;
             for (const auto& fn : functions) {
                 if (fn && fn->name == "__eval_expr__") {
-                    try {
-                        result = executeBlock(fn->body);
-                    } catch (const ReturnException& ret) {
-                        result = ret.value;
+                    result = executeBlock(fn->body);
+                    if (completion_ == Completion::Return) {
+                        result = std::move(returnValue_);
+                        completion_ = Completion::Normal;
                     }
                     break;
                 }
@@ -1309,7 +1626,7 @@ void VM::registerBuiltins() {
             return result;
         } catch (const std::exception& e) {
             // If parsing fails, might be an undefined function - return void
-            std::cerr << "[EVAL] Failed to evaluate: \"" << firstArg << "\" - " << e.what() << std::endl;
+            YAYA_LOG(Warn, "[EVAL] Failed to evaluate: \"" << firstArg << "\" - " << e.what());
             return Value();
         }
     };
@@ -1461,16 +1778,16 @@ void VM::registerBuiltins() {
         int result = (pos == std::string::npos ? -1 : static_cast<int>(pos));
 
         // Debug logging for troubleshooting infinite loops
-        static int call_count = 0;
-        call_count++;
-        if (call_count <= 20 || call_count % 10 == 0) {
+        static std::atomic<int> call_counter{0};
+        int call_count = ++call_counter;
+        if ((call_count <= 20 || call_count % 10 == 0) && yaya_log::enabled(yaya_log::Level::Trace)) {
             std::string hay_preview = haystack.length() > 50 ?
                 haystack.substr(0, 47) + "..." : haystack;
-            std::cerr << "[STRSTR #" << call_count << "] "
-                      << "haystack=\"" << hay_preview << "\" (len=" << haystack.length() << ")"
-                      << ", needle=\"" << needle << "\""
-                      << ", start=" << start
-                      << " => " << result << std::endl;
+            YAYA_LOG(Trace, "[STRSTR #" << call_count << "] "
+                            << "haystack=\"" << hay_preview << "\" (len=" << haystack.length() << ")"
+                            << ", needle=\"" << needle << "\""
+                            << ", start=" << start
+                            << " => " << result);
         }
 
         return Value(result);
@@ -1710,8 +2027,8 @@ void VM::registerBuiltins() {
         // Optional third parameter: max number of splits (0 = unlimited)
         int maxSplits = (args.size() >= 3) ? args[2].asInt() : 0;
 
-        static int split_call_count = 0;
-        split_call_count++;
+        static std::atomic<int> split_call_counter{0};
+        int split_call_count = ++split_call_counter;
 
         std::vector<Value> result;
         if (delim.empty()) {
@@ -1736,9 +2053,9 @@ void VM::registerBuiltins() {
                 if (maxSplits > 0 && splitCount >= maxSplits - 1) {
                     result.push_back(Value(str.substr(pos)));
                     if (split_call_count <= 5 || split_call_count % 10 == 0) {
-                        std::cerr << "[SPLIT #" << split_call_count << "] "
-                                  << "str=\"" << str << "\", delim=\"" << delim << "\", maxSplits=" << maxSplits
-                                  << " => [" << result.size() << " elements, early return]" << std::endl;
+                        YAYA_LOG(Trace, "[SPLIT #" << split_call_count << "] "
+                                        << "str=\"" << str << "\", delim=\"" << delim << "\", maxSplits=" << maxSplits
+                                        << " => [" << result.size() << " elements, early return]");
                     }
                     return Value(result);
                 }
@@ -1748,65 +2065,41 @@ void VM::registerBuiltins() {
         }
 
         if (split_call_count <= 5 || split_call_count % 10 == 0) {
-            std::cerr << "[SPLIT #" << split_call_count << "] "
-                      << "str=\"" << str << "\", delim=\"" << delim << "\", maxSplits=" << maxSplits
-                      << " => [" << result.size() << " elements]" << std::endl;
+            YAYA_LOG(Trace, "[SPLIT #" << split_call_count << "] "
+                            << "str=\"" << str << "\", delim=\"" << delim << "\", maxSplits=" << maxSplits
+                            << " => [" << result.size() << " elements]");
         }
 
         return Value(result);
     };
     
     // ASEARCH(array, value) - Search array for value, return index (-1 if not found)
-    builtins_["ASEARCH"] = [](const std::vector<Value>& args) -> Value {
+    // 繰り返し検索される配列は arraySearch_ が索引を作って引く
+    builtins_["ASEARCH"] = [this](const std::vector<Value>& args) -> Value {
         if (args.size() < 2) return Value(-1);
         if (args[0].getType() != Value::Type::Array) return Value(-1);
-        
-        const auto& arr = args[0].asArray();
-        const Value& searchVal = args[1];
-        
-        for (size_t i = 0; i < arr.size(); i++) {
-            if (arr[i] == searchVal) {
-                return Value(static_cast<int>(i));
-            }
-        }
-        return Value(-1);
+        return Value(arraySearch_.find(args[0], args[1]));
     };
     
-    // ASORT(array) - Sort array (simplified - sorts as strings)
+    // ASORT(array[, options]) / ASORT(options, array) - Sort array
+    // options: "string"（既定）/ "int" / "real" / "length" と "ascend" / "descend" のカンマ区切り
     builtins_["ASORT"] = [](const std::vector<Value>& args) -> Value {
         if (args.empty()) return Value(std::vector<Value>());
-        if (args[0].getType() != Value::Type::Array) return args[0];
-        
-        std::vector<Value> result = args[0].asArray();
-        std::sort(result.begin(), result.end(), [](const Value& a, const Value& b) {
-            return a.asString() < b.asString();
-        });
-        
-        return Value(result);
+        if (args[0].getType() != Value::Type::Array) {
+            if (args.size() >= 2 && args[1].getType() == Value::Type::Array) {
+                return Value(array_ops::sort(args[1].asArray(), args[0].asString()));
+            }
+            return args[0];
+        }
+        std::string options = args.size() >= 2 ? args[1].asString() : std::string();
+        return Value(array_ops::sort(args[0].asArray(), options));
     };
     
     // ARRAYDEDUP(array) - Remove duplicates from array
     builtins_["ARRAYDEDUP"] = [](const std::vector<Value>& args) -> Value {
         if (args.empty()) return Value(std::vector<Value>());
         if (args[0].getType() != Value::Type::Array) return args[0];
-        
-        const auto& arr = args[0].asArray();
-        std::vector<Value> result;
-        
-        for (const auto& val : arr) {
-            bool found = false;
-            for (const auto& existing : result) {
-                if (existing == val) {
-                    found = true;
-                    break;
-                }
-            }
-            if (!found) {
-                result.push_back(val);
-            }
-        }
-        
-        return Value(result);
+        return Value(array_ops::dedup(args[0].asArray()));
     };
     
     // ANY(array) - Return random element from array
@@ -1962,9 +2255,12 @@ void VM::registerBuiltins() {
     builtins_["ERASEVAR"] = [this](const std::vector<Value>& args) -> Value {
         if (args.empty()) return Value(0);
         std::string varName = args[0].asString();
-        auto it = variables_.find(varName);
-        if (it != variables_.end()) {
-            variables_.erase(it);
+        auto it = globalIndex_.find(varName);
+        if (it != globalIndex_.end() && globals_[it->second].defined) {
+            // スロットは残して未定義に戻す（解決済みノードのキャッシュを保つため）
+            globals_[it->second].defined = false;
+            globals_[it->second].value = Value();
+            globals_[it->second].dirty = true;
             return Value(1);
         }
         return Value(0);
@@ -1993,7 +2289,8 @@ void VM::registerBuiltins() {
     builtins_["GETVARLIST"] = [this](const std::vector<Value>& args) -> Value {
         (void)args;
         std::vector<Value> result;
-        for (const auto& pair : variables_) {
+        for (const auto& pair : globalIndex_) {
+            if (!globals_[pair.second].defined) continue;
             result.push_back(Value(pair.first));
         }
         return Value(result);
@@ -2037,10 +2334,7 @@ void VM::registerBuiltins() {
     // File operations restricted to ghost directory for security
     // File handles stored in a map for management
     
-    // File handle management (shared between file operation functions)
-    static std::map<int, std::unique_ptr<std::fstream>> fileHandles;
-    static int nextHandle = 1;
-    static std::string ghostBasePath; // Will be set when ghost loads
+    // File handle management (shared between file operation functions; per VM instance)
     
     // Helper to validate path is within ghost directory
     auto isPathSafe = [](const std::string& path) -> bool {
@@ -2052,7 +2346,7 @@ void VM::registerBuiltins() {
     };
     
     // FOPEN(filename, mode) - Open file
-    builtins_["FOPEN"] = [](const std::vector<Value>& args) -> Value {
+    builtins_["FOPEN"] = [this](const std::vector<Value>& args) -> Value {
         if (args.size() < 2) return Value(-1);
         std::string filename = args[0].asString();
         std::string mode = args[1].asString();
@@ -2075,8 +2369,8 @@ void VM::registerBuiltins() {
                 return Value(-1);
             }
             
-            int handle = nextHandle++;
-            fileHandles[handle] = std::move(file);
+            int handle = nextFileHandle_++;
+            fileHandles_[handle] = std::move(file);
             return Value(handle);
         } catch (...) {
             return Value(-1);
@@ -2084,26 +2378,26 @@ void VM::registerBuiltins() {
     };
     
     // FCLOSE(handle) - Close file
-    builtins_["FCLOSE"] = [](const std::vector<Value>& args) -> Value {
+    builtins_["FCLOSE"] = [this](const std::vector<Value>& args) -> Value {
         if (args.empty()) return Value(0);
         int handle = args[0].asInt();
         
-        auto it = fileHandles.find(handle);
-        if (it != fileHandles.end()) {
+        auto it = fileHandles_.find(handle);
+        if (it != fileHandles_.end()) {
             it->second->close();
-            fileHandles.erase(it);
+            fileHandles_.erase(it);
             return Value(1);
         }
         return Value(0);
     };
     
     // FREAD(handle) - Read from file
-    builtins_["FREAD"] = [](const std::vector<Value>& args) -> Value {
+    builtins_["FREAD"] = [this](const std::vector<Value>& args) -> Value {
         if (args.empty()) return Value("");
         int handle = args[0].asInt();
         
-        auto it = fileHandles.find(handle);
-        if (it == fileHandles.end() || !it->second->is_open()) {
+        auto it = fileHandles_.find(handle);
+        if (it == fileHandles_.end() || !it->second->is_open()) {
             return Value("");
         }
         
@@ -2115,13 +2409,13 @@ void VM::registerBuiltins() {
     };
     
     // FWRITE(handle, data) - Write to file
-    builtins_["FWRITE"] = [](const std::vector<Value>& args) -> Value {
+    builtins_["FWRITE"] = [this](const std::vector<Value>& args) -> Value {
         if (args.size() < 2) return Value(0);
         int handle = args[0].asInt();
         std::string data = args[1].asString();
         
-        auto it = fileHandles.find(handle);
-        if (it == fileHandles.end() || !it->second->is_open()) {
+        auto it = fileHandles_.find(handle);
+        if (it == fileHandles_.end() || !it->second->is_open()) {
             return Value(0);
         }
         
@@ -2314,13 +2608,13 @@ void VM::registerBuiltins() {
     };
     
     // FSEEK(handle, pos) - Seek in file
-    builtins_["FSEEK"] = [](const std::vector<Value>& args) -> Value {
+    builtins_["FSEEK"] = [this](const std::vector<Value>& args) -> Value {
         if (args.size() < 2) return Value(-1);
         int handle = args[0].asInt();
         int pos = args[1].asInt();
         
-        auto it = fileHandles.find(handle);
-        if (it == fileHandles.end() || !it->second->is_open()) {
+        auto it = fileHandles_.find(handle);
+        if (it == fileHandles_.end() || !it->second->is_open()) {
             return Value(-1);
         }
         
@@ -2329,12 +2623,12 @@ void VM::registerBuiltins() {
     };
     
     // FTELL(handle) - Get file position
-    builtins_["FTELL"] = [](const std::vector<Value>& args) -> Value {
+    builtins_["FTELL"] = [this](const std::vector<Value>& args) -> Value {
         if (args.empty()) return Value(-1);
         int handle = args[0].asInt();
         
-        auto it = fileHandles.find(handle);
-        if (it == fileHandles.end() || !it->second->is_open()) {
+        auto it = fileHandles_.find(handle);
+        if (it == fileHandles_.end() || !it->second->is_open()) {
             return Value(-1);
         }
         
@@ -2354,12 +2648,12 @@ void VM::registerBuiltins() {
     };
     
     // FREADBIN(handle) - Read binary from file
-    builtins_["FREADBIN"] = [](const std::vector<Value>& args) -> Value {
+    builtins_["FREADBIN"] = [this](const std::vector<Value>& args) -> Value {
         if (args.empty()) return Value("");
         int handle = args[0].asInt();
         
-        auto it = fileHandles.find(handle);
-        if (it == fileHandles.end() || !it->second->is_open()) {
+        auto it = fileHandles_.find(handle);
+        if (it == fileHandles_.end() || !it->second->is_open()) {
             return Value("");
         }
         
@@ -2372,13 +2666,13 @@ void VM::registerBuiltins() {
     };
     
     // FWRITEBIN(handle, data) - Write binary to file
-    builtins_["FWRITEBIN"] = [](const std::vector<Value>& args) -> Value {
+    builtins_["FWRITEBIN"] = [this](const std::vector<Value>& args) -> Value {
         if (args.size() < 2) return Value(0);
         int handle = args[0].asInt();
         std::string data = args[1].asString();
         
-        auto it = fileHandles.find(handle);
-        if (it == fileHandles.end() || !it->second->is_open()) {
+        auto it = fileHandles_.find(handle);
+        if (it == fileHandles_.end() || !it->second->is_open()) {
             return Value(0);
         }
         
@@ -2388,13 +2682,13 @@ void VM::registerBuiltins() {
     
     // FREADENCODE(handle, encoding) - 指定エンコーディングでファイル残り全体を読み込み、
     // UTF-8 に変換して返す。ハンドル不正/未オープン時は空文字列。
-    builtins_["FREADENCODE"] = [](const std::vector<Value>& args) -> Value {
+    builtins_["FREADENCODE"] = [this](const std::vector<Value>& args) -> Value {
         if (args.empty()) return Value("");
         int handle = args[0].asInt();
         std::string encoding = args.size() >= 2 ? args[1].asString() : std::string("UTF-8");
 
-        auto it = fileHandles.find(handle);
-        if (it == fileHandles.end() || !it->second->is_open()) {
+        auto it = fileHandles_.find(handle);
+        if (it == fileHandles_.end() || !it->second->is_open()) {
             return Value("");
         }
 
@@ -2407,7 +2701,7 @@ void VM::registerBuiltins() {
             return Value(raw);
         }
         std::string converted;
-        if (convertEncodingVM(raw, "CP932", "UTF-8", converted)) {
+        if (transcode::cp932ToUtf8(raw, converted)) {
             return Value(converted);
         }
         return Value("");
@@ -2415,14 +2709,14 @@ void VM::registerBuiltins() {
 
     // FWRITEDECODE(handle, data, encoding) - UTF-8 の data を指定エンコーディングへ変換し
     // ファイルへ書き込む。書き込みバイト数を返す（失敗時は0）。
-    builtins_["FWRITEDECODE"] = [](const std::vector<Value>& args) -> Value {
+    builtins_["FWRITEDECODE"] = [this](const std::vector<Value>& args) -> Value {
         if (args.size() < 2) return Value(0);
         int handle = args[0].asInt();
         std::string data = args[1].asString();
         std::string encoding = args.size() >= 3 ? args[2].asString() : std::string("UTF-8");
 
-        auto it = fileHandles.find(handle);
-        if (it == fileHandles.end() || !it->second->is_open()) {
+        auto it = fileHandles_.find(handle);
+        if (it == fileHandles_.end() || !it->second->is_open()) {
             return Value(0);
         }
 
@@ -2430,7 +2724,7 @@ void VM::registerBuiltins() {
         std::string toWrite = data;
         if (norm == "CP932") {
             std::string converted;
-            if (!convertEncodingVM(data, "UTF-8", "CP932", converted)) {
+            if (!transcode::utf8ToCp932(data, converted)) {
                 return Value(0);
             }
             toWrite = converted;
@@ -2459,18 +2753,16 @@ void VM::registerBuiltins() {
         return Value("");
     };
     
-    // ===== Regular Expression Functions (std::regex-based) =====
+    // ===== Regular Expression Functions (RegexEngine) =====
     // NOTE: 本家 YAYA と同じく、検索系 RE_* は直近のマッチ結果を保持し、
     //       RE_GETSTR / RE_GETPOS / RE_GETLEN で取得できる。
     //       引数順も本家準拠: RE_xxx(対象文字列, パターン)。
     //       （旧実装は (パターン, 文字列) 順だったが本家は (str, pattern)）
+    //       パターンは RE_OPTION と組で regexCache_ にコンパイル済みで保持する。
 
-    // RE_OPTION を反映した std::regex を生成する
-    auto makeRegex = [this](const std::string& pattern) {
-        auto flags = std::regex::ECMAScript;
-        if (reOptions_ & 1) flags |= std::regex::icase;
-        if (reOptions_ & 2) flags |= std::regex::multiline;
-        return std::regex(pattern, flags);
+    // RE_OPTION を反映したコンパイル済みパターンを取得する（不正なパターンは std::regex_error）
+    auto getRegex = [this](const std::string& pattern) {
+        return regexCache_.get(pattern, reOptions_);
     };
 
     auto clearReState = [this]() {
@@ -2480,75 +2772,60 @@ void VM::registerBuiltins() {
     };
 
     // マッチ結果（グループ含む）を保存する
-    auto storeMatch = [this](const std::smatch& m) {
-        for (size_t i = 0; i < m.size(); ++i) {
-            reMatchStrings_.emplace_back(m[i].str());
-            if (m[i].matched) {
-                reMatchPositions_.emplace_back(static_cast<int>(m.position(i)));
-                reMatchLengths_.emplace_back(static_cast<int>(m.length(i)));
-            } else {
-                reMatchPositions_.emplace_back(-1);
-                reMatchLengths_.emplace_back(-1);
-            }
+    auto storeMatch = [this](const std::vector<yaya_regex::Group>& groups) {
+        for (const auto& g : groups) {
+            reMatchStrings_.emplace_back(g.str);
+            reMatchPositions_.emplace_back(g.position);
+            reMatchLengths_.emplace_back(g.length);
         }
     };
 
     // RE_SEARCH(str, pattern) - Search for pattern; return 1/0 (マッチ結果は RE_GET* で取得)
-    builtins_["RE_SEARCH"] = [this, makeRegex, clearReState, storeMatch](const std::vector<Value>& args) -> Value {
+    builtins_["RE_SEARCH"] = [getRegex, clearReState, storeMatch](const std::vector<Value>& args) -> Value {
         clearReState();
         if (args.size() < 2) return Value(0);
         try {
-            std::regex re = makeRegex(args[1].asString());
-            std::smatch m;
-            std::string s = args[0].asString();
-            if (std::regex_search(s, m, re)) {
-                storeMatch(m);
+            std::vector<yaya_regex::Group> groups;
+            if (getRegex(args[1].asString())->search(args[0].asString(), &groups)) {
+                storeMatch(groups);
                 return Value(1);
             }
             return Value(0);
         } catch (const std::exception& e) {
-            std::cerr << "[VM] RE_SEARCH regex error: " << e.what() << std::endl;
+            YAYA_LOG(Warn, "[VM] RE_SEARCH regex error: " << e.what());
             return Value(0);
         }
     };
 
     // RE_MATCH(str, pattern) - Full match; return 1/0
-    builtins_["RE_MATCH"] = [this, makeRegex, clearReState, storeMatch](const std::vector<Value>& args) -> Value {
+    builtins_["RE_MATCH"] = [getRegex, clearReState, storeMatch](const std::vector<Value>& args) -> Value {
         clearReState();
         if (args.size() < 2) return Value(0);
         try {
-            std::regex re = makeRegex(args[1].asString());
-            std::smatch m;
-            std::string s = args[0].asString();
-            if (std::regex_match(s, m, re)) {
-                storeMatch(m);
+            std::vector<yaya_regex::Group> groups;
+            if (getRegex(args[1].asString())->match(args[0].asString(), &groups)) {
+                storeMatch(groups);
                 return Value(1);
             }
             return Value(0);
         } catch (const std::exception& e) {
-            std::cerr << "[VM] RE_MATCH regex error: " << e.what() << std::endl;
+            YAYA_LOG(Warn, "[VM] RE_MATCH regex error: " << e.what());
             return Value(0);
         }
     };
 
     // RE_GREP(str, pattern) - Return match count; matches stored for RE_GET*
-    builtins_["RE_GREP"] = [this, makeRegex, clearReState](const std::vector<Value>& args) -> Value {
+    builtins_["RE_GREP"] = [getRegex, clearReState, storeMatch](const std::vector<Value>& args) -> Value {
         clearReState();
         if (args.size() < 2) return Value(0);
-        int count = 0;
+        std::vector<yaya_regex::Group> matches;
         try {
-            std::regex re = makeRegex(args[1].asString());
-            const std::string s = args[0].asString();
-            for (std::sregex_iterator it(s.begin(), s.end(), re), end; it != end; ++it) {
-                reMatchStrings_.emplace_back(it->str());
-                reMatchPositions_.emplace_back(static_cast<int>(it->position()));
-                reMatchLengths_.emplace_back(static_cast<int>(it->length()));
-                ++count;
-            }
+            getRegex(args[1].asString())->searchAll(args[0].asString(), matches);
         } catch (const std::exception& e) {
-            std::cerr << "[VM] RE_GREP regex error: " << e.what() << std::endl;
+            YAYA_LOG(Warn, "[VM] RE_GREP regex error: " << e.what());
         }
-        return Value(count);
+        storeMatch(matches);
+        return Value(static_cast<int>(matches.size()));
     };
 
     // RE_GETSTR() - 直近マッチの文字列群（汎用配列）
@@ -2576,63 +2853,62 @@ void VM::registerBuiltins() {
     };
 
     // RE_REPLACE(str, pattern, replacement) - Replace all occurrences
-    builtins_["RE_REPLACE"] = [this, makeRegex](const std::vector<Value>& args) -> Value {
+    builtins_["RE_REPLACE"] = [getRegex](const std::vector<Value>& args) -> Value {
         if (args.size() < 3) return Value("");
         try {
-            return Value(std::regex_replace(args[0].asString(), makeRegex(args[1].asString()), args[2].asString()));
+            return Value(getRegex(args[1].asString())->replace(args[0].asString(), args[2].asString()));
         } catch (const std::exception& e) {
-            std::cerr << "[VM] RE_REPLACE regex error: " << e.what() << std::endl;
+            YAYA_LOG(Warn, "[VM] RE_REPLACE regex error: " << e.what());
             return args[0];
         }
     };
 
     // RE_REPLACEEX(str, pattern, replacement) - $0/$1 等の後方参照を使った置換
-    // std::regex_replace は ECMAScript 形式 ($1) をそのまま解釈するため同実装で良い
+    // replace は ECMAScript 形式 ($1) をそのまま解釈するため同実装で良い
     builtins_["RE_REPLACEEX"] = builtins_["RE_REPLACE"];
     
     // RE_SPLIT(str, pattern) - Split by regex（本家準拠の引数順）
-    builtins_["RE_SPLIT"] = [this, makeRegex](const std::vector<Value>& args) -> Value {
+    builtins_["RE_SPLIT"] = [getRegex](const std::vector<Value>& args) -> Value {
         std::vector<Value> out;
         if (args.size() < 2) return Value(out);
         try {
-            std::regex re = makeRegex(args[1].asString());
-            const std::string s = args[0].asString();
-            std::sregex_token_iterator it(s.begin(), s.end(), re, -1), end;
-            for (; it != end; ++it) out.emplace_back(it->str());
+            for (auto& part : getRegex(args[1].asString())->split(args[0].asString())) {
+                out.emplace_back(std::move(part));
+            }
         } catch (const std::exception& e) {
-            std::cerr << "[VM] RE_SPLIT regex error: " << e.what() << std::endl;
+            YAYA_LOG(Warn, "[VM] RE_SPLIT regex error: " << e.what());
         }
         return Value(out);
     };
     
     // RE_ASEARCH(array, pattern) - Return index of first array element matching regex.
-    builtins_["RE_ASEARCH"] = [this, makeRegex](const std::vector<Value>& args) -> Value {
+    builtins_["RE_ASEARCH"] = [getRegex](const std::vector<Value>& args) -> Value {
         if (args.size() < 2) return Value(-1);
         if (args[0].getType() != Value::Type::Array) return Value(-1);
-        std::regex re;
-        try { re = makeRegex(args[1].asString()); }
+        std::shared_ptr<const yaya_regex::Program> re;
+        try { re = getRegex(args[1].asString()); }
         catch (...) { return Value(-1); }
         const auto& arr = args[0].asArray();
         for (size_t i = 0; i < arr.size(); ++i) {
             try {
-                if (std::regex_search(arr[i].asString(), re)) return Value(static_cast<int>(i));
+                if (re->search(arr[i].asString(), nullptr)) return Value(static_cast<int>(i));
             } catch (...) {}
         }
         return Value(-1);
     };
 
     // RE_ASEARCHEX(array, pattern) - Return array of all matching element indices.
-    builtins_["RE_ASEARCHEX"] = [this, makeRegex](const std::vector<Value>& args) -> Value {
+    builtins_["RE_ASEARCHEX"] = [getRegex](const std::vector<Value>& args) -> Value {
         std::vector<Value> out;
         if (args.size() < 2) return Value(out);
         if (args[0].getType() != Value::Type::Array) return Value(out);
-        std::regex re;
-        try { re = makeRegex(args[1].asString()); }
+        std::shared_ptr<const yaya_regex::Program> re;
+        try { re = getRegex(args[1].asString()); }
         catch (...) { return Value(out); }
         const auto& arr = args[0].asArray();
         for (size_t i = 0; i < arr.size(); ++i) {
             try {
-                if (std::regex_search(arr[i].asString(), re)) out.push_back(Value(static_cast<int>(i)));
+                if (re->search(arr[i].asString(), nullptr)) out.push_back(Value(static_cast<int>(i)));
             } catch (...) {}
         }
         return Value(out);
@@ -2777,8 +3053,11 @@ void VM::registerBuiltins() {
     
     // ===== Additional Variable/Function Management =====
     
-    // SAVEVAR(filename) - グローバル変数を JSON で指定ファイルへ保存する。
-    // 型情報（s=文字列, i=整数, r=実数, a=配列, v=void）を保持し RESTOREVAR で復元可能にする。
+    // SAVEVAR(filename[, format]) - グローバル変数を指定ファイルへ保存する。
+    // 既定はバイナリのスナップショット（VarSnapshot.hpp）。前回の SAVEVAR / RESTOREVAR から
+    // 書き込みの無かった変数は符号化済みのバイト列を再利用する。format に "json" を渡すと
+    // 従来の JSON（t: s=文字列, i=整数, r=実数, a=配列, v=void）で書く。
+    // どちらも一時ファイルへ書いてから rename する。
     // Phase 7: relative paths anchor under the ghost root; temp vars are excluded.
     builtins_["SAVEVAR"] = [this](const std::vector<Value>& args) -> Value {
         if (args.empty()) return Value(0);
@@ -2794,6 +3073,30 @@ void VM::registerBuiltins() {
             if (!base.empty() && base.back() != '/') base += '/';
             full = base + filename;
         }
+        bool asJson = args.size() >= 2 && args[1].asString() == "json";
+        // Build a set of temp-var names to exclude from persistence.
+        std::set<std::string> excluded(tempVarNames_.begin(), tempVarNames_.end());
+
+        if (!asJson) {
+            std::string out;
+            var_snapshot::beginSnapshot(out);
+            uint32_t count = 0;
+            for (const auto& kv : globalIndex_) {
+                GlobalSlot& g = globals_[kv.second];
+                if (!g.defined) continue;
+                if (excluded.count(kv.first)) continue;  // registered temp vars are not persisted
+                if (g.dirty || g.saved.empty()) {
+                    g.saved.clear();
+                    var_snapshot::encodeValue(g.value, g.saved);
+                    g.dirty = false;
+                }
+                var_snapshot::appendRecord(out, kv.first, g.saved);
+                ++count;
+            }
+            var_snapshot::setRecordCount(out, count);
+            return Value(var_snapshot::writeAtomically(full, out) ? 1 : 0);
+        }
+
         std::function<nlohmann::json(const Value&)> toJson = [&toJson](const Value& v) -> nlohmann::json {
             nlohmann::json j;
             switch (v.getType()) {
@@ -2812,23 +3115,21 @@ void VM::registerBuiltins() {
             return j;
         };
         nlohmann::json root = nlohmann::json::object();
-        // Build a set of temp-var names to exclude from persistence.
-        std::set<std::string> excluded(tempVarNames_.begin(), tempVarNames_.end());
-        for (const auto& kv : variables_) {
+        for (const auto& kv : globalIndex_) {
+            const GlobalSlot& g = globals_[kv.second];
+            if (!g.defined) continue;
             if (excluded.count(kv.first)) continue;  // registered temp vars are not persisted
-            root[kv.first] = toJson(kv.second);
+            root[kv.first] = toJson(g.value);
         }
         try {
-            std::ofstream ofs(full, std::ios::binary | std::ios::trunc);
-            if (!ofs.is_open()) return Value(0);
-            ofs << root.dump();
-            return Value(ofs.good() ? 1 : 0);
+            return Value(var_snapshot::writeAtomically(full, root.dump()) ? 1 : 0);
         } catch (...) {
             return Value(0);
         }
     };
 
-    // RESTOREVAR(filename) - SAVEVAR で保存した JSON からグローバル変数を復元する。
+    // RESTOREVAR(filename) - SAVEVAR で保存したファイルからグローバル変数を復元する。
+    // 先頭のマジックでバイナリのスナップショットか従来の JSON かを見分ける（ファイルは mmap）。
     builtins_["RESTOREVAR"] = [this](const std::vector<Value>& args) -> Value {
         if (args.empty()) return Value(0);
         std::string filename = args[0].asString();
@@ -2841,6 +3142,27 @@ void VM::registerBuiltins() {
             if (!base.empty() && base.back() != '/') base += '/';
             full = base + filename;
         }
+        MappedFile file(full);
+        if (!file.ok()) return Value(0);
+
+        if (var_snapshot::isSnapshot(file.data(), file.size())) {
+            try {
+                std::vector<var_snapshot::Record> records;
+                if (!var_snapshot::decode(file.data(), file.size(), records)) return Value(0);
+                for (auto& rec : records) {
+                    GlobalSlot& g = globals_[internGlobal(rec.name)];
+                    g.value = std::move(rec.value);
+                    g.defined = true;
+                    // 読んだバイト列は値の符号化そのものなので、次の SAVEVAR で再利用できる
+                    g.saved = std::move(rec.encoded);
+                    g.dirty = false;
+                }
+                return Value(1);
+            } catch (...) {
+                return Value(0);
+            }
+        }
+
         std::function<Value(const nlohmann::json&)> fromJson = [&fromJson](const nlohmann::json& j) -> Value {
             std::string t = j.value("t", std::string("v"));
             if (t == "s") return Value(j.value("v", std::string()));
@@ -2856,12 +3178,14 @@ void VM::registerBuiltins() {
             return Value();
         };
         try {
-            std::ifstream ifs(full, std::ios::binary);
-            if (!ifs.is_open()) return Value(0);
-            nlohmann::json root = nlohmann::json::parse(ifs);
+            nlohmann::json root = nlohmann::json::parse(file.data(), file.data() + file.size());
             if (!root.is_object()) return Value(0);
             for (auto it = root.begin(); it != root.end(); ++it) {
-                variables_[it.key()] = fromJson(it.value());
+                Value v = fromJson(it.value());
+                GlobalSlot& g = globals_[internGlobal(it.key())];
+                g.value = std::move(v);
+                g.defined = true;
+                g.dirty = true;
             }
             return Value(1);
         } catch (...) {
@@ -2873,8 +3197,10 @@ void VM::registerBuiltins() {
     builtins_["DUMPVAR"] = [this](const std::vector<Value>& args) -> Value {
         (void)args;
         std::string result;
-        for (const auto& pair : variables_) {
-            result += pair.first + " = " + pair.second.asString() + "\n";
+        for (const auto& pair : globalIndex_) {
+            const GlobalSlot& g = globals_[pair.second];
+            if (!g.defined) continue;
+            result += pair.first + " = " + g.value.asString() + "\n";
         }
         return Value(result);
     };
@@ -2909,7 +3235,7 @@ void VM::registerBuiltins() {
             if (i > 0) line += ", ";
             line += args[i].asString();
         }
-        std::cerr << "[YAYA][LOGGING] " << line << std::endl;
+        YAYA_LOG(Info, "[YAYA][LOGGING] " << line);
         return Value(1);
     };
     
@@ -3028,7 +3354,8 @@ void VM::registerBuiltins() {
     // READFMO(name) - FMO（Forged Memory Object）のスナップショットを読み込む。
     // 戻り値は SSP 互換の `id.key\x01value\r\n` 形式の文字列（buildSnapshot と同一）。
     // name は FMO 名（慣例 "Sakura"）。Ourin は単一 FMO のみ保持するため name は参照のみ。
-    // ホスト（Swift）へ同期 IPC で問い合わせ、現在の FMO 内容を取得する。
+    // load で fmo_segment が指定されていれば共有メモリ（FmoSegment.hpp）から直接読み、
+    // 無ければホスト（Swift）へ同期 IPC で問い合わせて現在の FMO 内容を取得する。
     builtins_["READFMO"] = [this](const std::vector<Value>& args) -> Value {
         if (!callback_) return Value("");
         std::string name = args.empty() ? std::string("Sakura") : args[0].asString();
@@ -3162,42 +3489,22 @@ void VM::registerBuiltins() {
     };
     
     // ASEARCHEX(array, value, start) - Array search from position
-    builtins_["ASEARCHEX"] = [](const std::vector<Value>& args) -> Value {
+    builtins_["ASEARCHEX"] = [this](const std::vector<Value>& args) -> Value {
         if (args.size() < 2) return Value(-1);
         if (args[0].getType() != Value::Type::Array) return Value(-1);
-        
-        const auto& arr = args[0].asArray();
-        const Value& searchVal = args[1];
         int start = (args.size() >= 3) ? args[2].asInt() : 0;
-        
         if (start < 0) start = 0;
-        
-        for (size_t i = start; i < arr.size(); i++) {
-            if (arr[i] == searchVal) {
-                return Value(static_cast<int>(i));
-            }
-        }
-        return Value(-1);
+        return Value(arraySearch_.find(args[0], args[1], static_cast<size_t>(start)));
     };
 
     // ASEARCHPOS(array, value, start) - 配列内を start 位置から検索し最初に見つかった
     // 要素のインデックスを返す。見つからなければ -1。start 省略時は 0（ASEARCH と同等）。
-    builtins_["ASEARCHPOS"] = [](const std::vector<Value>& args) -> Value {
+    builtins_["ASEARCHPOS"] = [this](const std::vector<Value>& args) -> Value {
         if (args.size() < 2) return Value(-1);
         if (args[0].getType() != Value::Type::Array) return Value(-1);
-
-        const auto& arr = args[0].asArray();
-        const Value& searchVal = args[1];
         int start = (args.size() >= 3) ? args[2].asInt() : 0;
-
         if (start < 0) start = 0;
-
-        for (size_t i = static_cast<size_t>(start); i < arr.size(); i++) {
-            if (arr[i] == searchVal) {
-                return Value(static_cast<int>(i));
-            }
-        }
-        return Value(-1);
+        return Value(arraySearch_.find(args[0], args[1], static_cast<size_t>(start)));
     };
     
     // GETDELIM() - 現在の配列区切り文字を返す
@@ -3568,7 +3875,14 @@ void VM::registerBuiltins() {
 // Interpolate embedded expressions in strings like %(_varname) or %(funcname())
 // IMPORTANT: SSP/baseware percent variables like %(charname(0)) should NOT be interpolated by YAYA
 std::string VM::interpolateString(const std::string& str) {
-    std::string result;
+    return renderInterpolation(*compileInterpolation(str));
+}
+
+// 文字列を Text / Expression / Fallback の片に分解する。
+// 埋め込み式の Lexer/Parser はここでのみ走り、結果は LiteralNode に保持して使い回す。
+std::shared_ptr<const std::vector<AST::InterpolationSegment>> VM::compileInterpolation(const std::string& str) {
+    using Segment = AST::InterpolationSegment;
+    auto segments = std::make_shared<std::vector<Segment>>();
     size_t pos = 0;
 
     // List of SSP/baseware variables that should NOT be interpolated by YAYA
@@ -3578,17 +3892,29 @@ std::string VM::interpolateString(const std::string& str) {
         "screenwidth", "screenheight", "property"
     };
 
+    // 連続する Text 片は1つにまとめる
+    auto appendText = [&segments](const std::string& text) {
+        if (text.empty()) return;
+        if (!segments->empty() && segments->back().kind == Segment::Kind::Text) {
+            segments->back().source += text;
+        } else {
+            Segment seg;
+            seg.source = text;
+            segments->push_back(std::move(seg));
+        }
+    };
+
     while (pos < str.length()) {
         // Look for %(
         size_t start = str.find("%(", pos);
         if (start == std::string::npos) {
             // No more embedded expressions
-            result += str.substr(pos);
+            appendText(str.substr(pos));
             break;
         }
 
         // Add text before %(
-        result += str.substr(pos, start - pos);
+        appendText(str.substr(pos, start - pos));
 
         // Find matching ) - need to handle nested parentheses for function calls
         int depth = 1;
@@ -3601,7 +3927,7 @@ std::string VM::interpolateString(const std::string& str) {
 
         if (depth != 0) {
             // Malformed - just add the rest
-            result += str.substr(start);
+            appendText(str.substr(start));
             break;
         }
 
@@ -3619,40 +3945,83 @@ std::string VM::interpolateString(const std::string& str) {
 
         if (is_ssp_var) {
             // Leave SSP variables for baseware to expand
-            result += "%(" + expr + ")";
+            appendText("%(" + expr + ")");
         } else {
-            // 任意の式として評価する。inner text を Lexer/Parser に通し、
-            // 得られた式ノードを executeNode で評価して asString() を埋め込む。
-            bool evaluated = false;
+            // 任意の式として扱う。inner text を Lexer/Parser に通した本体を保持し、
+            // 評価は renderInterpolation で行う。パースできなければ変数参照へフォールバック。
+            Segment seg;
+            seg.kind = Segment::Kind::Fallback;
+            seg.source = expr;
             try {
-                // public な parse() は関数定義を要求するため、合成関数で包んで本体を実行する
+                // public な parse() は関数定義を要求するため、合成関数で包んで本体を取り出す
                 Lexer lexer("__interp__{\n" + expr + "\n}");
                 Parser parser(lexer.tokenize());
                 auto funcs = parser.parse();
                 if (!funcs.empty() && funcs[0]) {
-                    Value val;
-                    for (const auto& stmt : funcs[0]->body) {
-                        val = executeNode(stmt);
-                    }
-                    result += val.asString();
-                    evaluated = true;
+                    seg.body = funcs[0]->body;
+                    seg.kind = Segment::Kind::Expression;
                 }
             } catch (...) {
-                // パース/評価失敗時は下位のフォールバックへ
+                // パース失敗時は Fallback のまま
             }
-            if (!evaluated) {
-                // フォールバック: 単純な変数参照として評価する
-                Value val = getVariable(expr);
-                if (!val.isVoid()) {
+            segments->push_back(std::move(seg));
+        }
+
+        pos = end + 1;
+    }
+
+    if (segments->empty()) {
+        segments->push_back(Segment{});
+    }
+    return segments;
+}
+
+std::string VM::renderInterpolation(const std::vector<AST::InterpolationSegment>& segments) {
+    using Segment = AST::InterpolationSegment;
+    std::string result;
+
+    if (profiler_ && profileInterpolationGeneration_ != profiler_->generation()) {
+        profileInterpolationKey_ = profiler_->key(yaya_profile::Kind::Interpolation, "%()");
+        profileInterpolationGeneration_ = profiler_->generation();
+    }
+    yaya_profile::Scope profile(profiler_, profileInterpolationKey_);
+
+    for (const auto& seg : segments) {
+        if (seg.kind == Segment::Kind::Text) {
+            result += seg.source;
+            continue;
+        }
+
+        bool evaluated = false;
+        if (seg.kind == Segment::Kind::Expression) {
+            // 得られた式ノードを executeNode で評価して asString() を埋め込む
+            try {
+                Value val;
+                for (const auto& stmt : seg.body) {
+                    val = executeNode(stmt);
+                    if (completion_ != Completion::Normal) break;
+                }
+                if (completion_ == Completion::Normal) {
                     result += val.asString();
-                } else {
-                    // 変数も見つからない場合は空文字（旧挙動は baseware 展開のため残置だったが
-                    // 任意式評価の失敗時は空とする）
+                    evaluated = true;
+                } else if (completion_ != Completion::Abort) {
+                    // 埋め込み式中の return/break/continue は評価失敗として扱う
+                    completion_ = Completion::Normal;
                 }
+            } catch (...) {
+                // 評価失敗時は下位のフォールバックへ
+            }
+        }
+        if (!evaluated) {
+            // フォールバック: 単純な変数参照として評価する
+            Value val = getVariable(seg.source);
+            if (!val.isVoid()) {
+                result += val.asString();
+            } else {
+                // 変数も見つからない場合は空文字（旧挙動は baseware 展開のため残置だったが
+                // 任意式評価の失敗時は空とする）
             }
         }
-
-        pos = end + 1;
     }
 
     return result;
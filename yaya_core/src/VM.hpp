@@ -2,14 +2,23 @@
 
 #include "AST.hpp"
 #include "Value.hpp"
+#include "Bytecode.hpp"
+#include <cstdint>
 #include <map>
 #include <string>
 #include <vector>
 #include <functional>
+#include <fstream>
 #include <optional>
+#include <memory>
+#include <unordered_map>
 #include <nlohmann/json.hpp>
 #include <random>
 #include "RandomEngine.hpp"
+#include "RegexEngine.hpp"
+#include "ArrayOps.hpp"
+
+namespace yaya_profile { class Profiler; }
 
 // Callback interface for VM to request operations from host
 class VMCallback {
@@ -52,6 +61,11 @@ public:
         bool enabled = true;        // toggled by UNDEFFUNC
         bool nonoverload = false;   // YAYA `nonoverload` attribute
         bool isWhen = false;        // YAYA `when` attribute
+        // bytecode エンジン用の命令列（初回実行時にコンパイルしてキャッシュ）
+        mutable std::shared_ptr<const Bytecode::Chunk> bytecode;
+        // プロファイラの区間番号（profileGeneration が現在のプロファイラと一致するときだけ有効）
+        mutable int profileKey = -1;
+        mutable unsigned long long profileGeneration = 0;
     };
 
     // Begin a new parse/load scope; functions registered afterwards belong to `sourceId`.
@@ -83,6 +97,18 @@ public:
     // Check if a function is registered
     bool hasFunction(const std::string& name) const;
 
+    // SHIORI3FW（yaya_shiori3.dic）の request を、要求文字列を辞書で解析させずに行う
+    // （load の "shiori3fw_native"。ShioriRequest.cpp）。request が標準の定義のままのときだけ、
+    // ヘッダの並びから REQ.* / var.req.* / SHIORI3FW.* などを同じ順序で設定し、辞書と同じ関数
+    // （TranslateEvent / IsImportantEvent / TOAUTOEX / OnRequest 等）を呼んで request の戻り値を返す。
+    // request が上書きされている・同じ結果にできない要求（ASCII 以外を含む等）は false を返し、
+    // 呼び出し側は従来どおり execute("request", {requestText}) を使う。
+    using ShioriHeaders = std::vector<std::pair<std::string, std::string>>;
+    bool executeShioriRequest(const std::string& method, const ShioriHeaders& headers,
+                              const std::string& requestText, Value& result);
+    // request がただ 1 つの宣言で、構文木が標準のもの（同梱の request の DicCache::fingerprint）と一致する
+    bool hasStockShioriRequest();
+
     // Set the ghost root path used to anchor relative persistence/DICLOAD paths.
     void setGhostRootPath(const std::string& path) { ghostRootPath_ = path; }
     std::string getGhostRootPath() const { return ghostRootPath_; }
@@ -93,6 +119,34 @@ public:
         globalDefines_[name] = value;
     }
 
+    // 関数本体の実行方式。Ast は構文木を直接評価し、Bytecode は関数ごとに
+    // 命令列へコンパイルしたものをスタックマシンで実行する（load の engine オプション）。
+    enum class Engine { Ast, Bytecode };
+    void setEngine(Engine engine) { engine_ = engine; }
+    Engine getEngine() const { return engine_; }
+
+    // 計測プロファイラ（null で停止）。関数・組み込み関数・%() 展開を区間として記録する
+    void setProfiler(yaya_profile::Profiler* profiler) { profiler_ = profiler; }
+
+    // 登録前の定数畳み込み（ConstantFolding.cpp）。定数式を値に、条件が定数の
+    // if / 三項演算子 / case を選ばれた側だけに置き換える。数はノード数の比較用。
+    struct FoldStats {
+        size_t nodesBefore = 0;
+        size_t nodesAfter = 0;
+        size_t foldedExpressions = 0;
+        size_t prunedBranches = 0;
+        FoldStats& operator+=(const FoldStats& other);
+    };
+    FoldStats foldConstants(AST::FunctionNode& function);
+
+    // 実行予算（無限ループ防止）。トップレベルの呼び出しごとに、ループの 1 周と関数呼び出しを
+    // 1 として数え、ticks を超えるか MAX_EXECUTION_TIME_MS を過ぎたら打ち切る（ticks = 0 は回数の上限なし）。
+    // 打ち切った後はトップレベルへ戻るまでループを抜け、関数呼び出しは空を返す。
+    // 打ち切られたトップレベル呼び出しは空を返し、budgetExhaustedIn() がそのとき実行中だった関数名を返す。
+    void setBudget(uint64_t ticks) { budget_ = ticks; }
+    bool budgetExhausted() const { return budgetExhausted_; }
+    const std::string& budgetExhaustedIn() const { return exhaustedIn_; }
+
 private:
     VMCallback* callback_ = nullptr;
     // Function registry: supports multiple declarations per name (YAYA overload).
@@ -103,11 +157,66 @@ private:
     std::map<int, std::string> sourceNames_;
     int nextDeclarationOrder_ = 0;
 
+    // 呼び出し先の解決表。関数名を一度だけ番号に割り当て（番号は VM の寿命の間変わらない）、
+    // 呼び出しノードはその番号をキャッシュする（AST::FunctionSlot）。各項目は組み込み関数か
+    // 有効な宣言の一覧を保持し、関数の登録・DICUNLOAD・UNDEFFUNC・FUNCDECL_* で
+    // functionEpoch_ が進んだ後の最初の呼び出しで作り直す。
+    using Builtin = std::function<Value(const std::vector<Value>&)>;
+    struct LocalLayout;
+    struct FunctionEntry {
+        std::string name;
+        unsigned long long epoch = 0;       // 解決した時点の functionEpoch_（0 = 未解決）
+        const Builtin* builtin = nullptr;   // builtins_ の要素（std::map のため位置は安定）
+        bool defined = false;               // functions_ に名前がある（無効化された宣言だけでも true）
+        // 有効な宣言（宣言順）。実行中の呼び出しが作り直しの影響を受けないよう共有で持つ
+        std::shared_ptr<const std::vector<const FunctionDecl*>> active;
+        bool anyNonoverload = false;
+        std::shared_ptr<LocalLayout> layout;
+        int profileKey = -1;                    // 組み込み関数のプロファイラ区間（FunctionDecl と同じ扱い）
+        unsigned long long profileGeneration = 0;
+    };
+    std::vector<std::unique_ptr<FunctionEntry>> functionTable_;
+    std::unordered_map<std::string, int> functionIndex_;
+    unsigned long long functionEpoch_ = 1;
+    unsigned long long functionScopeId_;
+
     // Variable storage (global variables)
-    std::map<std::string, Value> variables_;
+    // グローバル変数は密なスロット表に置き、名前→スロットの索引（名前順）を別に持つ。
+    // 解決済みのノードはスロット番号で直接参照する。ERASEVAR はスロットを未定義に戻すだけで、
+    // 番号は解放・再利用しない（ノードに残ったキャッシュを無効にしないため）。
+    // SAVEVAR は変数ごとの符号化（saved）を覚えておき、その後に書き込みの無かった変数
+    // （dirty でない）はそれを再利用する。書き込みは variableRef を通るのでそこで dirty にする。
+    struct GlobalSlot {
+        std::string name;
+        Value value;
+        bool defined = false;
+        bool dirty = true;
+        std::string saved;  // var_snapshot::encodeValue(value)。空なら未符号化
+    };
+    std::vector<GlobalSlot> globals_;
+    std::map<std::string, size_t> globalIndex_;
+    unsigned long long globalScopeId_;
 
-    // Local variable scope stack (for variables starting with '_')
-    std::vector<std::map<std::string, Value>> localScopes_;
+    // Local variable frames (for variables starting with '_')
+    // ローカル変数名は関数名ごとのレイアウトでフレーム内の番号に解決し、
+    // 呼び出しごとのフレームは Value の配列として持つ。
+    // _argv / _argc は常に 0 / 1 番。
+    struct LocalLayout {
+        unsigned long long scopeId = 0;
+        std::vector<std::string> names;
+        std::unordered_map<std::string, int> index;
+        int find(const std::string& name) const;
+        int intern(const std::string& name);
+    };
+    struct LocalFrame {
+        std::shared_ptr<LocalLayout> layout;
+        std::vector<Value> slots;
+    };
+    // 呼び出しフレームは最大の深さまで保持して再利用する（slots の確保を呼び出しごとにしない）。
+    // 使用中は先頭から localDepth_ 個。
+    std::vector<LocalFrame> localScopes_;
+    size_t localDepth_ = 0;
+    std::map<std::string, std::shared_ptr<LocalLayout>> localLayouts_;
 
     // SETDELIM/GETDELIM で設定する配列⇔文字列の既定区切り文字（SPLIT の区切り省略時に使用）
     std::string arrayDelimiter_ = ",";
@@ -123,6 +232,10 @@ private:
     std::string lastErrorDesc_;                           // optional last error description
     std::vector<std::string> errorLog_;                   // GETERRORLOG/CLEARERRORLOG
 
+    // FOPEN/FCLOSE/FREAD/... のハンドル表（VM ごとに独立）
+    std::map<int, std::unique_ptr<std::fstream>> fileHandles_;
+    int nextFileHandle_ = 1;
+
     // SAORI multi-value response storage (Phase 8): last REQUESTLIB extras.
     std::vector<Value> saoriValueex_;                     // valueex0, valueex1, ...
     std::string saoriCharset_;                            // CHARSETLIB default charset
@@ -130,6 +243,13 @@ private:
     // Runtime global defines (Phase 10): name → replacement text.
     std::map<std::string, std::string> globalDefines_;
 
+    // hasStockShioriRequest の結果（functionEpoch_ が同じ間は使い回す）
+    unsigned long long stockRequestEpoch_ = 0;
+    bool stockRequest_ = false;
+    // 同梱の標準 request の fingerprint（畳み込み前・後）。初回の hasStockShioriRequest で求める
+    std::vector<uint64_t> stockRequestFingerprints_;
+    const std::vector<uint64_t>& stockRequestFingerprints();
+
     // LSO() 用: 直近に評価された parallel（本家の {a,b,c} ランダム選択相当）で
     // 選ばれた候補のインデックス。未選択時は -1。
     int lastSelectedIndex_ = -1;
@@ -138,7 +258,7 @@ private:
     int lastOutputNum_ = 0;
 
     // Built-in functions
-    std::map<std::string, std::function<Value(const std::vector<Value>&)>> builtins_;
+    std::map<std::string, Builtin> builtins_;
 
     // 直近の RE_SEARCH / RE_MATCH / RE_GREP のマッチ結果
     // （RE_GETSTR / RE_GETPOS / RE_GETLEN で取得する）
@@ -147,6 +267,10 @@ private:
     std::vector<Value> reMatchLengths_;
     // RE_OPTION で設定する正規表現オプション（bit0: icase, bit1: multiline）
     int reOptions_ = 0;
+    // コンパイル済みパターンの LRU キャッシュ（キーはパターンと reOptions_）
+    yaya_regex::Cache regexCache_;
+    // ASEARCH / ASEARCHEX / ASEARCHPOS で繰り返し検索される配列の索引
+    array_ops::SearchCache arraySearch_;
 
     // 再帰深度制限（無限ループ防止）
     int recursion_depth_ = 0;
@@ -156,15 +280,31 @@ private:
     std::chrono::steady_clock::time_point execution_start_time_;
     static constexpr int MAX_EXECUTION_TIME_MS = 120000; // 120秒（load()初期化用）
 
-    // Early return exception for control flow
-    struct ReturnException {
-        Value value;
-        explicit ReturnException(const Value& v) : value(v) {}
-    };
+    // 実行予算（setBudget）。tick() は残りを減らすだけで、kBudgetCheckInterval 回ごと
+    // （または上限の直前）に checkBudget() で消費量と経過時間を確かめる。
+    static constexpr int64_t kBudgetCheckInterval = 4096;
+    uint64_t budget_ = 0;
+    uint64_t ticksUsed_ = 0;      // 直前の確認までに消費した量
+    int64_t ticksBatch_ = 0;      // 直前の確認で ticksToCheck_ に入れた量
+    int64_t ticksToCheck_ = 0;    // 次の確認までの残り
+    bool budgetExhausted_ = false;
+    std::string exhaustedIn_;
+    int currentFunction_ = -1;    // 実行中のユーザー関数（functionTable_ の番号）
+    // ループの 1 周・関数呼び出しごとに呼ぶ。予算が尽きていれば false
+    bool tick() { return --ticksToCheck_ > 0 || checkBudget(); }
+    bool checkBudget();
+    // トップレベル呼び出しの開始時に消費量と時刻を初期化する
+    void resetBudget();
 
-    // Loop control-flow exceptions (caught by While/For/Foreach loops)
-    struct BreakException {};
-    struct ContinueException {};
+    // return/break/continue の伝播状態（例外は使わない）
+    // Return/Break/Continue ノードが completion_ を設定し、executeBlock などの文の実行列は
+    // Normal 以外になった時点で打ち切って呼び出し元へ戻る。Break/Continue は最寄りの
+    // While/For/Foreach が、Return は executeFunctionDecl（および EVAL）が消費して Normal に戻す。
+    // Abort は予算切れ（checkBudget）で設定され、誰も消費しない。トップレベル呼び出しの
+    // 開始（resetBudget）まで残り、以降の文・ループ・呼び出しをすべて打ち切る。
+    enum class Completion { Normal, Return, Break, Continue, Abort };
+    Completion completion_ = Completion::Normal;
+    Value returnValue_;
 
     // Execution helpers
     Value executeNode(std::shared_ptr<AST::Node> node);
@@ -172,11 +312,52 @@ private:
     // Execute a single function declaration body honoring its type modifier (array/sequential/void).
     // Used both for direct calls and overload concatenation.
     Value executeFunctionDecl(const FunctionDecl& decl);
-    Value evaluateBinaryOp(const std::string& op, const Value& left, const Value& right);
-    Value evaluateUnaryOp(const std::string& op, const Value& operand);
+    Value evaluateBinaryOp(AST::BinaryOperator op, const Value& left, const Value& right);
+    Value evaluateUnaryOp(AST::UnaryOperator op, const Value& operand);
+    // str[start, length] / array[start, count] の切り出し（__range__。文字列はバイト単位）
+    static Value sliceValue(const Value& base, int start, int len);
+    // 変数ノードの読み書き（構文木とバイトコードの両エンジンで共用する）
+    Value loadVariable(AST::VariableNode& var);
+    Value loadArrayElement(AST::ArrayAccessNode& access, int index);
+    void assignVariable(AST::AssignmentNode& assign, const Value& value);
+    Value incDecVariable(AST::VariableNode& var, int delta, bool isPost);
+
+    // bytecode エンジン（実行ループは Bytecode.cpp）。array/sequential 関数では
+    // collected に候補を積む。戻り値と completion_ の扱いは executeBlock と同じ。
+    Engine engine_ = Engine::Ast;
+    yaya_profile::Profiler* profiler_ = nullptr;
+    int profileInterpolationKey_ = -1;
+    unsigned long long profileInterpolationGeneration_ = 0;
+    int profileKey(const FunctionDecl& decl);
+    int profileKey(FunctionEntry& entry);
+    std::vector<Value> bytecodeStack_;
+    Value runBytecode(const Bytecode::Chunk& chunk, std::vector<Value>* collected);
     Value callBuiltin(const std::string& name, const std::vector<Value>& args);
+
+    // 関数表: 名前の番号を返す（無ければ割り当てる）。slot はノードのキャッシュ。
+    int internFunction(const std::string& name);
+    int resolveFunction(const std::string& name, AST::FunctionSlot& slot);
+    // 番号の項目を返す（関数の登録状態が変わっていれば解決し直す）
+    const FunctionEntry& functionEntry(int index);
+    void invalidateFunctions() { ++functionEpoch_; }
+    // 解決済みの関数を呼ぶ（execute の本体）
+    Value callFunction(int index, std::vector<Value> args);
     std::string interpolateString(const std::string& str);
 
+    // 変数スロットの解決。slot は呼び出し元ノードのキャッシュ（名前指定の API は一時値を渡す）。
+    // findVariable は未定義なら nullptr、variableRef は必要ならスロットを作って定義済みにする。
+    // 返した参照/ポインタは次の変数作成や関数呼び出しで無効になり得るため、保持しないこと。
+    const Value* findVariable(const std::string& name, AST::VarSlot& slot) const;
+    Value& variableRef(const std::string& name, AST::VarSlot& slot);
+    size_t internGlobal(const std::string& name);
+    std::shared_ptr<LocalLayout> localLayoutFor(const std::string& functionName);
+    // 登録時の解決パス: 関数本体の変数参照をグローバル表/ローカルレイアウトのスロットへ割り当てる
+    void resolveVariables(AST::Node& node, LocalLayout& layout);
+    void foldNode(std::shared_ptr<AST::Node>& node, FoldStats& stats);
+    // %(...) を含む文字列を Text/Expression 片に分解する（LiteralNode のキャッシュ用）
+    std::shared_ptr<const std::vector<AST::InterpolationSegment>> compileInterpolation(const std::string& str);
+    std::string renderInterpolation(const std::vector<AST::InterpolationSegment>& segments);
+
     // YAYA 前置 '&'（参照渡し）の解決用ヘルパ。
     // ノードが UnaryOpNode("&", operand) で、operand が変数または配列要素参照なら
     // その格納位置を表す RefTarget を返す（配列添字はこの時点で評価する）。
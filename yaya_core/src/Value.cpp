@@ -4,17 +4,21 @@
 #include <stdexcept>
 #include <random>
 
-Value::Value() : type_(Type::Void), intValue_(0) {}
+Value::Value() {}
 
-Value::Value(const std::string& str) : type_(Type::String), strValue_(str), intValue_(0) {}
+Value::Value(const std::string& str) : data_(str) {}
 
-Value::Value(int num) : type_(Type::Integer), intValue_(num) {}
+Value::Value(std::string&& str) : data_(std::move(str)) {}
 
-Value::Value(double num) : type_(Type::Real), intValue_(0), real_(num) {}
+Value::Value(int num) : data_(num) {}
 
-Value::Value(const std::vector<Value>& arr) : type_(Type::Array), arrayValue_(arr), intValue_(0) {}
+Value::Value(double num) : data_(num) {}
 
-Value::Value(const std::map<std::string, Value>& dict) : type_(Type::Dictionary), dictValue_(dict), intValue_(0) {}
+Value::Value(const std::vector<Value>& arr) : data_(std::make_shared<std::vector<Value>>(arr)) {}
+
+Value::Value(std::vector<Value>&& arr) : data_(std::make_shared<std::vector<Value>>(std::move(arr))) {}
+
+Value::Value(const std::map<std::string, Value>& dict) : data_(std::make_shared<std::map<std::string, Value>>(dict)) {}
 
 namespace {
 // Format a double trimming trailing zeros: 1.5 -> "1.5", 2.0 -> "2", 3.14 -> "3.14".
@@ -34,38 +38,40 @@ std::string formatReal(double v) {
 } // namespace
 
 std::string Value::asString() const {
-    switch (type_) {
+    switch (getType()) {
         case Type::String:
-            return strValue_;
+            return std::get<std::string>(data_);
         case Type::Integer:
-            return std::to_string(intValue_);
+            return std::to_string(std::get<int>(data_));
         case Type::Real:
-            return formatReal(real_);
+            return formatReal(std::get<double>(data_));
         case Type::Void:
             return "";
-        case Type::Array:
+        case Type::Array: {
             // For arrays, randomly select one element
             // This matches YAYA/SHIORI behavior where arrays are script candidates
-            if (!arrayValue_.empty()) {
-                std::uniform_int_distribution<size_t> dis(0, arrayValue_.size() - 1);
+            const auto& arr = *std::get<ArrayPtr>(data_);
+            if (!arr.empty()) {
+                std::uniform_int_distribution<size_t> dis(0, arr.size() - 1);
                 size_t randomIndex = dis(yaya_rng::engine());
-                return arrayValue_[randomIndex].asString();
+                return arr[randomIndex].asString();
             }
             return "";
+        }
         default:
             return "";
     }
 }
 
 int Value::asInt() const {
-    switch (type_) {
+    switch (getType()) {
         case Type::Integer:
-            return intValue_;
+            return std::get<int>(data_);
         case Type::Real:
-            return static_cast<int>(real_); // truncate toward zero
+            return static_cast<int>(std::get<double>(data_)); // truncate toward zero
         case Type::String:
             try {
-                return std::stoi(strValue_);
+                return std::stoi(std::get<std::string>(data_));
             } catch (...) {
                 return 0;
             }
@@ -75,14 +81,14 @@ int Value::asInt() const {
 }
 
 double Value::asReal() const {
-    switch (type_) {
+    switch (getType()) {
         case Type::Real:
-            return real_;
+            return std::get<double>(data_);
         case Type::Integer:
-            return static_cast<double>(intValue_);
+            return static_cast<double>(std::get<int>(data_));
         case Type::String:
             try {
-                return std::stod(strValue_);
+                return std::stod(std::get<std::string>(data_));
             } catch (...) {
                 return 0.0;
             }
@@ -92,70 +98,80 @@ double Value::asReal() const {
 }
 
 const std::vector<Value>& Value::asArray() const {
-    if (type_ != Type::Array) {
+    if (getType() != Type::Array) {
         throw std::runtime_error("Value is not an array");
     }
-    return arrayValue_;
+    return *std::get<ArrayPtr>(data_);
 }
 
 std::vector<Value>& Value::asArrayMutable() {
-    if (type_ != Type::Array) {
+    if (getType() != Type::Array) {
         throw std::runtime_error("Value is not an array");
     }
-    return arrayValue_;
+    return ownArray();
+}
+
+std::vector<Value>& Value::ownArray() {
+    auto& arr = std::get<ArrayPtr>(data_);
+    if (arr.use_count() > 1) {
+        arr = std::make_shared<std::vector<Value>>(*arr);
+    }
+    return *arr;
 }
 
 const std::map<std::string, Value>& Value::asDict() const {
-    if (type_ != Type::Dictionary) {
+    if (getType() != Type::Dictionary) {
         throw std::runtime_error("Value is not a dictionary");
     }
-    return dictValue_;
+    return *std::get<DictPtr>(data_);
 }
 
 bool Value::toBool() const {
-    switch (type_) {
+    switch (getType()) {
         case Type::Void:
             return false;
         case Type::Integer:
-            return intValue_ != 0;
+            return std::get<int>(data_) != 0;
         case Type::Real:
-            return real_ != 0.0;
+            return std::get<double>(data_) != 0.0;
         case Type::String:
-            return !strValue_.empty();
+            return !std::get<std::string>(data_).empty();
         case Type::Array:
-            return !arrayValue_.empty();
+            return !std::get<ArrayPtr>(data_)->empty();
         case Type::Dictionary:
-            return !dictValue_.empty();
+            return !std::get<DictPtr>(data_)->empty();
         default:
             return false;
     }
 }
 
 Value Value::operator+(const Value& other) const {
+    Type type = getType();
+    Type otherType = other.getType();
     // String concatenation takes precedence
-    if (type_ == Type::String || other.type_ == Type::String) {
+    if (type == Type::String || otherType == Type::String) {
         return Value(asString() + other.asString());
     }
     // Numeric promotion: if either operand is Real, result is Real
-    if (type_ == Type::Real || other.type_ == Type::Real) {
+    if (type == Type::Real || otherType == Type::Real) {
         return Value(asReal() + other.asReal());
     }
     // Integer addition
-    if (type_ == Type::Integer && other.type_ == Type::Integer) {
-        return Value(intValue_ + other.intValue_);
+    if (type == Type::Integer && otherType == Type::Integer) {
+        return Value(std::get<int>(data_) + std::get<int>(other.data_));
     }
     return Value();
 }
 
 Value Value::operator-(const Value& other) const {
-    if (type_ == Type::Real || other.type_ == Type::Real) {
+    if (isReal() || other.isReal()) {
         return Value(asReal() - other.asReal());
     }
     return Value(asInt() - other.asInt());
 }
 
 Value Value::operator*(const Value& other) const {
-    if (type_ == Type::Real || other.type_ == Type::Real) {
+    if (isReal() || other.isReal()) {
         return Value(asReal() * other.asReal());
     }
     return Value(asInt() * other.asInt());
@@ -163,7 +179,7 @@ Value Value::operator*(const Value& other) const {
 
 Value Value::operator/(const Value& other) const {
     // Real division if either operand is Real
-    if (type_ == Type::Real || other.type_ == Type::Real) {
+    if (isReal() || other.isReal()) {
         double divisor = other.asReal();
         if (divisor == 0.0) return Value(0.0);
         return Value(asReal() / divisor);
@@ -180,24 +196,24 @@ Value Value::operator%(const Value& other) const {
 }
 
 bool Value::operator==(const Value& other) const {
+    Type type = getType();
+    Type otherType = other.getType();
     // Numeric comparison across Int/Real
-    bool thisNum = (type_ == Type::Integer || type_ == Type::Real);
-    bool otherNum = (other.type_ == Type::Integer || other.type_ == Type::Real);
+    bool thisNum = (type == Type::Integer || type == Type::Real);
+    bool otherNum = (otherType == Type::Integer || otherType == Type::Real);
     if (thisNum && otherNum) {
-        if (type_ == Type::Real || other.type_ == Type::Real) {
+        if (type == Type::Real || otherType == Type::Real) {
             return asReal() == other.asReal();
         }
-        return intValue_ == other.intValue_;
+        return std::get<int>(data_) == std::get<int>(other.data_);
     }
-    if (type_ != other.type_) {
+    if (type != otherType) {
         // Allow comparison between string and int
         return asString() == other.asString();
     }
-    switch (type_) {
+    switch (type) {
         case Type::String:
-            return strValue_ == other.strValue_;
-        case Type::Integer:
-            return intValue_ == other.intValue_;
+            return std::get<std::string>(data_) == std::get<std::string>(other.data_);
         case Type::Void:
             return true;
         default:
@@ -210,14 +226,16 @@ bool Value::operator!=(const Value& other) const {
 }
 
 bool Value::operator<(const Value& other) const {
+    Type type = getType();
+    Type otherType = other.getType();
     // Numeric comparison across Int/Real
-    bool thisNum = (type_ == Type::Integer || type_ == Type::Real);
-    bool otherNum = (other.type_ == Type::Integer || other.type_ == Type::Real);
+    bool thisNum = (type == Type::Integer || type == Type::Real);
+    bool otherNum = (otherType == Type::Integer || otherType == Type::Real);
     if (thisNum && otherNum) {
-        if (type_ == Type::Real || other.type_ == Type::Real) {
+        if (type == Type::Real || otherType == Type::Real) {
             return asReal() < other.asReal();
         }
-        return intValue_ < other.intValue_;
+        return std::get<int>(data_) < std::get<int>(other.data_);
     }
     return asString() < other.asString();
 }
@@ -236,43 +254,50 @@ bool Value::operator>=(const Value& other) const {
 
 // Array operations
 size_t Value::arraySize() const {
-    if (type_ == Type::Array) {
-        return arrayValue_.size();
+    if (getType() == Type::Array) {
+        return std::get<ArrayPtr>(data_)->size();
     }
     return 0;
 }
 
 Value Value::arrayGet(size_t index) const {
-    if (type_ == Type::Array && index < arrayValue_.size()) {
-        return arrayValue_[index];
+    if (getType() == Type::Array) {
+        const auto& arr = *std::get<ArrayPtr>(data_);
+        if (index < arr.size()) return arr[index];
     }
     return Value();
 }
 
 void Value::arraySet(size_t index, const Value& value) {
-    if (type_ == Type::Array) {
-        if (index >= arrayValue_.size()) {
-            arrayValue_.resize(index + 1);
+    if (getType() == Type::Array) {
+        // value が自分の要素を指している場合に備え、複製前に値を確保する
+        Value v = value;
+        auto& arr = ownArray();
+        if (index >= arr.size()) {
+            arr.resize(index + 1);
         }
-        arrayValue_[index] = value;
+        arr[index] = std::move(v);
     }
 }
 
 void Value::arrayPush(const Value& value) {
-    if (type_ == Type::Array) {
-        arrayValue_.push_back(value);
+    if (getType() == Type::Array) {
+        Value v = value;
+        ownArray().push_back(std::move(v));
     }
 }
 
 void Value::arrayConcat(const Value& other) {
-    if (type_ == Type::Array) {
-        if (other.type_ == Type::Array) {
-            // Concatenate arrays
-            const auto& otherArray = other.asArray();
-            arrayValue_.insert(arrayValue_.end(), otherArray.begin(), otherArray.end());
+    if (getType() == Type::Array) {
+        if (other.getType() == Type::Array) {
+            // Concatenate arrays（自分自身との連結でも壊れないよう相手の本体を保持しておく）
+            ArrayPtr otherArray = std::get<ArrayPtr>(other.data_);
+            auto& arr = ownArray();
+            arr.insert(arr.end(), otherArray->begin(), otherArray->end());
         } else {
             // Add single element
-            arrayValue_.push_back(other);
+            Value v = other;
+            ownArray().push_back(std::move(v));
         }
     }
 }
@@ -7,8 +7,13 @@
 #include <variant>
 
 /// Represents a YAYA value (string, integer, array, or dictionary)
+///
+/// 値は型タグ付きの共用体（std::variant）1つに収める。文字列は std::string の SSO に任せ、
+/// 配列・辞書は参照カウントで共有してコピーオンライトにする（コピーはポインタの複製だけで、
+/// 変更系の操作が共有中の本体を見つけたときに初めて複製する）。
 class Value {
 public:
+    // variant の候補の並びと一致させる（getType は index をそのまま使う）
     enum class Type {
         Void,
         String,
@@ -20,20 +25,23 @@ public:
 
     Value();
     explicit Value(const std::string& str);
+    explicit Value(std::string&& str);
     explicit Value(int num);
     explicit Value(double num);
     explicit Value(const std::vector<Value>& arr);
+    explicit Value(std::vector<Value>&& arr);
     explicit Value(const std::map<std::string, Value>& dict);
 
-    Type getType() const { return type_; }
-    bool isVoid() const { return type_ == Type::Void; }
-    bool isReal() const { return type_ == Type::Real; }
+    Type getType() const { return static_cast<Type>(data_.index()); }
+    bool isVoid() const { return getType() == Type::Void; }
+    bool isReal() const { return getType() == Type::Real; }
 
     // Conversion methods
     std::string asString() const;
     int asInt() const;
     double asReal() const;
     const std::vector<Value>& asArray() const;
+    // 共有中の配列は複製してから返す（コピーオンライト）
     std::vector<Value>& asArrayMutable();
     const std::map<std::string, Value>& asDict() const;
     
@@ -60,10 +68,10 @@ public:
     bool operator>=(const Value& other) const;
 
 private:
-    Type type_;
-    std::string strValue_;
-    int intValue_;
-    double real_ = 0.0;
-    std::vector<Value> arrayValue_;
-    std::map<std::string, Value> dictValue_;
+    using ArrayPtr = std::shared_ptr<std::vector<Value>>;
+    using DictPtr = std::shared_ptr<std::map<std::string, Value>>;
+    std::variant<std::monostate, std::string, int, double, ArrayPtr, DictPtr> data_;
+
+    // 配列本体を単独所有にしてから返す（型が Array であること）
+    std::vector<Value>& ownArray();
 };
@@ -0,0 +1,214 @@
+#include "VarSnapshot.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+namespace var_snapshot {
+
+namespace {
+
+constexpr char kMagic[4] = {'Y', 'V', 'S', '1'};
+constexpr uint32_t kFormatVersion = 1;
+constexpr size_t kHeaderSize = sizeof kMagic + 2 * sizeof(uint32_t);
+// 復号時の入れ子の上限（壊れたファイルでスタックを使い切らないため）
+constexpr int kMaxDepth = 64;
+
+void putU32(std::string& out, uint32_t v) { out.append(reinterpret_cast<const char*>(&v), sizeof v); }
+void putStr(std::string& out, const std::string& s) {
+    putU32(out, static_cast<uint32_t>(s.size()));
+    out.append(s);
+}
+
+class Reader {
+public:
+    Reader(const char* p, const char* end) : p_(p), end_(end) {}
+
+    bool ok() const { return ok_; }
+    const char* pos() const { return p_; }
+    size_t remaining() const { return static_cast<size_t>(end_ - p_); }
+
+    bool bytes(void* dst, size_t n) {
+        if (!ok_ || static_cast<size_t>(end_ - p_) < n) {
+            ok_ = false;
+            return false;
+        }
+        std::memcpy(dst, p_, n);
+        p_ += n;
+        return true;
+    }
+    uint8_t u8() { uint8_t v = 0; bytes(&v, sizeof v); return v; }
+    uint32_t u32() { uint32_t v = 0; bytes(&v, sizeof v); return v; }
+    uint64_t u64() { uint64_t v = 0; bytes(&v, sizeof v); return v; }
+    std::string str() {
+        uint32_t n = u32();
+        if (!ok_ || static_cast<size_t>(end_ - p_) < n) {
+            ok_ = false;
+            return std::string();
+        }
+        std::string s(p_, n);
+        p_ += n;
+        return s;
+    }
+
+    Value value(int depth = 0) {
+        if (depth > kMaxDepth) {
+            ok_ = false;
+            return Value();
+        }
+        switch (u8()) {
+            case 's': return Value(str());
+            case 'i': return Value(static_cast<int>(u32()));
+            case 'r': {
+                uint64_t bits = u64();
+                double d;
+                std::memcpy(&d, &bits, sizeof d);
+                return Value(d);
+            }
+            case 'a': {
+                uint32_t n = u32();
+                std::vector<Value> arr;
+                // 要素は最低 1 バイトなので、残りより多い個数は壊れている
+                if (!ok_ || n > remaining()) {
+                    ok_ = false;
+                    return Value();
+                }
+                arr.reserve(n);
+                for (uint32_t i = 0; i < n && ok_; ++i) arr.push_back(value(depth + 1));
+                return Value(std::move(arr));
+            }
+            case 'd': {
+                uint32_t n = u32();
+                std::map<std::string, Value> dict;
+                // 要素はキーの長さ 4 バイトと値の最低 1 バイト
+                if (!ok_ || n > remaining() / 5) {
+                    ok_ = false;
+                    return Value();
+                }
+                for (uint32_t i = 0; i < n && ok_; ++i) {
+                    std::string key = str();
+                    dict[key] = value(depth + 1);
+                }
+                return Value(dict);
+            }
+            case 'v':
+                return Value();
+            default:
+                ok_ = false;
+                return Value();
+        }
+    }
+
+private:
+    const char* p_;
+    const char* end_;
+    bool ok_ = true;
+};
+
+} // namespace
+
+void encodeValue(const Value& value, std::string& out) {
+    switch (value.getType()) {
+        case Value::Type::String:
+            out.push_back('s');
+            putStr(out, value.asString());
+            break;
+        case Value::Type::Integer:
+            out.push_back('i');
+            putU32(out, static_cast<uint32_t>(value.asInt()));
+            break;
+        case Value::Type::Real: {
+            double d = value.asReal();
+            uint64_t bits;
+            std::memcpy(&bits, &d, sizeof bits);
+            out.push_back('r');
+            out.append(reinterpret_cast<const char*>(&bits), sizeof bits);
+            break;
+        }
+        case Value::Type::Array: {
+            const auto& arr = value.asArray();
+            out.push_back('a');
+            putU32(out, static_cast<uint32_t>(arr.size()));
+            for (const auto& e : arr) encodeValue(e, out);
+            break;
+        }
+        case Value::Type::Dictionary: {
+            const auto& dict = value.asDict();
+            out.push_back('d');
+            putU32(out, static_cast<uint32_t>(dict.size()));
+            for (const auto& kv : dict) {
+                putStr(out, kv.first);
+                encodeValue(kv.second, out);
+            }
+            break;
+        }
+        default:
+            out.push_back('v');
+            break;
+    }
+}
+
+void beginSnapshot(std::string& out) {
+    out.append(kMagic, sizeof kMagic);
+    putU32(out, kFormatVersion);
+    putU32(out, 0);
+}
+
+void appendRecord(std::string& out, const std::string& name, const std::string& encodedValue) {
+    putStr(out, name);
+    out.append(encodedValue);
+}
+
+void setRecordCount(std::string& out, uint32_t count) {
+    std::memcpy(&out[sizeof kMagic + sizeof(uint32_t)], &count, sizeof count);
+}
+
+bool isSnapshot(const char* data, size_t size) {
+    return size >= sizeof kMagic && std::memcmp(data, kMagic, sizeof kMagic) == 0;
+}
+
+bool decode(const char* data, size_t size, std::vector<Record>& records) {
+    if (size < kHeaderSize || !isSnapshot(data, size)) return false;
+    Reader r(data + sizeof kMagic, data + size);
+    if (r.u32() != kFormatVersion) return false;
+    uint32_t count = r.u32();
+    // レコードは名前の長さ 4 バイトと値の最低 1 バイト。残りに収まらない個数は壊れている
+    if (!r.ok() || count > r.remaining() / 5) return false;
+    records.reserve(count);
+    for (uint32_t i = 0; i < count && r.ok(); ++i) {
+        Record rec;
+        rec.name = r.str();
+        const char* start = r.pos();
+        rec.value = r.value();
+        if (!r.ok()) break;
+        rec.encoded.assign(start, r.pos());
+        records.push_back(std::move(rec));
+    }
+    return r.ok();
+}
+
+bool writeAtomically(const std::string& path, const std::string& content) {
+    // 一時ファイル名はプロセスとスレッドごとに分け、同時に保存する別インスタンスと衝突させない
+    std::ostringstream tmpName;
+    tmpName << path << ".tmp." << ::getpid() << '.' << std::this_thread::get_id();
+    std::string tmp = tmpName.str();
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        out.write(content.data(), static_cast<std::streamsize>(content.size()));
+        if (!out) {
+            out.close();
+            std::remove(tmp.c_str());
+            return false;
+        }
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace var_snapshot
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Value.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// SAVEVAR / RESTOREVAR のバイナリスナップショット形式。
+///   header := "YVS1", u32 formatVersion, u32 recordCount
+///   record := str name, value
+///   value  := u8 tag, 本体（'s' str / 'i' u32 / 'r' u64（double のビット列）/
+///             'a' u32 count, value* / 'd' u32 count, (str, value)* / 'v' なし）
+///   str    := u32 byteLength, bytes
+/// 整数は書いたマシンのバイト順（DicCache と同じ。別アーキテクチャへは持ち出さない前提）。
+/// レコードの値部分は変数ごとに独立しているので、前回から変わっていない変数は
+/// 以前に符号化したバイト列をそのまま並べ直せる。
+namespace var_snapshot {
+
+struct Record {
+    std::string name;
+    Value value;
+    std::string encoded;  // value の符号化（再保存時にそのまま使える）
+};
+
+// 値を符号化して out に追記する
+void encodeValue(const Value& value, std::string& out);
+
+// レコード数 0 のヘッダを out に書き、setRecordCount で後から埋める
+void beginSnapshot(std::string& out);
+void appendRecord(std::string& out, const std::string& name, const std::string& encodedValue);
+void setRecordCount(std::string& out, uint32_t count);
+
+// 先頭がスナップショットのマジックか
+bool isSnapshot(const char* data, size_t size);
+
+// 全体を復号する。壊れていれば false（records は途中まで埋まっていることがある）
+bool decode(const char* data, size_t size, std::vector<Record>& records);
+
+// path + ".tmp.<pid>.<thread>" に書いてから rename する（書き込み途中で落ちても元のファイルが残る）
+bool writeAtomically(const std::string& path, const std::string& content);
+
+} // namespace var_snapshot
@@ -1,10 +1,12 @@
 #include "YayaCore.hpp"
+#include "Log.hpp"
 #include <iostream>
 #include <chrono>
 #include <unordered_set>
-#include <set>
+#include <string_view>
 #include <algorithm>
 #include <cctype>
+#include <fstream>
 
 using json = nlohmann::json;
 
@@ -18,7 +20,24 @@ std::string YayaCore::requestHostOperation(const std::string& type, const json&
     json request;
     request["host_op"] = type;
     request["params"] = params;
+
+    if (hostTransport_) {
+        return hostTransport_(request);
+    }
     
+    if (framing_ == shiori_frame::Framing::Binary) {
+        try {
+            shiori_frame::writeFrame(std::cout, shiori_frame::encode(request));
+            std::string payload;
+            if (shiori_frame::readFrame(std::cin, payload)) {
+                return shiori_frame::decode(payload).dump();
+            }
+        } catch (const std::exception& e) {
+            YAYA_LOG(Error, "[YayaCore] host_op frame error: " << e.what());
+        }
+        return "{}";
+    }
+
     // Send request to stdout for host to intercept
     std::cout << request.dump() << std::endl;
     std::cout.flush();
@@ -75,6 +94,22 @@ json YayaCore::pluginOperation(const std::string& op, const json& params) {
         };
     }
 
+    // プロセス内で呼べるものはここで済ませ、見つからない・開けないモジュールだけホストへ回す
+    if (saoriInProcess_) {
+        const std::string module = params.value("module", "");
+        if (op == "saori_load" && saoriHost_.load(module)) {
+            return json{{"ok", true}};
+        }
+        if (op == "saori_unload" && saoriHost_.unload(module)) {
+            return json{{"ok", true}};
+        }
+        std::string response;
+        if (op == "saori_request" &&
+            saoriHost_.request(module, params.value("request", ""), params.value("charset", "UTF-8"), response)) {
+            return json{{"ok", true}, {"response", std::move(response)}};
+        }
+    }
+
     return handlePluginOperation(op, params);
 }
 
@@ -107,6 +142,15 @@ json YayaCore::handlePluginOperation(const std::string& op, const json& params)
 }
 
 json YayaCore::fmoOperation(const std::string& op, const nlohmann::json& params) {
+    // 共有メモリがあればホストへ問い合わせずに読む（ホストが後から作る場合に備えて開き直す）
+    if (op == "read" && !fmoSegmentName_.empty()) {
+        if (fmoSegment_.isOpen() || fmoSegment_.open(fmoSegmentName_)) {
+            if (const std::string* snapshot = fmoSegment_.read()) {
+                return json{{"ok", true}, {"snapshot", *snapshot}};
+            }
+            YAYA_LOG(Debug, "[YayaCore] FMO segment busy, falling back to host_op");
+        }
+    }
     json req;
     req["operation"] = op;
     req["params"] = params;
@@ -127,11 +171,120 @@ bool YayaCore::dicUnload(const std::string& relativePath) {
 }
 
 std::string YayaCore::processCommand(const std::string &line) {
+    json req;
+    try {
+        req = json::parse(line);
+    } catch (const std::exception &e) {
+        json response;
+        response["ok"] = false;
+        response["status"] = 500;
+        response["error"] = e.what();
+        return response.dump();
+    }
+    return processRequest(req).dump();
+}
+
+// {"cmd":"profile","action":"start"|"stop"|"reset"|"dump"}
+// dump は "summary"（JSON 集計）と "collapsed"（folded 形式）を返し、
+// "summary_path" / "collapsed_path" があればそのファイルにも書く。
+json YayaCore::handleProfileCommand(const json& req) {
+    json response;
+    std::string action = req.value("action", "dump");
+    if (action == "start") {
+        if (!profiler_) profiler_ = std::make_unique<yaya_profile::Profiler>();
+        profiling_ = true;
+        dictManager.setProfiler(profiler_.get());
+    } else if (action == "stop") {
+        profiling_ = false;
+        dictManager.setProfiler(nullptr);
+    } else if (action == "reset") {
+        if (profiler_) profiler_->reset();
+    } else if (action == "dump") {
+        yaya_profile::Profiler empty;
+        const yaya_profile::Profiler& profiler = profiler_ ? *profiler_ : empty;
+        json summary = profiler.summary();
+        std::string collapsed = profiler.collapsed();
+        auto writeFile = [&](const char* key, const std::string& content) {
+            std::string path = req.value(key, "");
+            if (path.empty()) return true;
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            out << content;
+            if (!out) {
+                YAYA_LOG(Error, "[YayaCore] Failed to write profile output: " << path);
+                return false;
+            }
+            return true;
+        };
+        if (!writeFile("summary_path", summary.dump(2) + "\n") || !writeFile("collapsed_path", collapsed)) {
+            response["ok"] = false;
+            response["status"] = 500;
+            response["error"] = "failed to write profile output";
+            return response;
+        }
+        response["summary"] = std::move(summary);
+        if (req.value("include_collapsed", true)) response["collapsed"] = std::move(collapsed);
+    } else {
+        response["ok"] = false;
+        response["status"] = 400;
+        response["error"] = "unknown profile action: " + action;
+        return response;
+    }
+    response["ok"] = true;
+    response["status"] = 200;
+    response["profiling"] = profiling_;
+    return response;
+}
+
+// 予算の値（0 以上の整数）を読む。それ以外は警告して無視する
+static bool readBudget(const json& v, uint64_t& ticks) {
+    if (v.is_number_unsigned() || (v.is_number_integer() && v.get<int64_t>() >= 0)) {
+        ticks = v.get<uint64_t>();
+        return true;
+    }
+    YAYA_LOG(Warn, "[YayaCore] Ignoring invalid budget value: " << v.dump());
+    return false;
+}
+
+// "budget": N（すべてに同じ値）または
+// {"load": N, "request": N, "events": {"OnSecondChange": N, ...}}（省略した項目は 0 = 上限なし）
+void YayaCore::configureBudget(const json& config) {
+    budget_ = BudgetConfig();
+    if (config.is_null()) return;
+    if (!config.is_object()) {
+        uint64_t ticks = 0;
+        if (readBudget(config, ticks)) budget_.load = budget_.request = ticks;
+        return;
+    }
+    if (config.contains("load")) readBudget(config["load"], budget_.load);
+    if (config.contains("request")) readBudget(config["request"], budget_.request);
+    if (config.contains("events") && config["events"].is_object()) {
+        for (const auto& item : config["events"].items()) {
+            uint64_t ticks = 0;
+            if (readBudget(item.value(), ticks)) budget_.events[item.key()] = ticks;
+        }
+    }
+}
+
+json YayaCore::processRequest(const json& req) {
+    yaya_rng::Scope rngScope(rng_);
     json response;
     try {
-        auto req = json::parse(line);
         std::string cmd = req.value("cmd", "");
-        if (cmd == "load_messages") {
+        if (cmd == "handshake") {
+            // 以降の入出力の枠付けを選ぶ: "json"（JSON Lines、既定）または "binary"（ShioriFrame.hpp）
+            std::string framingName = req.value("framing", "json");
+            shiori_frame::Framing framing;
+            if (shiori_frame::parseFraming(framingName, framing)) {
+                framing_ = framing;
+                response["ok"] = true;
+                response["status"] = 200;
+                response["framing"] = framingName;
+            } else {
+                response["ok"] = false;
+                response["status"] = 400;
+                response["error"] = "unsupported framing: " + framingName;
+            }
+        } else if (cmd == "load_messages") {
             std::string messagePath = req.value("message_path", "");
 
             if (!messagePath.empty()) {
@@ -153,6 +306,49 @@ std::string YayaCore::processCommand(const std::string &line) {
             // Anchor relative paths (DICLOAD / SAVEVAR / DICUNLOAD) under the ghost root.
             dictManager.setGhostRoot(ghostRoot);
 
+            // 実行エンジン: "ast"（既定）または "bytecode"
+            std::string engine = req.value("engine", "ast");
+            dictManager.setEngine(engine == "bytecode" ? VM::Engine::Bytecode : VM::Engine::Ast);
+            // 登録前の定数畳み込み（false で無効。比較用）
+            dictManager.setOptimize(req.value("optimize", true));
+            // 構文木キャッシュの置き場所（省略時はキャッシュしない）
+            dictManager.setCacheDirectory(req.value("cache_dir", ""));
+            // 辞書の読み込み・パースに使うスレッド数（0 = CPU 数、省略時は 1 = 逐次）
+            dictManager.setJobs(req.value("jobs", 1));
+            // 実行予算（ループの 1 周・関数呼び出しの回数。省略時は 120 秒の時間制限だけ）
+            configureBudget(req.contains("budget") ? req["budget"] : json());
+            // ホストが FMO を公開する POSIX 共有メモリの名前（省略時は READFMO ごとに host_op で問い合わせる）
+            fmoSegmentName_ = req.value("fmo_segment", "");
+            fmoSegment_.close();
+            if (!fmoSegmentName_.empty() && !fmoSegment_.open(fmoSegmentName_)) {
+                YAYA_LOG(Info, "[YayaCore] FMO segment not available yet: " << fmoSegmentName_);
+            }
+            // SAORI をプロセス内で dlopen して呼ぶか（SaoriHost.hpp の ABI のモジュールだけ。省略時はホスト経由）。
+            // "saori_paths" は相対名がゴーストの下に無いときに探すディレクトリ
+            saoriInProcess_ = req.value("saori_in_process", false);
+            std::vector<std::string> saoriPaths;
+            if (req.contains("saori_paths") && req["saori_paths"].is_array()) {
+                for (const auto& path : req["saori_paths"]) {
+                    if (path.is_string() && !path.get<std::string>().empty()) saoriPaths.push_back(path.get<std::string>());
+                }
+            }
+            saoriHost_.configure(ghostRoot, saoriPaths);
+            // SHIORI3FW の request を VM 側で代行するか（標準の request のときだけ。省略時は辞書で解析する）
+            shiori3fwNative_ = req.value("shiori3fw_native", false);
+            // 診断ログ: "log_level"（off/error/warn/info/debug/trace、省略時は変更しない）と
+            // "log_async"（true ならリングバッファ経由でバックグラウンド出力）。プロセス全体に効く。
+            if (req.contains("log_level") || req.contains("log_async")) {
+                yaya_log::Level level = static_cast<yaya_log::Level>(yaya_log::g_level.load());
+                if (req.contains("log_level")) {
+                    const auto& v = req["log_level"];
+                    std::string name = v.is_string() ? v.get<std::string>() : v.dump();
+                    if (!yaya_log::parseLevel(name, level)) {
+                        YAYA_LOG(Warn, "[YayaCore] Unknown log_level '" << name << "', keeping current level");
+                    }
+                }
+                yaya_log::configure(level, req.value("log_async", false));
+            }
+
             // Build structured entries. Prefer "dic_entries" (per-dic encoding) over flat "dic".
             std::vector<DictionaryManager::DicEntry> dicEntries;
             bool usedStructured = false;
@@ -198,8 +394,15 @@ std::string YayaCore::processCommand(const std::string &line) {
                     if (!ghostPath.empty() && ghostPath.back() != '/') {
                         ghostPath += '/';
                     }
-                    std::cerr << "[YayaCore] Calling YAYA framework load() with path: " << ghostPath << std::endl;
+                    YAYA_LOG(Debug, "[YayaCore] Calling YAYA framework load() with path: " << ghostPath);
+                    yaya_profile::Profiler* profiler = activeProfiler();
+                    yaya_profile::Scope profile(profiler, profiler ? profiler->key(yaya_profile::Kind::Event, "load") : -1);
+                    dictManager.setBudget(budget_.load);
                     dictManager.execute("load", {ghostPath});
+                    // 辞書は読めているので load は成功のまま、打ち切られたことだけ知らせる
+                    if (dictManager.budgetExhausted()) {
+                        response["budget_exhausted"] = dictManager.budgetExhaustedIn();
+                    }
                 }
             }
         } else if (cmd == "request") {
@@ -208,55 +411,72 @@ std::string YayaCore::processCommand(const std::string &line) {
             std::string method = req.value("method", "GET");
             auto headers = req.value("headers", std::map<std::string, std::string>{});
 
-            std::cerr << "[YayaCore] Executing request: method=" << method << ", id=" << id << ", refs=" << refs.size() << std::endl;
+            YAYA_LOG(Debug, "[YayaCore] Executing request: method=" << method << ", id=" << id << ", refs=" << refs.size());
             auto exec_start = std::chrono::steady_clock::now();
+            yaya_profile::Profiler* profiler = activeProfiler();
+            yaya_profile::Scope profile(profiler, profiler ? profiler->key(yaya_profile::Kind::Event, id) : -1);
+
+            // 実行予算: 要求の "budget" > イベントごとの設定 > 既定
+            uint64_t budget = budget_.request;
+            auto eventBudget = budget_.events.find(id);
+            if (eventBudget != budget_.events.end()) budget = eventBudget->second;
+            if (req.contains("budget")) readBudget(req["budget"], budget);
+            dictManager.setBudget(budget);
 
             // Build raw SHIORI protocol request to pass through YAYA framework's `request` function.
             // The framework parses this text to set SHIORI3FW.* variables and dispatch to SHIORI3EV.* handlers.
             // Phase 9: include UKADOC headers. Deduplication is case-insensitive and the
             // `ref` array is overlaid on top of any Reference* present in `headers`.
-            std::string shioriReq = method + " SHIORI/3.0\r\n";
+            // ヘッダは要求文字列と同じ順序の並びとしても持つ（shiori3fw_native で VM に直接渡す）。
             auto lower = [](std::string s) {
                 std::transform(s.begin(), s.end(), s.begin(),
                                [](unsigned char c) { return std::tolower(c); });
                 return s;
             };
-            // Case-insensitive lookup of a header value in the caller map.
-            auto findCI = [&](const std::string& key) -> const std::string* {
-                for (const auto& kv : headers) {
-                    if (lower(kv.first) == lower(key)) return &kv.second;
+            // 呼び出し元のヘッダ名は一度だけ小文字にする（同じ小文字名では先に並ぶものを使う）
+            std::vector<std::string> headerLower;
+            headerLower.reserve(headers.size());
+            for (const auto& kv : headers) headerLower.push_back(lower(kv.first));
+            auto findCI = [&](const char* key) -> const std::string* {
+                auto kv = headers.begin();
+                for (size_t i = 0; i < headerLower.size(); ++i, ++kv) {
+                    if (headerLower[i] == key) return &kv->second;
                 }
                 return nullptr;
             };
-            auto emitCI = [&](const std::string& key, const std::string& val) {
-                shioriReq += key + ": " + val + "\r\n";
-            };
-            auto emitDefault = [&](const std::string& key, const std::string& val) {
-                if (!findCI(key)) emitCI(key, val);
+            VM::ShioriHeaders requestHeaders;
+            requestHeaders.reserve(headers.size() + refs.size() + 5);
+            auto emitDefault = [&](const char* key, const char* lowerKey, const char* val) {
+                if (!findCI(lowerKey)) requestHeaders.emplace_back(key, val);
             };
-            emitDefault("Charset", "UTF-8");
-            emitDefault("Sender", "Ourin");
-            emitDefault("SenderType", "Plugin");
-            emitDefault("SecurityLevel", "local");
+            emitDefault("Charset", "charset", "UTF-8");
+            emitDefault("Sender", "sender", "Ourin");
+            emitDefault("SenderType", "sendertype", "Plugin");
+            emitDefault("SecurityLevel", "securitylevel", "local");
             // ID: prefer caller-supplied value, else the `id` argument.
-            if (const std::string* idHdr = findCI("ID")) emitCI("ID", *idHdr);
-            else emitCI("ID", id);
+            const std::string* idHdr = findCI("id");
+            requestHeaders.emplace_back("ID", idHdr ? *idHdr : id);
 
             // Emit every caller header once (except ID, already emitted above),
             // case-insensitively deduplicated. This includes Status, BaseID,
             // SecurityOrigin, X-SSTP-PassThru-*, and Reference* from headers.
-            std::set<std::string> emittedLower;
+            std::unordered_set<std::string> emittedLower;
             emittedLower.insert("id");
-            for (const auto& kv : headers) {
-                std::string kl = lower(kv.first);
-                if (emittedLower.count(kl)) continue;
-                emittedLower.insert(kl);
-                emitCI(kv.first, kv.second);
+            {
+                auto kv = headers.begin();
+                for (size_t i = 0; i < headerLower.size(); ++i, ++kv) {
+                    if (emittedLower.insert(headerLower[i]).second) requestHeaders.emplace_back(kv->first, kv->second);
+                }
             }
             // Overlay the `ref` array: it overrides Reference* from headers and
             // extends to higher indices.
             for (size_t i = 0; i < refs.size(); i++) {
-                emitCI("Reference" + std::to_string(i), refs[i]);
+                requestHeaders.emplace_back("Reference" + std::to_string(i), refs[i]);
+            }
+
+            std::string shioriReq = method + " SHIORI/3.0\r\n";
+            for (const auto& kv : requestHeaders) {
+                shioriReq.append(kv.first).append(": ").append(kv.second).append("\r\n");
             }
             shioriReq += "\r\n";
 
@@ -269,50 +489,47 @@ std::string YayaCore::processCommand(const std::string &line) {
             // Try YAYA framework's `request` function first (handles event dispatch, SHIORI3FW.* setup)
             bool usedFramework = false;
             if (dictManager.hasFunction("request")) {
-                std::string raw = dictManager.execute("request", {shioriReq});
+                std::string raw;
+                const bool native = shiori3fwNative_ &&
+                    dictManager.executeShioriRequest(method, requestHeaders, shioriReq, raw);
+                if (!native) raw = dictManager.execute("request", {shioriReq});
                 usedFramework = true;
                 // The YAYA framework returns a full SHIORI protocol response:
                 //   "SHIORI/3.0 200 OK\r\nValue: <script>\r\nReference0: ...\r\n\r\n"
                 // ヘッダ単位でパースする（"Value: " の部分文字列検索は本文中の同文字列を誤検出するため行わない）。
-                size_t lineStart = 0;
+                std::string_view rest(raw);
                 bool firstLine = true;
-                while (lineStart <= raw.size()) {
-                    size_t lineEnd = raw.find("\r\n", lineStart);
-                    std::string line;
-                    if (lineEnd == std::string::npos) {
-                        line = raw.substr(lineStart);
-                        lineStart = raw.size() + 1;
-                    } else {
-                        line = raw.substr(lineStart, lineEnd - lineStart);
-                        lineStart = lineEnd + 2;
-                    }
+                while (true) {
+                    size_t lineEnd = rest.find("\r\n");
+                    std::string_view line = rest.substr(0, lineEnd);
                     if (line.empty()) break; // 空行 = ヘッダ終端
+                    rest = (lineEnd == std::string_view::npos) ? std::string_view() : rest.substr(lineEnd + 2);
                     if (firstLine) {
                         firstLine = false;
                         // "SHIORI/3.0 200 OK" からステータスコードを取り出す
                         auto sp1 = line.find(' ');
-                        if (sp1 != std::string::npos) {
+                        if (sp1 != std::string_view::npos) {
                             auto sp2 = line.find(' ', sp1 + 1);
-                            std::string codeStr = (sp2 == std::string::npos)
-                                ? line.substr(sp1 + 1)
-                                : line.substr(sp1 + 1, sp2 - sp1 - 1);
+                            std::string codeStr(line.substr(sp1 + 1, sp2 == std::string_view::npos ? std::string_view::npos
+                                                                                                     : sp2 - sp1 - 1));
                             try { shioriStatus = std::stoi(codeStr); } catch (...) {}
                         }
                         continue;
                     }
                     auto colon = line.find(':');
-                    if (colon == std::string::npos) continue;
-                    std::string key = line.substr(0, colon);
-                    std::string val = line.substr(colon + 1);
+                    if (colon == std::string_view::npos) continue;
+                    std::string key(line.substr(0, colon));
+                    std::string_view val = line.substr(colon + 1);
                     // 先頭の空白を1つだけ除去（"Key: Value" 形式）
-                    if (!val.empty() && val.front() == ' ') val.erase(0, 1);
+                    if (!val.empty() && val.front() == ' ') val.remove_prefix(1);
                     if (key == "Value") {
                         value = val;
                     }
-                    shioriHeaders[key] = val;
+                    shioriHeaders[key] = std::string(val);
                 }
-                std::cerr << "[YayaCore] Used YAYA framework request() dispatcher (status="
-                          << shioriStatus << ", headers=" << shioriHeaders.size() << ")" << std::endl;
+                YAYA_LOG(Debug, "[YayaCore] Used YAYA framework request() dispatcher (status="
+                                << shioriStatus << ", headers=" << shioriHeaders.size()
+                                << (native ? ", native" : "") << ")");
 
                 // Some framework scripts can currently evaluate to a malformed empty
                 // response while the actual event function exists. Recover the script
@@ -320,10 +537,11 @@ std::string YayaCore::processCommand(const std::string &line) {
                 // greeting.
                 if ((method == "GET" || method == "get") &&
                     shioriStatus == 0 &&
+                    !dictManager.budgetExhausted() &&
                     value.empty() &&
                     dictManager.hasFunction(id)) {
-                    std::cerr << "[YayaCore] Framework returned an empty malformed GET response; "
-                              << "falling back to direct event call: " << id << std::endl;
+                    YAYA_LOG(Warn, "[YayaCore] Framework returned an empty malformed GET response; "
+                                   << "falling back to direct event call: " << id);
                     value = dictManager.execute(id, refs);
                     if (!value.empty()) {
                         shioriStatus = 200;
@@ -333,16 +551,28 @@ std::string YayaCore::processCommand(const std::string &line) {
             } else {
                 // Fallback: call function directly (for simple ghosts without YAYA framework)
                 value = dictManager.execute(id, refs);
-                std::cerr << "[YayaCore] Direct function call (no YAYA framework)" << std::endl;
+                YAYA_LOG(Debug, "[YayaCore] Direct function call (no YAYA framework)");
             }
 
             auto exec_end = std::chrono::steady_clock::now();
             auto exec_duration = std::chrono::duration_cast<std::chrono::milliseconds>(exec_end - exec_start).count();
-            std::cerr << "[YayaCore] Request completed: id=" << id << ", took " << exec_duration << "ms, result length=" << value.length() << std::endl;
+            YAYA_LOG(Info, "[YayaCore] Request completed: id=" << id << ", took " << exec_duration << "ms, result length=" << value.length());
 
             if (value.length() > 0) {
-                std::string preview = value.substr(0, std::min(size_t(200), value.length()));
-                std::cerr << "[YayaCore] Result preview (raw): " << preview << std::endl;
+                YAYA_LOG(Debug, "[YayaCore] Result preview (raw): " << value.substr(0, std::min(size_t(200), value.length())));
+            }
+
+            // 予算切れで打ち切った要求は SHIORI の 500 として返す（途中までのスクリプトは返さない）
+            if (dictManager.budgetExhausted()) {
+                std::string function = dictManager.budgetExhaustedIn();
+                YAYA_LOG(Warn, "[YayaCore] Request aborted: id=" << id << ", budget exhausted in " << function);
+                shioriHeaders.erase("Value");
+                response["ok"] = false;
+                response["status"] = 500;
+                response["headers"] = shioriHeaders;
+                response["error"] = "execution budget exhausted";
+                response["budget_exhausted"] = function;
+                return response;
             }
 
             response["ok"] = true;
@@ -370,6 +600,8 @@ std::string YayaCore::processCommand(const std::string &line) {
                 response["status"] = (usedFramework && shioriStatus > 0) ? shioriStatus : 200;
                 response["value"] = value;
             }
+        } else if (cmd == "profile") {
+            response = handleProfileCommand(req);
         } else if (cmd == "get_loaded_dics") {
             const auto& loadedFiles = dictManager.getLoadedDicFiles();
             response["ok"] = true;
@@ -378,10 +610,15 @@ std::string YayaCore::processCommand(const std::string &line) {
         } else if (cmd == "unload") {
             // Call YAYA framework's `unload` function before teardown
             if (dictManager.hasFunction("unload")) {
-                std::cerr << "[YayaCore] Calling YAYA framework unload()" << std::endl;
+                YAYA_LOG(Debug, "[YayaCore] Calling YAYA framework unload()");
+                yaya_profile::Profiler* profiler = activeProfiler();
+                yaya_profile::Scope profile(profiler, profiler ? profiler->key(yaya_profile::Kind::Event, "unload") : -1);
+                dictManager.setBudget(budget_.load);
                 dictManager.execute("unload", {});
             }
             dictManager.unload();
+            saoriHost_.unloadAll();
+            yaya_log::flush();
             response["ok"] = true;
             response["status"] = 200;
         } else {
@@ -394,5 +631,5 @@ std::string YayaCore::processCommand(const std::string &line) {
         response["status"] = 500;
         response["error"] = e.what();
     }
-    return response.dump();
+    return response;
 }
@@ -1,15 +1,34 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
 #include <string>
+#include <unordered_map>
 #include <nlohmann/json.hpp>
 #include "DictionaryManager.hpp"
+#include "FmoSegment.hpp"
 #include "MessageManager.hpp"
+#include "Profiler.hpp"
+#include "SaoriHost.hpp"
+#include "ShioriFrame.hpp"
 #include "VM.hpp"
 
 class YayaCore : public VMCallback {
 public:
     YayaCore();
     std::string processCommand(const std::string &line);
+    // 解析済みの要求を処理して応答を返す（processCommand の本体）
+    nlohmann::json processRequest(const nlohmann::json& req);
+
+    // host_op の送受信を差し替える（マルチインスタンスモードで InstanceHost が設定）。
+    // 未設定なら stdout へ要求を書き、stdin から応答を 1 行読む。
+    using HostTransport = std::function<std::string(const nlohmann::json&)>;
+    void setHostTransport(HostTransport transport) { hostTransport_ = std::move(transport); }
+
+    // stdin/stdout の枠付け。"handshake" コマンドで切り替わる（応答は切り替え前の形式で返す）
+    shiori_frame::Framing framing() const { return framing_; }
     
     // VMCallback interface
     nlohmann::json fileOperation(const std::string& op, const nlohmann::json& params) override;
@@ -24,6 +43,32 @@ public:
 private:
     DictionaryManager dictManager;
     MessageManager messageManager;
+    HostTransport hostTransport_;
+    shiori_frame::Framing framing_ = shiori_frame::Framing::JsonLines;
+    // このインスタンスの RAND/ANY/SRAND 用乱数エンジン（要求の処理中だけ yaya_rng に設定する）
+    std::mt19937 rng_{std::random_device{}()};
+    // "profile" コマンドの計測結果（stop 後も dump / reset まで残す）。profiling_ の間だけ VM に付ける
+    std::unique_ptr<yaya_profile::Profiler> profiler_;
+    bool profiling_ = false;
+    // 実行予算（VM::setBudget）。"load" の "budget" で設定し、"request" の "budget" でその要求だけ上書きできる
+    struct BudgetConfig {
+        uint64_t load = 0;     // load() / unload()
+        uint64_t request = 0;  // events に無いイベント
+        std::unordered_map<std::string, uint64_t> events;
+    };
+    BudgetConfig budget_;
+    // "load" の "fmo_segment" で指定されたホストの FMO 共有メモリ（READFMO はまずここを読む）
+    std::string fmoSegmentName_;
+    fmo_segment::Reader fmoSegment_;
+    // "load" の "saori_in_process" が true なら SAORI をプロセス内で呼ぶ（扱えないものはホスト経由）
+    bool saoriInProcess_ = false;
+    SaoriHost saoriHost_;
+    // "load" の "shiori3fw_native" が true なら、標準の SHIORI3FW request を要求文字列の解析なしで行う
+    // （VM::executeShioriRequest。request が上書きされているゴーストでは従来どおり）
+    bool shiori3fwNative_ = false;
+    void configureBudget(const nlohmann::json& config);
+    yaya_profile::Profiler* activeProfiler() const { return profiling_ ? profiler_.get() : nullptr; }
+    nlohmann::json handleProfileCommand(const nlohmann::json& req);
     std::string requestHostOperation(const std::string& type, const nlohmann::json& params);
     nlohmann::json handlePluginOperation(const std::string& op, const nlohmann::json& params);
 };
@@ -1,11 +1,44 @@
+#include <cstdlib>
 #include <iostream>
 #include <string>
+#include "InstanceHost.hpp"
+#include "ShioriFrame.hpp"
 #include "YayaCore.hpp"
 
-int main() {
+int main(int argc, char* argv[]) {
+    // --workers N: マルチインスタンスモード（要求の "instance" ごとに独立した VM を N スレッドで処理）
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::string(argv[i]) == "--workers") {
+            InstanceHost host(std::atoi(argv[i + 1]));
+            host.run(std::cin, std::cout);
+            return 0;
+        }
+    }
+
     YayaCore core;
-    std::string line;
-    while (std::getline(std::cin, line)) {
+    for (;;) {
+        if (core.framing() == shiori_frame::Framing::Binary) {
+            nlohmann::json response;
+            try {
+                std::string payload;
+                if (!shiori_frame::readFrame(std::cin, payload)) break;
+                response = core.processRequest(shiori_frame::decode(payload));
+            } catch (const std::exception& e) {
+                response["ok"] = false;
+                response["status"] = 500;
+                response["error"] = e.what();
+                // 枠が読めなくなった入力は回復できない
+                if (!std::cin) {
+                    shiori_frame::writeFrame(std::cout, shiori_frame::encode(response));
+                    break;
+                }
+            }
+            shiori_frame::writeFrame(std::cout, shiori_frame::encode(response));
+            continue;
+        }
+
+        std::string line;
+        if (!std::getline(std::cin, line)) break;
         auto response = core.processCommand(line);
         std::cout << response << std::endl;
     }